@@ -0,0 +1,545 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file Benchmark.cpp
+ * \brief Runs the scenes of the benchmark suite and compares the results
+ * with a baseline.
+ *
+ */
+
+#include "Benchmark.h"
+#include "Scene.h"
+
+#include <lib_manager/LibManager.hpp>
+#include <mars/cfg_manager/CFGManagerInterface.h>
+#include <mars/data_broker/DataBrokerInterface.h>
+#include <mars/interfaces/sim/SimulatorInterface.h>
+#include <mars/interfaces/sim/ControlCenter.h>
+#include <mars/interfaces/sim/Checkpoint.h>
+#include <mars/interfaces/sim/NodeManagerInterface.h>
+#include <mars/interfaces/sim/JointManagerInterface.h>
+#include <mars/interfaces/sim/MotorManagerInterface.h>
+#include <mars/interfaces/sim/SensorManagerInterface.h>
+#include <mars/interfaces/sim/ControllerManagerInterface.h>
+#include <mars/interfaces/graphics/GraphicsManagerInterface.h>
+#include <mars/utils/misc.h>
+#include <configmaps/ConfigData.h>
+
+#include <cstdlib>
+#include <cstring>
+
+#ifndef WIN32
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <csignal>
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+namespace mars {
+  namespace benchmark {
+
+    using namespace mars::interfaces;
+
+    // steps the scene runs before the checkpoint of a reset benchmark
+    static const int warmupSteps = 100;
+    // steps of one episode between two resets
+    static const int episodeSteps = 50;
+    // full scene reloads the restores are compared with
+    static const int reloads = 5;
+
+#ifndef WIN32
+    // name of the running scene for onTimeout()
+    static char runningScene[128];
+
+    static void onTimeout(int) {
+      // only async-signal-safe calls
+      static const char msg[] = "benchmark: timed out in scene ";
+      ssize_t n = write(2, msg, sizeof(msg)-1);
+      n = write(2, runningScene, strlen(runningScene));
+      n = write(2, "\n", 1);
+      (void)n;
+      _exit(3);
+    }
+#endif
+
+#ifndef WIN32
+    /// removes \c path and everything in it
+    static void removeTree(const std::string &path) {
+      DIR *dir = opendir(path.c_str());
+      if(dir) {
+        struct dirent *entry;
+        while((entry = readdir(dir))) {
+          std::string name = entry->d_name;
+          if(name == "." || name == "..") continue;
+          std::string child = path + "/" + name;
+          struct stat info;
+          if(lstat(child.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+            removeTree(child);
+          }
+          else {
+            unlink(child.c_str());
+          }
+        }
+        closedir(dir);
+      }
+      rmdir(path.c_str());
+    }
+#endif
+
+    static void resetPeakRss() {
+#ifdef __linux__
+      // writing 5 resets the peak resident set size (VmHWM) of the process,
+      // thus every scene gets its own peak
+      FILE *file = fopen("/proc/self/clear_refs", "w");
+      if(file) {
+        fputs("5", file);
+        fclose(file);
+      }
+#endif
+    }
+
+    /// \return the peak resident set size in kB
+    static long getPeakRss() {
+#ifdef __linux__
+      FILE *file = fopen("/proc/self/status", "r");
+      if(file) {
+        char line[256];
+        long rss = -1;
+        while(fgets(line, sizeof(line), file)) {
+          if(sscanf(line, "VmHWM: %ld kB", &rss) == 1) break;
+        }
+        fclose(file);
+        if(rss >= 0) return rss;
+      }
+#endif
+#ifndef WIN32
+      // the peak of the whole process run
+      struct rusage usage;
+      if(getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        return usage.ru_maxrss / 1024;
+#else
+        return usage.ru_maxrss;
+#endif
+      }
+#endif
+      return 0;
+    }
+
+    Benchmark::Benchmark(bool graphics)
+      : graphics(graphics), timeout(0), libManager(NULL), control(NULL), sim(NULL),
+        simTime(0.0), renderSum(0.0) {
+    }
+
+    Benchmark::~Benchmark() {
+      stopSimulation();
+    }
+
+    BenchmarkResult Benchmark::run(Scene *scene, int size, int steps) {
+      BenchmarkResult result;
+      result.name = scene->getName();
+      result.size = size > 0 ? size : scene->getDefaultSize();
+      result.steps = steps;
+
+#ifndef WIN32
+      if(timeout > 0) {
+        strncpy(runningScene, result.name.c_str(), sizeof(runningScene)-1);
+        signal(SIGALRM, onTimeout);
+        alarm(timeout);
+      }
+#endif
+      if(scene->needsGraphics() && !graphics) {
+        result.skipped = true;
+        result.skipReason = "needs the graphics, run with --graphics";
+      }
+      else if(!scene->isAvailable(&result.skipReason)) {
+        result.skipped = true;
+      }
+      else if(!startSimulation(scene, &result.skipReason)) {
+        result.skipped = true;
+      }
+      else if(!scene->build(control, result.size)) {
+        result.skipped = true;
+        result.skipReason = "could not build the scene";
+      }
+      else {
+        fprintf(stderr, "benchmark: %s (size %d)\n", result.name.c_str(),
+                result.size);
+        if(scene->measuresResets()) runResets(scene, &result);
+        else runSteps(scene, &result);
+      }
+      stopSimulation();
+#ifndef WIN32
+      alarm(0);
+#endif
+
+      if(result.skipped) {
+        fprintf(stderr, "benchmark: skipped %s: %s\n", result.name.c_str(),
+                result.skipReason.c_str());
+      }
+      return result;
+    }
+
+    bool Benchmark::startSimulation(Scene *scene, std::string *error) {
+      libManager = new lib_manager::LibManager();
+      simTime = 0.0;
+      phaseNames.clear();
+      phaseSums.clear();
+      renderSum = 0.0;
+
+      libManager->loadLibrary("cfg_manager");
+      cfg_manager::CFGManagerInterface *cfg;
+      cfg = libManager->getLibraryAs<cfg_manager::CFGManagerInterface>("cfg_manager");
+      if(!cfg) {
+        *error = "could not load cfg_manager";
+        return false;
+      }
+      loadedLibs.push_back("cfg_manager");
+#ifndef WIN32
+      // the Simulator and the cfg_manager save their configuration on
+      // shutdown, keep it out of the working directory
+      char dir[] = "/tmp/mars_benchmark_XXXXXX";
+      if(!mkdtemp(dir)) {
+        *error = "could not create a temporary config directory";
+        return false;
+      }
+      configDir = dir;
+      cfg->getOrCreateProperty("Config", "config_path", configDir);
+#endif
+      // the properties are read by the Simulator in runSimulation
+      cfg->getOrCreateProperty("Simulator", "deterministic", true);
+      cfg->getOrCreateProperty("Simulator", "profile steps", true);
+      cfg->getOrCreateProperty("Simulator", "hash every step", false);
+
+      libManager->loadLibrary("data_broker");
+      if(graphics) {
+        libManager->loadLibrary("mars_graphics");
+        GraphicsManagerInterface *g;
+        g = libManager->getLibraryAs<GraphicsManagerInterface>("mars_graphics");
+        if(!g) {
+          *error = "could not load mars_graphics";
+          return false;
+        }
+        loadedLibs.push_back("mars_graphics");
+        g->initializeOSG(NULL, false);
+      }
+      libManager->loadLibrary("mars_sim");
+      sim = libManager->getLibraryAs<SimulatorInterface>("mars_sim");
+      if(!sim) {
+        *error = "could not load mars_sim";
+        return false;
+      }
+      loadedLibs.push_back("mars_sim");
+
+      std::vector<std::string> libs = scene->getLibraries();
+      for(size_t i=0; i<libs.size(); ++i) {
+        if(libManager->loadLibrary(libs[i], NULL, true) !=
+           lib_manager::LibManager::LIBMGR_NO_ERROR) {
+          *error = "could not load " + libs[i];
+          return false;
+        }
+      }
+
+      control = sim->getControlCenter();
+      sim->runSimulation(false);
+      if(!control->dataBroker) {
+        *error = "could not load data_broker";
+        return false;
+      }
+      control->dataBroker->registerSyncReceiver(this, "mars_sim", "stepTimes");
+      return true;
+    }
+
+    void Benchmark::stopSimulation() {
+      if(!libManager) return;
+      if(control && control->dataBroker) {
+        control->dataBroker->unregisterSyncReceiver(this, "mars_sim",
+                                                    "stepTimes");
+      }
+      while(!loadedLibs.empty()) {
+        libManager->releaseLibrary(loadedLibs.back());
+        loadedLibs.pop_back();
+      }
+      delete libManager;
+      libManager = NULL;
+      control = NULL;
+      sim = NULL;
+#ifndef WIN32
+      if(!configDir.empty()) {
+        removeTree(configDir);
+        configDir.clear();
+      }
+#endif
+    }
+
+    /// hash of the full simulation state, like the Simulator's state hash
+    unsigned long long Benchmark::hashState() {
+      Checkpoint checkpoint;
+      sim->saveCheckpoint(&checkpoint);
+      return checkpoint.hash();
+    }
+
+    void Benchmark::step(Scene *scene) {
+      scene->update(control, simTime);
+      sim->step();
+      simTime += sim->getCalcMs();
+      if(control->graphics) {
+        long long start = utils::getTimeMicro();
+        control->graphics->draw();
+        renderSum += (utils::getTimeMicro() - start)*0.001;
+      }
+    }
+
+    void Benchmark::runSteps(Scene *scene, BenchmarkResult *result) {
+      resetPeakRss();
+      long long start = utils::getTimeMicro();
+      for(int i=0; i<result->steps; ++i) {
+        step(scene);
+      }
+      result->wallTime = (utils::getTimeMicro() - start)*0.000001;
+      result->peakRss = getPeakRss();
+      result->stateHash = hashState();
+      if(result->wallTime > 0.0) {
+        result->stepsPerSecond = result->steps / result->wallTime;
+      }
+      for(size_t i=0; i<phaseNames.size(); ++i) {
+        result->phases[phaseNames[i]] = phaseSums[i] / result->steps;
+      }
+      if(control->graphics) {
+        result->phases["render"] = renderSum / result->steps;
+      }
+    }
+
+    /**
+     * \brief Runs short episodes that all start from the same checkpoint,
+     * like a learning experiment does. Every episode has to end in the same
+     * state, otherwise the checkpoint does not restore the full state.
+     *
+     * Afterwards the scene is reloaded a few times the way resetSim() does
+     * it, to compare the restore with the reset it replaces.
+     */
+    void Benchmark::runResets(Scene *scene, BenchmarkResult *result) {
+      for(int i=0; i<warmupSteps; ++i) {
+        step(scene);
+      }
+      Checkpoint checkpoint;
+      sim->saveCheckpoint(&checkpoint);
+      double checkpointTime = simTime;
+      phaseNames.clear();
+      phaseSums.clear();
+      renderSum = 0.0;
+
+      result->resets = result->steps / episodeSteps;
+      if(result->resets < 1) result->resets = 1;
+      result->steps = result->resets*episodeSteps;
+
+      resetPeakRss();
+      double restoreSum = 0.0;
+      long long hashSum = 0;
+      long long start = utils::getTimeMicro();
+      for(int i=0; i<result->resets; ++i) {
+        long long restoreStart = utils::getTimeMicro();
+        if(!sim->restoreCheckpoint(&checkpoint)) {
+          result->skipped = true;
+          result->skipReason = "restoreCheckpoint failed";
+          return;
+        }
+        restoreSum += (utils::getTimeMicro() - restoreStart)*0.001;
+        simTime = checkpointTime;
+        for(int k=0; k<episodeSteps; ++k) {
+          step(scene);
+        }
+        // the hashing is not part of the measured time
+        long long hashStart = utils::getTimeMicro();
+        unsigned long long hash = hashState();
+        hashSum += utils::getTimeMicro() - hashStart;
+        if(i == 0) result->stateHash = hash;
+        else if(hash != result->stateHash) {
+          result->resetsReproducible = false;
+        }
+      }
+      result->wallTime = (utils::getTimeMicro() - start - hashSum)*0.000001;
+      result->peakRss = getPeakRss();
+      result->restoreTime = restoreSum / result->resets;
+      if(result->wallTime > 0.0) {
+        result->resetsPerSecond = result->resets / result->wallTime;
+        result->stepsPerSecond = result->steps / result->wallTime;
+      }
+      for(size_t i=0; i<phaseNames.size(); ++i) {
+        result->phases[phaseNames[i]] = phaseSums[i] / result->steps;
+      }
+      if(control->graphics) {
+        result->phases["render"] = renderSum / result->steps;
+      }
+
+      // the body of the reload in Simulator::run(), without its thread
+      start = utils::getTimeMicro();
+      for(int i=0; i<reloads; ++i) {
+        sim->newWorld();
+        control->nodes->reloadNodes(false);
+        control->joints->reloadJoints();
+        control->motors->reloadMotors();
+        control->sensors->reloadSensors();
+        control->controllers->resetControllerData();
+      }
+      result->reloadTime = (utils::getTimeMicro() - start)*0.001 / reloads;
+    }
+
+    void Benchmark::receiveData(const data_broker::DataInfo &info,
+                                const data_broker::DataPackage &package,
+                                int callbackParam) {
+      if(phaseNames.empty()) {
+        for(size_t i=0; i<package.size(); ++i) {
+          phaseNames.push_back(package[i].name);
+        }
+        phaseSums.resize(package.size(), 0.0);
+      }
+      for(size_t i=0; i<package.size() && i<phaseSums.size(); ++i) {
+        phaseSums[i] += package[i].d;
+      }
+    }
+
+    static std::string escape(const std::string &s) {
+      std::string out;
+      for(size_t i=0; i<s.size(); ++i) {
+        if(s[i] == '"' || s[i] == '\\') out += '\\';
+        out += s[i];
+      }
+      return out;
+    }
+
+    void writeResults(FILE *file, const std::vector<BenchmarkResult> &results) {
+      fprintf(file, "{\n  \"results\": [");
+      for(size_t i=0; i<results.size(); ++i) {
+        const BenchmarkResult &r = results[i];
+        fprintf(file, "%s\n    {\n", i ? "," : "");
+        fprintf(file, "      \"name\": \"%s\",\n", escape(r.name).c_str());
+        fprintf(file, "      \"size\": %d,\n", r.size);
+        if(r.skipped) {
+          fprintf(file, "      \"skipped\": true,\n");
+          fprintf(file, "      \"skip_reason\": \"%s\"\n    }",
+                  escape(r.skipReason).c_str());
+          continue;
+        }
+        fprintf(file, "      \"skipped\": false,\n");
+        fprintf(file, "      \"steps\": %d,\n", r.steps);
+        fprintf(file, "      \"wall_s\": %.6f,\n", r.wallTime);
+        fprintf(file, "      \"steps_per_sec\": %.3f,\n", r.stepsPerSecond);
+        fprintf(file, "      \"phases_ms\": {");
+        std::map<std::string, double>::const_iterator it;
+        for(it=r.phases.begin(); it!=r.phases.end(); ++it) {
+          fprintf(file, "%s\"%s\": %.6f", it==r.phases.begin() ? "" : ", ",
+                  escape(it->first).c_str(), it->second);
+        }
+        fprintf(file, "},\n");
+        if(r.resets) {
+          fprintf(file, "      \"resets\": %d,\n", r.resets);
+          fprintf(file, "      \"resets_per_sec\": %.3f,\n", r.resetsPerSecond);
+          fprintf(file, "      \"restore_ms\": %.6f,\n", r.restoreTime);
+          fprintf(file, "      \"reload_ms\": %.6f,\n", r.reloadTime);
+          fprintf(file, "      \"resets_reproducible\": %s,\n",
+                  r.resetsReproducible ? "true" : "false");
+        }
+        fprintf(file, "      \"peak_rss_kb\": %ld,\n", r.peakRss);
+        // as string, 64 bit integers do not survive every JSON parser
+        fprintf(file, "      \"state_hash\": \"%016llx\"\n    }", r.stateHash);
+      }
+      fprintf(file, "\n  ]\n}\n");
+    }
+
+    int compareResults(const std::string &baselineFile,
+                       const std::vector<BenchmarkResult> &results,
+                       double tolerance) {
+      if(!utils::pathExists(baselineFile)) {
+        fprintf(stderr, "benchmark: baseline \"%s\" not found\n",
+                baselineFile.c_str());
+        return -1;
+      }
+      // JSON is a subset of YAML
+      configmaps::ConfigMap baseline;
+      baseline = configmaps::ConfigMap::fromYamlFile(baselineFile);
+      if(!baseline.hasKey("results")) {
+        fprintf(stderr, "benchmark: baseline \"%s\" contains no results\n",
+                baselineFile.c_str());
+        return -1;
+      }
+
+      int regressions = 0;
+      for(size_t i=0; i<results.size(); ++i) {
+        const BenchmarkResult &r = results[i];
+        if(r.skipped) continue;
+        configmaps::ConfigVector::iterator it;
+        for(it=baseline["results"].begin(); it!=baseline["results"].end();
+            ++it) {
+          if((std::string)(*it)["name"] == r.name) break;
+        }
+        if(it == baseline["results"].end() || (bool)(*it)["skipped"]) {
+          fprintf(stderr, "benchmark: %s: not in the baseline\n",
+                  r.name.c_str());
+          continue;
+        }
+        if((int)(*it)["size"] != r.size || (int)(*it)["steps"] != r.steps) {
+          fprintf(stderr, "benchmark: %s: baseline ran with a different "
+                  "size or number of steps\n", r.name.c_str());
+          continue;
+        }
+
+        bool regressed = false;
+        double base = (double)(*it)["steps_per_sec"];
+        if(r.stepsPerSecond < base*(1.0-tolerance)) {
+          fprintf(stderr, "benchmark: %s: REGRESSION %.1f steps/s, "
+                  "baseline %.1f\n", r.name.c_str(), r.stepsPerSecond, base);
+          regressed = true;
+        }
+        if(r.resets && it->hasKey("resets_per_sec")) {
+          base = (double)(*it)["resets_per_sec"];
+          if(r.resetsPerSecond < base*(1.0-tolerance)) {
+            fprintf(stderr, "benchmark: %s: REGRESSION %.1f resets/s, "
+                    "baseline %.1f\n", r.name.c_str(), r.resetsPerSecond,
+                    base);
+            regressed = true;
+          }
+        }
+        base = (double)(*it)["peak_rss_kb"];
+        if(base > 0.0 && r.peakRss > base*(1.0+tolerance)) {
+          fprintf(stderr, "benchmark: %s: REGRESSION peak RSS %ld kB, "
+                  "baseline %.0f kB\n", r.name.c_str(), r.peakRss, base);
+          regressed = true;
+        }
+        unsigned long long hash;
+        hash = strtoull(((std::string)(*it)["state_hash"]).c_str(), NULL, 16);
+        if(hash != r.stateHash) {
+          fprintf(stderr, "benchmark: %s: state hash differs from the "
+                  "baseline, the physics changed\n", r.name.c_str());
+        }
+        if(r.resets && !r.resetsReproducible) {
+          fprintf(stderr, "benchmark: %s: REGRESSION episodes from the same "
+                  "checkpoint end in different states\n", r.name.c_str());
+          regressed = true;
+        }
+        if(regressed) ++regressions;
+      }
+      return regressions;
+    }
+
+  } // end of namespace benchmark
+} // end of namespace mars
@@ -0,0 +1,151 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file Benchmark.h
+ * \brief Runs the scenes of the benchmark suite and compares the results
+ * with a baseline.
+ *
+ */
+
+#ifndef MARS_BENCHMARK_BENCHMARK_H
+#define MARS_BENCHMARK_BENCHMARK_H
+
+#ifdef _PRINT_HEADER_
+  #warning "Benchmark.h"
+#endif
+
+#include <mars/data_broker/ReceiverInterface.h>
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace lib_manager {
+  class LibManager;
+}
+
+namespace mars {
+
+  namespace interfaces {
+    class ControlCenter;
+    class SimulatorInterface;
+  }
+
+  namespace benchmark {
+
+    class Scene;
+
+    struct BenchmarkResult {
+      BenchmarkResult() : size(0), steps(0), skipped(false), wallTime(0.0),
+                          stepsPerSecond(0.0), peakRss(0), stateHash(0),
+                          resets(0), resetsPerSecond(0.0), restoreTime(0.0),
+                          reloadTime(0.0), resetsReproducible(true) {}
+
+      std::string name;
+      int size, steps;
+      bool skipped;
+      std::string skipReason;
+      double wallTime; ///< in seconds
+      double stepsPerSecond;
+      std::map<std::string, double> phases; ///< mean time per step in ms
+      long peakRss; ///< in kB
+      unsigned long long stateHash; ///< after the last step
+
+      // only set if the scene measures resets
+      int resets;
+      double resetsPerSecond;
+      double restoreTime; ///< mean time of restoreCheckpoint() in ms
+      double reloadTime; ///< mean time of a full reload like resetSim() in ms
+      bool resetsReproducible;
+    };
+
+    /**
+     * \brief Runs one scene after the other, each in a simulation of its
+     * own with a fresh LibManager.
+     *
+     * The simulation runs in deterministic mode without its thread, the
+     * benchmark calls step() directly. The time of the phases of a step is
+     * taken from the "mars_sim/stepTimes" stream of the Simulator. The
+     * state hash is only computed outside of the measured steps.
+     *
+     * Every simulation reads and writes its configuration in a temporary
+     * directory that is removed afterwards, thus the mars_*.yaml files of
+     * the working directory are neither read nor changed.
+     */
+    class Benchmark : public data_broker::ReceiverInterface {
+    public:
+      explicit Benchmark(bool graphics);
+      ~Benchmark();
+
+      BenchmarkResult run(Scene *scene, int size, int steps);
+      /**
+       * \brief Ends the process with exit code 3 if a scene runs longer
+       * than \c seconds, 0 disables the limit. Not available on Windows.
+       */
+      void setTimeout(int seconds) {timeout = seconds;}
+
+      virtual void receiveData(const data_broker::DataInfo &info,
+                               const data_broker::DataPackage &package,
+                               int callbackParam);
+
+    private:
+      bool startSimulation(Scene *scene, std::string *error);
+      void stopSimulation();
+      void runSteps(Scene *scene, BenchmarkResult *result);
+      void runResets(Scene *scene, BenchmarkResult *result);
+      void step(Scene *scene);
+      unsigned long long hashState();
+
+      bool graphics;
+      int timeout;
+      lib_manager::LibManager *libManager;
+      std::vector<std::string> loadedLibs;
+      interfaces::ControlCenter *control;
+      interfaces::SimulatorInterface *sim;
+      std::string configDir;
+      double simTime;
+      std::vector<std::string> phaseNames;
+      std::vector<double> phaseSums;
+      double renderSum;
+    }; // end of class Benchmark
+
+    /// writes the results as a JSON array
+    void writeResults(FILE *file, const std::vector<BenchmarkResult> &results);
+
+    /**
+     * \brief Compares the results with the ones stored in \c baselineFile.
+     *
+     * A scene regresses if its steps (or resets) per second drop below
+     * baseline*(1-tolerance) or its peak RSS grows above
+     * baseline*(1+tolerance). A different state hash is reported as a
+     * change of the physics, not as a regression.
+     * \return the number of regressions or -1 if the baseline could not be
+     * read
+     */
+    int compareResults(const std::string &baselineFile,
+                       const std::vector<BenchmarkResult> &results,
+                       double tolerance);
+
+  } // end of namespace benchmark
+} // end of namespace mars
+
+#endif // MARS_BENCHMARK_BENCHMARK_H
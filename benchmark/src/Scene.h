@@ -0,0 +1,116 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file Scene.h
+ * \brief Generated scenes of the benchmark suite.
+ *
+ */
+
+#ifndef MARS_BENCHMARK_SCENE_H
+#define MARS_BENCHMARK_SCENE_H
+
+#ifdef _PRINT_HEADER_
+  #warning "Scene.h"
+#endif
+
+#include <string>
+#include <vector>
+
+namespace mars {
+
+  namespace interfaces {
+    class ControlCenter;
+  }
+
+  namespace benchmark {
+
+    /**
+     * \brief A scene that is generated from code and scales with one size
+     * parameter, e.g. the number of boxes or chain links.
+     *
+     * The scenes do not depend on any scene files, thus the same name and
+     * size always result in the same scene and the results of different
+     * builds can be compared.
+     */
+    class Scene {
+    public:
+      Scene(const std::string &name, int defaultSize)
+        : name(name), defaultSize(defaultSize) {}
+      virtual ~Scene() {}
+
+      const std::string& getName() const {
+        return name;
+      }
+      int getDefaultSize() const {
+        return defaultSize;
+      }
+
+      /**
+       * \brief Libraries that have to be loaded in addition to the
+       * simulation core. They are loaded before the simulation is started,
+       * thus their plugins are initialized with the simulation.
+       */
+      virtual std::vector<std::string> getLibraries() const {
+        return std::vector<std::string>();
+      }
+      virtual bool needsGraphics() const {
+        return false;
+      }
+      /**
+       * \brief If \c true the benchmark measures how fast the scene can be
+       * reset to a checkpoint instead of how fast it is stepped.
+       */
+      virtual bool measuresResets() const {
+        return false;
+      }
+
+      /**
+       * \brief Checks whether the scene can be run, e.g. if its data files
+       * exist. \c reason is set if not.
+       */
+      virtual bool isAvailable(std::string *reason) const {
+        return true;
+      }
+
+      /**
+       * \brief Creates the scene in the running simulation.
+       * \return \c false if the scene could not be created
+       */
+      virtual bool build(interfaces::ControlCenter *control, int size) = 0;
+
+      /// called before every step with the simulation time in ms
+      virtual void update(interfaces::ControlCenter *control, double time) {}
+
+    private:
+      std::string name;
+      int defaultSize;
+    }; // end of class Scene
+
+    /**
+     * \brief Creates all scenes of the suite in the order they are run.
+     * The caller owns the returned objects.
+     */
+    std::vector<Scene*> createScenes();
+
+  } // end of namespace benchmark
+} // end of namespace mars
+
+#endif // MARS_BENCHMARK_SCENE_H
@@ -0,0 +1,390 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file Scenes.cpp
+ * \brief The scenes of the benchmark suite.
+ *
+ */
+
+#include "Scene.h"
+
+#include <mars/interfaces/sim/ControlCenter.h>
+#include <mars/interfaces/sim/NodeManagerInterface.h>
+#include <mars/interfaces/sim/JointManagerInterface.h>
+#include <mars/interfaces/sim/SensorManagerInterface.h>
+#include <mars/interfaces/NodeData.h>
+#include <mars/interfaces/JointData.h>
+#include <mars/interfaces/terrainStruct.h>
+#include <mars/utils/RandomStream.h>
+#include <mars/utils/mathUtils.h>
+#include <mars/utils/misc.h>
+#include <configmaps/ConfigData.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace mars {
+  namespace benchmark {
+
+    using namespace mars::interfaces;
+    using namespace mars::utils;
+
+    // every scene draws its random numbers from the same fixed seed
+    static const uint64_t sceneSeed = 0x4d415253ULL;
+
+    static NodeId addPrimitive(ControlCenter *control, const std::string &name,
+                               NodeType type, const Vector &pos,
+                               const Vector &ext, double mass, bool movable,
+                               const Quaternion &rot = Quaternion::Identity()) {
+      NodeData node;
+      node.init(name, pos, rot);
+      node.initPrimitive(type, ext, mass);
+      node.movable = movable;
+      return control->nodes->addNode(&node);
+    }
+
+    static NodeId addGround(ControlCenter *control) {
+      return addPrimitive(control, "ground", NODE_TYPE_PLANE, Vector(0, 0, 0),
+                          Vector(100, 100, 0), 0, false);
+    }
+
+    static unsigned long addHinge(ControlCenter *control,
+                                  const std::string &name,
+                                  NodeId node1, NodeId node2,
+                                  const Vector &anchor, const Vector &axis) {
+      JointData joint;
+      joint.init(name, JOINT_TYPE_HINGE, node1, node2);
+      joint.anchorPos = ANCHOR_CUSTOM;
+      joint.anchor = anchor;
+      joint.axis1 = axis;
+      return control->joints->addJoint(&joint);
+    }
+
+    static std::string indexedName(const char *prefix, int i) {
+      char text[64];
+      sprintf(text, "%s_%03d", prefix, i);
+      return text;
+    }
+
+    /**
+     * \brief \c size boxes that fall in layers of 10x10 onto a plane and
+     * come to rest on each other. Measures the contact handling.
+     */
+    class FallingBoxesScene : public Scene {
+    public:
+      FallingBoxesScene(const std::string &name = "falling_boxes",
+                        int defaultSize = 100)
+        : Scene(name, defaultSize) {}
+
+      virtual bool build(ControlCenter *control, int size) {
+        RandomStream random(RandomStream::deriveSeed(sceneSeed, "boxes"));
+        if(!addGround(control)) return false;
+        for(int i=0; i<size; ++i) {
+          int layer = i / 100, cell = i % 100;
+          Vector pos((cell % 10) * 0.35 - 1.6, (cell / 10) * 0.35 - 1.6,
+                     0.5 + layer * 0.4);
+          // slightly tilted, thus the boxes do not land flat on each other
+          Quaternion rot = angleAxisToQuaternion(random.uniform(-0.3, 0.3),
+                                                 Vector(random.uniform(),
+                                                        random.uniform(),
+                                                        1.0).normalized());
+          if(!addPrimitive(control, indexedName("box", i), NODE_TYPE_BOX, pos,
+                           Vector(0.2, 0.2, 0.2), 0.5, true, rot)) {
+            return false;
+          }
+        }
+        return true;
+      }
+    };
+
+    /**
+     * \brief A horizontal chain of \c size links that swings down from a
+     * fixed anchor. Measures the joint solver.
+     */
+    class ChainScene : public Scene {
+    public:
+      ChainScene() : Scene("chain", 32) {}
+
+      virtual bool build(ControlCenter *control, int size) {
+        static const double length = 0.2;
+        double height = size*length + 1.0;
+        NodeId previous = addPrimitive(control, "anchor", NODE_TYPE_BOX,
+                                       Vector(0, 0, height),
+                                       Vector(0.1, 0.1, 0.1), 0, false);
+        if(!previous) return false;
+        for(int i=0; i<size; ++i) {
+          NodeId link = addPrimitive(control, indexedName("link", i),
+                                     NODE_TYPE_BOX,
+                                     Vector((i+0.5)*length, 0, height),
+                                     Vector(length, 0.04, 0.04), 0.1, true);
+          if(!link) return false;
+          if(!addHinge(control, indexedName("hinge", i), previous, link,
+                       Vector(i*length, 0, height), Vector(0, 1, 0))) {
+            return false;
+          }
+          previous = link;
+        }
+        return true;
+      }
+    };
+
+    /**
+     * \brief A walking robot with \c size legs on a generated heightfield.
+     * Every leg has a hip and a knee joint that are driven with sine
+     * velocities. Measures contacts with a terrain combined with joints.
+     */
+    class LeggedRobotScene : public Scene {
+    public:
+      LeggedRobotScene(const std::string &name = "legged_robot")
+        : Scene(name, 6), robotHeight(0.6) {}
+
+      virtual bool build(ControlCenter *control, int size) {
+        if(!buildGround(control)) return false;
+        return buildRobot(control, size);
+      }
+
+      virtual void update(ControlCenter *control, double time) {
+        // a tripod like gait, neighbouring legs move in opposite phase
+        static const double frequency = 1.0, amplitude = 0.4;
+        double w = 2*M_PI*frequency;
+        double t = time*0.001;
+        for(size_t i=0; i<hips.size(); ++i) {
+          double phase = (i % 2) ? M_PI : 0.0;
+          control->joints->setVelocity(hips[i],
+                                       amplitude*w*cos(w*t + phase));
+          control->joints->setVelocity(knees[i],
+                                       amplitude*w*cos(w*t + phase + 0.5*M_PI));
+        }
+      }
+
+    protected:
+      virtual bool buildGround(ControlCenter *control) {
+        static const int cells = 128;
+        RandomStream random(RandomStream::deriveSeed(sceneSeed, "heightfield"));
+        NodeData node;
+        node.init("heightfield", Vector(0, 0, 0));
+        node.physicMode = NODE_TYPE_TERRAIN;
+        node.movable = false;
+        // the SimNode takes the ownership of the terrain
+        node.terrain = new terrainStruct();
+        node.terrain->name = "heightfield";
+        node.terrain->srcname = "benchmark_heightfield";
+        node.terrain->width = node.terrain->height = cells;
+        node.terrain->targetWidth = node.terrain->targetHeight = 20.0;
+        node.terrain->scale = 0.3;
+        node.terrain->pixelData = (double*)calloc(cells*cells, sizeof(double));
+        // rolling hills with some noise, in the range [0, 1]
+        for(int y=0; y<cells; ++y) {
+          for(int x=0; x<cells; ++x) {
+            double h = 0.5 + 0.25*sin(x*0.15)*cos(y*0.11);
+            h += random.uniform(-0.05, 0.05);
+            node.terrain->pixelData[y*cells+x] = h < 0.0 ? 0.0 : h;
+          }
+        }
+        robotHeight = 0.7 + node.terrain->scale;
+        return control->nodes->addNode(&node) != 0;
+      }
+
+      bool buildRobot(ControlCenter *control, int legs) {
+        int pairs = (legs + 1) / 2;
+        double bodyLength = 0.25*pairs;
+        Vector center(0, 0, robotHeight);
+        NodeId body = addPrimitive(control, "body", NODE_TYPE_BOX, center,
+                                   Vector(bodyLength, 0.3, 0.1),
+                                   1.0*pairs, true);
+        if(!body) return false;
+        hips.clear();
+        knees.clear();
+        for(int i=0; i<pairs*2; ++i) {
+          double side = (i % 2) ? -1.0 : 1.0;
+          Vector hip = center + Vector((i/2 + 0.5)*0.25 - 0.5*bodyLength,
+                                       side*0.2, 0);
+          Vector knee = hip - Vector(0, 0, 0.2);
+          NodeId thigh = addPrimitive(control, indexedName("thigh", i),
+                                      NODE_TYPE_BOX, hip - Vector(0, 0, 0.1),
+                                      Vector(0.05, 0.05, 0.2), 0.2, true);
+          NodeId shank = addPrimitive(control, indexedName("shank", i),
+                                      NODE_TYPE_BOX, knee - Vector(0, 0, 0.1),
+                                      Vector(0.04, 0.04, 0.2), 0.1, true);
+          if(!thigh || !shank) return false;
+          unsigned long hipId = addHinge(control, indexedName("hip", i),
+                                         body, thigh, hip, Vector(0, 1, 0));
+          unsigned long kneeId = addHinge(control, indexedName("knee", i),
+                                          thigh, shank, knee, Vector(0, 1, 0));
+          if(!hipId || !kneeId) return false;
+          control->joints->setForceLimit(hipId, 20.0);
+          control->joints->setForceLimit(kneeId, 20.0);
+          hips.push_back(hipId);
+          knees.push_back(kneeId);
+        }
+        return true;
+      }
+
+      double robotHeight;
+      std::vector<unsigned long> hips, knees;
+    };
+
+    /**
+     * \brief The legged robot on the multi-level surface map of the
+     * test_mls plugin.
+     */
+    class MlsRobotScene : public LeggedRobotScene {
+    public:
+      MlsRobotScene() : LeggedRobotScene("mls_robot") {}
+
+      virtual std::vector<std::string> getLibraries() const {
+        std::vector<std::string> libs;
+        libs.push_back("envire_physics");
+        libs.push_back("test_mls");
+        return libs;
+      }
+
+      virtual bool isAvailable(std::string *reason) const {
+        // test_mls reads its map relative to the working directory
+        if(!pathExists("./mlsdata/MLSMapKalman_waves.bin")) {
+          *reason = "./mlsdata/MLSMapKalman_waves.bin not found";
+          return false;
+        }
+        return true;
+      }
+
+    protected:
+      virtual bool buildGround(ControlCenter *control) {
+        // the map is added by the test_mls plugin
+        robotHeight = 2.0;
+        return true;
+      }
+    };
+
+    /**
+     * \brief A lidar with \c size beams on a moving platform in a field of
+     * obstacles. Measures the ray casts of the RaySensor.
+     */
+    class LidarScene : public Scene {
+    public:
+      LidarScene() : Scene("lidar", 64), platform(0) {}
+
+      virtual bool build(ControlCenter *control, int size) {
+        RandomStream random(RandomStream::deriveSeed(sceneSeed, getName()));
+        if(!addGround(control)) return false;
+        for(int i=0; i<64; ++i) {
+          double angle = random.uniform(0.0, 2*M_PI);
+          double distance = random.uniform(2.0, 10.0);
+          double height = random.uniform(0.2, 2.0);
+          if(!addPrimitive(control, indexedName("obstacle", i), NODE_TYPE_BOX,
+                           Vector(distance*cos(angle), distance*sin(angle),
+                                  0.5*height),
+                           Vector(0.5, 0.5, height), 0, false)) {
+            return false;
+          }
+        }
+        platform = addPrimitive(control, "platform", NODE_TYPE_BOX,
+                                Vector(0, 0, 0.15), Vector(0.4, 0.4, 0.2),
+                                5.0, true);
+        if(!platform) return false;
+
+        configmaps::ConfigMap config;
+        config["name"] = "lidar";
+        config["type"] = "RaySensor";
+        config["attached_node"] = (unsigned long)platform;
+        config["width"] = size;
+        config["opening_width"] = 2*M_PI;
+        config["max_distance"] = 30.0;
+        config["draw_rays"] = false;
+        config["rate"] = 10;
+        return control->sensors->createAndAddSensor(&config) != NULL;
+      }
+
+      virtual void update(ControlCenter *control, double time) {
+        // turns the platform, thus the rays hit changing obstacles
+        control->nodes->setAngularVelocity(platform, Vector(0, 0, 0.5));
+      }
+
+    private:
+      NodeId platform;
+    };
+
+    /**
+     * \brief \c size cameras around a pile of falling boxes. Measures the
+     * rendering of the camera sensors, thus it needs the graphics.
+     */
+    class CameraRigScene : public FallingBoxesScene {
+    public:
+      CameraRigScene() : FallingBoxesScene("camera_rig", 4) {}
+
+      virtual bool needsGraphics() const {
+        return true;
+      }
+
+      virtual bool build(ControlCenter *control, int size) {
+        if(!FallingBoxesScene::build(control, 100)) return false;
+        for(int i=0; i<size; ++i) {
+          double angle = 2*M_PI*i/size;
+          // the cameras look along the x axis of their node to the center
+          Quaternion rot = angleAxisToQuaternion(angle + M_PI, Vector(0, 0, 1));
+          NodeId pole = addPrimitive(control, indexedName("camera_pole", i),
+                                     NODE_TYPE_BOX,
+                                     Vector(6*cos(angle), 6*sin(angle), 1.5),
+                                     Vector(0.1, 0.1, 0.1), 0, false, rot);
+          if(!pole) return false;
+          configmaps::ConfigMap config;
+          config["name"] = indexedName("camera", i);
+          config["type"] = "CameraSensor";
+          config["attached_node"] = (unsigned long)pole;
+          config["width"] = 640;
+          config["height"] = 480;
+          config["opening_angle"] = 60.0;
+          config["rate"] = 10;
+          if(!control->sensors->createAndAddSensor(&config)) return false;
+        }
+        return true;
+      }
+    };
+
+    /**
+     * \brief The legged robot, used to measure how fast a simulation can be
+     * restored to a checkpoint, e.g. between the episodes of a learning
+     * experiment.
+     */
+    class ResetThroughputScene : public LeggedRobotScene {
+    public:
+      ResetThroughputScene() : LeggedRobotScene("reset_throughput") {}
+
+      virtual bool measuresResets() const {
+        return true;
+      }
+    };
+
+    std::vector<Scene*> createScenes() {
+      std::vector<Scene*> scenes;
+      scenes.push_back(new FallingBoxesScene());
+      scenes.push_back(new ChainScene());
+      scenes.push_back(new LeggedRobotScene());
+      scenes.push_back(new MlsRobotScene());
+      scenes.push_back(new LidarScene());
+      scenes.push_back(new CameraRigScene());
+      scenes.push_back(new ResetThroughputScene());
+      return scenes;
+    }
+
+  } // end of namespace benchmark
+} // end of namespace mars
@@ -0,0 +1,170 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file main.cpp
+ * \brief Runs the benchmark suite headless and writes the results as JSON.
+ *
+ * Example: mars_benchmark --scenes chain:64,lidar --steps 2000
+ *          --out result.json --baseline baseline.json --tolerance 0.1
+ *
+ * The exit code is 1 if a scene regressed against the baseline and 3 if a
+ * scene ran longer than --timeout.
+ */
+
+#include "Benchmark.h"
+#include "Scene.h"
+
+#include <getopt.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace mars::benchmark;
+
+static void printUsage(const char *name, const std::vector<Scene*> &scenes) {
+  fprintf(stderr, "usage: %s [options]\n", name);
+  fprintf(stderr, "  --scenes name[:size],...  scenes to run (default all)\n");
+  fprintf(stderr, "  --steps n                 steps per scene (default 1000)\n");
+  fprintf(stderr, "  --size n                  size of all scenes\n");
+  fprintf(stderr, "  --out file                JSON output (default stdout)\n");
+  fprintf(stderr, "  --baseline file           results to compare with\n");
+  fprintf(stderr, "  --tolerance t             allowed relative slow down (default 0.1)\n");
+  fprintf(stderr, "  --graphics                render offscreen, needed by camera_rig\n");
+  fprintf(stderr, "  --timeout s               abort if a scene takes longer (default 600, 0 off)\n");
+  fprintf(stderr, "scenes:");
+  for(size_t i=0; i<scenes.size(); ++i) {
+    fprintf(stderr, " %s(%d)", scenes[i]->getName().c_str(),
+            scenes[i]->getDefaultSize());
+  }
+  fprintf(stderr, "\n");
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<Scene*> scenes = createScenes();
+  std::string sceneList, outFile, baselineFile;
+  int steps = 1000, size = 0, timeout = 600;
+  double tolerance = 0.1;
+  bool graphics = false;
+
+  static struct option long_options[] = {
+    {"scenes", required_argument, 0, 's'},
+    {"steps", required_argument, 0, 'n'},
+    {"size", required_argument, 0, 'z'},
+    {"out", required_argument, 0, 'o'},
+    {"baseline", required_argument, 0, 'b'},
+    {"tolerance", required_argument, 0, 't'},
+    {"graphics", no_argument, 0, 'g'},
+    {"timeout", required_argument, 0, 'T'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+  };
+  int c, option_index = 0;
+  while((c = getopt_long(argc, argv, "s:n:z:o:b:t:gT:h", long_options,
+                         &option_index)) != -1) {
+    switch(c) {
+    case 's': sceneList = optarg; break;
+    case 'n': steps = atoi(optarg); break;
+    case 'z': size = atoi(optarg); break;
+    case 'o': outFile = optarg; break;
+    case 'b': baselineFile = optarg; break;
+    case 't': tolerance = atof(optarg); break;
+    case 'g': graphics = true; break;
+    case 'T': timeout = atoi(optarg); break;
+    default:
+      printUsage(argv[0], scenes);
+      return 2;
+    }
+  }
+  if(steps <= 0) {
+    fprintf(stderr, "benchmark: --steps has to be positive\n");
+    return 2;
+  }
+
+  // the selected scenes with their sizes
+  std::vector<std::pair<Scene*, int> > runs;
+  if(sceneList.empty()) {
+    for(size_t i=0; i<scenes.size(); ++i) {
+      runs.push_back(std::make_pair(scenes[i], size));
+    }
+  }
+  else {
+    size_t start = 0;
+    while(start <= sceneList.size()) {
+      size_t end = sceneList.find(',', start);
+      if(end == std::string::npos) end = sceneList.size();
+      std::string entry = sceneList.substr(start, end-start);
+      start = end + 1;
+      if(entry.empty()) continue;
+      int entrySize = size;
+      size_t colon = entry.find(':');
+      if(colon != std::string::npos) {
+        entrySize = atoi(entry.substr(colon+1).c_str());
+        entry = entry.substr(0, colon);
+      }
+      size_t i;
+      for(i=0; i<scenes.size(); ++i) {
+        if(scenes[i]->getName() == entry) break;
+      }
+      if(i == scenes.size()) {
+        fprintf(stderr, "benchmark: unknown scene \"%s\"\n", entry.c_str());
+        printUsage(argv[0], scenes);
+        return 2;
+      }
+      runs.push_back(std::make_pair(scenes[i], entrySize));
+    }
+  }
+
+  std::vector<BenchmarkResult> results;
+  {
+    Benchmark benchmark(graphics);
+    benchmark.setTimeout(timeout);
+    for(size_t i=0; i<runs.size(); ++i) {
+      results.push_back(benchmark.run(runs[i].first, runs[i].second, steps));
+    }
+  }
+
+  FILE *out = stdout;
+  if(!outFile.empty()) {
+    out = fopen(outFile.c_str(), "w");
+    if(!out) {
+      fprintf(stderr, "benchmark: could not open \"%s\"\n", outFile.c_str());
+      return 2;
+    }
+  }
+  writeResults(out, results);
+  if(out != stdout) fclose(out);
+
+  int state = 0;
+  if(!baselineFile.empty()) {
+    int regressions = compareResults(baselineFile, results, tolerance);
+    if(regressions < 0) state = 2;
+    else if(regressions > 0) {
+      fprintf(stderr, "benchmark: %d scene(s) regressed\n", regressions);
+      state = 1;
+    }
+  }
+
+  for(size_t i=0; i<scenes.size(); ++i) {
+    delete scenes[i];
+  }
+  return state;
+}
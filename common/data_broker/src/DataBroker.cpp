@@ -50,6 +50,8 @@
 
 #include <cstdio>
 #include <cerrno>
+#include <cmath>
+#include <cstdlib>
 
 
 
@@ -95,8 +97,8 @@ namespace mars {
       next_id(1), thread_running(false), stop_thread(false),
       realtimeThreadRunning(false), startingRealtimeThread(false) {
 
-      updatedElementsBackBuffer = new std::set<DataElement*>;
-      updatedElementsFrontBuffer = new std::set<DataElement*>;
+      updatedElementsBackBuffer = new DataElementSet;
+      updatedElementsFrontBuffer = new DataElementSet;
 
       DataElement *e;
       e = createDataElement("data_broker", "newStream", DATA_PACKAGE_READ_FLAG);
@@ -289,7 +291,7 @@ namespace mars {
       std::map<std::string, Timer>::iterator timerIt, endIt;
       std::list<DeferredCallback> deferredCallbacks;
       std::set<DataItemConnection> activeConnections;
-      std::set<DataElement*> connectionActivatedElements;
+      DataElementSet connectionActivatedElements;
       DataItem currentItem;
 
       //bool ok = false;
@@ -305,9 +307,10 @@ namespace mars {
       //ok = true;
       timerIt->second.lock->lockForWrite();
       timerIt->second.t += step;
-      // call all producers
+      // call all producers and measure how long each one takes
       DeferredCallback deferredCallback;
       std::list<TimedProducer>::iterator producerIt;
+      long long produceStart;
       for(producerIt = timerIt->second.producers.begin();
           producerIt != timerIt->second.producers.end();
           ++producerIt) {
@@ -321,9 +324,13 @@ namespace mars {
           deferredCallback.receivers.clear();
 
           element->bufferLock->lockForWrite();
+          produceStart = getTimeMicro();
           producerIt->producer->produceData(element->info,
                                             element->backBuffer,
                                             producerIt->callbackParam);
+          addCallbackCost(&timerIt->second.producerCosts[producerIt->producer],
+                          timerIt->second.t, producerIt->updatePeriod,
+                          (double)(getTimeMicro() - produceStart));
           std::swap(element->backBuffer, element->frontBuffer);
           element->receiverLock->lockForRead();
           if(!element->syncReceivers.empty()) {
@@ -379,20 +386,30 @@ namespace mars {
 
       timerIt->second.lock->unlock();
 
-      // call all deferred receivers
+      // call all deferred receivers and measure how long each one takes
+      // (period and time in microseconds)
+      std::map<ReceiverInterface*, std::pair<int, long long> > callTimes;
+      long long callStart;
       for(timedReceiverIt = deferredReceivers.begin();
           timedReceiverIt != deferredReceivers.end();
           ++timedReceiverIt) {
         DataElement *element = timedReceiverIt->element;
+        callStart = getTimeMicro();
         element->bufferLock->lockForRead();
         timedReceiverIt->receiver->receiveData(element->info,
                                                *element->frontBuffer,
                                                timedReceiverIt->callbackParam);
         element->bufferLock->unlock();
+        std::pair<int, long long> &callTime = callTimes[timedReceiverIt->receiver];
+        callTime.first = timedReceiverIt->updatePeriod;
+        callTime.second += getTimeMicro() - callStart;
+      }
+      if(!callTimes.empty()) {
+        updateTimedReceiverCosts(&timerIt->second, time, callTimes);
       }
 
       // connections
-      std::set<DataElement*>::iterator toElementIt;
+      DataElementSet::iterator toElementIt;
       fflush(stderr);
       for(toElementIt = connectionActivatedElements.begin();
           toElementIt != connectionActivatedElements.end(); ++toElementIt) {
@@ -492,6 +509,7 @@ namespace mars {
             ++receiverIt;
           }
         }
+        timerIt->second.receiverCosts.erase(receiver);
         if(timerName == "_REALTIME_" &&
            timerIt->second.receivers.empty() &&
            timerIt->second.producers.empty()) {
@@ -516,6 +534,127 @@ namespace mars {
       return ok;
     }
 
+    void DataBroker::updateTimedReceiverCosts(Timer *timer, long time,
+                                              const std::map<ReceiverInterface*, std::pair<int, long long> > &callTimes) {
+      std::map<ReceiverInterface*, std::pair<int, long long> >::const_iterator it;
+      std::map<ReceiverInterface*, TimedCallbackCost>::iterator costIt;
+      std::list<TimedReceiver>::iterator receiverIt;
+
+      timer->lock->lockForWrite();
+      for(it = callTimes.begin(); it != callTimes.end(); ++it) {
+        costIt = timer->receiverCosts.find(it->first);
+        if(costIt == timer->receiverCosts.end()) {
+          // the receiver might have unregistered itself in its callback
+          for(receiverIt = timer->receivers.begin();
+              receiverIt != timer->receivers.end(); ++receiverIt) {
+            if(receiverIt->receiver == it->first) break;
+          }
+          if(receiverIt == timer->receivers.end()) continue;
+          costIt = timer->receiverCosts.insert(std::make_pair(it->first,
+                                                              TimedCallbackCost())).first;
+        }
+        addCallbackCost(&costIt->second, time, it->second.first,
+                        (double)it->second.second);
+      }
+      timer->lock->unlock();
+    }
+
+    void DataBroker::addCallbackCost(TimedCallbackCost *cost, long time,
+                                     int updatePeriod, double duration) {
+      cost->calls += 1;
+      cost->sum += duration;
+      cost->sumSquared += duration*duration;
+      if(duration > cost->max) cost->max = duration;
+      if(cost->lastCall >= 0 && updatePeriod > 0) {
+        long jitter = labs(time - cost->lastCall - updatePeriod);
+        if(jitter > cost->maxJitter) cost->maxJitter = jitter;
+      }
+      cost->lastCall = time;
+    }
+
+    void DataBroker::getCallbackStatistics(const TimedCallbackCost &cost,
+                                           TimedCallbackStatistics *statistics) {
+      if(!cost.calls) return;
+      statistics->calls = cost.calls;
+      statistics->avgTime = cost.sum / cost.calls;
+      statistics->maxTime = cost.max;
+      double variance = (cost.sumSquared / cost.calls -
+                         statistics->avgTime*statistics->avgTime);
+      statistics->deviation = variance > 0.0 ? sqrt(variance) : 0.0;
+      statistics->intervalJitter = cost.maxJitter;
+    }
+
+    long DataBroker::getPhaseTriggerTime(long t, long updatePeriod, long phase) {
+      long offset = phase % updatePeriod;
+      if(offset < 0) offset += updatePeriod;
+      long next = t - t % updatePeriod + offset;
+      if(next <= t) next += updatePeriod;
+      return next;
+    }
+
+    bool DataBroker::setTimedReceiverPhase(ReceiverInterface *receiver,
+                                           const std::string &timerName,
+                                           long phase) {
+      std::map<std::string, Timer>::iterator timerIt, endIt;
+      std::list<TimedReceiver>::iterator receiverIt;
+      bool ok = false;
+      timersLock.lockForRead();
+      timerIt = timers.find(timerName);
+      endIt = timers.end();
+      timersLock.unlock();
+      if(timerIt == endIt) {
+        return false;
+      }
+      timerIt->second.lock->lockForWrite();
+      long t = timerIt->second.t;
+      for(receiverIt = timerIt->second.receivers.begin();
+          receiverIt != timerIt->second.receivers.end(); ++receiverIt) {
+        if(receiverIt->receiver != receiver) continue;
+        ok = true;
+        if(receiverIt->updatePeriod <= 0) continue;
+        receiverIt->nextTriggerTime = getPhaseTriggerTime(t, receiverIt->updatePeriod,
+                                                          phase);
+      }
+      timerIt->second.lock->unlock();
+      return ok;
+    }
+
+    bool DataBroker::getTimedReceiverStatistics(ReceiverInterface *receiver,
+                                                const std::string &timerName,
+                                                TimedCallbackStatistics *statistics) {
+      std::map<std::string, Timer>::iterator timerIt, endIt;
+      std::list<TimedReceiver>::iterator receiverIt;
+      std::map<ReceiverInterface*, TimedCallbackCost>::iterator costIt;
+      bool ok = false;
+      timersLock.lockForRead();
+      timerIt = timers.find(timerName);
+      endIt = timers.end();
+      timersLock.unlock();
+      if(timerIt == endIt) {
+        return false;
+      }
+      *statistics = TimedCallbackStatistics();
+      timerIt->second.lock->lockForRead();
+      for(receiverIt = timerIt->second.receivers.begin();
+          receiverIt != timerIt->second.receivers.end(); ++receiverIt) {
+        if(receiverIt->receiver == receiver) {
+          statistics->updatePeriod = receiverIt->updatePeriod;
+          if(receiverIt->updatePeriod > 0) {
+            statistics->phase = (receiverIt->nextTriggerTime %
+                                 receiverIt->updatePeriod);
+          }
+          ok = true;
+          break;
+        }
+      }
+      costIt = timerIt->second.receiverCosts.find(receiver);
+      if(ok && costIt != timerIt->second.receiverCosts.end()) {
+        getCallbackStatistics(costIt->second, statistics);
+      }
+      timerIt->second.lock->unlock();
+      return ok;
+    }
+
     bool DataBroker::registerTimedProducer(ProducerInterface *producer,
                                            const std::string &groupName,
                                            const std::string &dataName,
@@ -588,6 +727,7 @@ namespace mars {
             ++producerIt;
           }
         }
+        timerIt->second.producerCosts.erase(producer);
         if(timerName == "_REALTIME_" &&
            timerIt->second.receivers.empty() &&
            timerIt->second.producers.empty()) {
@@ -612,6 +752,69 @@ namespace mars {
       return ok;
     }
 
+    bool DataBroker::setTimedProducerPhase(ProducerInterface *producer,
+                                           const std::string &timerName,
+                                           long phase) {
+      std::map<std::string, Timer>::iterator timerIt, endIt;
+      std::list<TimedProducer>::iterator producerIt;
+      bool ok = false;
+      timersLock.lockForRead();
+      timerIt = timers.find(timerName);
+      endIt = timers.end();
+      timersLock.unlock();
+      if(timerIt == endIt) {
+        return false;
+      }
+      timerIt->second.lock->lockForWrite();
+      long t = timerIt->second.t;
+      for(producerIt = timerIt->second.producers.begin();
+          producerIt != timerIt->second.producers.end(); ++producerIt) {
+        if(producerIt->producer != producer) continue;
+        ok = true;
+        if(producerIt->updatePeriod <= 0) continue;
+        producerIt->nextTriggerTime = getPhaseTriggerTime(t, producerIt->updatePeriod,
+                                                          phase);
+      }
+      timerIt->second.lock->unlock();
+      return ok;
+    }
+
+    bool DataBroker::getTimedProducerStatistics(ProducerInterface *producer,
+                                                const std::string &timerName,
+                                                TimedCallbackStatistics *statistics) {
+      std::map<std::string, Timer>::iterator timerIt, endIt;
+      std::list<TimedProducer>::iterator producerIt;
+      std::map<ProducerInterface*, TimedCallbackCost>::iterator costIt;
+      bool ok = false;
+      timersLock.lockForRead();
+      timerIt = timers.find(timerName);
+      endIt = timers.end();
+      timersLock.unlock();
+      if(timerIt == endIt) {
+        return false;
+      }
+      *statistics = TimedCallbackStatistics();
+      timerIt->second.lock->lockForRead();
+      for(producerIt = timerIt->second.producers.begin();
+          producerIt != timerIt->second.producers.end(); ++producerIt) {
+        if(producerIt->producer == producer) {
+          statistics->updatePeriod = producerIt->updatePeriod;
+          if(producerIt->updatePeriod > 0) {
+            statistics->phase = (producerIt->nextTriggerTime %
+                                 producerIt->updatePeriod);
+          }
+          ok = true;
+          break;
+        }
+      }
+      costIt = timerIt->second.producerCosts.find(producer);
+      if(ok && costIt != timerIt->second.producerCosts.end()) {
+        getCallbackStatistics(costIt->second, statistics);
+      }
+      timerIt->second.lock->unlock();
+      return ok;
+    }
+
 
     bool DataBroker::createTrigger(const std::string &triggerName) {
       std::map<std::string, Trigger>::iterator triggerIt;
@@ -910,7 +1113,7 @@ namespace mars {
                                        const ReceiverInterface *producer) {
       std::list<Receiver>::iterator syncReceiverIt;
       std::map<unsigned long, DataElement*>::iterator elementIt;
-      std::set<DataElement*> connectionActivatedElements;
+      DataElementSet connectionActivatedElements;
       std::list<Receiver> syncReceivers;
       DataInfo info;
       DataElement *element = NULL;
@@ -958,7 +1161,7 @@ namespace mars {
                                                 syncReceiverIt->callbackParam);
       }
 
-      for(std::set<DataElement*>::iterator toElementIt = connectionActivatedElements.begin(); toElementIt != connectionActivatedElements.end(); ++toElementIt) {
+      for(DataElementSet::iterator toElementIt = connectionActivatedElements.begin(); toElementIt != connectionActivatedElements.end(); ++toElementIt) {
         DataElement *toElement = *toElementIt;
         pushData(toElement->info.dataId, *toElement->frontBuffer);
       }
@@ -1038,7 +1241,7 @@ namespace mars {
     }
 
     void DataBroker::run() {
-      std::set<DataElement*>::iterator updatedElementsIt;
+      DataElementSet::iterator updatedElementsIt;
       std::list<Receiver>::iterator receiverIt;
       std::list<DeferredCallback> deferredCallbacks;
       std::list<DeferredCallback>::iterator callbackIt;
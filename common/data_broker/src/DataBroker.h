@@ -106,10 +106,20 @@ namespace mars {
       int callbackParam;
     };
 
+    struct TimedCallbackCost {
+      TimedCallbackCost() : calls(0), sum(0.0), sumSquared(0.0), max(0.0),
+                            lastCall(-1), maxJitter(0) {}
+      unsigned long calls;
+      double sum, sumSquared, max;
+      long lastCall, maxJitter;
+    };
+
     struct Timer {
       long t;
       LockableContainer<std::list<TimedProducer> > producers;
       LockableContainer<std::list<TimedReceiver> > receivers;
+      std::map<ReceiverInterface*, TimedCallbackCost> receiverCosts;
+      std::map<ProducerInterface*, TimedCallbackCost> producerCosts;
       mars::utils::ReadWriteLock *lock;
       unsigned long timerElementId;
     };
@@ -142,6 +152,15 @@ namespace mars {
       const ReceiverInterface *lastProducer;
       std::list<DataItemConnection> connections;
     };
+
+    // orders the elements by id, thus the order in which updated elements
+    // are processed does not depend on their addresses
+    struct DataElementLess {
+      bool operator()(const DataElement *a, const DataElement *b) const {
+        return a->info.dataId < b->info.dataId;
+      }
+    };
+    typedef std::set<DataElement*, DataElementLess> DataElementSet;
     /// \endcond
 
     /**
@@ -170,6 +189,12 @@ namespace mars {
                                    const std::string &groupName,
                                    const std::string &dataName,
                                    const std::string &timerName);
+      bool setTimedReceiverPhase(ReceiverInterface *receiver,
+                                 const std::string &timerName,
+                                 long phase);
+      bool getTimedReceiverStatistics(ReceiverInterface *receiver,
+                                      const std::string &timerName,
+                                      TimedCallbackStatistics *statistics);
       bool registerTimedProducer(ProducerInterface *producer,
                                  const std::string &groupName,
                                  const std::string &dataName,
@@ -180,6 +205,12 @@ namespace mars {
                                    const std::string &groupName,
                                    const std::string &dataName,
                                    const std::string &timerName);
+      bool setTimedProducerPhase(ProducerInterface *producer,
+                                 const std::string &timerName,
+                                 long phase);
+      bool getTimedProducerStatistics(ProducerInterface *producer,
+                                      const std::string &timerName,
+                                      TimedCallbackStatistics *statistics);
 
       bool createTrigger(const std::string &triggerName);
       bool trigger(const std::string &triggerName);
@@ -291,8 +322,17 @@ namespace mars {
                              const std::string &dataName,
                              std::vector<DataElement*> *elements) const;
 
-      std::set<DataElement*> *updatedElementsBackBuffer;
-      std::set<DataElement*> *updatedElementsFrontBuffer;
+      void updateTimedReceiverCosts(Timer *timer, long time,
+                                    const std::map<ReceiverInterface*, std::pair<int, long long> > &callTimes);
+      static void addCallbackCost(TimedCallbackCost *cost, long time,
+                                  int updatePeriod, double duration);
+      static void getCallbackStatistics(const TimedCallbackCost &cost,
+                                        TimedCallbackStatistics *statistics);
+      // the first time after t with the given phase within the period
+      static long getPhaseTriggerTime(long t, long updatePeriod, long phase);
+
+      DataElementSet *updatedElementsBackBuffer;
+      DataElementSet *updatedElementsFrontBuffer;
 
       unsigned long next_id;
       pthread_t theThread;
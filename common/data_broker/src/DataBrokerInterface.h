@@ -101,6 +101,30 @@ namespace mars {
       __DB_MESSAGE_TYPE_COUNT
     };
 
+    /**
+     * \brief Scheduling state and measured cost of a receiver or producer
+     * registered with a timer.
+     *
+     * The times are wall clock times in microseconds of the receiveData()
+     * or produceData() calls of one timer step, the jitter is in timer
+     * steps.
+     */
+    struct TimedCallbackStatistics {
+      TimedCallbackStatistics() : updatePeriod(0), phase(0), calls(0),
+                                  avgTime(0.0), maxTime(0.0), deviation(0.0),
+                                  intervalJitter(0) {}
+      /** \brief The update period of the registration. */
+      int updatePeriod;
+      /** \brief The offset of the triggers within the period. */
+      long phase;
+      /** \brief The number of timer steps the callback was called in. */
+      unsigned long calls;
+      double avgTime, maxTime, deviation;
+      /** \brief The largest difference between the time of two calls and
+       * the update period. */
+      long intervalJitter;
+    };
+
     /** \brief The interface every DataBroker should implement. */
     class DataBrokerInterface : public lib_manager::LibInterface {
 
@@ -228,6 +252,64 @@ namespace mars {
                                            const std::string &dataName,
                                            const std::string &timerName) = 0;
 
+      /**
+       * \brief shifts the trigger times of a timed receiver
+       *
+       * Receivers with the same update period are all triggered in the
+       * same timer step if they are registered at the same time. Giving
+       * them different phases spreads their cost over the steps of the
+       * period.
+       * \param receiver The receiver whose registrations with the timer
+       *                 should be shifted.
+       * \param timerName The name of the timer.
+       * \param phase The offset of the triggers within the update period.
+       *              The next trigger is the first time \c t after the
+       *              current time with \c t % updatePeriod == \c phase.
+       * \return \c false if the timer doesn't exist or the receiver is not
+       *         registered with it.
+       * \see registerTimedReceiver, getTimedReceiverStatistics
+       */
+      virtual bool setTimedReceiverPhase(ReceiverInterface *receiver,
+                                         const std::string &timerName,
+                                         long phase) = 0;
+
+      /**
+       * \brief returns the update period, phase and the measured cost of a
+       *        timed receiver
+       * \return \c false if the timer doesn't exist or the receiver is not
+       *         registered with it.
+       * \see setTimedReceiverPhase, TimedCallbackStatistics
+       */
+      virtual bool getTimedReceiverStatistics(ReceiverInterface *receiver,
+                                              const std::string &timerName,
+                                              TimedCallbackStatistics *statistics) = 0;
+
+      /**
+       * \brief shifts the trigger times of a timed producer
+       *
+       * Works like setTimedReceiverPhase(). The producers of a timer are
+       * called before its receivers, thus a producer that publishes what
+       * its receivers collected should have the phase of the receivers
+       * plus one timer step.
+       * \return \c false if the timer doesn't exist or the producer is not
+       *         registered with it.
+       * \see registerTimedProducer, getTimedProducerStatistics
+       */
+      virtual bool setTimedProducerPhase(ProducerInterface *producer,
+                                         const std::string &timerName,
+                                         long phase) = 0;
+
+      /**
+       * \brief returns the update period, phase and the measured cost of a
+       *        timed producer
+       * \return \c false if the timer doesn't exist or the producer is not
+       *         registered with it.
+       * \see setTimedProducerPhase, TimedCallbackStatistics
+       */
+      virtual bool getTimedProducerStatistics(ProducerInterface *producer,
+                                              const std::string &timerName,
+                                              TimedCallbackStatistics *statistics) = 0;
+
 
       /**
        * \brief create a new trigger with the given name
@@ -0,0 +1,108 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file LogFormat.h
+ * \brief On disk layout of the DataBroker log files.
+ *
+ * A log file starts with a logFileHeader followed by records. Each record
+ * starts with a logRecordHeader:
+ *   - LOG_RECORD_STREAM: a logStreamHeader followed by the zero terminated
+ *     group name, data name and the names of all columns. Written once
+ *     before the first chunk of the stream.
+ *   - LOG_RECORD_CHUNK: a logChunkHeader followed by the time column and
+ *     one column per item, each holding numRows doubles.
+ *   - LOG_RECORD_INDEX: one logIndexEntry per chunk of the file.
+ * When the file is closed all stream records are repeated, followed by the
+ * index record and a logFileTrailer pointing to the first repeated stream
+ * record. Thus a reader does not need to touch the chunks to open a file.
+ * All records are padded to 8 bytes. Values are stored in host byte order.
+ * A file without trailer (e.g. after a crash) can still be read by
+ * scanning the records; the scan ends at the first zero record type.
+ */
+
+#ifndef MARS_DATA_BROKER_LOG_FORMAT_H
+#define MARS_DATA_BROKER_LOG_FORMAT_H
+
+#ifdef _PRINT_HEADER_
+  #warning "LogFormat.h"
+#endif
+
+#include <stdint.h>
+
+namespace mars {
+  namespace data_broker {
+
+    static const char logFileMagic[8] = {'M','A','R','S','L','O','G','\0'};
+    static const char logIndexMagic[8] = {'M','A','R','S','I','D','X','\0'};
+    static const uint32_t logFormatVersion = 1;
+
+    enum LogRecordType {
+      LOG_RECORD_END = 0, // unused space at the end of an unclosed file
+      LOG_RECORD_STREAM = 1,
+      LOG_RECORD_CHUNK = 2,
+      LOG_RECORD_INDEX = 3
+    };
+
+    struct logFileHeader {
+      char magic[8];
+      uint32_t version;
+      uint32_t rowsPerChunk;
+    };
+
+    struct logRecordHeader {
+      uint32_t type;
+      uint32_t reserved;
+      uint64_t size; ///< size of the payload in bytes including padding
+    };
+
+    struct logStreamHeader {
+      uint32_t streamId;
+      uint32_t numColumns;
+    };
+
+    struct logChunkHeader {
+      uint32_t streamId;
+      uint32_t numRows;
+      uint64_t firstRow; ///< index of the first row within the stream
+      double firstTime, lastTime; ///< simulation time in ms
+    };
+
+    struct logIndexEntry {
+      uint32_t streamId;
+      uint32_t numRows;
+      uint64_t firstRow;
+      uint64_t offset; ///< file offset of the chunk record
+      double firstTime, lastTime;
+    };
+
+    struct logFileTrailer {
+      uint64_t indexOffset; ///< file offset of the repeated stream records
+      char magic[8];
+    };
+
+    inline uint64_t logPadding(uint64_t size) {
+      return (8 - (size & 7)) & 7;
+    }
+
+  } // end of namespace data_broker
+} // end of namespace mars
+
+#endif // MARS_DATA_BROKER_LOG_FORMAT_H
@@ -0,0 +1,312 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "LogReader.h"
+
+#include <mars/utils/misc.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mars {
+  namespace data_broker {
+
+    static bool chunkRowLess(const logIndexEntry &a, const logIndexEntry &b) {
+      return a.firstRow < b.firstRow;
+    }
+
+    LogReader::LogReader() : fd(-1), data(0), size(0) {
+    }
+
+    LogReader::~LogReader() {
+      close();
+    }
+
+    bool LogReader::open(const std::string &filename) {
+      close();
+      fd = ::open(filename.c_str(), O_RDONLY);
+      if(fd == -1) return false;
+      struct stat st;
+      if(fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(logFileHeader)) {
+        close();
+        return false;
+      }
+      size = st.st_size;
+      void *p = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+      if(p == MAP_FAILED) {
+        data = 0;
+        close();
+        return false;
+      }
+      data = (const char*)p;
+      const logFileHeader *header = (const logFileHeader*)data;
+      if(memcmp(header->magic, logFileMagic, sizeof(header->magic)) ||
+         header->version != logFormatVersion) {
+        close();
+        return false;
+      }
+      // the index is only present if the recorder was closed properly
+      if(!readIndex()) {
+        streams.clear();
+        if(!scanRecords()) {
+          close();
+          return false;
+        }
+      }
+      for(size_t i=0; i<streams.size(); ++i) {
+        LogStream &stream = streams[i];
+        std::sort(stream.chunks.begin(), stream.chunks.end(), chunkRowLess);
+        stream.numRows = 0;
+        if(!stream.chunks.empty()) {
+          stream.numRows = (stream.chunks.back().firstRow +
+                            stream.chunks.back().numRows);
+        }
+      }
+      return true;
+    }
+
+    void LogReader::close() {
+      if(data) {
+        munmap((void*)data, size);
+        data = 0;
+      }
+      if(fd != -1) {
+        ::close(fd);
+        fd = -1;
+      }
+      size = 0;
+      streams.clear();
+    }
+
+    bool LogReader::addStream(const char *payload, uint64_t payloadSize) {
+      if(payloadSize < sizeof(logStreamHeader)) return false;
+      const logStreamHeader *header = (const logStreamHeader*)payload;
+      if(header->streamId < streams.size() &&
+         !streams[header->streamId].dataName.empty()) {
+        // already known, the footer repeats all stream records
+        return true;
+      }
+      const char *p = payload + sizeof(logStreamHeader);
+      const char *end = payload + payloadSize;
+      LogStream stream;
+      stream.numRows = 0;
+      size_t len = strnlen(p, end - p);
+      stream.groupName.assign(p, len);
+      p += len+1;
+      if(p >= end) return false;
+      len = strnlen(p, end - p);
+      stream.dataName.assign(p, len);
+      p += len+1;
+      for(uint32_t i=0; i<header->numColumns; ++i) {
+        if(p >= end) return false;
+        len = strnlen(p, end - p);
+        stream.columns.push_back(std::string(p, len));
+        p += len+1;
+      }
+      if(streams.size() <= header->streamId) {
+        streams.resize(header->streamId+1);
+      }
+      stream.chunks.swap(streams[header->streamId].chunks);
+      streams[header->streamId] = stream;
+      return true;
+    }
+
+    bool LogReader::readIndex() {
+      if(size < sizeof(logFileHeader) + sizeof(logFileTrailer)) {
+        return false;
+      }
+      const logFileTrailer *trailer =
+        (const logFileTrailer*)(data + size - sizeof(logFileTrailer));
+      if(memcmp(trailer->magic, logIndexMagic, sizeof(trailer->magic)) ||
+         trailer->indexOffset >= size) {
+        return false;
+      }
+      uint64_t pos = trailer->indexOffset;
+      while(pos + sizeof(logRecordHeader) <= size) {
+        const logRecordHeader *record = (const logRecordHeader*)(data + pos);
+        const char *payload = data + pos + sizeof(logRecordHeader);
+        if(pos + sizeof(logRecordHeader) + record->size > size) return false;
+        if(record->type == LOG_RECORD_STREAM) {
+          if(!addStream(payload, record->size)) return false;
+        }
+        else if(record->type == LOG_RECORD_INDEX) {
+          const logIndexEntry *entries = (const logIndexEntry*)payload;
+          size_t n = record->size / sizeof(logIndexEntry);
+          for(size_t i=0; i<n; ++i) {
+            if(entries[i].streamId >= streams.size()) return false;
+            streams[entries[i].streamId].chunks.push_back(entries[i]);
+          }
+          return true;
+        }
+        else {
+          return false;
+        }
+        pos += sizeof(logRecordHeader) + record->size;
+      }
+      return false;
+    }
+
+    bool LogReader::scanRecords() {
+      uint64_t pos = sizeof(logFileHeader);
+      while(pos + sizeof(logRecordHeader) <= size) {
+        const logRecordHeader *record = (const logRecordHeader*)(data + pos);
+        const char *payload = data + pos + sizeof(logRecordHeader);
+        if(record->type == LOG_RECORD_END ||
+           pos + sizeof(logRecordHeader) + record->size > size) {
+          break;
+        }
+        if(record->type == LOG_RECORD_STREAM) {
+          if(!addStream(payload, record->size)) break;
+        }
+        else if(record->type == LOG_RECORD_CHUNK) {
+          const logChunkHeader *chunk = (const logChunkHeader*)payload;
+          if(record->size < sizeof(logChunkHeader) ||
+             chunk->streamId >= streams.size()) break;
+          logIndexEntry entry;
+          entry.streamId = chunk->streamId;
+          entry.numRows = chunk->numRows;
+          entry.firstRow = chunk->firstRow;
+          entry.offset = pos;
+          entry.firstTime = chunk->firstTime;
+          entry.lastTime = chunk->lastTime;
+          streams[chunk->streamId].chunks.push_back(entry);
+        }
+        else if(record->type == LOG_RECORD_INDEX) {
+          break;
+        }
+        pos += sizeof(logRecordHeader) + record->size;
+      }
+      return true;
+    }
+
+    int LogReader::findStream(const std::string &groupName,
+                              const std::string &dataName) const {
+      for(size_t i=0; i<streams.size(); ++i) {
+        if(utils::matchPattern(groupName, streams[i].groupName) &&
+           utils::matchPattern(dataName, streams[i].dataName)) {
+          return (int)i;
+        }
+      }
+      return -1;
+    }
+
+    int LogReader::findColumn(int streamId, const std::string &name) const {
+      if(streamId < 0 || (size_t)streamId >= streams.size()) return -1;
+      const std::vector<std::string> &columns = streams[streamId].columns;
+      for(size_t i=0; i<columns.size(); ++i) {
+        if(columns[i] == name) return (int)i;
+      }
+      return -1;
+    }
+
+    uint64_t LogReader::getNumRows(int streamId) const {
+      if(streamId < 0 || (size_t)streamId >= streams.size()) return 0;
+      return streams[streamId].numRows;
+    }
+
+    const logChunkHeader* LogReader::getChunk(const logIndexEntry &entry) const {
+      return (const logChunkHeader*)(data + entry.offset +
+                                     sizeof(logRecordHeader));
+    }
+
+    const double* LogReader::getColumn(const logIndexEntry &entry,
+                                       int column) const {
+      // column -1 is the time column
+      const double *columns = (const double*)(getChunk(entry) + 1);
+      return columns + (size_t)(column+1)*entry.numRows;
+    }
+
+    int LogReader::findChunk(const LogStream &stream, uint64_t row) const {
+      size_t lo = 0, hi = stream.chunks.size();
+      while(lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        const logIndexEntry &e = stream.chunks[mid];
+        if(row < e.firstRow) hi = mid;
+        else if(row >= e.firstRow + e.numRows) lo = mid + 1;
+        else return (int)mid;
+      }
+      return -1;
+    }
+
+    bool LogReader::getRow(int streamId, uint64_t row, double *time,
+                           std::vector<double> *values) const {
+      if(streamId < 0 || (size_t)streamId >= streams.size()) return false;
+      const LogStream &stream = streams[streamId];
+      int c = findChunk(stream, row);
+      if(c < 0) return false;
+      const logIndexEntry &entry = stream.chunks[c];
+      uint64_t r = row - entry.firstRow;
+      *time = getColumn(entry, -1)[r];
+      values->resize(stream.columns.size());
+      for(size_t i=0; i<stream.columns.size(); ++i) {
+        (*values)[i] = getColumn(entry, i)[r];
+      }
+      return true;
+    }
+
+    uint64_t LogReader::findRow(int streamId, double time) const {
+      if(streamId < 0 || (size_t)streamId >= streams.size()) return 0;
+      const LogStream &stream = streams[streamId];
+      // the chunks of a stream are ordered in time as well
+      size_t lo = 0, hi = stream.chunks.size();
+      while(lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if(stream.chunks[mid].lastTime < time) lo = mid + 1;
+        else hi = mid;
+      }
+      if(lo == stream.chunks.size()) return stream.numRows;
+      const logIndexEntry &entry = stream.chunks[lo];
+      const double *times = getColumn(entry, -1);
+      const double *t = std::lower_bound(times, times + entry.numRows, time);
+      return entry.firstRow + (t - times);
+    }
+
+    size_t LogReader::getRange(int streamId, int column, double startTime,
+                               double endTime, std::vector<double> *times,
+                               std::vector<double> *values) const {
+      if(streamId < 0 || (size_t)streamId >= streams.size()) return 0;
+      const LogStream &stream = streams[streamId];
+      if(column >= (int)stream.columns.size()) return 0;
+      uint64_t row = findRow(streamId, startTime);
+      size_t count = 0;
+      int c = findChunk(stream, row);
+      if(c < 0) return 0;
+      for(size_t i=c; i<stream.chunks.size(); ++i) {
+        const logIndexEntry &entry = stream.chunks[i];
+        if(entry.firstTime > endTime) break;
+        const double *t = getColumn(entry, -1);
+        const double *v = column < 0 ? 0 : getColumn(entry, column);
+        uint64_t r = (row > entry.firstRow) ? row - entry.firstRow : 0;
+        uint64_t end = r;
+        while(end < entry.numRows && t[end] <= endTime) ++end;
+        if(times) times->insert(times->end(), t + r, t + end);
+        if(values && v) values->insert(values->end(), v + r, v + end);
+        count += end - r;
+        if(end < entry.numRows) break;
+      }
+      return count;
+    }
+
+  } // end of namespace data_broker
+} // end of namespace mars
@@ -0,0 +1,134 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file LogReader.h
+ * \brief Random access to DataBroker log files written by the
+ * DataBrokerRecorder.
+ */
+
+#ifndef MARS_DATA_BROKER_LOG_READER_H
+#define MARS_DATA_BROKER_LOG_READER_H
+
+#ifdef _PRINT_HEADER_
+  #warning "LogReader.h"
+#endif
+
+#include "LogFormat.h"
+
+#include <string>
+#include <vector>
+
+namespace mars {
+  namespace data_broker {
+
+    /**
+     * \brief Description of one recorded DataBroker stream.
+     */
+    struct LogStream {
+      std::string groupName;
+      std::string dataName;
+      std::vector<std::string> columns;
+      uint64_t numRows;
+      std::vector<logIndexEntry> chunks; ///< sorted by row and time
+    };
+
+    /**
+     * \brief Maps a log file read-only and gives random access to its
+     * samples. Chunks are located with a binary search in the chunk index,
+     * the values are read directly from the mapping.
+     *
+     * Example:
+     * \code
+     * LogReader reader;
+     * if(reader.open("run.mlog")) {
+     *   int id = reader.findStream("mars_sim", "Joints/00001_hip");
+     *   int col = reader.findColumn(id, "position");
+     *   std::vector<double> time, position;
+     *   reader.getRange(id, col, 1000.0, 2000.0, &time, &position);
+     * }
+     * \endcode
+     */
+    class LogReader {
+    public:
+      LogReader();
+      ~LogReader();
+
+      /// also reads files that were not closed properly
+      bool open(const std::string &filename);
+      void close();
+
+      const std::vector<LogStream>& getStreams() const {
+        return streams;
+      }
+
+      /**
+       * \brief Returns the id of the first stream matching the patterns
+       * (see utils::matchPattern) or -1.
+       */
+      int findStream(const std::string &groupName,
+                     const std::string &dataName) const;
+      /// returns the column index of the item \c name or -1
+      int findColumn(int streamId, const std::string &name) const;
+
+      uint64_t getNumRows(int streamId) const;
+
+      /**
+       * \brief Reads the row \c row of the stream.
+       * \param values is resized to the number of columns
+       */
+      bool getRow(int streamId, uint64_t row, double *time,
+                  std::vector<double> *values) const;
+
+      /// index of the first row with a time >= \c time
+      uint64_t findRow(int streamId, double time) const;
+
+      /**
+       * \brief Appends all samples of one column with
+       * \c startTime <= time <= \c endTime to \c times and \c values.
+       * A negative \c column only collects the times.
+       * \return number of appended samples
+       */
+      size_t getRange(int streamId, int column, double startTime,
+                      double endTime, std::vector<double> *times,
+                      std::vector<double> *values) const;
+
+    private:
+      const logChunkHeader* getChunk(const logIndexEntry &entry) const;
+      const double* getColumn(const logIndexEntry &entry, int column) const;
+      int findChunk(const LogStream &stream, uint64_t row) const;
+      bool readIndex();
+      bool scanRecords();
+      bool addStream(const char *payload, uint64_t size);
+
+      // disallow copying
+      LogReader(const LogReader &);
+      LogReader &operator=(const LogReader &);
+
+      int fd;
+      const char *data;
+      uint64_t size;
+      std::vector<LogStream> streams;
+    }; // end of class LogReader
+
+  } // end of namespace data_broker
+} // end of namespace mars
+
+#endif // MARS_DATA_BROKER_LOG_READER_H
@@ -0,0 +1,226 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "LogWriter.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace mars {
+  namespace data_broker {
+
+    LogWriter::LogWriter() : fd(-1), window(0), windowOffset(0),
+                             windowSize(0), fileSize(0), pos(0),
+                             extentSize(0) {
+      pageSize = sysconf(_SC_PAGESIZE);
+    }
+
+    LogWriter::~LogWriter() {
+      close();
+    }
+
+    bool LogWriter::open(const std::string &filename,
+                         uint32_t rowsPerChunk, uint64_t extentSize_) {
+      close();
+      fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+      if(fd == -1) return false;
+      extentSize = extentSize_;
+      fileSize = pos = 0;
+      index.clear();
+      streams.clear();
+
+      logFileHeader header;
+      memcpy(header.magic, logFileMagic, sizeof(header.magic));
+      header.version = logFormatVersion;
+      header.rowsPerChunk = rowsPerChunk;
+      if(!mapWindow(sizeof(header))) {
+        close();
+        return false;
+      }
+      memcpy(window + (pos - windowOffset), &header, sizeof(header));
+      pos += sizeof(header);
+      return true;
+    }
+
+    void LogWriter::close() {
+      if(fd == -1) return;
+      if(!index.empty()) {
+        uint64_t indexOffset = pos;
+        bool ok = true;
+        for(size_t i=0; ok && i<streams.size(); ++i) {
+          ok = appendStream(streams[i]);
+        }
+        uint64_t size = index.size()*sizeof(logIndexEntry);
+        char *record = ok ? beginRecord(size) : 0;
+        if(record) {
+          memcpy(record + sizeof(logRecordHeader), &index[0], size);
+          endRecord(record, LOG_RECORD_INDEX, size);
+          logFileTrailer trailer;
+          trailer.indexOffset = indexOffset;
+          memcpy(trailer.magic, logIndexMagic, sizeof(trailer.magic));
+          if(mapWindow(sizeof(trailer))) {
+            memcpy(window + (pos - windowOffset), &trailer, sizeof(trailer));
+            pos += sizeof(trailer);
+          }
+        }
+      }
+      unmapWindow();
+      // cut the unused part of the last extent
+      if(ftruncate(fd, pos) != 0) {
+        // the file is still readable by scanning the records
+      }
+      ::close(fd);
+      fd = -1;
+      index.clear();
+      streams.clear();
+    }
+
+    bool LogWriter::writeStream(uint32_t streamId,
+                                const std::string &groupName,
+                                const std::string &dataName,
+                                const std::vector<std::string> &columns) {
+      streamInfo info;
+      info.id = streamId;
+      info.groupName = groupName;
+      info.dataName = dataName;
+      info.columns = columns;
+      if(!appendStream(info)) return false;
+      streams.push_back(info);
+      return true;
+    }
+
+    bool LogWriter::appendStream(const streamInfo &info) {
+      const std::string &groupName = info.groupName;
+      const std::string &dataName = info.dataName;
+      const std::vector<std::string> &columns = info.columns;
+      uint64_t size = sizeof(logStreamHeader) + groupName.size() + 1 +
+        dataName.size() + 1;
+      for(size_t i=0; i<columns.size(); ++i) {
+        size += columns[i].size() + 1;
+      }
+      char *record = beginRecord(size);
+      if(!record) return false;
+      char *p = record + sizeof(logRecordHeader);
+      logStreamHeader header;
+      header.streamId = info.id;
+      header.numColumns = columns.size();
+      memcpy(p, &header, sizeof(header));
+      p += sizeof(header);
+      memcpy(p, groupName.c_str(), groupName.size()+1);
+      p += groupName.size()+1;
+      memcpy(p, dataName.c_str(), dataName.size()+1);
+      p += dataName.size()+1;
+      for(size_t i=0; i<columns.size(); ++i) {
+        memcpy(p, columns[i].c_str(), columns[i].size()+1);
+        p += columns[i].size()+1;
+      }
+      endRecord(record, LOG_RECORD_STREAM, size);
+      return true;
+    }
+
+    bool LogWriter::writeChunk(const logChunkHeader &header,
+                               const double *columns, uint32_t numColumns,
+                               uint32_t stride) {
+      uint64_t columnSize = header.numRows*sizeof(double);
+      uint64_t size = sizeof(header) + (numColumns+1)*columnSize;
+      uint64_t offset = pos;
+      char *record = beginRecord(size);
+      if(!record) return false;
+      char *p = record + sizeof(logRecordHeader);
+      memcpy(p, &header, sizeof(header));
+      p += sizeof(header);
+      for(uint32_t c=0; c<=numColumns; ++c) {
+        memcpy(p, columns + (size_t)c*stride, columnSize);
+        p += columnSize;
+      }
+      endRecord(record, LOG_RECORD_CHUNK, size);
+
+      logIndexEntry entry;
+      entry.streamId = header.streamId;
+      entry.numRows = header.numRows;
+      entry.firstRow = header.firstRow;
+      entry.offset = offset;
+      entry.firstTime = header.firstTime;
+      entry.lastTime = header.lastTime;
+      index.push_back(entry);
+      return true;
+    }
+
+    char* LogWriter::beginRecord(uint64_t payloadSize) {
+      uint64_t size = sizeof(logRecordHeader) + payloadSize +
+        logPadding(payloadSize);
+      if(!mapWindow(size)) return 0;
+      return window + (pos - windowOffset);
+    }
+
+    void LogWriter::endRecord(char *record, uint32_t type,
+                              uint64_t payloadSize) {
+      uint64_t padding = logPadding(payloadSize);
+      memset(record + sizeof(logRecordHeader) + payloadSize, 0, padding);
+      // the type is written last, a reader of an unclosed file stops at
+      // a record that is not complete yet
+      logRecordHeader header;
+      header.type = LOG_RECORD_END;
+      header.reserved = 0;
+      header.size = payloadSize + padding;
+      memcpy(record, &header, sizeof(header));
+      __sync_synchronize();
+      header.type = type;
+      memcpy(record, &header.type, sizeof(header.type));
+      pos += sizeof(logRecordHeader) + payloadSize + padding;
+    }
+
+    bool LogWriter::mapWindow(uint64_t size) {
+      if(fd == -1) return false;
+      if(window && pos >= windowOffset &&
+         pos + size <= windowOffset + windowSize) {
+        return true;
+      }
+      unmapWindow();
+      uint64_t offset = pos - (pos % pageSize);
+      uint64_t length = pos - offset + size;
+      if(length < extentSize) length = extentSize;
+      length = ((length + pageSize - 1) / pageSize) * pageSize;
+      if(offset + length > fileSize) {
+        // the new space reads as zeros and thus as LOG_RECORD_END
+        if(ftruncate(fd, offset + length) != 0) return false;
+        fileSize = offset + length;
+      }
+      void *p = mmap(0, length, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     fd, offset);
+      if(p == MAP_FAILED) return false;
+      window = (char*)p;
+      windowOffset = offset;
+      windowSize = length;
+      return true;
+    }
+
+    void LogWriter::unmapWindow() {
+      if(window) {
+        munmap(window, windowSize);
+        window = 0;
+        windowSize = 0;
+      }
+    }
+
+  } // end of namespace data_broker
+} // end of namespace mars
@@ -0,0 +1,106 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file LogWriter.h
+ * \brief Appends records to a memory mapped DataBroker log file.
+ */
+
+#ifndef MARS_DATA_BROKER_LOG_WRITER_H
+#define MARS_DATA_BROKER_LOG_WRITER_H
+
+#ifdef _PRINT_HEADER_
+  #warning "LogWriter.h"
+#endif
+
+#include "LogFormat.h"
+
+#include <string>
+#include <vector>
+
+namespace mars {
+  namespace data_broker {
+
+    /**
+     * \brief Append-only writer of the log format described in
+     * LogFormat.h.
+     *
+     * The file is grown and mapped in extents of \c extentSize bytes;
+     * records are copied into the mapping and written back by the kernel.
+     * The stream descriptions and the index of all chunks are kept in
+     * memory and written to the end of the file on close().
+     */
+    class LogWriter {
+    public:
+      LogWriter();
+      ~LogWriter();
+
+      bool open(const std::string &filename, uint32_t rowsPerChunk,
+                uint64_t extentSize = 64*1024*1024);
+      void close();
+      bool isOpen() const {
+        return (fd != -1);
+      }
+
+      bool writeStream(uint32_t streamId, const std::string &groupName,
+                       const std::string &dataName,
+                       const std::vector<std::string> &columns);
+
+      /**
+       * \brief Writes one chunk. \c columns holds the time column followed
+       * by \c numColumns value columns, each column starts \c stride
+       * doubles after the previous one.
+       */
+      bool writeChunk(const logChunkHeader &header, const double *columns,
+                      uint32_t numColumns, uint32_t stride);
+
+      uint64_t getFileSize() const {
+        return pos;
+      }
+
+    private:
+      struct streamInfo {
+        uint32_t id;
+        std::string groupName, dataName;
+        std::vector<std::string> columns;
+      };
+
+      bool appendStream(const streamInfo &info);
+      char* beginRecord(uint64_t payloadSize);
+      void endRecord(char *record, uint32_t type, uint64_t payloadSize);
+      bool mapWindow(uint64_t size);
+      void unmapWindow();
+
+      // disallow copying
+      LogWriter(const LogWriter &);
+      LogWriter &operator=(const LogWriter &);
+
+      int fd;
+      char *window;
+      uint64_t windowOffset, windowSize;
+      uint64_t fileSize, pos, extentSize, pageSize;
+      std::vector<logIndexEntry> index;
+      std::vector<streamInfo> streams;
+    }; // end of class LogWriter
+
+  } // end of namespace data_broker
+} // end of namespace mars
+
+#endif // MARS_DATA_BROKER_LOG_WRITER_H
@@ -7,13 +7,14 @@
  * the normal in the fragment sahder can also be transformed to eyespace instead of this,
  * but this would need more calculations, then doing it in the vertex shader.
  * @param n: the normal attribute at the processed vertex in eye space.
+ * @param tangent: the tangent attribute in model space.
  **/
 
-void bump(vec3 n) {
+void bump(vec3 n, vec3 tangent) {
   // get the tangent in world space (multiplication by gl_NormalMatrix
   // transforms to eye space)
   // the tangent should point in positive u direction on the uv plane in the tangent space.
-  vec3 t = normalize( (osg_ViewMatrixInverse*vec4(gl_NormalMatrix * vertexTangent.xyz, 0.0)).xyz );
+  vec3 t = normalize( (osg_ViewMatrixInverse*vec4(gl_NormalMatrix * tangent, 0.0)).xyz );
   // calculate the binormal, cross makes sure tbn matrix is orthogonal
   // multiplicated by handeness.
   vec3 b = cross(n, t);
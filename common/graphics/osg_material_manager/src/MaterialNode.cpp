@@ -316,6 +316,10 @@ namespace osg_material_manager {
   }
 
   void TangentVisitor::generateTangents(osg::Geometry *geom) {
+    // keep precomputed tangents, e.g. of .bobj version 2 meshes
+    osg::Array *existing = geom->getVertexAttribArray(TANGENT_UNIT);
+    if(existing && existing->getNumElements() > 0) return;
+
     osg::ref_ptr< osgUtil::TangentSpaceGenerator > tsg = new osgUtil::TangentSpaceGenerator;
     // color map unit for texture coordinates
     tsg->generate( geom, DEFAULT_UV_UNIT );
@@ -29,6 +29,7 @@
 #include "OsgMaterial.h"
 #include "OsgMaterialManager.h"
 #include "MaterialNode.h"
+#include "ShaderCache.h"
 #include <osgDB/WriteFile>
 
 #include "shader/shader-generator.h"
@@ -48,6 +49,7 @@
 #endif
 
 #include <cmath>
+#include <sstream>
 
 namespace osg_material_manager {
 
@@ -57,6 +59,7 @@ namespace osg_material_manager {
 
   OsgMaterial::OsgMaterial(std::string resPath)
     : material(0),
+      shaderCache(NULL),
       hasShaderSources(false),
       useShader(true),
       maxNumLights(1),
@@ -434,11 +437,117 @@ namespace osg_material_manager {
     stateSet->removeUniform(envMapSpecularUniform.get());
     stateSet->removeUniform(envMapScaleUniform.get());
     stateSet->removeUniform(terrainScaleZUniform.get());
-    ShaderGenerator shaderGenerator;
-    vector<string> args;
-
     bool hasTexture = checkTexture("environmentMap") || checkTexture("diffuseMap") || checkTexture("normalMap");
+    if(!map.hasKey("shader")) {
+      map["shader"]["PixelLightVertex"] = 1;
+      map["shader"]["PixelLightFragment"] = 1;
+      if(checkTexture("normalMap")) {
+        map["shader"]["NormalMapVertex"] = 1;
+        map["shader"]["NormalMapFragment"] = 1;
+      }
+    }
+
+    // the values of the material are uniforms, they do not change the
+    // generated program
+    if(map["shader"].hasKey("TerrainMapVertex")) {
+      stateSet->addUniform(terrainScaleZUniform.get());
+      terrainScaleZUniform->set((float)(double)map["scaleZ"]);
+    }
+    if(map["shader"].hasKey("EnvMapVertex")) {
+      envMapSpecularUniform->set(osg::Vec3((double)map["envMapSpecular"]["r"],
+                                           (double)map["envMapSpecular"]["g"],
+                                           (double)map["envMapSpecular"]["b"]));
+      stateSet->addUniform(envMapSpecularUniform.get());
+    }
+    if(map["shader"].hasKey("EnvMapFragment")) {
+      envMapScaleUniform->set(osg::Vec3((double)map["envMapScale"]["r"],
+                                        (double)map["envMapScale"]["g"],
+                                        (double)map["envMapScale"]["b"]));
+      stateSet->addUniform(envMapScaleUniform.get());
+    }
+
+    osg::ref_ptr<osg::Program> glslProgram;
+    // shaders loaded from files are not cached, the files may change
+    bool useCache = shaderCache && !map.hasKey("shaderSources");
+    std::string key;
+    if(useCache) {
+      key = getShaderKey(hasTexture);
+      glslProgram = shaderCache->getProgram(key);
+    }
+    if(!glslProgram.valid()) {
+      glslProgram = generateShaderProgram(hasTexture);
+      if(useCache) shaderCache->addProgram(key, glslProgram.get());
+    }
+    if(checkTexture("normalMap")) {
+      glslProgram->addBindAttribLocation( "vertexTangent", TANGENT_UNIT );
+      stateSet->addUniform(bumpNorFacUniform.get());
+    }
+    else {
+      stateSet->removeUniform(bumpNorFacUniform.get());
+    }
+    stateSet->addUniform(noiseMapUniform.get());
+    if(map.get("instanceTransforms", false)) {
+      stateSet->addUniform(new osg::Uniform("instanceMatrices",
+                                            INSTANCE_MATRIX_UNIT));
+    }
+
+    if(hasTexture) {
+      stateSet->addUniform(texScaleUniform.get());
+      stateSet->addUniform(sinUniform.get());
+      stateSet->addUniform(cosUniform.get());
+    }
+    else {
+      stateSet->removeUniform(texScaleUniform.get());
+    }
+
+    if(lastProgram.valid()) {
+      stateSet->removeAttribute(lastProgram.get());
+    }
+    stateSet->setAttributeAndModes(glslProgram.get(),
+                                   osg::StateAttribute::ON);
+
+    stateSet->removeUniform(shadowSamplesUniform.get());
+    stateSet->removeUniform(invShadowSamplesUniform.get());
+    stateSet->removeUniform(invShadowTextureSizeUniform.get());
+    stateSet->removeUniform(shadowScaleUniform.get());
+
+    stateSet->addUniform(shadowSamplesUniform.get());
+    stateSet->addUniform(invShadowSamplesUniform.get());
+    stateSet->addUniform(invShadowTextureSizeUniform.get());
+    stateSet->addUniform(shadowScaleUniform.get());
+
+    lastProgram = glslProgram;
+  }
+
+  /**
+   * The key has to contain every value that is used by
+   * generateShaderProgram() to create the source.
+   */
+  std::string OsgMaterial::getShaderKey(bool hasTexture) {
+    std::stringstream key;
+    key << "lights=" << maxNumLights << ";texture=" << hasTexture
+        << ";worldTexCoords=" << useWorldTexCoords
+        << ";diffuseMap=" << checkTexture("diffuseMap")
+        << ";normalMap=" << checkTexture("normalMap")
+        << ";instancing=" << map.hasKey("instancing")
+        << ";instanceTransforms=" << (bool)map.get("instanceTransforms", false)
+        << ";textures=";
+    std::map<std::string, TextureInfo>::iterator it = textures.begin();
+    for(; it!=textures.end(); ++it) {
+      key << it->second.name << ",";
+    }
+    key << ";shader=";
+    ConfigMap &shader = map["shader"];
+    for(ConfigMap::iterator jt=shader.begin(); jt!=shader.end(); ++jt) {
+      key << jt->first << ",";
+    }
+    key << ";resources=" << resPath;
+    return key.str();
+  }
 
+  osg::Program* OsgMaterial::generateShaderProgram(bool hasTexture) {
+    ShaderGenerator shaderGenerator;
+    vector<string> args;
 
     ShaderFunc *vertexShader = new ShaderFunc;
     {
@@ -469,6 +578,27 @@ namespace osg_material_manager {
         vertexShader->addMainVar( (GLSLVariable)
                                   { "vec4", "specularCol", "gl_FrontMaterial.specular*(0.5+offset.w)" });
       }
+      else if(map.get("instanceTransforms", false)) {
+        // the model matrices of the instances are stored in a float
+        // texture with one row of four texels per instance
+        vertexShader->enableExtension("GL_ARB_draw_instanced");
+        vertexShader->addUniform( (GLSLUniform)
+                                  { "sampler2D", "instanceMatrices" } );
+        vertexShader->addUniform( (GLSLUniform)
+                                  { "float", "instanceTexHeight" } );
+        vertexShader->addMainVar( (GLSLVariable)
+                                  { "float", "instanceRow", "(float(gl_InstanceIDARB)+0.5)/instanceTexHeight" });
+        vertexShader->addMainVar( (GLSLVariable)
+                                  { "mat4", "instanceMatrix", "mat4(texture2DLod(instanceMatrices, vec2(0.125, instanceRow), 0.0), texture2DLod(instanceMatrices, vec2(0.375, instanceRow), 0.0), texture2DLod(instanceMatrices, vec2(0.625, instanceRow), 0.0), texture2DLod(instanceMatrices, vec2(0.875, instanceRow), 0.0))" });
+        vertexShader->addMainVar( (GLSLVariable)
+                                  { "vec4", "vModelPos", "instanceMatrix * gl_Vertex" });
+        vertexShader->addMainVar( (GLSLVariable)
+                                  { "vec4", "vViewPos", "gl_ModelViewMatrix * vModelPos " });
+        vertexShader->addMainVar( (GLSLVariable)
+                                  { "vec4", "vWorldPos", "osg_ViewMatrixInverse * vViewPos " });
+        vertexShader->addMainVar( (GLSLVariable)
+                            { "vec4", "specularCol", "gl_FrontMaterial.specular" });
+      }
       else {
         vertexShader->addMainVar( (GLSLVariable)
                                   { "vec4", "vModelPos", "gl_Vertex" });
@@ -527,14 +657,6 @@ namespace osg_material_manager {
 
     osg::Program *glslProgram;
     args.clear();
-    if(!map.hasKey("shader")) {
-      map["shader"]["PixelLightVertex"] = 1;
-      map["shader"]["PixelLightFragment"] = 1;
-      if(checkTexture("normalMap")) {
-        map["shader"]["NormalMapVertex"] = 1;
-        map["shader"]["NormalMapFragment"] = 1;
-      }
-    }
     if(map.hasKey("shader")) {
       bool havePCol = false;
       if(map["shader"].hasKey("TerrainMapVertex")) {
@@ -550,8 +672,6 @@ namespace osg_material_manager {
         // need to recalculate view pos
         vertexShader->addMainVar( (GLSLVariable)
                                   { "", "vViewPos", "gl_ModelViewMatrix * vModelPos " });
-        stateSet->addUniform(terrainScaleZUniform.get());
-        terrainScaleZUniform->set((float)(double)map["scaleZ"]);
       }
       if(map["shader"].hasKey("PixelLightVertex")) {
         PixelLightVert *plightVert = new PixelLightVert(args, maxNumLights,
@@ -562,16 +682,22 @@ namespace osg_material_manager {
         BumpMapVert *bumpVert = new BumpMapVert(args, resPath);
         shaderGenerator.addShaderFunction(bumpVert, SHADER_TYPE_VERTEX);
       }
+      if(map.get("instanceTransforms", false)) {
+        // the normal and tangent have to be rotated by the instance
+        // matrix before the usual transformation
+        vertexShader->addMainVar( (GLSLVariable)
+                                  { "vec4", "n", "normalize(osg_ViewMatrixInverse * vec4(gl_NormalMatrix * (mat3(instanceMatrix) * gl_Normal), 0.0))" });
+        if(map["shader"].hasKey("NormalMapVertex")) {
+          vertexShader->addMainVar( (GLSLVariable)
+                                    { "vec3", "modelTangent", "mat3(instanceMatrix) * vertexTangent.xyz" });
+        }
+      }
       if(map["shader"].hasKey("NormalMapFragment")) {
         BumpMapFrag *bumpFrag = new BumpMapFrag(args, resPath);
         shaderGenerator.addShaderFunction(bumpFrag, SHADER_TYPE_FRAGMENT);
       }
 
       if(map["shader"].hasKey("EnvMapVertex")) {
-        envMapSpecularUniform->set(osg::Vec3((double)map["envMapSpecular"]["r"],
-                                            (double)map["envMapSpecular"]["g"],
-                                            (double)map["envMapSpecular"]["b"]));
-        stateSet->addUniform(envMapSpecularUniform.get());
         vertexShader->addUniform( (GLSLUniform) { "vec3", "envMapSpecular" } );
         vertexShader->addUniform( (GLSLUniform) { "sampler2D", "environmentMap" } );
 
@@ -593,10 +719,6 @@ namespace osg_material_manager {
       }
       if(map["shader"].hasKey("EnvMapFragment")) {
         havePCol = true;
-        envMapScaleUniform->set(osg::Vec3((double)map["envMapScale"]["r"],
-                                          (double)map["envMapScale"]["g"],
-                                          (double)map["envMapScale"]["b"]));
-        stateSet->addUniform(envMapScaleUniform.get());
         fragmentShader->addUniform( (GLSLUniform) { "vec3", "envMapScale" } );
         fragmentShader->addMainVar( (GLSLVariable) { "vec4", "scale",
               "texture2D(environmentMap, texCoord)" }, 2);
@@ -666,41 +788,7 @@ namespace osg_material_manager {
     else {
       glslProgram = shaderGenerator.generate();
     }
-    if(checkTexture("normalMap")) {
-      glslProgram->addBindAttribLocation( "vertexTangent", TANGENT_UNIT );
-      stateSet->addUniform(bumpNorFacUniform.get());
-    }
-    else {
-      stateSet->removeUniform(bumpNorFacUniform.get());
-    }
-    stateSet->addUniform(noiseMapUniform.get());
-
-    if(hasTexture) {
-      stateSet->addUniform(texScaleUniform.get());
-      stateSet->addUniform(sinUniform.get());
-      stateSet->addUniform(cosUniform.get());
-    }
-    else {
-      stateSet->removeUniform(texScaleUniform.get());
-    }
-
-    if(lastProgram.valid()) {
-      stateSet->removeAttribute(lastProgram.get());
-    }
-    stateSet->setAttributeAndModes(glslProgram,
-                                   osg::StateAttribute::ON);
-
-    stateSet->removeUniform(shadowSamplesUniform.get());
-    stateSet->removeUniform(invShadowSamplesUniform.get());
-    stateSet->removeUniform(invShadowTextureSizeUniform.get());
-    stateSet->removeUniform(shadowScaleUniform.get());
-
-    stateSet->addUniform(shadowSamplesUniform.get());
-    stateSet->addUniform(invShadowSamplesUniform.get());
-    stateSet->addUniform(invShadowTextureSizeUniform.get());
-    stateSet->addUniform(shadowScaleUniform.get());
-
-    lastProgram = glslProgram;
+    return glslProgram;
   }
 
   void OsgMaterial::setNoiseImage(osg::Image *i) {
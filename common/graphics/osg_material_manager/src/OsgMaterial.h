@@ -43,12 +43,14 @@
 #include <osg/Group>
 #include <osg/Uniform>
 #include <osg/Texture2D>
+#include <osg/Program>
 
 #define COLOR_MAP_UNIT 0
 #define NORMAL_MAP_UNIT 1
 #define SHADOW_MAP_UNIT 2
 #define BUMP_MAP_UNIT 3
 #define NOISE_MAP_UNIT 4
+#define INSTANCE_MATRIX_UNIT 6
 #define TANGENT_UNIT 7
 #define DEFAULT_UV_UNIT 0
 
@@ -63,6 +65,7 @@
 namespace osg_material_manager {
 
   class MaterialNode;
+  class ShaderCache;
 
   class TextureInfo {
   public:
@@ -92,6 +95,9 @@ namespace osg_material_manager {
     void setMaxNumLights(int n);
 
     void setUseShader(bool val);
+    /** \brief Shares the generated programs with other materials; has to
+     * be set before setMaterial(). */
+    void setShaderCache(ShaderCache *cache) {shaderCache = cache;}
     void setNoiseImage(osg::Image *i);
     void setShadowScale(float v);
     void setShadowSamples(int v);
@@ -129,6 +135,7 @@ namespace osg_material_manager {
     // new implementation for generic texture handling
     std::map<std::string, TextureInfo> textures;
 
+    ShaderCache *shaderCache;
     bool hasShaderSources;
     bool useShader;
     int maxNumLights;
@@ -142,6 +149,9 @@ namespace osg_material_manager {
     osg::Vec4 getColor(std::string key);
     void setColor(std::string color, std::string key, std::string value);
     osg::Texture2D* loadTerrainTexture(std::string filename);
+    /// describes all features that change the generated shader source
+    std::string getShaderKey(bool hasTexture);
+    osg::Program* generateShaderProgram(bool hasTexture);
 }; // end of class OsgMaterial
 
 } // end of namespace osg_material_manager
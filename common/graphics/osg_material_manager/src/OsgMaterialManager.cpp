@@ -56,7 +56,16 @@ namespace osg_material_manager {
       shadowSamples = cfg->getOrCreateProperty("Graphics",
                                                "shadowSamples",
                                                shadowSamples.iValue, this);
+      // the generated shader sources are kept between sessions;
+      // an empty path disables the disk cache
+      std::string configPath = cfg->getOrCreateProperty("Config", "config_path",
+                                                        std::string(".")).sValue;
+      shaderCachePath = cfg->getOrCreateProperty("Graphics", "shaderCachePath",
+                                                 configPath+"/shader_cache",
+                                                 this);
+      shaderCache.setCachePath(shaderCachePath.sValue);
     }
+    shaderCache.setResourcePath(resPath.sValue+"/mars/osg_material_manager/resources");
     noiseImage = new osg::Image();
     noiseImage->allocateImage(128, 128, 4, GL_RGBA, GL_UNSIGNED_BYTE);
     updateShadowSamples();
@@ -159,6 +168,12 @@ namespace osg_material_manager {
     }
     if(_property.paramId == resPath.paramId) {
       resPath.sValue = _property.sValue;
+      shaderCache.setResourcePath(resPath.sValue+"/mars/osg_material_manager/resources");
+      return;
+    }
+    if(_property.paramId == shaderCachePath.paramId) {
+      shaderCachePath.sValue = _property.sValue;
+      shaderCache.setCachePath(shaderCachePath.sValue);
       return;
     }
   }
@@ -178,6 +193,7 @@ namespace osg_material_manager {
     if(it == materialMap.end()) {
       OsgMaterial *m = new OsgMaterial(resPath.sValue+"/mars/osg_material_manager/resources");
       m->setShadowTextureSize(shadowTextureSize);
+      m->setShaderCache(&shaderCache);
       m->setMaterial(map);
       m->setUseShader(useShader);
       m->setNoiseImage(noiseImage.get());
@@ -194,6 +210,12 @@ namespace osg_material_manager {
     if(it != materialMap.end()) {
       it->second->setMaterial(map);
     }
+    it = materialMap.find(instancedName(name));
+    if(it != materialMap.end()) {
+      configmaps::ConfigMap instancedMap = map;
+      instancedMap["instanceTransforms"] = true;
+      it->second->setMaterial(instancedMap);
+    }
   }
 
   void OsgMaterialManager::editMaterial(const std::string &name,
@@ -204,6 +226,10 @@ namespace osg_material_manager {
     if(it != materialMap.end()) {
       it->second->edit(key, value);
     }
+    it = materialMap.find(instancedName(name));
+    if(it != materialMap.end()) {
+      it->second->edit(key, value);
+    }
   }
 
   osg::ref_ptr<MaterialNode> OsgMaterialManager::getNewMaterialGroup(const std::string &name) {
@@ -228,8 +254,36 @@ namespace osg_material_manager {
     }
   }
 
+  osg::ref_ptr<MaterialNode> OsgMaterialManager::getNewInstancedMaterialGroup(const std::string &name) {
+    std::string variant = instancedName(name);
+    if(materialMap.find(variant) == materialMap.end()) {
+      std::map<std::string, osg::ref_ptr<OsgMaterial> >::iterator it;
+      it = materialMap.find(name);
+      if(it == materialMap.end()) {
+        return NULL;
+      }
+      configmaps::ConfigMap map = it->second->getMaterialData();
+      map["instanceTransforms"] = true;
+      createMaterial(variant, map);
+    }
+    return getNewMaterialGroup(variant);
+  }
+
   void OsgMaterialManager::removeMaterialGroup(osg::ref_ptr<osg::Group> group) {
-    // todo
+    std::vector<osg::ref_ptr<MaterialNode> >::iterator it = materialNodes.begin();
+    for(; it!=materialNodes.end(); ++it) {
+      if(it->get() == group.get()) {
+        MaterialNode *n = it->get();
+        while(n->getNumParents()) {
+          osg::Group *parent = n->getParent(0);
+          OsgMaterial *m = dynamic_cast<OsgMaterial*>(parent);
+          if(m) m->removeMaterialNode(n);
+          parent->removeChild(n);
+        }
+        materialNodes.erase(it);
+        return;
+      }
+    }
   }
 
   void OsgMaterialManager::updateLights(std::vector<mars::interfaces::LightData*> &lightList) {
@@ -321,6 +375,8 @@ namespace osg_material_manager {
     std::vector<configmaps::ConfigMap> list;
     std::map<std::string, osg::ref_ptr<OsgMaterial> >::iterator it = materialMap.begin();
     for(; it!=materialMap.end(); ++it) {
+      // the instanced variants are internal copies
+      if(it->first.find("#instanced") != std::string::npos) continue;
       list.push_back(it->second->getMaterialData());
     }
     return list;
@@ -32,6 +32,7 @@
 #endif
 
 #include "OsgMaterial.h"
+#include "ShaderCache.h"
 
 #include <lib_manager/LibInterface.hpp>
 #include <mars/cfg_manager/CFGManagerInterface.h>
@@ -72,6 +73,14 @@ namespace osg_material_manager {
     void editMaterial(const std::string &name, const std::string &key,
                       const std::string &value);
     osg::ref_ptr<MaterialNode> getNewMaterialGroup(const std::string &name);
+    /**
+     * \brief Returns a group of the instanced variant of the material.
+     *
+     * The variant reads the model matrix of every instance from the
+     * texture bound to INSTANCE_MATRIX_UNIT. It is created on first use
+     * and follows all changes of the original material.
+     */
+    osg::ref_ptr<MaterialNode> getNewInstancedMaterialGroup(const std::string &name);
     void removeMaterialGroup(osg::ref_ptr<osg::Group> group);
     void setShadowSamples(int v);
 
@@ -97,6 +106,8 @@ namespace osg_material_manager {
                                   float openingAngle);
     void updateShadowSamples();
 
+    const ShaderCache& getShaderCache() const {return shaderCache;}
+
     static osg::ref_ptr<osg::Texture2D> loadTexture(std::string filename);
     static osg::ref_ptr<osg::Image> loadImage(std::string filename);
 
@@ -105,9 +116,15 @@ namespace osg_material_manager {
     osg::ref_ptr<osg::Group> mainStateGroup;
     osg::ref_ptr<osg::Image> noiseImage;
     mars::cfg_manager::cfgPropertyStruct resPath, shadowSamples;
+    mars::cfg_manager::cfgPropertyStruct shaderCachePath;
+    ShaderCache shaderCache;
     std::map<std::string, osg::ref_ptr<OsgMaterial> > materialMap;
     std::vector<osg::ref_ptr<MaterialNode> > materialNodes;
 
+    static std::string instancedName(const std::string &name) {
+      return name + "#instanced";
+    }
+
     // most properties are currently global settings
     // global OsgMaterial properties
     bool useShader;
@@ -0,0 +1,182 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ShaderCache.h"
+
+#include <mars/utils/misc.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#ifdef WIN32
+  #include <process.h>
+  #define getpid _getpid
+#else
+  #include <unistd.h>
+#endif
+
+namespace osg_material_manager {
+
+  using namespace std;
+
+  // increase if the format of the cache files changes
+  static const int cacheVersion = 1;
+
+  ShaderCache::ShaderCache() {
+    statistics.hits = statistics.diskHits = statistics.misses = 0;
+  }
+
+  void ShaderCache::setCachePath(const std::string &path) {
+    cachePath = path;
+    if(!cachePath.empty()) {
+      if(!mars::utils::createDirectory(cachePath)) {
+        fprintf(stderr, "ShaderCache: cannot create %s, disk cache disabled\n",
+                cachePath.c_str());
+        cachePath.clear();
+      }
+    }
+  }
+
+  void ShaderCache::setResourcePath(const std::string &path) {
+    // the generated sources include these files
+    const char *files[] = {"plight.vert", "plight.frag",
+                           "normalmap.vert", "normalmap.frag"};
+    unsigned long long h = hash("");
+    for(size_t i=0; i<sizeof(files)/sizeof(files[0]); ++i) {
+      std::ifstream t((path+"/shader/"+files[i]).c_str());
+      std::stringstream buffer;
+      buffer << t.rdbuf();
+      h = hash(buffer.str(), h);
+    }
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", h);
+    resourceFingerprint = hex;
+  }
+
+  unsigned long long ShaderCache::hash(const std::string &s,
+                                       unsigned long long h) {
+    for(size_t i=0; i<s.size(); ++i) {
+      h ^= (unsigned char)s[i];
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
+
+  osg::Program* ShaderCache::getProgram(const std::string &key) {
+    std::map<std::string, osg::ref_ptr<osg::Program> >::iterator it;
+    it = programs.find(key);
+    if(it != programs.end()) {
+      ++statistics.hits;
+      return it->second.get();
+    }
+    osg::Program *program = loadProgram(key);
+    if(program) {
+      ++statistics.diskHits;
+      programs[key] = program;
+      return program;
+    }
+    ++statistics.misses;
+    return NULL;
+  }
+
+  void ShaderCache::addProgram(const std::string &key,
+                               osg::Program *program) {
+    programs[key] = program;
+    writeProgram(key, program);
+  }
+
+  std::string ShaderCache::getCacheFile(const std::string &key) const {
+    char name[40];
+    snprintf(name, sizeof(name), "/%016llx.glsl",
+             hash(key, hash(resourceFingerprint)));
+    return cachePath + name;
+  }
+
+  /**
+   * A cache file starts with the version and the full key to detect hash
+   * collisions, followed by the shaders as "<type> <length>" lines each
+   * followed by the source.
+   */
+  osg::Program* ShaderCache::loadProgram(const std::string &key) {
+    if(cachePath.empty()) return NULL;
+    std::ifstream file(getCacheFile(key).c_str(), std::ios::binary);
+    if(!file.good()) return NULL;
+
+    int version = 0;
+    std::string line;
+    file >> version;
+    std::getline(file, line);
+    if(version != cacheVersion) return NULL;
+    std::getline(file, line);
+    if(line != key) return NULL;
+    std::getline(file, line);
+    if(line != resourceFingerprint) return NULL;
+
+    osg::ref_ptr<osg::Program> program = new osg::Program();
+    int type;
+    size_t length;
+    while(file >> type >> length) {
+      file.get();
+      std::string source(length, '\0');
+      if(length && !file.read(&source[0], length)) return NULL;
+      if(type != osg::Shader::VERTEX && type != osg::Shader::FRAGMENT &&
+         type != osg::Shader::GEOMETRY) {
+        return NULL;
+      }
+      osg::Shader *shader = new osg::Shader((osg::Shader::Type)type);
+      shader->setShaderSource(source);
+      program->addShader(shader);
+    }
+    if(!program->getNumShaders()) return NULL;
+    return program.release();
+  }
+
+  void ShaderCache::writeProgram(const std::string &key,
+                                 osg::Program *program) {
+    if(cachePath.empty()) return;
+    // write to a temporary file first, several processes may share the
+    // cache directory
+    std::string filename = getCacheFile(key);
+    std::stringstream tmpName;
+    tmpName << filename << "." << getpid() << ".tmp";
+    {
+      std::ofstream file(tmpName.str().c_str(), std::ios::binary);
+      if(!file.good()) return;
+      file << cacheVersion << "\n" << key << "\n"
+           << resourceFingerprint << "\n";
+      for(unsigned int i=0; i<program->getNumShaders(); ++i) {
+        const osg::Shader *shader = program->getShader(i);
+        const std::string &source = shader->getShaderSource();
+        file << (int)shader->getType() << " " << source.size() << "\n"
+             << source;
+      }
+      if(!file.good()) {
+        file.close();
+        remove(tmpName.str().c_str());
+        return;
+      }
+    }
+    if(rename(tmpName.str().c_str(), filename.c_str()) != 0) {
+      remove(tmpName.str().c_str());
+    }
+  }
+
+} // end of namespace osg_material_manager
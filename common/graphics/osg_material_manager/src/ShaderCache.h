@@ -0,0 +1,100 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ *  ShaderCache.h
+ *  Shares the generated GLSL programs between materials.
+ */
+
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#ifdef _PRINT_HEADER_
+  #warning "ShaderCache.h"
+#endif
+
+#include <string>
+#include <map>
+
+#include <osg/Program>
+
+namespace osg_material_manager {
+
+  /**
+   * \brief Caches the GLSL programs by the shader features of a material.
+   *
+   * Materials which only differ in colors, textures or other uniforms
+   * generate the same source and can use the same osg::Program; thus the
+   * program is compiled only once per graphics context. If a cache path is
+   * set the generated sources are stored there as well and are reused
+   * in the next session without running the shader generator.
+   *
+   * The key is a string describing the features (e.g. lights, normal map,
+   * terrain). It has to contain everything that changes the generated
+   * source. The cache files are named by a hash of the key and a
+   * fingerprint of the shader resource files.
+   */
+  class ShaderCache {
+  public:
+    struct Statistics {
+      unsigned long hits;
+      unsigned long diskHits;
+      unsigned long misses;
+    };
+
+    ShaderCache();
+
+    /** \brief Sets the directory for the source cache; an empty path
+     * disables the disk cache. */
+    void setCachePath(const std::string &path);
+    /** \brief Sets the directory of the shader resource files; their
+     * content is part of the key of the disk cache. */
+    void setResourcePath(const std::string &path);
+
+    /**
+     * \brief Returns the program for the given feature key or NULL.
+     *
+     * A program found in the disk cache is created and added to the
+     * memory cache.
+     */
+    osg::Program* getProgram(const std::string &key);
+    /// adds a newly generated program and writes its sources to disk
+    void addProgram(const std::string &key, osg::Program *program);
+
+    const Statistics& getStatistics() const {return statistics;}
+    size_t getNumPrograms() const {return programs.size();}
+
+    /// 64 bit FNV-1a hash
+    static unsigned long long hash(const std::string &s,
+                                   unsigned long long h=14695981039346656037ULL);
+
+  private:
+    std::map<std::string, osg::ref_ptr<osg::Program> > programs;
+    std::string cachePath, resourceFingerprint;
+    Statistics statistics;
+
+    std::string getCacheFile(const std::string &key) const;
+    osg::Program* loadProgram(const std::string &key);
+    void writeProgram(const std::string &key, osg::Program *program);
+  }; // end of class ShaderCache
+
+} // end of namespace osg_material_manager
+
+#endif /* SHADER_CACHE_H */
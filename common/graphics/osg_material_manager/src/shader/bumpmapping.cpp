@@ -32,7 +32,9 @@ namespace osg_material_manager {
   BumpMapVert::BumpMapVert(vector<string> &args, std::string resPath)
     : ShaderFunc("bump", args) {
     funcs[0].second.push_back("n.xyz");
+    funcs[0].second.push_back("modelTangent");
     addAttribute( (GLSLAttribute) { "vec4", "vertexTangent" });
+    addMainVar( (GLSLVariable) { "vec3", "modelTangent", "vertexTangent.xyz" });
     addVarying( (GLSLVarying) { "mat3", "ttw" } );
 
     resPath += "/shader/normalmap.vert";
@@ -41,7 +41,7 @@ namespace mars {
       main_gui::BaseWidget(parent, cfg, "DataBrokerWidget"),
       pDialog(new main_gui::PropertyDialog(parent)),
       dataBroker(_dataBroker),
-      ignore_change(0) {
+      ignore_change(0), updateSubscriptions(false), widgetVisible(false) {
 
       startTimer(500);
 
@@ -57,6 +57,8 @@ namespace mars {
       showAll = false;
       showAllProperty = pDialog->addGenericProperty("data_broker/ShowAll", 
                                                     QVariant::Bool, showAll);
+      connect(pDialog, SIGNAL(visibilityChanged()),
+              this, SLOT(visibilityChanged()));
    
       if(dataBroker) {
         dataBroker->registerSyncReceiver(this, "data_broker", "newStream",
@@ -65,12 +67,10 @@ namespace mars {
         std::vector<DataInfo>::iterator it;
         infoList = dataBroker->getDataList();
 
+        // the receivers are registered once the rows are shown
         for(it=infoList.begin(); it!=infoList.end(); ++it) {
           if(it->flags & data_broker::DATA_PACKAGE_WRITE_FLAG) {
             addParam(*it);
-            dataBroker->registerTimedReceiver(this, it->groupName, it->dataName,
-                                              "_REALTIME_", 250);
-            //          dataBroker->registerAsyncReceiver(this, it->groupName, it->dataName);
           }
         }
       }  
@@ -87,6 +87,7 @@ namespace mars {
       paramWrapper newParam;
       newParam.info = _info;
       newParam.dataPackage = dataBroker->getDataPackage(_info.dataId);
+      newParam.subscribed = false;
       addList[_info.dataId] = newParam;
     
       addMutex.unlock();
@@ -95,7 +96,6 @@ namespace mars {
     void DataWidget::receiveData(const DataInfo &info,
                                  const data_broker::DataPackage &dataPackage,
                                  int callbackParam) {
-      changeMutex.lock();
       if(callbackParam == CALLBACK_NEW_STREAM) {
         DataInfo newInfo;
         dataPackage.get("groupName", &newInfo.groupName);
@@ -104,22 +104,88 @@ namespace mars {
         dataPackage.get("flags", (int*)&newInfo.flags);
         if(showAll || newInfo.flags & data_broker::DATA_PACKAGE_WRITE_FLAG) {
           addParam(newInfo);
-          dataBroker->registerTimedReceiver(this, newInfo.groupName, 
-                                            newInfo.dataName, "_REALTIME_", 250);
-          //        dataBroker->registerAsyncReceiver(this, newInfo.groupName, newInfo.dataName);
         }
       } else {
         map<unsigned long, paramWrapper>::iterator it;
+        listMutex.lock();
         it = paramList.find(info.dataId);
-        if(it != paramList.end()) {
-          listMutex.lock();
-          //        assert(it->second.dataPackage.size());
-          it->second.dataPackage = dataPackage;
-          listMutex.unlock();
+        if(it != paramList.end() &&
+           updateValues(&it->second.dataPackage, dataPackage)) {
           changeList.insert(info.dataId);
         }
+        listMutex.unlock();
+      }
+    }
+
+    bool DataWidget::updateValues(data_broker::DataPackage *slot,
+                                  const data_broker::DataPackage &dataPackage) {
+      if(slot->size() != dataPackage.size()) {
+        *slot = dataPackage;
+        return true;
+      }
+      // only the values are copied, the item names are kept
+      bool changed = false;
+      for(size_t i=0; i<dataPackage.size(); ++i) {
+        DataItem &item = (*slot)[i];
+        const DataItem &newItem = dataPackage[i];
+        if(item.type != newItem.type) {
+          item = newItem;
+          changed = true;
+          continue;
+        }
+        switch(item.type) {
+        case data_broker::DOUBLE_TYPE:
+          if(item.d != newItem.d) {item.d = newItem.d; changed = true;}
+          break;
+        case data_broker::FLOAT_TYPE:
+          if(item.f != newItem.f) {item.f = newItem.f; changed = true;}
+          break;
+        case data_broker::INT_TYPE:
+          if(item.i != newItem.i) {item.i = newItem.i; changed = true;}
+          break;
+        case data_broker::UINT_TYPE:
+          if(item.ui != newItem.ui) {item.ui = newItem.ui; changed = true;}
+          break;
+        case data_broker::LONG_TYPE:
+          if(item.l != newItem.l) {item.l = newItem.l; changed = true;}
+          break;
+        case data_broker::ULONG_TYPE:
+          if(item.ul != newItem.ul) {item.ul = newItem.ul; changed = true;}
+          break;
+        case data_broker::BOOL_TYPE:
+          if(item.b != newItem.b) {item.b = newItem.b; changed = true;}
+          break;
+        case data_broker::STRING_TYPE:
+          if(item.s != newItem.s) {item.s = newItem.s; changed = true;}
+          break;
+        case data_broker::UNDEFINED_TYPE:
+          break;
+        }
+      }
+      return changed;
+    }
+
+    void DataWidget::subscribe(paramWrapper *param, bool subscribe) {
+      param->subscribed = subscribe;
+      if(!subscribe) {
+        dataBroker->unregisterTimedReceiver(this, param->info.groupName,
+                                            param->info.dataName, "_REALTIME_");
+        return;
       }
-      changeMutex.unlock();
+      dataBroker->registerTimedReceiver(this, param->info.groupName,
+                                        param->info.dataName, "_REALTIME_", 250);
+      // the row may show an outdated value
+      data_broker::DataPackage dataPackage;
+      dataPackage = dataBroker->getDataPackage(param->info.dataId);
+      listMutex.lock();
+      if(updateValues(&param->dataPackage, dataPackage)) {
+        changeList.insert(param->info.dataId);
+      }
+      listMutex.unlock();
+    }
+
+    void DataWidget::visibilityChanged() {
+      updateSubscriptions = true;
     }
 
     void DataWidget::timerEvent(QTimerEvent* event) {
@@ -187,6 +253,7 @@ namespace mars {
           }
           it->second.guiElements.push_back(guiElem);
           if(!it->second.guiElements.empty()) {
+            updateSubscriptions = true;
             listMutex.lock();
             paramList[it->first] = it->second;
             guiToWrapper[guiElem] = &paramList[it->first];//it->second;
@@ -204,9 +271,31 @@ namespace mars {
     
       ignore_change = false;
       addMutex.unlock();
-      // and check for updates
-      changeMutex.lock();
+
+      // only streams with a shown row have a receiver
+      if(isVisible() != widgetVisible) {
+        widgetVisible = !widgetVisible;
+        updateSubscriptions = true;
+      }
+      if(updateSubscriptions) {
+        updateSubscriptions = false;
+        for(it=paramList.begin(); it!=paramList.end(); ++it) {
+          bool visible = false;
+          for(unsigned int i = 0; widgetVisible && !visible &&
+                i < it->second.guiElements.size(); ++i) {
+            visible = (it->second.guiElements[i] &&
+                       pDialog->isPropertyVisible(it->second.guiElements[i]));
+          }
+          if(visible != it->second.subscribed) {
+            subscribe(&it->second, visible);
+          }
+        }
+      }
+
+      // and check for updates, all rows are refreshed in one pass
+      listMutex.lock();
       ignore_change = true;
+      pDialog->setUpdatesEnabled(false);
       while(changeList.size() > 0) {
         it = paramList.find(*changeList.begin());
         if(it != paramList.end() && !it->second.guiElements.empty()) {
@@ -248,8 +337,9 @@ namespace mars {
         }
         changeList.erase(changeList.begin());
       }
+      pDialog->setUpdatesEnabled(true);
       ignore_change = false;
-      changeMutex.unlock();
+      listMutex.unlock();
     }
 
     void DataWidget::valueChanged(QtProperty *property, const QVariant &value) {
@@ -272,7 +362,6 @@ namespace mars {
         assert(newShowAll != showAll);
         dataBroker->unregisterAsyncReceiver(this, "*", "*");
         dataBroker->unregisterTimedReceiver(this, "*", "*", "_REALTIME_");
-        changeMutex.lock();
         addMutex.lock();
         listMutex.lock();
         changeList.clear();
@@ -286,7 +375,6 @@ namespace mars {
         guiToWrapper.clear();
         listMutex.unlock();
         addMutex.unlock();
-        changeMutex.unlock();
 
         showAll = newShowAll;
 
@@ -294,9 +382,6 @@ namespace mars {
         for(it=infoList.begin(); it!=infoList.end(); ++it) {
           if(newShowAll || it->flags & data_broker::DATA_PACKAGE_WRITE_FLAG) {
             addParam(*it);
-            dataBroker->registerTimedReceiver(this, it->groupName, it->dataName,
-                                              "_REALTIME_", 250);
-            //dataBroker->registerAsyncReceiver(this, it->groupName, it->dataName);
           }
         }
         return;
@@ -310,6 +395,7 @@ namespace mars {
             it2 != it3->second->guiElements.end() && *it2 != property; 
             ++it2, ++idx) /* do nothing */ ;
       
+        listMutex.lock();
         item = &it3->second->dataPackage[idx];
         //item2 = &paramList[it->second.info.dataId].dataPackage[idx];
 
@@ -361,8 +447,9 @@ namespace mars {
         // don't supply a default case so that the compiler might warn
         // us if we forget to handle a new enum value.
         }
-        dataBroker->pushData(it3->second->info.dataId,
-                             it3->second->dataPackage);
+        data_broker::DataPackage dataPackage = it3->second->dataPackage;
+        listMutex.unlock();
+        dataBroker->pushData(it3->second->info.dataId, dataPackage);
       }
     }
 
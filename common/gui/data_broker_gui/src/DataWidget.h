@@ -56,8 +56,11 @@ namespace mars {
 
     struct paramWrapper {
       data_broker::DataInfo info;
+      // the last received values, updated in place
       data_broker::DataPackage dataPackage;
       std::vector<QtVariantProperty*> guiElements;
+      // true while a timed receiver is registered for the stream
+      bool subscribed;
     };
   
     class DataWidget : public main_gui::BaseWidget,
@@ -86,8 +89,8 @@ namespace mars {
       QtProperty *showAllProperty;
       bool showAll;
       QMutex addMutex;
+      // guards the values in paramList and the changeList
       QMutex listMutex;
-      QMutex changeMutex;
 
       set<unsigned long> changeList;
       map<unsigned long, paramWrapper> addList;
@@ -95,9 +98,15 @@ namespace mars {
       //    map<std::vector<QtVariantProperty*>*, paramWrapper> guiToWrapper;
       map<QtVariantProperty*, paramWrapper*> guiToWrapper;
       bool ignore_change;
+      bool updateSubscriptions, widgetVisible;
+
+      void subscribe(paramWrapper *param, bool subscribe);
+      static bool updateValues(data_broker::DataPackage *slot,
+                               const data_broker::DataPackage &dataPackage);
     
     protected slots:
       void timerEvent(QTimerEvent* event);
+      void visibilityChanged();
       virtual void accept();
       virtual void reject();
     
@@ -2,8 +2,17 @@
 #include "DataBrokerPlotterLib.h"
 
 #include<QVBoxLayout>
+#include <cmath>
+#include <cstdio>
 
 namespace data_broker_plotter {
+
+  // samples kept per plot
+  static const size_t plotBufferSize = 1 << 17;
+  // samples that can be queued between two updates
+  static const size_t maxQueuedSamples = 1 << 16;
+  // lower bound for the number of decimation buckets
+  static const int minBuckets = 100;
   
   DataBrokerPlotter::DataBrokerPlotter(DataBrokerPlotterLib *_mainLib,
                                mars::data_broker::DataBrokerInterface *_dataBroker,
@@ -11,7 +20,7 @@ namespace data_broker_plotter {
                                std::string _name, QWidget *parent) : 
     mars::main_gui::BaseWidget(parent, cfg, _name),
     dataBroker(_dataBroker), mainLib(_mainLib),
-    name(_name), nextPlotId(1) {
+    name(_name), droppedSamples(0), reportedDrops(0), nextPlotId(1) {
   
     setStyleSheet("background-color:#eeeeee;");
 
@@ -47,64 +56,49 @@ namespace data_broker_plotter {
     dataLock.lock();
     dataBroker->unregisterSyncReceiver(this, "*", "*");
 
+    for(size_t i=0; i<plots.size(); ++i) {
+      delete plots[i];
+    }
     delete qcPlot;
   }
 
   void DataBrokerPlotter::update() {
     std::vector<Plot*>::iterator it;
     Plot *p;
-    double x;
-    int ix;
-    double xmin;
-    double sTime, xRange;
+    double xRange;
+
+    // take the received samples, the receiver is only blocked for the swap
+    queueLock.lock();
+    processQueue.swap(sampleQueue);
+    unsigned long dropped = droppedSamples;
+    queueLock.unlock();
+    if(dropped != reportedDrops) {
+      dataBroker->pushWarning("DataBrokerPlotter %s: dropped %lu samples",
+                              name.c_str(), dropped-reportedDrops);
+      reportedDrops = dropped;
+    }
 
-    // first handle panding dataPackages
     dataLock.lock();
-    while(!packageList.empty()) {
-      mars::data_broker::DataPackage &dataPackage = packageList.front().dp;
-      int callbackParam = packageList.front().callbackParam;
+    for(size_t i=0; i<processQueue.size(); ++i) {
+      int callbackParam = processQueue[i].callbackParam;
+      double x = processQueue[i].value;
       for(it=plots.begin(); it!=plots.end(); ++it) {
         if((*it)->dpId == callbackParam/10) {
           p = *it;
 
-          if(dataPackage[0].type == mars::data_broker::DOUBLE_TYPE)
-            dataPackage.get(0, &x);
-          else if(dataPackage[0].type == mars::data_broker::INT_TYPE) {
-            dataPackage.get(0, &ix);
-            x = (double)ix;
-          }
-
           if(callbackParam % 10) {
-            x = x*p->yScale.dValue+p->yOffset.dValue;
-            p->yValues.push_back(x);
+            p->nextY = x*p->yScale.dValue+p->yOffset.dValue;
             p->gotNewData |= 1;
           }
           else {
-            p->xValues.push_back(x);
-            if((xRange = fabs(p->xRange.dValue)) < 0.000001)
-              xRange = fabs(plots[0]->xRange.dValue);
-            if(xRange > 0.0000001) {
-              xmin = x-xRange;
-              while(!p->xValues.empty() && p->xValues.front() < xmin) {
-                p->xValues.pop_front();
-                p->yValues.pop_front();
-              }
-            }
+            p->nextX = x;
             p->gotNewData |= 2;
           }
-          /*
-          if((sTime = fabs(p->sTime.dValue)) < 0.000001) {
-            sTime = fabs(plots[0]->sTime.dValue);
+          if(p->gotNewData == 3) {
+            appendSample(p, p->nextX, p->nextY);
+            p->gotNewData = 0;
           }
-          if(sTime > 0.00000001) {
-            if(x-p->xValues.back() < sTime) {
-              dataLock.unlock();
-              return;
-            }
-          }
-          */
 
-        
           if(!p->gotData) {
             p->gotData = true;
             createNewPlot();
@@ -113,31 +107,123 @@ namespace data_broker_plotter {
           break;
         }
       }
-      packageList.pop_front();
     }
+    processQueue.clear();
 
+    // adapt the decimation to the visible range and the plot width
+    int pixels = qcPlot->xAxis->axisRect()->width();
+    if(pixels < minBuckets) pixels = minBuckets;
     bool onlyEnlarge = false;
     for(it=plots.begin(); it!=plots.end(); ++it) {
-      if((*it)->gotNewData == 3) {
-        (*it)->curve->setData((*it)->xValues, (*it)->yValues);
-        (*it)->curve->rescaleAxes(onlyEnlarge);
-        onlyEnlarge = true;
-        (*it)->gotNewData = 0;
+      p = *it;
+      if(!p->dirty) continue;
+      if((xRange = getXRange(p)) < 0.0000001 && p->buffer->size() > 1) {
+        xRange = p->buffer->x(p->buffer->size()-1) - p->buffer->x(0);
+      }
+      double bucketWidth = xRange / pixels;
+      if(bucketWidth > 0.0 &&
+         (bucketWidth > 2*p->bucketWidth || bucketWidth < 0.5*p->bucketWidth)) {
+        rebuildCurve(p, bucketWidth);
       }
+      p->curve->rescaleAxes(onlyEnlarge);
+      onlyEnlarge = true;
+      p->dirty = false;
     }
-    qcPlot->replot();
+    if(onlyEnlarge) qcPlot->replot();
     dataLock.unlock();
   }
 
+  double DataBrokerPlotter::getXRange(Plot *p) const {
+    double xRange;
+    if((xRange = fabs(p->xRange.dValue)) < 0.000001)
+      xRange = fabs(plots[0]->xRange.dValue);
+    return xRange;
+  }
+
+  void DataBrokerPlotter::appendSample(Plot *p, double x, double y) {
+    if(p->buffer->push(x, y)) {
+      // the oldest sample was overwritten
+      p->curve->removeDataBefore(p->buffer->x(0));
+    }
+    double xRange = getXRange(p);
+    if(xRange > 0.0000001) {
+      double xmin = x-xRange;
+      p->buffer->removeBefore(xmin);
+      p->curve->removeDataBefore(xmin);
+    }
+    addToCurve(p, x, y);
+    p->dirty = true;
+  }
+
+  void DataBrokerPlotter::addToCurve(Plot *p, double x, double y) {
+    if(p->bucketWidth <= 0.0) {
+      p->curve->addData(x, y);
+      return;
+    }
+    if(!p->bucketOpen || x < p->bucketStart ||
+       x >= p->bucketStart+p->bucketWidth) {
+      // the points of the previous bucket stay in the curve
+      p->bucketStart = floor(x/p->bucketWidth)*p->bucketWidth;
+      p->minX = p->maxX = x;
+      p->minY = p->maxY = y;
+      p->bucketOpen = true;
+    }
+    else {
+      if(y < p->minY) {
+        p->minY = y;
+        p->minX = x;
+      }
+      if(y > p->maxY) {
+        p->maxY = y;
+        p->maxX = x;
+      }
+      // replace the points of the open bucket
+      for(int i=0; i<p->numEmitted; ++i) {
+        p->curve->data()->remove(p->emittedKeys[i]);
+      }
+    }
+    p->curve->addData(p->minX, p->minY);
+    p->emittedKeys[0] = p->minX;
+    p->numEmitted = 1;
+    if(p->maxX != p->minX) {
+      p->curve->addData(p->maxX, p->maxY);
+      p->emittedKeys[p->numEmitted++] = p->maxX;
+    }
+  }
+
+  void DataBrokerPlotter::rebuildCurve(Plot *p, double bucketWidth) {
+    p->bucketWidth = bucketWidth;
+    p->bucketOpen = false;
+    p->numEmitted = 0;
+    p->curve->clearData();
+    for(size_t i=0; i<p->buffer->size(); ++i) {
+      addToCurve(p, p->buffer->x(i), p->buffer->y(i));
+    }
+  }
+
   void DataBrokerPlotter::receiveData(const mars::data_broker::DataInfo &info,
                                   const mars::data_broker::DataPackage &dataPackage,
                                   int callbackParam) {
+    SampleData sample;
+    sample.callbackParam = callbackParam;
+    if(dataPackage[0].type == mars::data_broker::DOUBLE_TYPE) {
+      dataPackage.get(0, &sample.value);
+    }
+    else if(dataPackage[0].type == mars::data_broker::INT_TYPE) {
+      int ix;
+      dataPackage.get(0, &ix);
+      sample.value = (double)ix;
+    }
+    else return;
 
-    dataLock.lock();
-
-    packageList.push_back((PackageData){dataPackage, callbackParam});
-
-    dataLock.unlock();
+    queueLock.lock();
+    if(sampleQueue.size() < maxQueuedSamples) {
+      sampleQueue.push_back(sample);
+    }
+    else {
+      ++droppedSamples;
+    }
+    queueLock.unlock();
   }
   
   void DataBrokerPlotter::createNewPlot() {
@@ -162,6 +248,7 @@ namespace data_broker_plotter {
     newCurve->setLineStyle( QCPGraph::lsLine );
 
     newPlot->curve = newCurve;
+    newPlot->buffer = new PlotBuffer(plotBufferSize);
     
     plots.push_back(newPlot);
 
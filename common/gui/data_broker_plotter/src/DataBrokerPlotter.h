@@ -12,6 +12,7 @@
 #endif
 
 #include "qcustomplot.h"
+#include "PlotBuffer.h"
 #include <QPainter>
 #include <QCloseEvent>
 #include <QMutex>
@@ -29,21 +30,32 @@ namespace data_broker_plotter {
 
   class Plot {
   public:
+    Plot() : buffer(NULL), gotNewData(0), dirty(false), bucketWidth(0.0),
+             bucketStart(0.0), bucketOpen(false), numEmitted(0) {}
+    ~Plot() {delete buffer;}
+
     std::string name;
     QCPGraph *curve;
-    QVector<double> xValues;
-    QVector<double> yValues;
+    PlotBuffer *buffer;
     mars::data_broker::DataPackage dpPackage;
     int dpId, gotNewData;
-    bool gotData;
+    double nextX, nextY;
+    bool gotData, dirty;
+    // min/max decimation of the buffer into the curve: each bucket of
+    // bucketWidth is represented by its minimum and maximum sample
+    double bucketWidth, bucketStart;
+    double minX, minY, maxX, maxY;
+    bool bucketOpen;
+    double emittedKeys[2];
+    int numEmitted;
     QMutex mutex;
     mars::cfg_manager::cfgPropertyStruct xRange, yScale, sTime, yOffset;
     std::map<mars::cfg_manager::cfgParamId, mars::cfg_manager::cfgPropertyStruct*> cfgParamIdProp;
   };
 
-  class PackageData {
+  class SampleData {
   public:
-    mars::data_broker::DataPackage dp;
+    double value;
     int callbackParam;
   };
 
@@ -73,9 +85,11 @@ namespace data_broker_plotter {
     mars::data_broker::DataBrokerInterface *dataBroker;
     DataBrokerPlotterLib *mainLib;
     QCustomPlot *qcPlot;
-    QMutex dataLock;
+    QMutex dataLock, queueLock;
     std::string name;
-    std::list<PackageData> packageList;
+    // received samples, bounded by maxQueuedSamples
+    std::vector<SampleData> sampleQueue, processQueue;
+    unsigned long droppedSamples, reportedDrops;
 
     void shiftDown( QRect &rect, int offset ) const;
 
@@ -85,6 +99,10 @@ namespace data_broker_plotter {
     int nextPlotId;
 
     void createNewPlot();
+    void appendSample(Plot *p, double x, double y);
+    void addToCurve(Plot *p, double x, double y);
+    void rebuildCurve(Plot *p, double bucketWidth);
+    double getXRange(Plot *p) const;
     QColor colors[8];
 
   };
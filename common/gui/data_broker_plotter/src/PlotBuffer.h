@@ -0,0 +1,80 @@
+/**
+ * \file PlotBuffer.h
+ * \brief Fixed capacity sample history of one plot.
+ **/
+
+#ifndef DATA_BROKER_PLOTTER_PLOT_BUFFER_H
+#define DATA_BROKER_PLOTTER_PLOT_BUFFER_H
+
+#ifdef _PRINT_HEADER_
+#warning "PlotBuffer.h"
+#endif
+
+#include <vector>
+#include <cstddef>
+
+namespace data_broker_plotter {
+
+  /**
+   * \brief Ring buffer of (x, y) samples. When the buffer is full the
+   * oldest sample is overwritten, thus the memory of a plot does not grow
+   * with the plotted time. Samples are indexed from the oldest (0) to the
+   * newest (size()-1).
+   */
+  class PlotBuffer {
+  public:
+    explicit PlotBuffer(size_t capacity) : xs(capacity), ys(capacity),
+                                           first(0), count(0) {}
+
+    /// \return \c true if the oldest sample was overwritten
+    bool push(double x, double y) {
+      size_t i = first + count;
+      if(i >= xs.size()) i -= xs.size();
+      xs[i] = x;
+      ys[i] = y;
+      if(count < xs.size()) {
+        ++count;
+        return false;
+      }
+      if(++first == xs.size()) first = 0;
+      return true;
+    }
+
+    /// removes all samples with an x value smaller than \c x
+    void removeBefore(double x) {
+      while(count && xs[first] < x) {
+        if(++first == xs.size()) first = 0;
+        --count;
+      }
+    }
+
+    void clear() {
+      first = count = 0;
+    }
+
+    size_t size() const {
+      return count;
+    }
+    bool empty() const {
+      return count == 0;
+    }
+    double x(size_t i) const {
+      return xs[index(i)];
+    }
+    double y(size_t i) const {
+      return ys[index(i)];
+    }
+
+  private:
+    size_t index(size_t i) const {
+      i += first;
+      return i < xs.size() ? i : i - xs.size();
+    }
+
+    std::vector<double> xs, ys;
+    size_t first, count;
+  };
+
+} // end of namespace: data_broker_plotter
+
+#endif // DATA_BROKER_PLOTTER_PLOT_BUFFER_H
@@ -69,6 +69,14 @@ namespace mars {
       connect(variantEditorButton, SIGNAL(currentItemChanged(QtBrowserItem*)),
               this, SLOT(currentItemChanged(QtBrowserItem*)),
               Qt::DirectConnection);
+      connect(variantEditorTree, SIGNAL(expanded(QtBrowserItem*)),
+              this, SIGNAL(visibilityChanged()));
+      connect(variantEditorTree, SIGNAL(collapsed(QtBrowserItem*)),
+              this, SIGNAL(visibilityChanged()));
+      connect(variantEditorButton, SIGNAL(expanded(QtBrowserItem*)),
+              this, SIGNAL(visibilityChanged()));
+      connect(variantEditorButton, SIGNAL(collapsed(QtBrowserItem*)),
+              this, SIGNAL(visibilityChanged()));
 
 
       buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok|QDialogButtonBox::Cancel,
@@ -114,6 +122,8 @@ namespace mars {
         vBoxLayout->insertWidget(0, tabWidget);
         tabWidget->show();
         tabView = true;
+        connect(tabWidget, SIGNAL(currentChanged(int)),
+                this, SIGNAL(visibilityChanged()));
       }
 
       int tabExists = false;
@@ -137,6 +147,8 @@ namespace mars {
       myTabs.insert(pair<QString, PropertyDialog*>(label, page));
       connect(page, SIGNAL(tabValueChanged(QtProperty*, const QVariant&)),
               this, SLOT(valueChanged(QtProperty*, const QVariant&)));
+      connect(page, SIGNAL(visibilityChanged()),
+              this, SIGNAL(visibilityChanged()));
 
       return page->addGenericProperty(rest, type, value, attributes, options);
     }
@@ -271,6 +283,29 @@ namespace mars {
       collapseTree(variantEditorTree->items(parent));
     }
 
+    bool PropertyDialog::isPropertyVisible(QtProperty *property) const {
+      if(tabView) {
+        PropertyDialog *page = qobject_cast<PropertyDialog*>(tabWidget->currentWidget());
+        return page && page->isPropertyVisible(property);
+      }
+      QList<QtBrowserItem*> items;
+      if(viewMode == TreeViewMode) {
+        items = variantEditorTree->items(property);
+      } else {
+        items = variantEditorButton->items(property);
+      }
+      if(items.isEmpty()) return false;
+      for(QtBrowserItem *item = items.front()->parent(); item;
+          item = item->parent()) {
+        if(viewMode == TreeViewMode) {
+          if(!variantEditorTree->isExpanded(item)) return false;
+        } else if(!variantEditorButton->isExpanded(item)) {
+          return false;
+        }
+      }
+      return true;
+    }
+
 
     QtVariantProperty* PropertyDialog::addGenericProperty(QtVariantProperty *parent,
                                                           QtVariantProperty *property) {
@@ -522,6 +557,7 @@ namespace mars {
         break;
       }
       updateGeometry();
+      emit visibilityChanged();
     }
 
 
@@ -212,6 +212,13 @@ namespace mars {
       //! Collapses the branch of the property \c item.
       void collapseTree(QtProperty *item);
 
+      /**
+       * \brief Returns \c true if the row of the property is shown, i.e.
+       *        its tab is the current one and all its parents are expanded.
+       * \see visibilityChanged()
+       */
+      bool isPropertyVisible(QtProperty *property) const;
+
     protected:
       //! A vertical layout.
       QVBoxLayout *vBoxLayout;
@@ -324,6 +331,12 @@ namespace mars {
        * */
       void tabValueChanged(QtProperty *property, const QVariant &value);
 
+      /**
+       * \brief Emitted when a branch is expanded or collapsed, the tab
+       *        or the view mode changes.
+       */
+      void visibilityChanged();
+
     }; // end class PropertyDialog
 
 
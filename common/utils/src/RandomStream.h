@@ -0,0 +1,96 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MARS_UTILS_RANDOMSTREAM_H
+#define MARS_UTILS_RANDOMSTREAM_H
+
+#include <stdint.h>
+#include <cmath>
+#include <string>
+
+namespace mars {
+  namespace utils {
+
+    /**
+     * \brief A seeded random number generator that does not share any state
+     * with rand() or other streams.
+     *
+     * Every subsystem that needs random numbers owns its own stream, whose
+     * seed is derived from one base seed and the subsystem name with
+     * deriveSeed(). Thus the numbers one subsystem draws do not depend on
+     * how often or in which order the others draw. The generator is
+     * splitmix64, which is fast and has a state of one integer that can be
+     * stored in a checkpoint.
+     */
+    class RandomStream {
+    public:
+      explicit RandomStream(uint64_t seed = 0) : state(seed) {}
+
+      void setSeed(uint64_t seed) {
+        state = seed;
+      }
+
+      uint64_t getState() const {
+        return state;
+      }
+
+      uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+      }
+
+      /// uniform in [0, 1)
+      double uniform() {
+        return (next() >> 11) * (1.0 / 9007199254740992.0);
+      }
+
+      double uniform(double min, double max) {
+        return min + uniform() * (max - min);
+      }
+
+      /// normal distribution (Box-Muller)
+      double normal(double mean, double std) {
+        double u1 = 1.0 - uniform(); // (0, 1]
+        double u2 = uniform();
+        return mean + std * sqrt(-2.0*log(u1)) * cos(2.0*M_PI*u2);
+      }
+
+      /// the seed of the stream \c name for the base seed \c seed
+      static uint64_t deriveSeed(uint64_t seed, const std::string &name) {
+        // FNV-1a of the name mixed into the base seed
+        uint64_t h = 0xCBF29CE484222325ULL;
+        for(size_t i=0; i<name.size(); ++i) {
+          h ^= (unsigned char)name[i];
+          h *= 0x100000001B3ULL;
+        }
+        RandomStream mix(seed ^ h);
+        return mix.next();
+      }
+
+    private:
+      uint64_t state;
+    };
+
+  } // end of namespace utils
+} // end of namespace mars
+
+#endif // MARS_UTILS_RANDOMSTREAM_H
@@ -0,0 +1,97 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef MARS_UTILS_TRIPLEBUFFER_H
+#define MARS_UTILS_TRIPLEBUFFER_H
+
+#include "Mutex.h"
+
+namespace mars {
+  namespace utils {
+
+    /**
+     * \brief Exchanges values of type T between exactly one writer and one
+     * reader thread without the two ever waiting for each other.
+     *
+     * The writer fills writeBuffer() and calls publish(), the reader calls
+     * update() and then works on readBuffer(). Both threads own their buffer
+     * exclusively; the third buffer holds the latest published value. The
+     * mutex only guards the swap of two indices. A value that is published
+     * several times before the reader catches up is simply overwritten.
+     */
+    template <typename T>
+    class TripleBuffer {
+    public:
+      TripleBuffer() : writeIndex(0), readyIndex(1), readIndex(2),
+                       fresh(false) {}
+
+      /// the buffer the writer may fill, only to be used by the writer
+      T& writeBuffer() {
+        return buffers[writeIndex];
+      }
+
+      /// makes the content of writeBuffer() available to the reader
+      void publish() {
+        mutex.lock();
+        int tmp = readyIndex;
+        readyIndex = writeIndex;
+        writeIndex = tmp;
+        fresh = true;
+        mutex.unlock();
+      }
+
+      /**
+       * \brief Fetches the latest published value into readBuffer().
+       * \return \c true if a new value was published since the last call.
+       */
+      bool update() {
+        bool result = false;
+        mutex.lock();
+        if(fresh) {
+          int tmp = readyIndex;
+          readyIndex = readIndex;
+          readIndex = tmp;
+          fresh = false;
+          result = true;
+        }
+        mutex.unlock();
+        return result;
+      }
+
+      /// the buffer of the reader, only to be used by the reader
+      T& readBuffer() {
+        return buffers[readIndex];
+      }
+
+    private:
+      // disallow copying
+      TripleBuffer(const TripleBuffer &);
+      TripleBuffer &operator=(const TripleBuffer &);
+
+      T buffers[3];
+      int writeIndex, readyIndex, readIndex;
+      bool fresh;
+      Mutex mutex;
+    }; // end of class TripleBuffer
+
+  } // end of namespace utils
+} // end of namespace mars
+
+#endif /* MARS_UTILS_TRIPLEBUFFER_H */
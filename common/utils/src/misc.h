@@ -80,6 +80,21 @@ namespace mars {
 #endif
     }
 
+    /**
+     * @return current time in microseconds
+     */
+    inline long long getTimeMicro() {
+#ifdef WIN32
+      struct timeb timer;
+      ftime(&timer);
+      return (long long)(timer.time*1000000LL + timer.millitm*1000LL);
+#else
+      struct timeval timer;
+      gettimeofday(&timer, NULL);
+      return ((long long)(timer.tv_sec))*1000000LL + timer.tv_usec;
+#endif
+    }
+
     /**
      * @brief returns the time difference between now and a given reference.
      * @param start reference time
@@ -26,9 +26,12 @@
  */
 
 #include "DrawObject.h"
+#include "ScreenErrorLOD.h"
 #include "gui_helper_functions.h"
 #include "../wrapper/OSGMaterialStruct.h"
 
+#include <mars/interfaces/Logging.hpp>
+
 #include <iostream>
 
 #include <osg/CullFace>
@@ -69,6 +72,7 @@ namespace mars {
         selected_(false),
         selectable_(true),
         group_(0),
+        autoLod(false),
         posTransform_(0),
         scaleTransform_(0),
         maxNumLights(1),
@@ -80,6 +84,7 @@ namespace mars {
 
     DrawObject::~DrawObject() {
       if(materialNode.valid()) materialNode->removeChild(posTransform_.get());
+      if(instanceGroup.valid()) instanceGroup->removeChild(posTransform_.get());
       if(!sharedStateGroup) {
         // todo: remove materialnode from manager
       }
@@ -172,6 +177,28 @@ namespace mars {
       }
     }
 
+    void DrawObject::addLODGeodesByError(std::list< osg::ref_ptr< osg::Geode > > geodes,
+                                         float error) {
+      std::list< osg::ref_ptr< osg::Geode > >::iterator it;
+      if(!lod.valid()) {
+        lod = new ScreenErrorLOD();
+      }
+      ScreenErrorLOD *errorLod = dynamic_cast<ScreenErrorLOD*>(lod.get());
+      if(!errorLod) {
+        LOG_WARN("DrawObject: distance and error based levels of detail can not be mixed");
+        return;
+      }
+      osg::ref_ptr<osg::Group> level = new osg::Group();
+      for(it=geodes.begin(); it!=geodes.end(); ++it) {
+        level->addChild(it->get());
+        for(unsigned int i=0; i<it->get()->getNumDrawables(); ++i) {
+          osg::Drawable *draw = it->get()->getDrawable(i);
+          geometry_.push_back(draw->asGeometry());
+        }
+      }
+      errorLod->addChild(level.get(), error);
+    }
+
     void DrawObject::setStateFilename(const std::string &filename, int create) {
       stateFilename_ = filename;
       if (create) {
@@ -206,6 +233,7 @@ namespace mars {
         // todo: remove materialNode from manager
         materialNode = g->getMaterialNode(name);
       }
+      materialName_ = name;
       if(show_) {
         show();
       }
@@ -315,13 +343,64 @@ namespace mars {
       if(!materialNode.valid()) return;
       hide();
       isHidden = false;
-      materialNode->addChild(posTransform_.get());
+      if(instanceGroup.valid()) {
+        instanceGroup->addChild(posTransform_.get());
+      }
+      else {
+        materialNode->addChild(posTransform_.get());
+      }
     }
 
     void DrawObject::hide() {
       if(!materialNode.valid()) return;
       isHidden = true;
       materialNode->removeChild(posTransform_.get());
+      if(instanceGroup.valid()) {
+        instanceGroup->removeChild(posTransform_.get());
+      }
+    }
+
+    bool DrawObject::isInstanceable() const {
+      if(!materialNode.valid() || isHidden || selected_ ||
+         (lod.valid() && !autoLod) || group_->getNumChildren() == 0) {
+        return false;
+      }
+      // objects with an own render bin have to be drawn on their own
+      const osg::StateSet *state = group_->getStateSet();
+      if(state && state->useRenderBinDetails() &&
+         state->getBinNumber() != 0) {
+        return false;
+      }
+      for(unsigned int i=0; i<group_->getNumChildren(); ++i) {
+        const osg::Geode *geode = group_->getChild(i)->asGeode();
+        if(!geode) return false;
+        for(unsigned int j=0; j<geode->getNumDrawables(); ++j) {
+          if(!geode->getDrawable(j)->asGeometry()) return false;
+        }
+      }
+      return true;
+    }
+
+    void DrawObject::getInstanceMatrix(osg::Matrix *matrix) const {
+      // walk down from the position to the scale transform, .STL files
+      // have an additional transform in between
+      matrix->makeIdentity();
+      osg::Node *node = posTransform_.get();
+      while(node) {
+        osg::Transform *transform = node->asTransform();
+        if(transform) transform->computeLocalToWorldMatrix(*matrix, NULL);
+        if(node == scaleTransform_.get()) break;
+        osg::Group *group = node->asGroup();
+        node = (group && group->getNumChildren()) ? group->getChild(0) : NULL;
+      }
+    }
+
+    void DrawObject::setInstanceGroup(osg::Group *group) {
+      if(instanceGroup.get() == group) return;
+      bool show_ = !isHidden;
+      hide();
+      instanceGroup = group;
+      if(show_) show();
     }
 
     void DrawObject::seperateMaterial() {
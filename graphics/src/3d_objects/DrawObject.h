@@ -148,9 +148,35 @@ namespace mars {
       osg_material_manager::MaterialNode* getStateGroup() {return materialNode.get();}
       void addLODGeodes(std::list< osg::ref_ptr< osg::Geode > > geodes,
                         float start, float end);
+      /**
+       * \brief Adds a level of detail that is selected by its geometric
+       * \c error projected to the screen (see ScreenErrorLOD); the levels
+       * have to be added from fine to coarse.
+       */
+      void addLODGeodesByError(std::list< osg::ref_ptr< osg::Geode > > geodes,
+                               float error);
 
       void seperateMaterial();
 
+      const std::string& getMaterialName() const {
+        return materialName_;
+      }
+      /**
+       * \brief Returns \c true if the object can be drawn as instance of an
+       * InstanceBatch, i.e. it is shown with its plain geometry and state.
+       * Generated levels of detail (see getLodCacheFile()) do not prevent
+       * instancing, the batch draws the full mesh instead.
+       */
+      bool isInstanceable() const;
+      /// the transformation from the geometry to world coordinates
+      void getInstanceMatrix(osg::Matrix *matrix) const;
+      /**
+       * \brief If \c group is set the object is drawn by an InstanceBatch;
+       * the transform is moved to \c group which is not drawn but
+       * keeps the object pickable.
+       */
+      void setInstanceGroup(osg::Group *group);
+
     protected:
       unsigned long id_;
       unsigned int nodeMask_;
@@ -158,10 +184,13 @@ namespace mars {
       std::string stateFilename_;
       bool selected_, selectable_, showSelected;
       osg::ref_ptr<osg_material_manager::MaterialNode> materialNode;
+      osg::ref_ptr<osg::Group> instanceGroup;
+      std::string materialName_;
       osg::ref_ptr<osg::Group> group_;
       std::list< osg::ref_ptr<osg::Geometry> > geometry_;
       osg::ref_ptr<osg::Geode> normal_geode;
       osg::ref_ptr<osg::LOD> lod;
+      bool autoLod; ///< the levels of detail are generated from the mesh
       osg::ref_ptr<osg::PositionAttitudeTransform> posTransform_;
       osg::ref_ptr<osg::MatrixTransform> scaleTransform_;
 
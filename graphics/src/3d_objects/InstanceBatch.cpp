@@ -0,0 +1,139 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "InstanceBatch.h"
+#include "DrawObject.h"
+
+#include <osg/ComputeBoundsVisitor>
+#include <osg/Geode>
+
+#include <mars/osg_material_manager/OsgMaterial.h>
+
+namespace mars {
+  namespace graphics {
+
+    /**
+     * The geometries are drawn at the positions of all instances, thus
+     * their bound is the bound of all members and not the one of the
+     * vertices.
+     */
+    class InstanceBatch::BoundCallback :
+      public osg::Drawable::ComputeBoundingBoxCallback {
+    public:
+      virtual osg::BoundingBox computeBound(const osg::Drawable&) const {
+        return box;
+      }
+      osg::BoundingBox box;
+    };
+
+    InstanceBatch::InstanceBatch(osg_material_manager::MaterialNode *materialNode,
+                                 osg::Group *source, unsigned int nodeMask)
+      : materialNode(materialNode), root(new osg::Group),
+        boundCallback(new BoundCallback), capacity(0) {
+
+      osg::ComputeBoundsVisitor cbbv;
+      source->accept(cbbv);
+      sourceBox = cbbv.getBoundingBox();
+
+      // the batch shares the vertex arrays of the source geometries but
+      // needs own primitive sets to set the number of instances
+      for(unsigned int i=0; i<source->getNumChildren(); ++i) {
+        osg::Geode *sourceGeode = source->getChild(i)->asGeode();
+        if(!sourceGeode) continue;
+        osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+        geode->setStateSet(sourceGeode->getStateSet());
+        for(unsigned int j=0; j<sourceGeode->getNumDrawables(); ++j) {
+          osg::Geometry *sourceGeometry = sourceGeode->getDrawable(j)->asGeometry();
+          if(!sourceGeometry) continue;
+          osg::ref_ptr<osg::Geometry> geometry =
+            new osg::Geometry(*sourceGeometry, osg::CopyOp::DEEP_COPY_PRIMITIVES);
+          geometry->setComputeBoundingBoxCallback(boundCallback.get());
+          geometry->setUseDisplayList(false);
+          geometry->setUseVertexBufferObjects(true);
+          geode->addDrawable(geometry.get());
+          geometries.push_back(geometry);
+        }
+        root->addChild(geode.get());
+      }
+
+      matrixImage = new osg::Image;
+      matrixTexture = new osg::Texture2D;
+      matrixTexture->setDataVariance(osg::Object::DYNAMIC);
+      matrixTexture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::NEAREST);
+      matrixTexture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::NEAREST);
+      matrixTexture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+      matrixTexture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+      matrixTexture->setResizeNonPowerOfTwoHint(false);
+      matrixTexture->setUnRefImageDataAfterApply(false);
+      matrixTexture->setInternalFormat(GL_RGBA32F_ARB);
+      texHeightUniform = new osg::Uniform("instanceTexHeight", 1.0f);
+
+      osg::StateSet *state = root->getOrCreateStateSet();
+      state->setTextureAttribute(INSTANCE_MATRIX_UNIT, matrixTexture.get());
+      state->addUniform(texHeightUniform.get());
+      root->setNodeMask(nodeMask);
+      materialNode->addChild(root.get());
+    }
+
+    InstanceBatch::~InstanceBatch() {
+      materialNode->removeChild(root.get());
+    }
+
+    void InstanceBatch::update() {
+      unsigned int n = members.size();
+      if(n > capacity) {
+        // grow in powers of two to not reallocate the texture every frame
+        capacity = capacity ? capacity : 16;
+        while(capacity < n) capacity *= 2;
+        matrixImage->allocateImage(4, capacity, 1, GL_RGBA, GL_FLOAT);
+        matrixImage->setInternalTextureFormat(GL_RGBA32F_ARB);
+        matrixTexture->setImage(matrixImage.get());
+        matrixTexture->dirtyTextureObject();
+        texHeightUniform->set((float)capacity);
+      }
+
+      float *data = (float*)matrixImage->data();
+      osg::BoundingBox box;
+      osg::Matrix matrix;
+      for(unsigned int i=0; i<n; ++i) {
+        members[i]->getInstanceMatrix(&matrix);
+        const osg::Matrix::value_type *m = matrix.ptr();
+        for(int j=0; j<16; ++j) {
+          data[i*16+j] = (float)m[j];
+        }
+        if(sourceBox.valid()) {
+          for(unsigned int c=0; c<8; ++c) {
+            box.expandBy(sourceBox.corner(c) * matrix);
+          }
+        }
+      }
+      matrixImage->dirty();
+
+      boundCallback->box = box;
+      for(size_t i=0; i<geometries.size(); ++i) {
+        for(unsigned int p=0; p<geometries[i]->getNumPrimitiveSets(); ++p) {
+          geometries[i]->getPrimitiveSet(p)->setNumInstances(n);
+        }
+        geometries[i]->dirtyBound();
+      }
+    }
+
+  } // end of namespace graphics
+} // end of namespace mars
@@ -0,0 +1,107 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file InstanceBatch.h
+ * \brief Draws DrawObjects that share geometry and material with one
+ * instanced draw call.
+ */
+
+#ifndef MARS_GRAPHICS_INSTANCE_BATCH_H
+#define MARS_GRAPHICS_INSTANCE_BATCH_H
+
+#ifdef _PRINT_HEADER_
+  #warning "InstanceBatch.h"
+#endif
+
+#include <mars/osg_material_manager/MaterialNode.h>
+
+#include <osg/Geometry>
+#include <osg/Group>
+#include <osg/Image>
+#include <osg/Texture2D>
+#include <osg/Uniform>
+
+#include <vector>
+
+namespace mars {
+  namespace graphics {
+
+    class DrawObject;
+
+    /**
+     * \brief Draws the geometry of several DrawObjects with one instanced
+     * draw call per geometry.
+     *
+     * The members have to share their geodes and material. Their model
+     * matrices are written to a float texture with four texels per
+     * instance once per frame in update(). The instanced variant of the
+     * material reads the matrix with gl_InstanceIDARB, thus only
+     * GL_ARB_draw_instanced, float textures and vertex texture fetch are
+     * needed, which software GL (Mesa llvmpipe) provides as well.
+     */
+    class InstanceBatch {
+    public:
+      /**
+       * \param materialNode the node of the instanced material variant,
+       *        the batch adds its geometry to it
+       * \param source the geodes of the members
+       * \param nodeMask the node mask of the members
+       */
+      InstanceBatch(osg_material_manager::MaterialNode *materialNode,
+                    osg::Group *source, unsigned int nodeMask);
+      ~InstanceBatch();
+
+      void addMember(DrawObject *drawObject) {
+        members.push_back(drawObject);
+      }
+      const std::vector<DrawObject*>& getMembers() const {
+        return members;
+      }
+      osg_material_manager::MaterialNode* getMaterialNode() const {
+        return materialNode.get();
+      }
+
+      /// uploads the matrices of all members and updates the bound
+      void update();
+
+    private:
+      class BoundCallback;
+
+      osg::ref_ptr<osg_material_manager::MaterialNode> materialNode;
+      osg::ref_ptr<osg::Group> root;
+      std::vector< osg::ref_ptr<osg::Geometry> > geometries;
+      osg::ref_ptr<osg::Image> matrixImage;
+      osg::ref_ptr<osg::Texture2D> matrixTexture;
+      osg::ref_ptr<osg::Uniform> texHeightUniform;
+      osg::ref_ptr<BoundCallback> boundCallback;
+      osg::BoundingBox sourceBox;
+      std::vector<DrawObject*> members;
+      unsigned int capacity;
+
+      // not copyable
+      InstanceBatch(const InstanceBatch&);
+      InstanceBatch& operator=(const InstanceBatch&);
+    }; // end of class InstanceBatch
+
+  } // end of namespace graphics
+} // end of namespace mars
+
+#endif /* MARS_GRAPHICS_INSTANCE_BATCH_H */
@@ -26,7 +26,9 @@
  */
 
 #include "LoadDrawObject.h"
+#include "MeshLod.h"
 #include "gui_helper_functions.h"
+#include "../GraphicsManager.h"
 
 #include <osg/ComputeBoundsVisitor>
 #include <osg/CullFace>
@@ -75,7 +77,48 @@ namespace mars {
       if(filename[0] != '/') {
         filename = p+"/"+filename;
       }
-      return loadGeodes(filename, (std::string)info_["origname"]);
+      std::string objname = (std::string)info_["origname"];
+      if(info_.find("lod") == info_.end()) {
+        // use the levels of detail stored in a .bobj version 2 file or
+        // generate them for larger meshes
+        std::string lodFile;
+        if(filename.substr(filename.size()-5, 5) == ".bobj") {
+          lodFile = filename;
+        }
+        std::vector< osg::ref_ptr<osg::Geode> > lodGeodes;
+        std::vector<float> maxDistances;
+        bool lodErrors = false;
+        bool hasLods = (!lodFile.empty() &&
+                        GuiHelper::readBobjLodsFromFile(lodFile, &lodGeodes,
+                                                        &maxDistances,
+                                                        &lodErrors) &&
+                        lodGeodes.size() > 1);
+        std::string autoLodPath = g->getAutoLodPath();
+        if(!hasLods && objname.empty() && !autoLodPath.empty()) {
+          lodFile = getLodCacheFile(filename, autoLodPath);
+          hasLods = (!lodFile.empty() &&
+                     GuiHelper::readBobjLodsFromFile(lodFile, &lodGeodes,
+                                                     &maxDistances,
+                                                     &lodErrors) &&
+                     lodErrors && lodGeodes.size() > 1);
+          autoLod = hasLods;
+        }
+        if(hasLods && lodErrors) {
+          for(size_t i=0; i<lodGeodes.size(); ++i) {
+            addLODGeodesByError(std::list< osg::ref_ptr< osg::Geode > >(1, lodGeodes[i]),
+                                maxDistances[i]);
+          }
+        }
+        else if(hasLods) {
+          float start = 0.0;
+          for(size_t i=0; i<lodGeodes.size(); ++i) {
+            addLODGeodes(std::list< osg::ref_ptr< osg::Geode > >(1, lodGeodes[i]),
+                         start, maxDistances[i]);
+            start = maxDistances[i];
+          }
+        }
+      }
+      return loadGeodes(filename, objname);
     }
 
     std::list< osg::ref_ptr< osg::Geode > > LoadDrawObject::loadGeodes(std::string filename, std::string objname) {
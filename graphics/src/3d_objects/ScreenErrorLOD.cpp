@@ -0,0 +1,64 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ScreenErrorLOD.h"
+
+#include <osgUtil/CullVisitor>
+
+#include <algorithm>
+#include <cfloat>
+
+namespace mars {
+  namespace graphics {
+
+    float ScreenErrorLOD::pixelError = 1.0f;
+
+    ScreenErrorLOD::ScreenErrorLOD() {
+      // the ranges store the errors, they are not evaluated by osg::LOD
+      setRangeMode(osg::LOD::PIXEL_SIZE_ON_SCREEN);
+    }
+
+    bool ScreenErrorLOD::addChild(osg::Node *child, float error) {
+      return osg::LOD::addChild(child, error, FLT_MAX);
+    }
+
+    void ScreenErrorLOD::traverse(osg::NodeVisitor &nv) {
+      if(_children.empty()) return;
+      if(nv.getTraversalMode() == osg::NodeVisitor::TRAVERSE_ALL_CHILDREN) {
+        osg::Group::traverse(nv);
+        return;
+      }
+      unsigned int selected = 0;
+      osgUtil::CullVisitor *cv = dynamic_cast<osgUtil::CullVisitor*>(&nv);
+      if(cv) {
+        // pixels covered by one unit at the center of the object
+        float pixelsPerUnit = cv->clampedPixelSize(getBound().center(), 1.0f);
+        unsigned int n = std::min((unsigned int)_children.size(),
+                                  (unsigned int)_rangeList.size());
+        for(unsigned int i=1; i<n; ++i) {
+          if(_rangeList[i].first * pixelsPerUnit > pixelError) break;
+          selected = i;
+        }
+      }
+      _children[selected]->accept(nv);
+    }
+
+  } // end of namespace graphics
+} // end of namespace mars
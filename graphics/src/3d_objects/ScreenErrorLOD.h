@@ -0,0 +1,63 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file ScreenErrorLOD.h
+ * \brief Selects a level of detail by its projected geometric error.
+ */
+
+#ifndef MARS_GRAPHICS_SCREEN_ERROR_LOD_H
+#define MARS_GRAPHICS_SCREEN_ERROR_LOD_H
+
+#ifdef _PRINT_HEADER_
+  #warning "ScreenErrorLOD.h"
+#endif
+
+#include <osg/LOD>
+
+namespace mars {
+  namespace graphics {
+
+    /**
+     * \brief An osg::LOD whose children are ordered from fine to coarse and
+     * store their geometric error (in object units) as minimum range.
+     *
+     * The cull traversal draws the coarsest child whose error projected to
+     * the screen is at most pixelError pixels. Unlike distance ranges this
+     * takes the field of view, the viewport size and the scale of the
+     * object into account. All other traversals only see the finest child.
+     */
+    class ScreenErrorLOD : public osg::LOD {
+    public:
+      ScreenErrorLOD();
+
+      /** \brief Adds a level with the given geometric error. */
+      bool addChild(osg::Node *child, float error);
+
+      virtual void traverse(osg::NodeVisitor &nv);
+
+      /// allowed projected error in pixels, shared by all objects
+      static float pixelError;
+    }; // end of class ScreenErrorLOD
+
+  } // end of namespace graphics
+} // end of namespace mars
+
+#endif // MARS_GRAPHICS_SCREEN_ERROR_LOD_H
@@ -40,6 +40,8 @@ namespace mars {
       osg::Vec3 p3;
     } SphereFace;
 
+    osg::ref_ptr<osg::Geode> SphereDrawObject::sharedSphere = NULL;
+
     SphereDrawObject::SphereDrawObject(GraphicsManager *g)
       : DrawObject(g) {
     }
@@ -214,30 +216,34 @@ namespace mars {
     }
 
     std::list< osg::ref_ptr< osg::Geode > > SphereDrawObject::createGeometry() {
-      osg::ref_ptr<osg::Vec3Array> vertices(new osg::Vec3Array());
-      osg::ref_ptr<osg::Vec3Array> normals(new osg::Vec3Array());
-      osg::ref_ptr<osg::Vec2Array> uv(new osg::Vec2Array());
-      osg::Vec3 zero(0.0f, 0.0f, 0.0f);
-      osg::Geometry *geom = new osg::Geometry();
       std::list< osg::ref_ptr< osg::Geode > > geodes;
 
-      createGeometry(vertices.get(), normals.get(), uv.get(),
-                     1.0, zero, zero, false, 2);
-
-      geom->setVertexArray(vertices.get());
-      geom->setNormalArray(normals.get());
-      geom->setTexCoordArray(DEFAULT_UV_UNIT, uv.get());
-      geom->setNormalBinding(osg::Geometry::BIND_PER_VERTEX);
-      geom->addPrimitiveSet(new osg::DrawArrays(
-                                                osg::PrimitiveSet::TRIANGLES,
-                                                0, // index of first vertex
-                                                vertices->size()));
-
-      geom->setUseDisplayList(false);
-      geom->setUseVertexBufferObjects(true);
-      osg::ref_ptr<osg::Geode> geode = new osg::Geode;
-      geode->addDrawable(geom);
-      geodes.push_back(geode);
+      // all spheres share the unit sphere, thus they can be instanced
+      if(!sharedSphere.valid()) {
+        osg::ref_ptr<osg::Vec3Array> vertices(new osg::Vec3Array());
+        osg::ref_ptr<osg::Vec3Array> normals(new osg::Vec3Array());
+        osg::ref_ptr<osg::Vec2Array> uv(new osg::Vec2Array());
+        osg::Vec3 zero(0.0f, 0.0f, 0.0f);
+        osg::Geometry *geom = new osg::Geometry();
+
+        createGeometry(vertices.get(), normals.get(), uv.get(),
+                       1.0, zero, zero, false, 2);
+
+        geom->setVertexArray(vertices.get());
+        geom->setNormalArray(normals.get());
+        geom->setTexCoordArray(DEFAULT_UV_UNIT, uv.get());
+        geom->setNormalBinding(osg::Geometry::BIND_PER_VERTEX);
+        geom->addPrimitiveSet(new osg::DrawArrays(
+                                                  osg::PrimitiveSet::TRIANGLES,
+                                                  0, // index of first vertex
+                                                  vertices->size()));
+
+        geom->setUseDisplayList(false);
+        geom->setUseVertexBufferObjects(true);
+        sharedSphere = new osg::Geode;
+        sharedSphere->addDrawable(geom);
+      }
+      geodes.push_back(sharedSphere.get());
 
       return geodes;
     }
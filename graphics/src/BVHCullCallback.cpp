@@ -0,0 +1,172 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "BVHCullCallback.h"
+
+#include <osgUtil/CullVisitor>
+#include <OpenThreads/ScopedLock>
+
+#include <algorithm>
+
+namespace mars {
+  namespace graphics {
+
+    // maximal number of children in a leaf
+    static const unsigned int LeafSize = 4;
+
+    namespace {
+
+      struct CenterLess {
+        int axis;
+        bool operator()(osg::Node *a, osg::Node *b) const {
+          return a->getBound().center()[axis] < b->getBound().center()[axis];
+        }
+      };
+
+    } // end of anonymous namespace
+
+    BVHCullCallback::BVHCullCallback(unsigned int minChildren)
+      : minChildren(minChildren), buildRadiusSum(0.0f), lastFrame(-1) {
+    }
+
+    void BVHCullCallback::operator()(osg::Node *node, osg::NodeVisitor *nv) {
+      osg::Group *group = node->asGroup();
+      osgUtil::CullVisitor *cv = dynamic_cast<osgUtil::CullVisitor*>(nv);
+      if(!cv || !group || group->getNumChildren() < minChildren) {
+        traverse(node, nv);
+        return;
+      }
+
+      OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex);
+      int frame = nv->getFrameStamp() ? nv->getFrameStamp()->getFrameNumber() : -1;
+      if(childrenChanged(group)) {
+        build(group);
+      }
+      else if(frame != lastFrame || frame == -1) {
+        // every camera culls the same tree, refit it only once per frame
+        float radiusSum = nodes.empty() ? 0.0f : refit(0);
+        if(radiusSum > 2.0f*buildRadiusSum) build(group);
+      }
+      lastFrame = frame;
+
+      for(size_t i=0; i<unbounded.size(); ++i) {
+        unbounded[i]->accept(*nv);
+      }
+      if(!nodes.empty()) cull(0, nv);
+    }
+
+    bool BVHCullCallback::childrenChanged(osg::Group *group) const {
+      if(group->getNumChildren() != lastChildren.size()) return true;
+      for(unsigned int i=0; i<group->getNumChildren(); ++i) {
+        if(group->getChild(i) != lastChildren[i]) return true;
+      }
+      return false;
+    }
+
+    void BVHCullCallback::build(osg::Group *group) {
+      lastChildren.clear();
+      members.clear();
+      unbounded.clear();
+      nodes.clear();
+      for(unsigned int i=0; i<group->getNumChildren(); ++i) {
+        osg::Node *child = group->getChild(i);
+        lastChildren.push_back(child);
+        if(child->getBound().valid()) members.push_back(child);
+        else unbounded.push_back(child);
+      }
+      if(members.empty()) {
+        buildRadiusSum = 0.0f;
+        return;
+      }
+      nodes.reserve(2*members.size()/LeafSize + 1);
+      buildNode(0, members.size());
+      buildRadiusSum = refit(0);
+    }
+
+    /**
+     * Splits the members at the median of the longest extent of their
+     * centers; the bounds are set by refit().
+     */
+    int BVHCullCallback::buildNode(unsigned int first, unsigned int count) {
+      int index = nodes.size();
+      nodes.push_back(BVHNode());
+      nodes[index].left = nodes[index].right = -1;
+      nodes[index].first = first;
+      nodes[index].count = count;
+      if(count <= LeafSize) return index;
+
+      osg::BoundingBox box;
+      for(unsigned int i=first; i<first+count; ++i) {
+        box.expandBy(members[i]->getBound().center());
+      }
+      osg::Vec3 extent = box._max - box._min;
+      CenterLess less;
+      less.axis = 0;
+      if(extent.y() > extent[less.axis]) less.axis = 1;
+      if(extent.z() > extent[less.axis]) less.axis = 2;
+      unsigned int half = count / 2;
+      std::nth_element(members.begin()+first, members.begin()+first+half,
+                       members.begin()+first+count, less);
+
+      int left = buildNode(first, half);
+      int right = buildNode(first+half, count-half);
+      nodes[index].left = left;
+      nodes[index].right = right;
+      return index;
+    }
+
+    /**
+     * Updates the spheres bottom up and returns the sum of the radii of
+     * the subtree as measure of the quality of the tree.
+     */
+    float BVHCullCallback::refit(int index) {
+      BVHNode &node = nodes[index];
+      node.bound.init();
+      if(node.left < 0) {
+        for(unsigned int i=node.first; i<node.first+node.count; ++i) {
+          node.bound.expandBy(members[i]->getBound());
+        }
+        return node.bound.radius();
+      }
+      float sum = refit(node.left) + refit(node.right);
+      node.bound.expandBy(nodes[node.left].bound);
+      node.bound.expandBy(nodes[node.right].bound);
+      return sum + node.bound.radius();
+    }
+
+    void BVHCullCallback::cull(int index, osg::NodeVisitor *nv) {
+      osgUtil::CullVisitor *cv = static_cast<osgUtil::CullVisitor*>(nv);
+      const BVHNode &node = nodes[index];
+      if(node.bound.valid() &&
+         cv->getCurrentCullingSet().isCulled(node.bound)) {
+        return;
+      }
+      if(node.left < 0) {
+        for(unsigned int i=node.first; i<node.first+node.count; ++i) {
+          members[i]->accept(*nv);
+        }
+        return;
+      }
+      cull(node.left, nv);
+      cull(node.right, nv);
+    }
+
+  } // end of namespace graphics
+} // end of namespace mars
@@ -0,0 +1,91 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file BVHCullCallback.h
+ * \brief Culls the children of a group with a bounding volume hierarchy.
+ */
+
+#ifndef MARS_GRAPHICS_BVH_CULL_CALLBACK_H
+#define MARS_GRAPHICS_BVH_CULL_CALLBACK_H
+
+#ifdef _PRINT_HEADER_
+  #warning "BVHCullCallback.h"
+#endif
+
+#include <osg/BoundingSphere>
+#include <osg/Group>
+#include <osg/NodeCallback>
+#include <OpenThreads/Mutex>
+
+#include <vector>
+
+namespace mars {
+  namespace graphics {
+
+    /**
+     * \brief Cull callback for a group with many children, e.g. the
+     * objects sharing one material.
+     *
+     * osg tests every child of a group against the view frustum. The
+     * callback sorts the children into a tree of bounding spheres and
+     * only visits the children of visible leaves, thus large invisible
+     * parts of the scene are rejected with a few tests.
+     *
+     * The tree is refitted to the moving children once per frame and
+     * built again if the set of children changed or the refitted spheres
+     * grew too much. Groups with less than \c minChildren children are
+     * traversed as usual.
+     */
+    class BVHCullCallback : public osg::NodeCallback {
+    public:
+      explicit BVHCullCallback(unsigned int minChildren=32);
+
+      virtual void operator()(osg::Node *node, osg::NodeVisitor *nv);
+
+    private:
+      struct BVHNode {
+        osg::BoundingSphere bound;
+        // children in the tree or, for leaves, a range in members
+        int left, right;
+        unsigned int first, count;
+      };
+
+      unsigned int minChildren;
+      std::vector<BVHNode> nodes;
+      std::vector<osg::Node*> members;
+      // children without a valid bound are always traversed
+      std::vector<osg::Node*> unbounded;
+      std::vector<osg::Node*> lastChildren;
+      float buildRadiusSum;
+      int lastFrame;
+      OpenThreads::Mutex mutex;
+
+      bool childrenChanged(osg::Group *group) const;
+      void build(osg::Group *group);
+      int buildNode(unsigned int first, unsigned int count);
+      float refit(int index);
+      void cull(int index, osg::NodeVisitor *nv);
+    }; // end of class BVHCullCallback
+
+  } // end of namespace graphics
+} // end of namespace mars
+
+#endif // MARS_GRAPHICS_BVH_CULL_CALLBACK_H
@@ -0,0 +1,301 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "BobjFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cfloat>
+
+#ifndef WIN32
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
+namespace mars {
+  namespace graphics {
+
+    static const char bobjMagic[4] = {'B', 'O', 'B', 'J'};
+    static const uint32_t bobjVersion = 2;
+
+    static uint64_t align16(uint64_t offset) {
+      return (offset + 15) & ~(uint64_t)15;
+    }
+
+    static bool isLittleEndian() {
+      const uint32_t one = 1;
+      return *(const char*)&one == 1;
+    }
+
+    BobjFile::BobjFile() : data(0), size(0), header(0), lods(0),
+                           mapped(false) {
+    }
+
+    BobjFile::~BobjFile() {
+      close();
+    }
+
+    bool BobjFile::isVersion2(const std::string &filename) {
+      char magic[4];
+      FILE *file = fopen(filename.c_str(), "rb");
+      if(!file) return false;
+      bool result = (fread(magic, 1, 4, file) == 4 &&
+                     memcmp(magic, bobjMagic, 4) == 0);
+      fclose(file);
+      return result;
+    }
+
+    bool BobjFile::open(const std::string &filename) {
+      close();
+      if(!isLittleEndian()) {
+        fprintf(stderr, "BobjFile: big endian hosts are not supported\n");
+        return false;
+      }
+#ifndef WIN32
+      int fd = ::open(filename.c_str(), O_RDONLY);
+      if(fd < 0) return false;
+      struct stat st;
+      if(fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(BobjHeader)) {
+        ::close(fd);
+        return false;
+      }
+      void *mem = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      ::close(fd);
+      if(mem == MAP_FAILED) return false;
+      data = (const char*)mem;
+      size = st.st_size;
+      mapped = true;
+#else
+      FILE *file = fopen(filename.c_str(), "rb");
+      if(!file) return false;
+      fseek(file, 0, SEEK_END);
+      long length = ftell(file);
+      fseek(file, 0, SEEK_SET);
+      if(length < (long)sizeof(BobjHeader)) {
+        fclose(file);
+        return false;
+      }
+      buffer.resize(length);
+      size_t r = fread(&buffer[0], 1, length, file);
+      fclose(file);
+      if(r != (size_t)length) {
+        buffer.clear();
+        return false;
+      }
+      data = &buffer[0];
+      size = length;
+#endif
+      if(!validate(filename)) {
+        close();
+        return false;
+      }
+      return true;
+    }
+
+    void BobjFile::close() {
+#ifndef WIN32
+      if(mapped) {
+        munmap((void*)data, size);
+      }
+#endif
+      buffer.clear();
+      data = 0;
+      size = 0;
+      header = 0;
+      lods = 0;
+      mapped = false;
+    }
+
+    /**
+     * Checks the header and that all arrays lie inside of the file. The
+     * indices are checked too, thus a broken file can neither crash the
+     * rendering nor the collision detection.
+     */
+    bool BobjFile::validate(const std::string &filename) {
+      header = (const BobjHeader*)data;
+      if(memcmp(header->magic, bobjMagic, 4) != 0 ||
+         header->version != bobjVersion) {
+        fprintf(stderr, "BobjFile: %s is no .bobj version %d file\n",
+                filename.c_str(), bobjVersion);
+        return false;
+      }
+      uint64_t n = header->vertexCount;
+      struct {
+        uint64_t offset, bytes;
+        bool required;
+      } arrays[] = {
+        {header->positions, n*3*sizeof(float), true},
+        {header->normals, n*3*sizeof(float), false},
+        {header->tangents, n*4*sizeof(float), false},
+        {header->texcoords, n*2*sizeof(float), false},
+        {header->lods, header->lodCount*sizeof(BobjLod), true},
+      };
+      for(size_t i=0; i<sizeof(arrays)/sizeof(arrays[0]); ++i) {
+        if(!arrays[i].offset && !arrays[i].required) continue;
+        if(!arrays[i].offset || arrays[i].offset % 16 ||
+           arrays[i].offset > size ||
+           arrays[i].bytes > size - arrays[i].offset) {
+          header = 0;
+          break;
+        }
+      }
+      if(!header || header->lodCount == 0) {
+        fprintf(stderr, "BobjFile: %s is truncated or broken\n",
+                filename.c_str());
+        header = 0;
+        return false;
+      }
+      lods = (const BobjLod*)(data+header->lods);
+      for(uint32_t l=0; l<header->lodCount; ++l) {
+        uint64_t bytes = (uint64_t)lods[l].indexCount*sizeof(uint32_t);
+        if(lods[l].indices % 16 || lods[l].indices > size ||
+           bytes > size - lods[l].indices || lods[l].indexCount % 3) {
+          fprintf(stderr, "BobjFile: %s has a broken level of detail %d\n",
+                  filename.c_str(), l);
+          return false;
+        }
+        const uint32_t *indices = getIndices(l);
+        for(uint32_t i=0; i<lods[l].indexCount; ++i) {
+          if(indices[i] >= header->vertexCount) {
+            fprintf(stderr, "BobjFile: %s has an index out of range\n",
+                    filename.c_str());
+            return false;
+          }
+        }
+      }
+      return true;
+    }
+
+    const uint32_t* BobjFile::getIndices(unsigned int lod) const {
+      return (const uint32_t*)(data+lods[lod].indices);
+    }
+
+    unsigned int BobjFile::getIndexCount(unsigned int lod) const {
+      return lods[lod].indexCount;
+    }
+
+    float BobjFile::getLodDistance(unsigned int lod) const {
+      return lods[lod].maxDistance;
+    }
+
+    static bool writeAt(FILE *file, uint64_t offset, const void *src,
+                        size_t bytes) {
+      if(!bytes) return true;
+      if(fseek(file, (long)offset, SEEK_SET) != 0) return false;
+      return fwrite(src, 1, bytes, file) == bytes;
+    }
+
+    bool BobjFile::write(const std::string &filename, const BobjMesh &mesh) {
+      if(!isLittleEndian() || mesh.positions.size() % 3 ||
+         mesh.lodIndices.empty()) {
+        return false;
+      }
+      size_t n = mesh.positions.size() / 3;
+      BobjHeader header;
+      memset(&header, 0, sizeof(header));
+      memcpy(header.magic, bobjMagic, 4);
+      header.version = bobjVersion;
+      header.vertexCount = n;
+      header.lodCount = mesh.lodIndices.size();
+      for(int i=0; i<3; ++i) {
+        header.aabbMin[i] = n ? FLT_MAX : 0.0f;
+        header.aabbMax[i] = n ? -FLT_MAX : 0.0f;
+      }
+      for(size_t v=0; v<n; ++v) {
+        for(int i=0; i<3; ++i) {
+          float p = mesh.positions[v*3+i];
+          if(p < header.aabbMin[i]) header.aabbMin[i] = p;
+          if(p > header.aabbMax[i]) header.aabbMax[i] = p;
+        }
+      }
+
+      // layout: header, level table, vertex arrays, index arrays
+      uint64_t offset = align16(sizeof(BobjHeader));
+      header.lods = offset;
+      offset = align16(offset + header.lodCount*sizeof(BobjLod));
+      header.positions = offset;
+      offset = align16(offset + mesh.positions.size()*sizeof(float));
+      if(mesh.normals.size() == n*3 && n) {
+        header.flags |= BOBJ_NORMALS;
+        header.normals = offset;
+        offset = align16(offset + mesh.normals.size()*sizeof(float));
+      }
+      if(mesh.tangents.size() == n*4 && n) {
+        header.flags |= BOBJ_TANGENTS;
+        header.tangents = offset;
+        offset = align16(offset + mesh.tangents.size()*sizeof(float));
+      }
+      if(mesh.texcoords.size() == n*2 && n) {
+        header.flags |= BOBJ_TEXCOORDS;
+        header.texcoords = offset;
+        offset = align16(offset + mesh.texcoords.size()*sizeof(float));
+      }
+      bool storeErrors = (mesh.lodErrors.size() == mesh.lodIndices.size());
+      if(storeErrors) header.flags |= BOBJ_LOD_ERRORS;
+      std::vector<BobjLod> lods(header.lodCount);
+      for(size_t l=0; l<lods.size(); ++l) {
+        lods[l].indices = offset;
+        lods[l].indexCount = mesh.lodIndices[l].size();
+        if(storeErrors) {
+          lods[l].maxDistance = mesh.lodErrors[l];
+        }
+        else {
+          lods[l].maxDistance = (l < mesh.lodDistances.size() ?
+                                 mesh.lodDistances[l] : FLT_MAX);
+        }
+        offset = align16(offset + lods[l].indexCount*sizeof(uint32_t));
+      }
+
+      FILE *file = fopen(filename.c_str(), "wb");
+      if(!file) return false;
+      bool ok = writeAt(file, 0, &header, sizeof(header));
+      ok &= writeAt(file, header.lods, &lods[0],
+                    lods.size()*sizeof(BobjLod));
+      ok &= writeAt(file, header.positions, mesh.positions.data(),
+                    mesh.positions.size()*sizeof(float));
+      if(header.normals) {
+        ok &= writeAt(file, header.normals, mesh.normals.data(),
+                      mesh.normals.size()*sizeof(float));
+      }
+      if(header.tangents) {
+        ok &= writeAt(file, header.tangents, mesh.tangents.data(),
+                      mesh.tangents.size()*sizeof(float));
+      }
+      if(header.texcoords) {
+        ok &= writeAt(file, header.texcoords, mesh.texcoords.data(),
+                      mesh.texcoords.size()*sizeof(float));
+      }
+      for(size_t l=0; l<lods.size(); ++l) {
+        ok &= writeAt(file, lods[l].indices, mesh.lodIndices[l].data(),
+                      mesh.lodIndices[l].size()*sizeof(uint32_t));
+      }
+      // pad the file to the aligned end of the last array
+      if(ok && offset > 0) {
+        char zero = 0;
+        ok &= writeAt(file, offset-1, &zero, 1);
+      }
+      ok &= (fclose(file) == 0);
+      return ok;
+    }
+
+  } // end of namespace graphics
+} // end of namespace mars
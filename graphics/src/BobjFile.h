@@ -0,0 +1,171 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file BobjFile.h
+ * \brief Reads and writes the indexed binary mesh format .bobj version 2.
+ *
+ * A version 2 file starts with the BobjHeader, followed by the BobjLod
+ * table and the data arrays. All values are little endian, every array
+ * starts at a multiple of 16 bytes and is stored in the layout the OSG
+ * arrays and the physics mesh use, thus a file can be mapped into memory
+ * and used without parsing it. Version 1 files start with a record tag
+ * (1-4) instead of the magic "BOBJ" and are still read by
+ * GuiHelper::readBobjFromFile.
+ */
+
+#ifndef MARS_GRAPHICS_BOBJ_FILE_H
+#define MARS_GRAPHICS_BOBJ_FILE_H
+
+#ifdef _PRINT_HEADER_
+  #warning "BobjFile.h"
+#endif
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace mars {
+  namespace graphics {
+
+    enum BobjFlags {
+      BOBJ_NORMALS = 1 << 0,
+      BOBJ_TANGENTS = 1 << 1,
+      BOBJ_TEXCOORDS = 1 << 2,
+      /// the levels store their geometric error instead of a distance
+      BOBJ_LOD_ERRORS = 1 << 3
+    };
+
+    struct BobjHeader {
+      char magic[4];        ///< "BOBJ"
+      uint32_t version;     ///< 2
+      uint32_t flags;       ///< BobjFlags of the stored arrays
+      uint32_t vertexCount;
+      uint32_t lodCount;    ///< at least 1, level 0 is the full mesh
+      uint32_t reserved;
+      float aabbMin[3];
+      float aabbMax[3];
+      uint64_t positions;   ///< offset of vertexCount x float[3]
+      uint64_t normals;     ///< offset of vertexCount x float[3] or 0
+      uint64_t tangents;    ///< offset of vertexCount x float[4] or 0
+      uint64_t texcoords;   ///< offset of vertexCount x float[2] or 0
+      uint64_t lods;        ///< offset of lodCount x BobjLod
+    }; // end of struct BobjHeader
+
+    struct BobjLod {
+      uint64_t indices;     ///< offset of indexCount x uint32_t (triangles)
+      uint32_t indexCount;
+      /**
+       * The level is shown up to this distance. If the header has the flag
+       * BOBJ_LOD_ERRORS it is the maximal displacement of the level
+       * against level 0 in mesh units and the level is selected by its
+       * projected error.
+       */
+      float maxDistance;
+    }; // end of struct BobjLod
+
+    /**
+     * \brief A mesh in memory that is written with BobjFile::write().
+     *
+     * All levels of detail index the same vertex arrays. The arrays are
+     * flat, e.g. positions holds three floats per vertex. If lodErrors
+     * has one entry per level it is written instead of lodDistances.
+     */
+    struct BobjMesh {
+      std::vector<float> positions;
+      std::vector<float> normals;
+      std::vector<float> tangents;
+      std::vector<float> texcoords;
+      std::vector< std::vector<uint32_t> > lodIndices;
+      std::vector<float> lodDistances;
+      std::vector<float> lodErrors;
+    }; // end of struct BobjMesh
+
+    /**
+     * \brief Read only view of a .bobj version 2 file.
+     *
+     * The file is mapped into memory (read into one buffer on Windows) and
+     * validated once in open(), afterwards the accessors return pointers
+     * into the mapped data. The pointers are valid until close().
+     */
+    class BobjFile {
+    public:
+      BobjFile();
+      ~BobjFile();
+
+      /// \c true if the file starts with the version 2 magic
+      static bool isVersion2(const std::string &filename);
+      static bool write(const std::string &filename, const BobjMesh &mesh);
+
+      bool open(const std::string &filename);
+      void close();
+
+      const BobjHeader& getHeader() const {
+        return *header;
+      }
+      unsigned int getVertexCount() const {
+        return header->vertexCount;
+      }
+      unsigned int getLodCount() const {
+        return header->lodCount;
+      }
+      const float* getPositions() const {
+        return array(header->positions);
+      }
+      /// \return \c NULL if the file stores no normals
+      const float* getNormals() const {
+        return array(header->normals);
+      }
+      const float* getTangents() const {
+        return array(header->tangents);
+      }
+      const float* getTexcoords() const {
+        return array(header->texcoords);
+      }
+      const uint32_t* getIndices(unsigned int lod) const;
+      unsigned int getIndexCount(unsigned int lod) const;
+      float getLodDistance(unsigned int lod) const;
+      /// \c true if getLodDistance() returns the error of the level
+      bool hasLodErrors() const {
+        return header->flags & BOBJ_LOD_ERRORS;
+      }
+
+    private:
+      const float* array(uint64_t offset) const {
+        return offset ? (const float*)(data+offset) : 0;
+      }
+      bool validate(const std::string &filename);
+
+      const char *data;
+      size_t size;
+      const BobjHeader *header;
+      const BobjLod *lods;
+      bool mapped;
+      std::vector<char> buffer;
+
+      // not copyable
+      BobjFile(const BobjFile&);
+      BobjFile& operator=(const BobjFile&);
+    }; // end of class BobjFile
+
+  } // end of namespace graphics
+} // end of namespace mars
+
+#endif // MARS_GRAPHICS_BOBJ_FILE_H
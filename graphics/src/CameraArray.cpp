@@ -0,0 +1,421 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "CameraArray.h"
+
+#include <osg/DisplaySettings>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Program>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#ifndef GL_R32F
+  #define GL_R32F 0x822E
+#endif
+
+namespace mars {
+  namespace graphics {
+
+    namespace {
+
+      /** copies the region of \c dest size at x, y of \c source */
+      void copyRegion(const osg::Image *source, osg::Image *dest, int x, int y) {
+        unsigned int rowSize = dest->s() * dest->getPixelSizeInBits() / 8;
+        for(int r=0; r<dest->t(); ++r) {
+          memcpy(dest->data(0, r), source->data(x, y+r), rowSize);
+        }
+        dest->dirty();
+      }
+
+      /**
+       * Every fragment of the sample target reads the atlas position and
+       * the clip planes of one sample from the lookup texture. A pixel
+       * without depth is written as -1.
+       */
+      const char *samplerVertexSource =
+        "void main() {\n"
+        "  gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+        "  gl_Position = ftransform();\n"
+        "}\n";
+
+      const char *samplerFragmentSource =
+        "uniform sampler2D depthTexture;\n"
+        "uniform sampler2D lookupTexture;\n"
+        "void main() {\n"
+        "  vec4 lookup = texture2D(lookupTexture, gl_TexCoord[0].xy);\n"
+        "  float d = texture2D(depthTexture, lookup.xy).r;\n"
+        "  float zn = lookup.z, zf = lookup.w;\n"
+        "  float dist = d < 1.0 ? zn*zf/(zf-d*(zf-zn)) : -1.0;\n"
+        "  gl_FragColor = vec4(dist, 0.0, 0.0, 1.0);\n"
+        "}\n";
+
+    } // end of anonymous namespace
+
+    CameraArray::CameraArray(const std::string &group,
+                             osgViewer::CompositeViewer *viewer,
+                             osg::GraphicsContext *context, int maxSize)
+      : group(group), viewer(viewer), context(context), maxSize(maxSize),
+        root(new osg::Group), clearColor(0.0, 0.0, 0.0, 1.0),
+        width(0), height(0), targetDirty(false), gpuSampling(true) {
+    }
+
+    CameraArray::~CameraArray() {
+      if(view.valid()) viewer->removeView(view.get());
+    }
+
+    bool CameraArray::addTile(osg::Camera *camera, osg::Image *color,
+                              osg::Image *depth) {
+      std::vector<Tile> newTiles = tiles;
+      Tile tile;
+      tile.camera = camera;
+      tile.color = color;
+      tile.depth = depth;
+      tile.x = tile.y = 0;
+      tile.width = color->s();
+      tile.height = color->t();
+      tile.drawn = false;
+      tile.sampleOffset = 0;
+      tile.zNear = tile.zFar = 0.0;
+      newTiles.push_back(tile);
+      int w, h;
+      if(!layout(newTiles, &w, &h)) return false;
+      tiles.swap(newTiles);
+      width = w;
+      height = h;
+      root->addChild(camera);
+      targetDirty = true;
+      return true;
+    }
+
+    bool CameraArray::canAdd(int tileWidth, int tileHeight) const {
+      std::vector<Tile> newTiles = tiles;
+      Tile tile;
+      tile.width = tileWidth;
+      tile.height = tileHeight;
+      newTiles.push_back(tile);
+      int w, h;
+      return layout(newTiles, &w, &h);
+    }
+
+    void CameraArray::removeTile(osg::Camera *camera) {
+      std::vector<Tile>::iterator it;
+      for(it=tiles.begin(); it!=tiles.end(); ++it) {
+        if(it->camera.get() == camera) {
+          root->removeChild(camera);
+          tiles.erase(it);
+          layout(tiles, &width, &height);
+          targetDirty = true;
+          return;
+        }
+      }
+    }
+
+    void CameraArray::setClearColor(const osg::Vec4 &color) {
+      clearColor = color;
+      if(view.valid()) view->getCamera()->setClearColor(color);
+    }
+
+    void CameraArray::setGPUSampling(bool enable) {
+      if(enable == gpuSampling) return;
+      gpuSampling = enable;
+      targetDirty = true;
+    }
+
+    void CameraArray::setTileSamples(osg::Camera *camera,
+                                     const std::vector<int> &pixels) {
+      for(size_t i=0; i<tiles.size(); ++i) {
+        if(tiles[i].camera.get() == camera) {
+          tiles[i].samplePixels = pixels;
+          targetDirty = true;
+          return;
+        }
+      }
+    }
+
+    bool CameraArray::getTileSamples(osg::Camera *camera,
+                                     float *buffer) const {
+      if(!sampleImage.valid()) return false;
+      const Tile *tile = findTile(camera);
+      if(!tile || tile->samples.empty()) return false;
+      memcpy(buffer, &tile->samples[0], tile->samples.size()*sizeof(float));
+      return true;
+    }
+
+    const CameraArray::Tile* CameraArray::findTile(osg::Camera *camera) const {
+      for(size_t i=0; i<tiles.size(); ++i) {
+        if(tiles[i].camera.get() == camera) return &tiles[i];
+      }
+      return NULL;
+    }
+
+    bool CameraArray::isSampled() const {
+      if(!gpuSampling || tiles.empty()) return false;
+      for(size_t i=0; i<tiles.size(); ++i) {
+        if(tiles[i].samplePixels.empty()) return false;
+      }
+      return true;
+    }
+
+    /**
+     * Fills rows from left to right in the order the tiles were added;
+     * a row is as high as its highest tile.
+     */
+    bool CameraArray::layout(std::vector<Tile> &list, int *w, int *h) const {
+      int x = 0, y = 0, rowHeight = 0;
+      *w = 0;
+      for(size_t i=0; i<list.size(); ++i) {
+        int tileWidth = list[i].width, tileHeight = list[i].height;
+        if(tileWidth > maxSize) return false;
+        if(x + tileWidth > maxSize) {
+          x = 0;
+          y += rowHeight;
+          rowHeight = 0;
+        }
+        list[i].x = x;
+        list[i].y = y;
+        x += tileWidth;
+        if(tileHeight > rowHeight) rowHeight = tileHeight;
+        if(x > *w) *w = x;
+      }
+      *h = y + rowHeight;
+      return *h <= maxSize;
+    }
+
+    void CameraArray::createTarget() {
+      if(view.valid()) {
+        viewer->removeView(view.get());
+        view = NULL;
+      }
+      if(sampler.valid()) {
+        root->removeChild(sampler.get());
+        sampler = NULL;
+      }
+      colorImage = depthImage = lookupImage = sampleImage = NULL;
+      colorTexture = depthTexture = lookupTexture = NULL;
+      if(tiles.empty()) return;
+
+      osg::ref_ptr<osg::Camera> camera = new osg::Camera();
+      camera->setGraphicsContext(context.get());
+      camera->setDisplaySettings(new osg::DisplaySettings(*osg::DisplaySettings::instance()));
+      camera->setViewport(0, 0, width, height);
+      camera->setRenderOrder(osg::Camera::PRE_RENDER);
+      camera->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT);
+      camera->setAllowEventFocus(false);
+      camera->setClearColor(clearColor);
+
+      if(isSampled()) {
+        // nothing of the atlas is read back, the sampler reads the depth
+        colorTexture = new osg::Texture2D();
+        colorTexture->setTextureSize(width, height);
+        colorTexture->setInternalFormat(GL_RGBA);
+        colorTexture->setResizeNonPowerOfTwoHint(false);
+        camera->attach(osg::Camera::COLOR_BUFFER, colorTexture.get());
+        depthTexture = new osg::Texture2D();
+        depthTexture->setTextureSize(width, height);
+        depthTexture->setInternalFormat(GL_DEPTH_COMPONENT24);
+        depthTexture->setSourceFormat(GL_DEPTH_COMPONENT);
+        depthTexture->setSourceType(GL_UNSIGNED_INT);
+        depthTexture->setResizeNonPowerOfTwoHint(false);
+        depthTexture->setFilter(osg::Texture2D::MIN_FILTER,
+                                osg::Texture2D::NEAREST);
+        depthTexture->setFilter(osg::Texture2D::MAG_FILTER,
+                                osg::Texture2D::NEAREST);
+        camera->attach(osg::Camera::DEPTH_BUFFER, depthTexture.get());
+        sampler = createSampler();
+        root->addChild(sampler.get());
+      }
+      else {
+        colorImage = new osg::Image();
+        colorImage->allocateImage(width, height, 1, GL_RGBA,
+                                  GL_UNSIGNED_INT_8_8_8_8_REV);
+        camera->attach(osg::Camera::COLOR_BUFFER, colorImage.get());
+        depthImage = new osg::Image();
+        depthImage->allocateImage(width, height, 1, GL_DEPTH_COMPONENT,
+                                  GL_UNSIGNED_INT);
+        camera->attach(osg::Camera::DEPTH_BUFFER, depthImage.get());
+      }
+
+      for(size_t i=0; i<tiles.size(); ++i) {
+        tiles[i].camera->setViewport(tiles[i].x, tiles[i].y,
+                                     tiles[i].width, tiles[i].height);
+      }
+
+      view = new osgViewer::View;
+      view->setLightingMode(osg::View::NO_LIGHT);
+      view->setCamera(camera.get());
+      view->setSceneData(root.get());
+      viewer->addView(view.get());
+    }
+
+    /**
+     * The sampler is a post render camera below the root, thus it is drawn
+     * after the tiles within the same view. The samples of all tiles are
+     * stored row by row in a target of at most maxSize columns.
+     */
+    osg::Camera* CameraArray::createSampler() {
+      int numSamples = 0;
+      for(size_t i=0; i<tiles.size(); ++i) {
+        tiles[i].sampleOffset = numSamples;
+        numSamples += tiles[i].samplePixels.size();
+        tiles[i].samples.assign(tiles[i].samplePixels.size(),
+                                std::numeric_limits<float>::quiet_NaN());
+      }
+      int sampleWidth = std::min(numSamples, maxSize);
+      int sampleHeight = (numSamples + sampleWidth - 1) / sampleWidth;
+
+      lookupImage = new osg::Image();
+      lookupImage->allocateImage(sampleWidth, sampleHeight, 1, GL_RGBA,
+                                 GL_FLOAT);
+      lookupImage->setInternalTextureFormat(GL_RGBA32F_ARB);
+      memset(lookupImage->data(), 0, lookupImage->getTotalSizeInBytes());
+      lookupTexture = new osg::Texture2D(lookupImage.get());
+      lookupTexture->setInternalFormat(GL_RGBA32F_ARB);
+      lookupTexture->setResizeNonPowerOfTwoHint(false);
+      lookupTexture->setFilter(osg::Texture2D::MIN_FILTER,
+                               osg::Texture2D::NEAREST);
+      lookupTexture->setFilter(osg::Texture2D::MAG_FILTER,
+                               osg::Texture2D::NEAREST);
+      updateLookup(true);
+
+      sampleImage = new osg::Image();
+      sampleImage->allocateImage(sampleWidth, sampleHeight, 1, GL_RED,
+                                 GL_FLOAT);
+      sampleImage->setInternalTextureFormat(GL_R32F);
+
+      osg::Camera *camera = new osg::Camera();
+      camera->setRenderOrder(osg::Camera::POST_RENDER);
+      camera->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT);
+      camera->setReferenceFrame(osg::Transform::ABSOLUTE_RF);
+      camera->setComputeNearFarMode(osg::CullSettings::DO_NOT_COMPUTE_NEAR_FAR);
+      camera->setProjectionMatrixAsOrtho2D(0.0, 1.0, 0.0, 1.0);
+      camera->setViewMatrix(osg::Matrix::identity());
+      camera->setViewport(0, 0, sampleWidth, sampleHeight);
+      // the quad writes every pixel
+      camera->setClearMask(0);
+      camera->attach(osg::Camera::COLOR_BUFFER, sampleImage.get());
+
+      osg::Geode *geode = new osg::Geode();
+      geode->addDrawable(osg::createTexturedQuadGeometry(osg::Vec3(0, 0, 0),
+                                                         osg::Vec3(1, 0, 0),
+                                                         osg::Vec3(0, 1, 0)));
+      osg::StateSet *state = geode->getOrCreateStateSet();
+      osg::Program *program = new osg::Program();
+      program->addShader(new osg::Shader(osg::Shader::VERTEX,
+                                         samplerVertexSource));
+      program->addShader(new osg::Shader(osg::Shader::FRAGMENT,
+                                         samplerFragmentSource));
+      state->setAttributeAndModes(program, osg::StateAttribute::ON);
+      state->setTextureAttributeAndModes(0, depthTexture.get(),
+                                         osg::StateAttribute::ON);
+      state->setTextureAttributeAndModes(1, lookupTexture.get(),
+                                         osg::StateAttribute::ON);
+      state->addUniform(new osg::Uniform("depthTexture", 0));
+      state->addUniform(new osg::Uniform("lookupTexture", 1));
+      state->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+      state->setMode(GL_DEPTH_TEST, osg::StateAttribute::OFF);
+      camera->addChild(geode);
+      return camera;
+    }
+
+    /**
+     * Writes the atlas coordinates of the pixel centers and the clip planes
+     * of the tile cameras; the clip planes are checked every frame since
+     * the frustum of a window can change.
+     */
+    void CameraArray::updateLookup(bool force) {
+      bool changed = force;
+      for(size_t i=0; i<tiles.size(); ++i) {
+        double fovy, aspectRatio, zNear, zFar;
+        tiles[i].camera->getProjectionMatrixAsPerspective(fovy, aspectRatio,
+                                                          zNear, zFar);
+        if(zNear != tiles[i].zNear || zFar != tiles[i].zFar) {
+          tiles[i].zNear = zNear;
+          tiles[i].zFar = zFar;
+          changed = true;
+        }
+      }
+      if(!changed) return;
+
+      float *data = (float*)lookupImage->data();
+      for(size_t i=0; i<tiles.size(); ++i) {
+        const Tile &tile = tiles[i];
+        for(size_t j=0; j<tile.samplePixels.size(); ++j) {
+          int column = tile.samplePixels[j] % tile.width;
+          // the first row of the sample layout is the top row
+          int row = tile.height - 1 - tile.samplePixels[j] / tile.width;
+          float *lookup = data + 4*(tile.sampleOffset + j);
+          lookup[0] = (tile.x + column + 0.5f) / width;
+          lookup[1] = (tile.y + row + 0.5f) / height;
+          lookup[2] = tile.zNear;
+          lookup[3] = tile.zFar;
+        }
+      }
+      lookupImage->dirty();
+    }
+
+    void CameraArray::update() {
+      if(targetDirty) {
+        createTarget();
+        targetDirty = false;
+      }
+      if(!view.valid()) return;
+
+      // the windows (de)activate their cameras by the node mask
+      bool active = false;
+      unsigned int cullMask = 0;
+      for(size_t i=0; i<tiles.size(); ++i) {
+        tiles[i].drawn = (tiles[i].camera->getNodeMask() != 0);
+        if(tiles[i].drawn) {
+          active = true;
+          cullMask |= tiles[i].camera->getCullMask();
+        }
+      }
+      osg::Camera *camera = view->getCamera();
+      camera->setNodeMask(active ? 0xffffffff : 0);
+      if(active) camera->setCullMask(cullMask);
+      if(active && lookupImage.valid()) updateLookup(false);
+    }
+
+    void CameraArray::splitTiles() {
+      if(!view.valid() || !view->getCamera()->getNodeMask()) return;
+      if(sampleImage.valid()) {
+        const float *data = (const float*)sampleImage->data();
+        for(size_t i=0; i<tiles.size(); ++i) {
+          if(!tiles[i].drawn) continue;
+          std::vector<float> &samples = tiles[i].samples;
+          for(size_t j=0; j<samples.size(); ++j) {
+            float d = data[tiles[i].sampleOffset + j];
+            samples[j] = (d < 0.0f) ? std::numeric_limits<float>::quiet_NaN() : d;
+          }
+        }
+        return;
+      }
+      for(size_t i=0; i<tiles.size(); ++i) {
+        if(!tiles[i].drawn) continue;
+        copyRegion(colorImage.get(), tiles[i].color.get(), tiles[i].x, tiles[i].y);
+        copyRegion(depthImage.get(), tiles[i].depth.get(), tiles[i].x, tiles[i].y);
+      }
+    }
+
+  } // end of namespace graphics
+} // end of namespace mars
@@ -0,0 +1,150 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file CameraArray.h
+ * \brief Renders several render to texture cameras as tiles of one target.
+ */
+
+#ifndef MARS_GRAPHICS_CAMERA_ARRAY_H
+#define MARS_GRAPHICS_CAMERA_ARRAY_H
+
+#ifdef _PRINT_HEADER_
+  #warning "CameraArray.h"
+#endif
+
+#include <osg/Camera>
+#include <osg/Image>
+#include <osg/Texture2D>
+#include <osgViewer/CompositeViewer>
+
+#include <string>
+#include <vector>
+
+namespace mars {
+  namespace graphics {
+
+    /**
+     * \brief Draws the cameras of a group of render to texture windows with
+     * one view.
+     *
+     * Every window camera becomes a nested camera that draws into its own
+     * viewport (tile) of a frame buffer object shared by the group. The
+     * view is culled and drawn in one traversal, cleared once and color
+     * and depth are read back with one transfer each. After the frame
+     * splitTiles() copies the regions of the tiles that were active into
+     * the images of their windows, thus the windows keep their last image
+     * while they are deactivated.
+     *
+     * The tiles are packed in rows; the target is created again if tiles
+     * are added or removed.
+     *
+     * If GPU sampling is enabled and every tile has a list of sample pixels
+     * (see setTileSamples()) color and depth stay in textures. A second pass
+     * looks up the depth of the sample pixels, linearizes it and writes it
+     * into a small float target; only these values are read back and the
+     * images of the tiles are not updated.
+     */
+    class CameraArray {
+    public:
+      CameraArray(const std::string &group, osgViewer::CompositeViewer *viewer,
+                  osg::GraphicsContext *context, int maxSize=4096);
+      ~CameraArray();
+
+      const std::string& getGroup() const {return group;}
+      bool empty() const {return tiles.empty();}
+
+      /**
+       * \brief Adds a nested camera; its viewport is set by the array.
+       *
+       * \c color (RGBA) and \c depth (GL_DEPTH_COMPONENT as unsigned
+       * int) have to be allocated with the size of the tile.
+       * \return \c false if the target has no space left for the tile
+       */
+      bool addTile(osg::Camera *camera, osg::Image *color, osg::Image *depth);
+      /** \brief Returns \c true if a tile of the given size fits. */
+      bool canAdd(int tileWidth, int tileHeight) const;
+      void removeTile(osg::Camera *camera);
+
+      void setClearColor(const osg::Vec4 &color);
+      /** \brief Enables the GPU gather pass for tiles with sample pixels. */
+      void setGPUSampling(bool enable);
+
+      /**
+       * \brief Sets the pixels whose distance is read by getTileSamples().
+       *
+       * The indices are y*width+x with the first row at the top, as in
+       * GraphicsWindowInterface::getRTTDepthData().
+       */
+      void setTileSamples(osg::Camera *camera, const std::vector<int> &pixels);
+      /**
+       * \brief Copies the distances of the sample pixels of a tile to
+       * \c buffer; pixels without depth are NaN.
+       * \return \c false if the samples are not gathered on the GPU, the
+       *         caller has to read them from the depth image of the tile
+       */
+      bool getTileSamples(osg::Camera *camera, float *buffer) const;
+
+      /** \brief Creates the target if needed and enables the view if a tile
+       * is active. Has to be called before the frame is rendered. */
+      void update();
+      /** \brief Copies the tiles drawn in the last frame to their images. */
+      void splitTiles();
+
+    private:
+      struct Tile {
+        osg::ref_ptr<osg::Camera> camera;
+        osg::ref_ptr<osg::Image> color, depth;
+        int x, y, width, height;
+        bool drawn;
+        std::vector<int> samplePixels;
+        std::vector<float> samples;
+        int sampleOffset;
+        double zNear, zFar;
+      };
+
+      std::string group;
+      osgViewer::CompositeViewer *viewer;
+      osg::ref_ptr<osg::GraphicsContext> context;
+      int maxSize;
+      std::vector<Tile> tiles;
+      osg::ref_ptr<osg::Group> root;
+      osg::ref_ptr<osgViewer::View> view;
+      osg::ref_ptr<osg::Image> colorImage, depthImage;
+      osg::Vec4 clearColor;
+      int width, height;
+      bool targetDirty;
+      bool gpuSampling;
+      osg::ref_ptr<osg::Texture2D> colorTexture, depthTexture, lookupTexture;
+      osg::ref_ptr<osg::Image> lookupImage, sampleImage;
+      osg::ref_ptr<osg::Camera> sampler;
+
+      bool layout(std::vector<Tile> &list, int *w, int *h) const;
+      bool isSampled() const;
+      const Tile* findTile(osg::Camera *camera) const;
+      void createTarget();
+      osg::Camera* createSampler();
+      void updateLookup(bool force);
+    }; // end of class CameraArray
+
+  } // end of namespace graphics
+} // end of namespace mars
+
+#endif // MARS_GRAPHICS_CAMERA_ARRAY_H
@@ -41,6 +41,10 @@
 
 #include "3d_objects/GridPrimitive.h"
 #include "3d_objects/DrawObject.h"
+#include "3d_objects/InstanceBatch.h"
+#include "3d_objects/ScreenErrorLOD.h"
+#include "BVHCullCallback.h"
+#include "CameraArray.h"
 #include "3d_objects/CoordsPrimitive.h"
 #include "3d_objects/AxisPrimitive.h"
 
@@ -61,6 +65,7 @@
 #include "QtOsgMixGraphicsWidget.h"
 
 #include <iostream>
+#include <sstream>
 #include <cassert>
 #include <stdexcept>
 
@@ -78,7 +83,17 @@ namespace mars {
 
     static int ReceivesShadowTraversalMask = 0x1000;
     static int CastsShadowTraversalMask = 0x2000;
+    // fewer objects are cheaper to draw one by one
+    static const size_t MinInstanceBatchSize = 4;
 
+    /**
+     * Stops the cull traversal; the children are still found by the
+     * intersection visitors used for picking.
+     */
+    class SkipCullCallback : public osg::NodeCallback {
+    public:
+      virtual void operator()(osg::Node *node, osg::NodeVisitor *nv) {}
+    };
 
     GraphicsManager::GraphicsManager(lib_manager::LibManager *theManager,
                                      void *myQTWidget)
@@ -107,6 +122,9 @@ namespace mars {
         initialized(false),
         activeWindow(NULL),
         materialManager(NULL) {
+      instancePickGroup = new osg::Group;
+      instancePickGroup->setCullCallback(new SkipCullCallback);
+      instancingDirty = true;
       //osg::setNotifyLevel( osg::WARN );
 
       // first check if we have the cfg_manager lib
@@ -114,6 +132,13 @@ namespace mars {
     }
 
     GraphicsManager::~GraphicsManager() {
+      clearInstanceBatches();
+      for(size_t i=0; i<graphicsWindows.size(); ++i) {
+        graphicsWindows[i]->setCameraArray(NULL);
+      }
+      for(size_t i=0; i<cameraArrays.size(); ++i) {
+        delete cameraArrays[i];
+      }
       if(cfg) {
         string saveFile = configPath.sValue;
         saveFile.append("/mars_Graphics.yaml");
@@ -260,6 +285,7 @@ namespace mars {
         scene->setStateSet(globalStateset.get());
         scene->addChild(lightGroup.get());
         scene->addChild(shadowedScene.get());
+        shadowedScene->addChild(instancePickGroup.get());
 
         // init light (osg can have only 8 lights enabled at a time)
         for (unsigned int i =0; i<8;i++) {
@@ -512,6 +538,11 @@ namespace mars {
       graphicOptions = options;
       for(unsigned int i=0; i<graphicsWindows.size(); i++)
         graphicsWindows[i]->setClearColor(graphicOptions.clearColor);
+      for(unsigned int i=0; i<cameraArrays.size(); i++)
+        cameraArrays[i]->setClearColor(osg::Vec4(graphicOptions.clearColor.r,
+                                                 graphicOptions.clearColor.g,
+                                                 graphicOptions.clearColor.b,
+                                                 graphicOptions.clearColor.a));
 
       myFog->setColor(osg::Vec4(graphicOptions.fogColor.r,
                                 graphicOptions.fogColor.g,
@@ -599,6 +630,47 @@ namespace mars {
       return next_window_id - 1;
     }
 
+    unsigned long GraphicsManager::new3DWindowTile(const std::string &group,
+                                                   int width, int height,
+                                                   const std::string &name) {
+      // the tiles use the context of the main window
+      if(graphicsWindows.empty() || !cfg || !cameraArraysProp.bValue) {
+        return new3DWindow(0, true, width, height, name);
+      }
+
+      CameraArray *array = NULL;
+      for(size_t i=0; i<cameraArrays.size(); ++i) {
+        if(cameraArrays[i]->getGroup() == group &&
+           cameraArrays[i]->canAdd(width, height)) {
+          array = cameraArrays[i];
+          break;
+        }
+      }
+      if(!array) {
+        array = new CameraArray(group, viewer.get(),
+                                graphicsWindows[0]->getGraphicsWindow());
+        if(!array->canAdd(width, height)) {
+          delete array;
+          return new3DWindow(0, true, width, height, name);
+        }
+        const mars::utils::Color &c = graphicOptions.clearColor;
+        array->setClearColor(osg::Vec4(c.r, c.g, c.b, c.a));
+        array->setGPUSampling(gpuDepthSampling.bValue);
+        cameraArrays.push_back(array);
+      }
+
+      GraphicsWidget *gw;
+      gw = QtOsgMixGraphicsWidget::createInstance(0, scene.get(),
+                                                  next_window_id++, true,
+                                                  0, this);
+      gw->setCameraArray(array);
+      gw->initializeOSG(0, graphicsWindows[0], width, height);
+      gw->setName(name);
+      gw->setClearColor(graphicOptions.clearColor);
+      graphicsWindows.push_back(gw);
+      return next_window_id - 1;
+    }
+
     void* GraphicsManager::getView(unsigned long id){
 
       GraphicsWidget* gw=getGraphicsWindow(id);
@@ -715,30 +787,27 @@ namespace mars {
       getLights(&lightList);
       if(lightList.size() == 0) lightList.push_back(&defaultLight.lStruct);
 
-      map<unsigned long, osg::ref_ptr<OSGNodeStruct> >::iterator drawIter;
-
       for (unsigned int i=0; i<myLights.size(); i++) {
         //return only the used lights
-        if (!myLights[i].free) {
-          if(myLights[i].lStruct.drawID != 0) {
-            for(drawIter=drawObjects_.begin(); drawIter!=drawObjects_.end(); ++drawIter) {
-              if(drawIter->first == myLights[i].lStruct.drawID) {
-                Vector pos = drawIter->second->object()->getPosition();
-                Quaternion q = drawIter->second->object()->getQuaternion();
-                myLights[i].lStruct.pos = pos;
-                myLights[i].light->setPosition(osg::Vec4(pos.x(), pos.y(),
-                                                         pos.z()+0.1, 1.0));
-                pos = q*Vector(1, 0, 0);
-                myLights[i].lStruct.lookAt = pos;
-                myLights[i].light->setDirection(osg::Vec3(pos.x(), pos.y(),
-                                                          pos.z()));
-                break;
-              }
-            }
+        if (!myLights[i].free && myLights[i].lStruct.drawID != 0) {
+          OSGNodeStruct *ns = findDrawObject(myLights[i].lStruct.drawID);
+          if(ns) {
+            Vector pos = ns->object()->getPosition();
+            Quaternion q = ns->object()->getQuaternion();
+            myLights[i].lStruct.pos = pos;
+            myLights[i].light->setPosition(osg::Vec4(pos.x(), pos.y(),
+                                                     pos.z()+0.1, 1.0));
+            pos = q*Vector(1, 0, 0);
+            myLights[i].lStruct.lookAt = pos;
+            myLights[i].light->setDirection(osg::Vec3(pos.x(), pos.y(),
+                                                      pos.z()));
           }
         }
       }
 
+      updateInstancing();
+      updateCulling();
+
       if(materialManager) {
         materialManager->updateLights(lightList);
 
@@ -748,15 +817,121 @@ namespace mars {
         materialManager->setShadowScale(shadowMap->getTexScale());
       }
 
+      std::vector<CameraArray*>::iterator arrayIt;
+      for(arrayIt=cameraArrays.begin(); arrayIt!=cameraArrays.end();) {
+        if((*arrayIt)->empty()) {
+          delete *arrayIt;
+          arrayIt = cameraArrays.erase(arrayIt);
+        }
+        else {
+          (*arrayIt)->update();
+          ++arrayIt;
+        }
+      }
+
       // Render a complete new frame.
       if(viewer) viewer->frame();
       ++framecount;
+      for(arrayIt=cameraArrays.begin(); arrayIt!=cameraArrays.end(); ++arrayIt) {
+        (*arrayIt)->splitTiles();
+      }
       for(it=graphicsUpdateObjects.begin();
           it!=graphicsUpdateObjects.end(); ++it) {
         (*it)->postGraphicsUpdate();
       }
     }
 
+    void GraphicsManager::updateInstancing() {
+      if(instancingDirty) {
+        instancingDirty = false;
+        clearInstanceBatches();
+        // the instanced materials need the shader and the shadow pass
+        // does not know about the instances
+        if(materialManager && instancing.bValue && marsShader.bValue) {
+          std::map<std::string, std::vector<DrawObject*> > groups;
+          DrawObjects::iterator iter;
+          for(iter=drawObjects_.begin(); iter!=drawObjects_.end(); ++iter) {
+            DrawObject *drawObject = iter->second->object();
+            if(!drawObject || drawObject->getMaterialName().empty() ||
+               !drawObject->isInstanceable()) {
+              continue;
+            }
+            unsigned int mask = (drawObject->getPosTransform()->getNodeMask() &
+                                 drawObject->getObject()->getNodeMask());
+            if(marsShadow.bValue && (mask & CastsShadowTraversalMask)) {
+              continue;
+            }
+            std::stringstream key;
+            key << drawObject->getMaterialName() << ":" << mask;
+            osg::Group *group = drawObject->getObject();
+            for(unsigned int i=0; i<group->getNumChildren(); ++i) {
+              key << ":" << group->getChild(i);
+            }
+            groups[key.str()].push_back(drawObject);
+          }
+
+          std::map<std::string, std::vector<DrawObject*> >::iterator it;
+          for(it=groups.begin(); it!=groups.end(); ++it) {
+            if(it->second.size() < MinInstanceBatchSize) continue;
+            DrawObject *first = it->second.front();
+            osg::ref_ptr<MaterialNode> materialNode =
+              materialManager->getNewInstancedMaterialGroup(first->getMaterialName());
+            if(!materialNode.valid()) continue;
+            unsigned int mask = (first->getPosTransform()->getNodeMask() &
+                                 first->getObject()->getNodeMask());
+            InstanceBatch *batch = new InstanceBatch(materialNode.get(),
+                                                     first->getObject(), mask);
+            for(size_t i=0; i<it->second.size(); ++i) {
+              batch->addMember(it->second[i]);
+              it->second[i]->setInstanceGroup(instancePickGroup.get());
+            }
+            instanceBatches.push_back(batch);
+          }
+        }
+      }
+
+      std::vector<InstanceBatch*>::iterator it;
+      for(it=instanceBatches.begin(); it!=instanceBatches.end(); ++it) {
+        (*it)->update();
+      }
+    }
+
+    void GraphicsManager::clearInstanceBatches() {
+      std::vector<InstanceBatch*>::iterator it;
+      for(it=instanceBatches.begin(); it!=instanceBatches.end(); ++it) {
+        const std::vector<DrawObject*> &members = (*it)->getMembers();
+        for(size_t i=0; i<members.size(); ++i) {
+          members[i]->setInstanceGroup(NULL);
+        }
+        if(materialManager) {
+          materialManager->removeMaterialGroup((*it)->getMaterialNode());
+        }
+        delete *it;
+      }
+      instanceBatches.clear();
+    }
+
+    void GraphicsManager::updateCulling() {
+      if(!materialManager) return;
+      osg::ref_ptr<osg::Group> stateGroup = materialManager->getMainStateGroup();
+      // materials are created while loading, check the groups every frame
+      for(unsigned int i=0; i<stateGroup->getNumChildren(); ++i) {
+        osg::Node *material = stateGroup->getChild(i);
+        osg::NodeCallback *callback = material->getCullCallback();
+        if(bvhCulling.bValue && !callback) {
+          material->setCullCallback(new BVHCullCallback);
+        }
+        else if(!bvhCulling.bValue && dynamic_cast<BVHCullCallback*>(callback)) {
+          material->setCullCallback(NULL);
+        }
+      }
+    }
+
+    std::string GraphicsManager::getAutoLodPath() const {
+      if(!cfg || !autoLod.bValue) return "";
+      return lodCachePath.sValue;
+    }
+
     void GraphicsManager::setGrabFrames(bool value) {
       graphicsWindows[0]->setGrabFrames(value);
       graphicsWindows[0]->setSaveFrames(value);
@@ -824,10 +999,8 @@ namespace mars {
 
 
     OSGNodeStruct* GraphicsManager::findDrawObject(unsigned long id) const {
-      map<unsigned long, osg::ref_ptr<OSGNodeStruct> >::const_iterator needle;
-      needle = drawObjects_.find(id);
-      if(needle == drawObjects_.end()) return NULL;
-      else return needle->second.get();
+      if(id < drawObjectIndex_.size()) return drawObjectIndex_[id];
+      return NULL;
     }
 
     unsigned long GraphicsManager::addDrawObject(const mars::interfaces::NodeData &snode,
@@ -843,6 +1016,10 @@ namespace mars {
 
       DrawCoreIds.insert(pair<unsigned long int, unsigned long int>(id, snode.index));
       drawObjects_[id] = drawObject;
+      if(drawObjectIndex_.size() <= id) {
+        drawObjectIndex_.resize(id+1, NULL);
+      }
+      drawObjectIndex_[id] = drawObject.get();
 
       if(snode.isShadowCaster) {
         mask |= CastsShadowTraversalMask;
@@ -888,6 +1065,7 @@ namespace mars {
       }
 
       setDrawObjectMaterial(id, snode.material);
+      instancingDirty = true;
       if(activated) {
         if(mask != 0) {
           drawObject->object()->show();
@@ -915,12 +1093,16 @@ namespace mars {
       OSGNodeStruct *ns = findDrawObject(id);
       if(ns == NULL) return;
       DrawObject *drawObject = ns->object();
+      // the batches must not keep a pointer to the deleted object
+      clearInstanceBatches();
+      instancingDirty = true;
       if (drawObject) {
         drawObject->hide();
         scene->removeChild(drawObject->getPosTransform());
         shadowedScene->removeChild(drawObject->getPosTransform());
         delete drawObject;
       }
+      drawObjectIndex_[id] = NULL;
       drawObjects_.erase(id);
     }
 
@@ -938,6 +1120,7 @@ namespace mars {
       for (iter = drawObjects_.begin(); iter != drawObjects_.end(); iter++) {
         iter->second->object()->removeBits(bit);
       }
+      instancingDirty = true;
     }
 
     void GraphicsManager::setDrawObjectSelected(unsigned long id, bool val) {
@@ -948,6 +1131,7 @@ namespace mars {
       DrawObjectList::iterator drawit;
 
       ns->object()->setSelected(val);
+      instancingDirty = true;
 
       if(!val) {
         for(drawit=selectedObjects_.begin(); drawit!=selectedObjects_.end();
@@ -974,6 +1158,16 @@ namespace mars {
       OSGNodeStruct *ns = findDrawObject(id);
       if(ns != NULL) ns->object()->setQuaternion(q);
     }
+    void GraphicsManager::setDrawObjectTransforms(const std::vector<interfaces::drawObjectTransform> &transforms) {
+      std::vector<interfaces::drawObjectTransform>::const_iterator it;
+      OSGNodeStruct *ns;
+      for(it=transforms.begin(); it!=transforms.end(); ++it) {
+        ns = findDrawObject(it->id);
+        if(ns == NULL) continue;
+        ns->object()->setPosition(it->pos);
+        ns->object()->setQuaternion(it->rot);
+      }
+    }
     void GraphicsManager::setDrawObjectScale(unsigned long id, const Vector &ext) {
       OSGNodeStruct *ns = findDrawObject(id);
       if(ns != NULL) ns->object()->setScaledSize(ext);
@@ -990,6 +1184,7 @@ namespace mars {
         materialManager->createMaterial(material.name, map);
         ns->object()->setMaterial(material.name);
         ns->object()->setNodeMask(material.cullMask);
+        instancingDirty = true;
       }
     }
 
@@ -1017,6 +1212,7 @@ namespace mars {
     void GraphicsManager::setDrawObjectNodeMask(unsigned long id, unsigned int bits) {
       OSGNodeStruct *ns = findDrawObject(id);
       if(ns != NULL) ns->object()->setBits(bits);
+      instancingDirty = true;
     }
 
     void GraphicsManager::setBlending(unsigned long id, bool mode) {
@@ -1035,6 +1231,7 @@ namespace mars {
     void GraphicsManager::setDrawObjectRBN(unsigned long id, int val) {
       OSGNodeStruct *ns = findDrawObject(id);
       if(ns != NULL) ns->object()->setRenderBinNumber(val);
+      instancingDirty = true;
     }
     void GraphicsManager::setDrawObjectShow(unsigned long id, bool val) {
       OSGNodeStruct *ns = findDrawObject(id);
@@ -1047,6 +1244,7 @@ namespace mars {
           scene->removeChild(ns->object()->getPosTransform());
           shadowedScene->removeChild(ns->object()->getPosTransform());
         }
+        instancingDirty = true;
       }
     }
 
@@ -1767,6 +1965,31 @@ namespace mars {
       marsShader = cfg->getOrCreateProperty("Graphics", "marsShader", true,
                                             cfgClient);
 
+      instancing = cfg->getOrCreateProperty("Graphics", "instancing", true,
+                                            cfgClient);
+
+      autoLod = cfg->getOrCreateProperty("Graphics", "autoLod", true,
+                                         cfgClient);
+
+      lodCachePath = cfg->getOrCreateProperty("Graphics", "lodCachePath",
+                                              configPath.sValue+"/lod_cache",
+                                              cfgClient);
+
+      lodPixelError = cfg->getOrCreateProperty("Graphics", "lodPixelError",
+                                               1.0, cfgClient);
+      ScreenErrorLOD::pixelError = lodPixelError.dValue;
+
+      bvhCulling = cfg->getOrCreateProperty("Graphics", "bvhCulling", true,
+                                            cfgClient);
+
+      cameraArraysProp = cfg->getOrCreateProperty("Graphics", "cameraArrays",
+                                                  true, cfgClient);
+
+      // disable for GL drivers without float render targets
+      gpuDepthSampling = cfg->getOrCreateProperty("Graphics",
+                                                  "gpuDepthSampling",
+                                                  true, cfgClient);
+
       drawRain = cfg->getOrCreateProperty("Graphics", "drawRain", false,
                                           cfgClient);
 
@@ -1881,6 +2104,48 @@ namespace mars {
         return;
       }
 
+      if(_property.paramId == instancing.paramId) {
+        instancing.bValue = _property.bValue;
+        instancingDirty = true;
+        return;
+      }
+
+      if(_property.paramId == autoLod.paramId) {
+        // applies to meshes loaded afterwards
+        autoLod.bValue = _property.bValue;
+        return;
+      }
+
+      if(_property.paramId == lodCachePath.paramId) {
+        lodCachePath.sValue = _property.sValue;
+        return;
+      }
+
+      if(_property.paramId == lodPixelError.paramId) {
+        lodPixelError.dValue = _property.dValue;
+        ScreenErrorLOD::pixelError = lodPixelError.dValue;
+        return;
+      }
+
+      if(_property.paramId == bvhCulling.paramId) {
+        bvhCulling.bValue = _property.bValue;
+        return;
+      }
+
+      if(_property.paramId == cameraArraysProp.paramId) {
+        // applies to windows created afterwards
+        cameraArraysProp.bValue = _property.bValue;
+        return;
+      }
+
+      if(_property.paramId == gpuDepthSampling.paramId) {
+        gpuDepthSampling.bValue = _property.bValue;
+        for(size_t i=0; i<cameraArrays.size(); ++i) {
+          cameraArrays[i]->setGPUSampling(gpuDepthSampling.bValue);
+        }
+        return;
+      }
+
       if(_property.paramId == shadowSamples.paramId) {
         setShadowSamples(_property.iValue);
         return;
@@ -1985,6 +2250,8 @@ namespace mars {
     }
 
     void GraphicsManager::setUseShader(bool val) {
+      marsShader.bValue = val;
+      instancingDirty = true;
       if(materialManager) materialManager->setUseShader(val);
       if(val) {
         shadowMap->addTexture(globalStateset.get());
@@ -2146,6 +2413,7 @@ namespace mars {
 
     void GraphicsManager::setUseShadow(bool v) {
       marsShadow.bValue = v;
+      instancingDirty = true;
 
       if(v) {
         shadowedScene->setShadowTechnique(shadowMap.get());
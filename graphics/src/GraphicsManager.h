@@ -79,8 +79,10 @@
 namespace mars {
   namespace graphics {
 
+    class CameraArray;
     class GraphicsWidget;
     class DrawObject;
+    class InstanceBatch;
     class OSGNodeStruct;
     class OSGHudElementStruct;
     class HUDElement;
@@ -145,6 +147,7 @@ namespace mars {
       virtual void removeDrawObject(unsigned long id);
       virtual void setDrawObjectPos(unsigned long id, const mars::utils::Vector &pos);
       virtual void setDrawObjectRot(unsigned long id, const mars::utils::Quaternion &q);
+      virtual void setDrawObjectTransforms(const std::vector<interfaces::drawObjectTransform> &transforms);
       virtual void setDrawObjectScale(unsigned long id, const mars::utils::Vector &ext);
       virtual void setDrawObjectMaterial(unsigned long id,
                                          const mars::interfaces::MaterialData &material);
@@ -224,6 +227,9 @@ namespace mars {
 
       virtual unsigned long new3DWindow(void *myQTWidget = 0, bool rtt = 0,
                                         int width = 0, int height = 0, const std::string &name=std::string(""));
+      virtual unsigned long new3DWindowTile(const std::string &group,
+                                            int width, int height,
+                                            const std::string &name=std::string(""));
       virtual interfaces::GraphicsWindowInterface* get3DWindow(unsigned long id) const;
       virtual void remove3DWindow(unsigned long id);
 
@@ -310,6 +316,11 @@ namespace mars {
                                 std::string value);
       virtual void setCameraDefaultView(int view);
       inline void setActiveWindow(GraphicsWidget *g) {activeWindow = g;}
+      /**
+       * \brief Returns the directory for generated levels of detail or an
+       * empty string if loaded meshes should not get levels of detail.
+       */
+      std::string getAutoLodPath() const;
 
     private:
       mars::interfaces::GraphicData graphicOptions;
@@ -368,6 +379,8 @@ namespace mars {
       std::vector<nodemanager> myNodes;
       DrawObjects previewNodes_;
       DrawObjects drawObjects_;
+      // flat index of drawObjects_; ids are handed out sequentially
+      std::vector<OSGNodeStruct*> drawObjectIndex_;
       // object selection
       DrawObjectList selectedObjects_;
       std::list<interfaces::GraphicsUpdateInterface*> graphicsUpdateObjects;
@@ -381,6 +394,15 @@ namespace mars {
 
       osg::ref_ptr<ShadowMap> shadowMap;
 
+      // objects that share mesh and material are drawn by instance batches
+      std::vector<InstanceBatch*> instanceBatches;
+      // keeps the transforms of batched objects pickable without drawing them
+      osg::ref_ptr<osg::Group> instancePickGroup;
+      bool instancingDirty;
+
+      // render to texture windows drawn as tiles of a shared target
+      std::vector<CameraArray*> cameraArrays;
+
       /**\brief adds a preview node to the scene */
       int createPreviewNode(const std::vector<mars::interfaces::NodeData> &allNodes);
 
@@ -399,6 +421,10 @@ namespace mars {
       cfg_manager::cfgPropertyStruct resources_path;
       cfg_manager::cfgPropertyStruct configPath;
       cfg_manager::cfgPropertyStruct shadowSamples;
+      cfg_manager::cfgPropertyStruct instancing;
+      cfg_manager::cfgPropertyStruct autoLod, lodCachePath, lodPixelError;
+      cfg_manager::cfgPropertyStruct bvhCulling;
+      cfg_manager::cfgPropertyStruct cameraArraysProp, gpuDepthSampling;
       int ignore_next_resize;
       bool set_window_prop;
       osg::ref_ptr<osg::CullFace> cull;
@@ -414,6 +440,13 @@ namespace mars {
       void setUseShader(bool val);
 
       void initDefaultLight();
+      /**\brief regroups the draw objects into instance batches if needed
+       * and uploads the instance matrices */
+      void updateInstancing();
+      void clearInstanceBatches();
+      /**\brief installs or removes the bounding volume culling of the
+       * material groups */
+      void updateCulling();
 
     }; // end of class GraphicsManager
 
@@ -20,6 +20,7 @@
 
 #include "QtOsgMixGraphicsWidget.h"
 #include "GraphicsWidget.h"
+#include "CameraArray.h"
 #include "HUD.h"
 #include "GraphicsManager.h"
 
@@ -72,6 +73,7 @@ namespace mars {
       widgetID = id;
 
       this->isRTTWidget = isRTTWidget;
+      cameraArray = NULL;
       isStereoDisplay = isFullscreen = false;
       isMouseMoving = isMouseButtonDown = false;
       isHUDShown = true;
@@ -100,6 +102,9 @@ namespace mars {
        */
       this->ref();
       if(gm) gm->removeGraphicsWidget(widgetID);
+      if(cameraArray && graphicsCamera) {
+        cameraArray->removeTile(graphicsCamera->getOSGCamera().get());
+      }
       delete graphicsCamera;
       delete myHUD;
     }
@@ -765,6 +770,11 @@ namespace mars {
       view->setLightingMode(osg::View::NO_LIGHT);
 
       createContext(data, shared, widgetWidth, widgetHeight);
+      if(cameraArray) {
+        // the tile is drawn by the view of the camera array
+        graphicsCamera->changeCameraTypeToPerspective();
+        return;
+      }
       if(!isRTTWidget) {
         graphicsWindow->setWindowName("3D Environment");
 
@@ -842,6 +852,22 @@ namespace mars {
         postDrawCallback->setGrab(false);
         //osgCamera->setFinalDrawCallback(postDrawCallback);
       }
+      else if(cameraArray) {
+        // nested camera drawing into its tile of the shared target; the
+        // projection is kept as set to compute the distances correctly
+        osgCamera = new osg::Camera();
+        osgCamera->setRenderOrder(osg::Camera::NESTED_RENDER);
+        osgCamera->setReferenceFrame(osg::Transform::ABSOLUTE_RF);
+        osgCamera->setComputeNearFarMode(osg::CullSettings::DO_NOT_COMPUTE_NEAR_FAR);
+        osgCamera->setCullMask(CULL_LAYER);
+        osgCamera->addChild(scene);
+        createRTTTextures();
+        if(!cameraArray->addTile(osgCamera.get(), rttImage.get(),
+                                 rttDepthImage.get())) {
+          fprintf(stderr, "GraphicsWidget: no space left in camera array \"%s\"\n",
+                  cameraArray->getGroup().c_str());
+        }
+      }
       else { // hasRTTWidget == true
         osgCamera = new osg::Camera();
         if(!shared) {
@@ -881,52 +907,51 @@ namespace mars {
         osgCamera->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT);
         osgCamera->setAllowEventFocus(false);
         osgCamera->setCullMask(CULL_LAYER);
-        rttTexture = new osg::Texture2D();
-        rttTexture->setResizeNonPowerOfTwoHint(false);
-        rttTexture->setDataVariance(osg::Object::DYNAMIC);
-        rttTexture->setTextureSize(widgetWidth, widgetHeight);
-        rttTexture->setInternalFormat(GL_RGBA);
-        rttTexture->setWrap(osg::Texture::WRAP_S, osg::Texture::REPEAT);
-        rttTexture->setWrap(osg::Texture::WRAP_T, osg::Texture::REPEAT);
-        rttTexture->setFilter(osg::Texture2D::MIN_FILTER,osg::Texture2D::LINEAR);
-        rttTexture->setFilter(osg::Texture2D::MAG_FILTER,osg::Texture2D::LINEAR);
-
-
-
-        rttImage = new osg::Image();
-        rttImage->allocateImage(widgetWidth, widgetHeight,
-                                1, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV);
+        createRTTTextures();
         osgCamera->attach(osg::Camera::COLOR_BUFFER, rttImage.get());
-        rttTexture->setImage(rttImage);
-
-        // depth component
-        rttDepthTexture = new osg::Texture2D();
-        rttDepthTexture->setResizeNonPowerOfTwoHint(false);
-        rttDepthTexture->setDataVariance(osg::Object::DYNAMIC);
-        rttDepthTexture->setTextureSize(widgetWidth, widgetHeight);
-        rttDepthTexture->setSourceType(GL_UNSIGNED_INT);
-        rttDepthTexture->setSourceFormat(GL_DEPTH_COMPONENT);
-        rttDepthTexture->setWrap(osg::Texture::WRAP_S, osg::Texture::REPEAT);
-        rttDepthTexture->setWrap(osg::Texture::WRAP_T, osg::Texture::REPEAT);
-        rttDepthTexture->setFilter(osg::Texture2D::MIN_FILTER,
-                                   osg::Texture2D::LINEAR);
-        rttDepthTexture->setFilter(osg::Texture2D::MAG_FILTER,
-                                   osg::Texture2D::LINEAR);
-        rttDepthImage = new osg::Image();
-        rttDepthImage->allocateImage(widgetWidth, widgetHeight,
-                                     1, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT);
-
         osgCamera->attach(osg::Camera::DEPTH_BUFFER, rttDepthImage.get());
-        
-        std::fill(rttDepthImage->data(), rttDepthImage->data() + widgetWidth * widgetHeight * sizeof(GLuint), 0);
-        
-        rttDepthTexture->setImage(rttDepthImage);
-
-
       }
       graphicsCamera = new GraphicsCamera(osgCamera, widgetWidth, widgetHeight);
     }
 
+    void GraphicsWidget::createRTTTextures() {
+      rttTexture = new osg::Texture2D();
+      rttTexture->setResizeNonPowerOfTwoHint(false);
+      rttTexture->setDataVariance(osg::Object::DYNAMIC);
+      rttTexture->setTextureSize(widgetWidth, widgetHeight);
+      rttTexture->setInternalFormat(GL_RGBA);
+      rttTexture->setWrap(osg::Texture::WRAP_S, osg::Texture::REPEAT);
+      rttTexture->setWrap(osg::Texture::WRAP_T, osg::Texture::REPEAT);
+      rttTexture->setFilter(osg::Texture2D::MIN_FILTER,osg::Texture2D::LINEAR);
+      rttTexture->setFilter(osg::Texture2D::MAG_FILTER,osg::Texture2D::LINEAR);
+
+      rttImage = new osg::Image();
+      rttImage->allocateImage(widgetWidth, widgetHeight,
+                              1, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV);
+      rttTexture->setImage(rttImage);
+
+      // depth component
+      rttDepthTexture = new osg::Texture2D();
+      rttDepthTexture->setResizeNonPowerOfTwoHint(false);
+      rttDepthTexture->setDataVariance(osg::Object::DYNAMIC);
+      rttDepthTexture->setTextureSize(widgetWidth, widgetHeight);
+      rttDepthTexture->setSourceType(GL_UNSIGNED_INT);
+      rttDepthTexture->setSourceFormat(GL_DEPTH_COMPONENT);
+      rttDepthTexture->setWrap(osg::Texture::WRAP_S, osg::Texture::REPEAT);
+      rttDepthTexture->setWrap(osg::Texture::WRAP_T, osg::Texture::REPEAT);
+      rttDepthTexture->setFilter(osg::Texture2D::MIN_FILTER,
+                                 osg::Texture2D::LINEAR);
+      rttDepthTexture->setFilter(osg::Texture2D::MAG_FILTER,
+                                 osg::Texture2D::LINEAR);
+      rttDepthImage = new osg::Image();
+      rttDepthImage->allocateImage(widgetWidth, widgetHeight,
+                                   1, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT);
+
+      std::fill(rttDepthImage->data(), rttDepthImage->data() + widgetWidth * widgetHeight * sizeof(GLuint), 0);
+
+      rttDepthTexture->setImage(rttDepthImage);
+    }
+
     unsigned long GraphicsWidget::getID(void) {
       return widgetID;
     }
@@ -1120,6 +1145,43 @@ namespace mars {
       }
     }
 
+    void GraphicsWidget::setRTTDepthSamples(const std::vector<int> &pixels) {
+      if(!isRTTWidget) {
+        throw std::runtime_error("Depth image not supported on non RTT Widges");
+      }
+      depthSamples = pixels;
+      if(cameraArray) {
+        cameraArray->setTileSamples(graphicsCamera->getOSGCamera().get(),
+                                    pixels);
+      }
+    }
+
+    void GraphicsWidget::getRTTDepthSamples(float *buffer) {
+      if(!isRTTWidget) {
+        throw std::runtime_error("Depth image not supported on non RTT Widges");
+      }
+      if(cameraArray &&
+         cameraArray->getTileSamples(graphicsCamera->getOSGCamera().get(),
+                                     buffer)) {
+        return;
+      }
+      // fallback: linearize only the sampled pixels of the depth image
+      const GLuint *data2 = (const GLuint *)rttDepthImage->data();
+      const int width = rttDepthImage->s();
+      const int height = rttDepthImage->t();
+      double fovy, aspectRatio, Zn, Zf;
+      graphicsCamera->getOSGCamera()->getProjectionMatrixAsPerspective( fovy, aspectRatio, Zn, Zf );
+      for(size_t i=0; i<depthSamples.size(); ++i) {
+        const int y = depthSamples[i] / width;
+        const int x = depthSamples[i] % width;
+        const float dv = ((float) data2[(height-1-y)*width+x]) / std::numeric_limits< GLuint >::max();
+        if( dv >= 1.0 )
+          buffer[i] = std::numeric_limits<float>::quiet_NaN();
+        else
+          buffer[i] = Zn*Zf/(Zf-dv*(Zf-Zn));
+      }
+    }
+
     bool GraphicsWidget::handle(
                                 const osgGA::GUIEventAdapter& ea,
                                 osgGA::GUIActionAdapter& aa)
@@ -50,6 +50,7 @@
 namespace mars {
   namespace graphics {
 
+    class CameraArray;
     class GraphicsManager;
     class HUD;
     class HUDElement;
@@ -68,6 +69,11 @@ namespace mars {
       ~GraphicsWidget();
       void initializeOSG(void *data = 0, GraphicsWidget* shared = 0,
                          int width = 0, int height = 0);
+      /**
+       * \brief Draws the render to texture widget as tile of \c array
+       * instead of an own view; has to be set before initializeOSG().
+       */
+      void setCameraArray(CameraArray *array) {cameraArray = array;}
 
       unsigned long getID(void);
 
@@ -192,6 +198,8 @@ namespace mars {
        * */
       virtual void getRTTDepthData(float *buffer, int &width, int &height);
       virtual void getRTTDepthData(float **data, int &width, int &height);
+      virtual void setRTTDepthSamples(const std::vector<int> &pixels);
+      virtual void getRTTDepthSamples(float *buffer);
   
       virtual osg::Group* getScene(){
         return scene;
@@ -243,6 +251,8 @@ namespace mars {
 
       // toggle for render to texture
       bool isRTTWidget;
+      // draws the render to texture camera if set
+      CameraArray *cameraArray;
 
       // access to creating and managing graphics window and events
       osg::ref_ptr<osgViewer::GraphicsWindow> graphicsWindow;
@@ -289,6 +299,8 @@ namespace mars {
       osg::ref_ptr<osg::Texture2D> rttDepthTexture;
       // destination image if isRTTWidget==true
       osg::ref_ptr<osg::Image> rttDepthImage;
+      // pixels read by getRTTDepthSamples()
+      std::vector<int> depthSamples;
 
       // list of picked objects
       std::vector<osg::Node*> pickedObjects;
@@ -299,6 +311,7 @@ namespace mars {
       virtual osg::ref_ptr<osg::GraphicsContext> createWidgetContext(
                                                                      void* parent, osg::ref_ptr<osg::GraphicsContext::Traits> traits);
       void createContext(void* parent, GraphicsWidget* shared, int width, int height);
+      void createRTTTextures();
 
       // implements osgGA::GUIEventHandler::handle
       bool handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter& aa);
@@ -0,0 +1,368 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "MeshLod.h"
+#include "gui_helper_functions.h"
+
+#include <mars/utils/misc.h>
+#include <mars/utils/Mutex.h>
+#include <mars/utils/MutexLocker.h>
+
+#include <osg/BoundingBox>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/NodeVisitor>
+#include <osg/TriangleIndexFunctor>
+
+#include <sys/stat.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <set>
+#include <sstream>
+
+#ifdef WIN32
+  #include <process.h>
+  #define getpid _getpid
+#else
+  #include <unistd.h>
+#endif
+
+namespace mars {
+  namespace graphics {
+
+    // increase if the generated levels change
+    static const int lodCacheVersion = 1;
+
+    // meshes of this process that got no levels of detail, also covers
+    // the cases in which no marker file can be written
+    static std::set<std::string> meshesWithoutLod;
+    static utils::Mutex meshesWithoutLodMutex;
+
+    namespace {
+
+      struct Vertex {
+        float v[8]; // position, normal, texcoord
+
+        bool operator<(const Vertex &other) const {
+          return memcmp(v, other.v, sizeof(v)) < 0;
+        }
+      };
+
+      struct TriangleCollector {
+        std::vector<unsigned int> *indices;
+
+        void operator()(unsigned int i1, unsigned int i2, unsigned int i3) {
+          if(i1 == i2 || i2 == i3 || i1 == i3) return;
+          indices->push_back(i1);
+          indices->push_back(i2);
+          indices->push_back(i3);
+        }
+      };
+
+      /**
+       * Collects the triangles of all geometries below a node in world
+       * coordinates and merges equal vertices.
+       */
+      class MeshCollector : public osg::NodeVisitor {
+      public:
+        MeshCollector(BobjMesh *mesh) :
+          osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+          mesh(mesh), hasTexcoords(false) {
+          mesh->lodIndices.resize(1);
+        }
+
+        virtual void apply(osg::Geode &geode) {
+          osg::Matrix matrix = osg::computeLocalToWorld(getNodePath());
+          for(unsigned int i=0; i<geode.getNumDrawables(); ++i) {
+            osg::Geometry *geometry = geode.getDrawable(i)->asGeometry();
+            if(geometry) addGeometry(geometry, matrix);
+          }
+        }
+
+        bool getHasTexcoords() const {
+          return hasTexcoords;
+        }
+
+      private:
+        void addGeometry(osg::Geometry *geometry, const osg::Matrix &matrix) {
+          osg::Vec3Array *vertices = dynamic_cast<osg::Vec3Array*>(geometry->getVertexArray());
+          if(!vertices) return;
+          osg::Vec3Array *normals = dynamic_cast<osg::Vec3Array*>(geometry->getNormalArray());
+          if(normals && normals->size() != vertices->size()) normals = 0;
+          osg::Vec2Array *texcoords = dynamic_cast<osg::Vec2Array*>(geometry->getTexCoordArray(0));
+          if(texcoords && texcoords->size() != vertices->size()) texcoords = 0;
+          if(texcoords) hasTexcoords = true;
+
+          osg::Matrix inverse = osg::Matrix::inverse(matrix);
+          std::vector<unsigned int> triangles;
+          osg::TriangleIndexFunctor<TriangleCollector> functor;
+          functor.indices = &triangles;
+          geometry->accept(functor);
+
+          for(size_t t=0; t<triangles.size(); t+=3) {
+            osg::Vec3 p[3];
+            for(int k=0; k<3; ++k) p[k] = (*vertices)[triangles[t+k]] * matrix;
+            osg::Vec3 faceNormal = (p[1]-p[0]) ^ (p[2]-p[0]);
+            faceNormal.normalize();
+            for(int k=0; k<3; ++k) {
+              unsigned int index = triangles[t+k];
+              osg::Vec3 n = faceNormal;
+              if(normals) {
+                n = osg::Matrix::transform3x3(inverse, (*normals)[index]);
+                n.normalize();
+              }
+              Vertex vertex;
+              memset(&vertex, 0, sizeof(vertex));
+              for(int j=0; j<3; ++j) {
+                vertex.v[j] = p[k][j];
+                vertex.v[3+j] = n[j];
+              }
+              if(texcoords) {
+                vertex.v[6] = (*texcoords)[index][0];
+                vertex.v[7] = (*texcoords)[index][1];
+              }
+              mesh->lodIndices[0].push_back(addVertex(vertex));
+            }
+          }
+        }
+
+        uint32_t addVertex(const Vertex &vertex) {
+          std::map<Vertex, uint32_t>::iterator it = vertexMap.find(vertex);
+          if(it != vertexMap.end()) return it->second;
+          uint32_t index = mesh->positions.size() / 3;
+          mesh->positions.insert(mesh->positions.end(), vertex.v, vertex.v+3);
+          mesh->normals.insert(mesh->normals.end(), vertex.v+3, vertex.v+6);
+          mesh->texcoords.insert(mesh->texcoords.end(), vertex.v+6, vertex.v+8);
+          vertexMap[vertex] = index;
+          return index;
+        }
+
+        BobjMesh *mesh;
+        bool hasTexcoords;
+        std::map<Vertex, uint32_t> vertexMap;
+      };
+
+      osg::Vec3 getVec3(const std::vector<float> &array, uint32_t i) {
+        return osg::Vec3(array[i*3], array[i*3+1], array[i*3+2]);
+      }
+
+      /**
+       * Computes per vertex tangents from the texture coordinates, the w
+       * component stores the handedness of the bitangent.
+       */
+      void computeTangents(BobjMesh *mesh) {
+        size_t n = mesh->positions.size() / 3;
+        std::vector<osg::Vec3> tan(n), bitan(n);
+        const std::vector<uint32_t> &indices = mesh->lodIndices[0];
+        for(size_t t=0; t<indices.size(); t+=3) {
+          uint32_t i[3] = {indices[t], indices[t+1], indices[t+2]};
+          osg::Vec3 e1 = getVec3(mesh->positions, i[1]) - getVec3(mesh->positions, i[0]);
+          osg::Vec3 e2 = getVec3(mesh->positions, i[2]) - getVec3(mesh->positions, i[0]);
+          float du1 = mesh->texcoords[i[1]*2] - mesh->texcoords[i[0]*2];
+          float dv1 = mesh->texcoords[i[1]*2+1] - mesh->texcoords[i[0]*2+1];
+          float du2 = mesh->texcoords[i[2]*2] - mesh->texcoords[i[0]*2];
+          float dv2 = mesh->texcoords[i[2]*2+1] - mesh->texcoords[i[0]*2+1];
+          float det = du1*dv2 - du2*dv1;
+          if(fabs(det) < 1e-12) continue;
+          float r = 1.0f / det;
+          osg::Vec3 sdir = (e1*dv2 - e2*dv1) * r;
+          osg::Vec3 tdir = (e2*du1 - e1*du2) * r;
+          for(int k=0; k<3; ++k) {
+            tan[i[k]] += sdir;
+            bitan[i[k]] += tdir;
+          }
+        }
+        mesh->tangents.resize(n*4);
+        for(size_t v=0; v<n; ++v) {
+          osg::Vec3 normal = getVec3(mesh->normals, v);
+          // Gram-Schmidt orthogonalization
+          osg::Vec3 t = tan[v] - normal * (normal * tan[v]);
+          if(t.normalize() == 0.0) {
+            // no texture gradient, use any direction orthogonal to the normal
+            t = normal ^ (fabs(normal.x()) < 0.9 ? osg::Vec3(1, 0, 0) :
+                          osg::Vec3(0, 1, 0));
+            t.normalize();
+          }
+          mesh->tangents[v*4] = t.x();
+          mesh->tangents[v*4+1] = t.y();
+          mesh->tangents[v*4+2] = t.z();
+          mesh->tangents[v*4+3] = ((normal ^ t) * bitan[v] < 0.0f) ? -1.0f : 1.0f;
+        }
+      }
+
+      unsigned long long hashString(const std::string &s) {
+        unsigned long long h = 14695981039346656037ULL;
+        for(size_t i=0; i<s.size(); ++i) {
+          h ^= (unsigned char)s[i];
+          h *= 1099511628211ULL;
+        }
+        return h;
+      }
+
+    } // end of anonymous namespace
+
+    bool createBobjMesh(osg::Node *node, BobjMesh *mesh) {
+      MeshCollector collector(mesh);
+      node->accept(collector);
+      if(mesh->lodIndices[0].empty()) return false;
+      if(collector.getHasTexcoords()) {
+        computeTangents(mesh);
+      }
+      else {
+        mesh->texcoords.clear();
+      }
+      return true;
+    }
+
+    std::vector<uint32_t> clusterLevel(const BobjMesh &mesh, int resolution,
+                                       float *error) {
+      size_t n = mesh.positions.size() / 3;
+      osg::BoundingBox box;
+      for(size_t v=0; v<n; ++v) box.expandBy(getVec3(mesh.positions, v));
+      float size = std::max(box.xMax()-box.xMin(),
+                            std::max(box.yMax()-box.yMin(), box.zMax()-box.zMin()));
+      float cell = size / resolution;
+      if(error) *error = 0.0f;
+      if(cell <= 0.0f) return mesh.lodIndices[0];
+
+      std::map<long long, uint32_t> cells;
+      std::vector<uint32_t> representative(n);
+      float maxError2 = 0.0f;
+      for(size_t v=0; v<n; ++v) {
+        osg::Vec3 p = getVec3(mesh.positions, v) - box._min;
+        long long x = (long long)(p.x() / cell);
+        long long y = (long long)(p.y() / cell);
+        long long z = (long long)(p.z() / cell);
+        long long key = (x * (resolution+1) + y) * (resolution+1) + z;
+        std::map<long long, uint32_t>::iterator it = cells.find(key);
+        if(it == cells.end()) {
+          cells[key] = v;
+          representative[v] = v;
+        }
+        else {
+          representative[v] = it->second;
+          float d2 = (getVec3(mesh.positions, v) -
+                      getVec3(mesh.positions, it->second)).length2();
+          if(d2 > maxError2) maxError2 = d2;
+        }
+      }
+      std::vector<uint32_t> indices;
+      const std::vector<uint32_t> &full = mesh.lodIndices[0];
+      for(size_t t=0; t<full.size(); t+=3) {
+        uint32_t a = representative[full[t]];
+        uint32_t b = representative[full[t+1]];
+        uint32_t c = representative[full[t+2]];
+        if(a == b || b == c || a == c) continue;
+        indices.push_back(a);
+        indices.push_back(b);
+        indices.push_back(c);
+      }
+      if(error) *error = sqrtf(maxError2);
+      return indices;
+    }
+
+    void addErrorLods(BobjMesh *mesh, unsigned int maxLevels) {
+      mesh->lodIndices.resize(1);
+      mesh->lodErrors.assign(1, 0.0f);
+      size_t triangles = mesh->lodIndices[0].size() / 3;
+      int resolution = 64;
+      for(unsigned int l=0; l<maxLevels && resolution >= 2; ++l) {
+        float error;
+        std::vector<uint32_t> indices = clusterLevel(*mesh, resolution,
+                                                     &error);
+        resolution /= 2;
+        size_t count = indices.size() / 3;
+        // a finer grid may not reduce anything, try the next one
+        if(count*4 > triangles*3) continue;
+        if(count == 0) break;
+        mesh->lodIndices.push_back(indices);
+        mesh->lodErrors.push_back(error);
+        triangles = count;
+        if(triangles < 64) break;
+      }
+    }
+
+    std::string getLodCacheFile(const std::string &filename,
+                                const std::string &cachePath,
+                                unsigned int minTriangles) {
+      struct stat st;
+      if(cachePath.empty() || stat(filename.c_str(), &st) != 0) return "";
+      std::stringstream key;
+      key << lodCacheVersion << ":" << filename << ":"
+          << (long long)st.st_size << ":" << (long long)st.st_mtime;
+      unsigned long long hash = hashString(key.str());
+      char name[40];
+      snprintf(name, sizeof(name), "/%016llx.bobj", hash);
+      std::string cacheFile = cachePath + name;
+      if(BobjFile::isVersion2(cacheFile)) return cacheFile;
+
+      // a mesh without levels of detail is marked by an empty file, thus
+      // it is not read and decimated again on every load
+      snprintf(name, sizeof(name), "/%016llx.%u.nolod", hash, minTriangles);
+      std::string markerFile = cachePath + name;
+      {
+        utils::MutexLocker locker(&meshesWithoutLodMutex);
+        if(meshesWithoutLod.count(markerFile)) return "";
+      }
+      if(utils::pathExists(markerFile)) return "";
+
+      osg::ref_ptr<osg::Node> node;
+      if(filename.size() > 5 && filename.substr(filename.size()-5, 5) == ".bobj") {
+        node = GuiHelper::readBobjFromFile(filename);
+      }
+      else {
+        node = GuiHelper::readNodeFromFile(filename);
+      }
+      BobjMesh mesh;
+      bool useLod = (node.valid() && createBobjMesh(node.get(), &mesh) &&
+                     mesh.lodIndices[0].size()/3 >= minTriangles);
+      if(useLod) {
+        addErrorLods(&mesh);
+        useLod = (mesh.lodIndices.size() > 1);
+      }
+      if(!useLod) {
+        meshesWithoutLodMutex.lock();
+        meshesWithoutLod.insert(markerFile);
+        meshesWithoutLodMutex.unlock();
+        // unreadable meshes are only remembered by this process
+        if(node.valid() && utils::createDirectory(cachePath)) {
+          FILE *marker = fopen(markerFile.c_str(), "w");
+          if(marker) fclose(marker);
+        }
+        return "";
+      }
+
+      if(!utils::createDirectory(cachePath)) return "";
+      // several processes may fill the cache at the same time
+      std::stringstream tmpFile;
+      tmpFile << cacheFile << "." << getpid() << ".tmp";
+      if(!BobjFile::write(tmpFile.str(), mesh) ||
+         rename(tmpFile.str().c_str(), cacheFile.c_str()) != 0) {
+        remove(tmpFile.str().c_str());
+        return "";
+      }
+      return cacheFile;
+    }
+
+  } // end of namespace graphics
+} // end of namespace mars
@@ -0,0 +1,94 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file MeshLod.h
+ * \brief Builds indexed meshes and their levels of detail for the .bobj
+ * version 2 format.
+ */
+
+#ifndef MARS_GRAPHICS_MESH_LOD_H
+#define MARS_GRAPHICS_MESH_LOD_H
+
+#ifdef _PRINT_HEADER_
+  #warning "MeshLod.h"
+#endif
+
+#include "BobjFile.h"
+
+#include <osg/Node>
+
+#include <string>
+#include <vector>
+
+namespace mars {
+  namespace graphics {
+
+    /**
+     * \brief Merges the triangles of all geometries below \c node into
+     * level 0 of \c mesh.
+     *
+     * Equal vertices are shared, missing normals are computed per face and
+     * tangents are computed if the mesh has texture coordinates.
+     * \return \c false if the node contains no triangles
+     */
+    bool createBobjMesh(osg::Node *node, BobjMesh *mesh);
+
+    /**
+     * \brief Simplifies level 0 of \c mesh by vertex clustering.
+     *
+     * Every vertex is snapped to the first vertex of its cell in a regular
+     * grid with \c resolution cells along the largest extent, triangles
+     * that collapse are removed. The result indexes the vertices of
+     * level 0.
+     * \param error is set to the largest displacement of a vertex
+     */
+    std::vector<uint32_t> clusterLevel(const BobjMesh &mesh, int resolution,
+                                       float *error=NULL);
+
+    /**
+     * \brief Adds up to \c maxLevels levels by clustering with halved
+     * resolution each and stores the error of every level in
+     * BobjMesh::lodErrors.
+     *
+     * No more levels are added once a level has less than 64 triangles or
+     * saves less than a quarter of the previous one.
+     */
+    void addErrorLods(BobjMesh *mesh, unsigned int maxLevels=6);
+
+    /**
+     * \brief Returns a .bobj file in \c cachePath with generated levels of
+     * detail for the mesh file \c filename.
+     *
+     * The file is created on first use. Its name depends on the path,
+     * size and modification time of the mesh, thus a changed mesh is
+     * decimated again. Meshes that get no levels of detail are marked
+     * with an empty .nolod file in \c cachePath and are not read again.
+     * \return an empty string if the mesh has less than \c minTriangles
+     *         triangles or cannot be read
+     */
+    std::string getLodCacheFile(const std::string &filename,
+                                const std::string &cachePath,
+                                unsigned int minTriangles=512);
+
+  } // end of namespace graphics
+} // end of namespace mars
+
+#endif // MARS_GRAPHICS_MESH_LOD_H
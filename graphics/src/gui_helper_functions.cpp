@@ -19,6 +19,7 @@
  */
 
 #include "gui_helper_functions.h"
+#include "BobjFile.h"
 #include <iostream>
 #include <osg/TriangleFunctor>
 #include <osgDB/ReadFile>
@@ -37,6 +38,7 @@
 #endif
 
 #include <mars/utils/mathUtils.h>
+#include <mars/osg_material_manager/OsgMaterial.h>
 
 namespace mars {
   namespace graphics {
@@ -231,9 +233,37 @@ namespace mars {
       return ex;
     }
 
+    /**
+     * Sets the extent of the node from the extent \c ex of its mesh if
+     * requested and returns the factors that scale the mesh to the extent
+     * of the node.
+     */
+    static Vector computeMeshScale(mars::interfaces::NodeData* node,
+                                   const Vector &ex) {
+      if (node->map.find("loadSizeFromMesh") != node->map.end()) {
+        if (node->map["loadSizeFromMesh"]) {
+          Vector physicalScale;
+          utils::vectorFromConfigItem(&(node->map["physicalScale"][0]), &physicalScale);
+          node->ext=Vector(ex.x()*physicalScale.x(), ex.y()*physicalScale.y(), ex.z()*physicalScale.z());
+        }
+      }
+
+      //compute scale factor
+      Vector scale(1, 1, 1);
+      if (ex.x() != 0) scale.x() = node->ext.x() / ex.x();
+      if (ex.y() != 0) scale.y() = node->ext.y() / ex.y();
+      if (ex.z() != 0) scale.z() = node->ext.z() / ex.z();
+      return scale;
+    }
+
     void GuiHelper::getPhysicsFromMesh(mars::interfaces::NodeData* node) {
       if(node->filename.substr(node->filename.size()-5, 5) == ".bobj") {
-        getPhysicsFromNode(node, GuiHelper::readBobjFromFile(node->filename));
+        if(BobjFile::isVersion2(node->filename)) {
+          getPhysicsFromBobj(node);
+        }
+        else {
+          getPhysicsFromNode(node, GuiHelper::readBobjFromFile(node->filename));
+        }
       }
       else {
         getPhysicsFromNode(node, GuiHelper::readNodeFromFile(node->filename));
@@ -295,19 +325,8 @@ namespace mars {
       (fabs(bb.zMax()) > fabs(bb.zMin())) ? ex.z() = fabs(bb.zMax() - bb.zMin())
         : ex.z() = fabs(bb.zMin() - bb.zMax());
 
-      if (node->map.find("loadSizeFromMesh") != node->map.end()) {
-        if (node->map["loadSizeFromMesh"]) {
-          Vector physicalScale;
-          utils::vectorFromConfigItem(&(node->map["physicalScale"][0]), &physicalScale);
-          node->ext=Vector(ex.x()*physicalScale.x(), ex.y()*physicalScale.y(), ex.z()*physicalScale.z());
-        }
-      }
-
-      //compute scale factor
-      double scaleX = 1, scaleY = 1, scaleZ = 1;
-      if (ex.x() != 0) scaleX = node->ext.x() / ex.x();
-      if (ex.y() != 0) scaleY = node->ext.y() / ex.y();
-      if (ex.z() != 0) scaleZ = node->ext.z() / ex.z();
+      Vector scale = computeMeshScale(node, ex);
+      double scaleX = scale.x(), scaleY = scale.y(), scaleZ = scale.z();
 
       // create transform and group Node for the actual node
       osg::ref_ptr<osg::PositionAttitudeTransform> transform;
@@ -346,6 +365,46 @@ namespace mars {
                                                      node->pivot.z());
     }
 
+    /**
+     * Builds the collision mesh directly from the arrays of a .bobj version
+     * 2 file. The extent is taken from the stored bounding box and the
+     * first level of detail is used as is, thus no osg node is created.
+     */
+    void GuiHelper::getPhysicsFromBobj(mars::interfaces::NodeData* node) {
+      BobjFile file;
+      if(!file.open(node->filename)) {
+        throw std::runtime_error("cannot read node from file");
+      }
+      const BobjHeader &header = file.getHeader();
+      Vector ex(header.aabbMax[0] - header.aabbMin[0],
+                header.aabbMax[1] - header.aabbMin[1],
+                header.aabbMax[2] - header.aabbMin[2]);
+      Vector scale = computeMeshScale(node, ex);
+
+      snmesh mesh;
+      unsigned int vertexCount = file.getVertexCount();
+      unsigned int indexCount = file.getIndexCount(0);
+      if(vertexCount > 0) {
+        const float *positions = file.getPositions();
+        mesh.vertices = new mars::interfaces::mydVector3[vertexCount];
+        for(unsigned int i=0; i<vertexCount; ++i) {
+          mesh.vertices[i][0] = (positions[i*3] - node->pivot.x()) * scale.x();
+          mesh.vertices[i][1] = (positions[i*3+1] - node->pivot.y()) * scale.y();
+          mesh.vertices[i][2] = (positions[i*3+2] - node->pivot.z()) * scale.z();
+        }
+      }
+      if(indexCount > 0) {
+        const uint32_t *indices = file.getIndices(0);
+        mesh.indices = new int[indexCount];
+        for(unsigned int i=0; i<indexCount; ++i) {
+          mesh.indices[i] = indices[i];
+        }
+      }
+      mesh.vertexcount = vertexCount;
+      mesh.indexcount = indexCount;
+      node->mesh = mesh;
+    }
+
     osg::ref_ptr<osg::Node> GuiHelper::readNodeFromFile(string fileName) {
       std::vector<nodeFileStruct>::iterator iter;
 
@@ -361,6 +420,64 @@ namespace mars {
     }
 
 
+    static void setTangentArray(osg::Geometry *geometry, osg::Array *tangents) {
+#if (OPENSCENEGRAPH_MAJOR_VERSION < 3 || ( OPENSCENEGRAPH_MAJOR_VERSION == 3 && OPENSCENEGRAPH_MINOR_VERSION < 2))
+      geometry->setVertexAttribData(TANGENT_UNIT, osg::Geometry::ArrayData(tangents, osg::Geometry::BIND_PER_VERTEX));
+#elif (OPENSCENEGRAPH_MAJOR_VERSION > 3 || (OPENSCENEGRAPH_MAJOR_VERSION == 3 && OPENSCENEGRAPH_MINOR_VERSION >= 2))
+      geometry->setVertexAttribArray(TANGENT_UNIT, tangents, osg::Array::BIND_PER_VERTEX);
+#else
+#error Unknown OSG Version
+#endif
+    }
+
+    /**
+     * Creates the geometry of one level of detail of a .bobj version 2
+     * file. The arrays are copied in one block each from the mapped file;
+     * if \c shared is given its arrays are reused and only the indices of
+     * the level are copied.
+     */
+    static osg::Geometry* createBobjGeometry(const BobjFile &file,
+                                             unsigned int lod,
+                                             osg::Geometry *shared) {
+      osg::Geometry *geometry = new osg::Geometry;
+      if(shared) {
+        geometry->setVertexArray(shared->getVertexArray());
+        if(shared->getNormalArray()) {
+          geometry->setNormalArray(shared->getNormalArray());
+          geometry->setNormalBinding(osg::Geometry::BIND_PER_VERTEX);
+        }
+        if(shared->getTexCoordArray(DEFAULT_UV_UNIT)) {
+          geometry->setTexCoordArray(DEFAULT_UV_UNIT,
+                                     shared->getTexCoordArray(DEFAULT_UV_UNIT));
+        }
+        if(shared->getVertexAttribArray(TANGENT_UNIT)) {
+          setTangentArray(geometry, shared->getVertexAttribArray(TANGENT_UNIT));
+        }
+      }
+      else {
+        unsigned int n = file.getVertexCount();
+        geometry->setVertexArray(new osg::Vec3Array(n, (const osg::Vec3*)file.getPositions()));
+        if(file.getNormals()) {
+          geometry->setNormalArray(new osg::Vec3Array(n, (const osg::Vec3*)file.getNormals()));
+          geometry->setNormalBinding(osg::Geometry::BIND_PER_VERTEX);
+        }
+        if(file.getTexcoords()) {
+          geometry->setTexCoordArray(DEFAULT_UV_UNIT,
+                                     new osg::Vec2Array(n, (const osg::Vec2*)file.getTexcoords()));
+        }
+        if(file.getTangents()) {
+          setTangentArray(geometry, new osg::Vec4Array(n, (const osg::Vec4*)file.getTangents()));
+        }
+      }
+      geometry->addPrimitiveSet(new osg::DrawElementsUInt(osg::PrimitiveSet::TRIANGLES,
+                                                          file.getIndexCount(lod),
+                                                          file.getIndices(lod)));
+      // the indexed layout is already optimized, thus no osgUtil::Optimizer
+      geometry->setUseDisplayList(false);
+      geometry->setUseVertexBufferObjects(true);
+      return geometry;
+    }
+
     osg::ref_ptr<osg::Node> GuiHelper::readBobjFromFile(const std::string &filename) {
 
       std::vector<nodeFileStruct>::iterator iter;
@@ -372,6 +489,17 @@ namespace mars {
       nodeFileStruct newNodeFile;
       newNodeFile.fileName = filename;
 
+      if(BobjFile::isVersion2(filename)) {
+        BobjFile file;
+        if(!file.open(filename)) return 0;
+        osg::Geode *geode = new osg::Geode();
+        geode->addDrawable(createBobjGeometry(file, 0, 0));
+        geode->setName("bobj");
+        newNodeFile.node = geode;
+        GuiHelper::nodeFiles.push_back(newNodeFile);
+        return newNodeFile.node;
+      }
+
       FILE* input = fopen(filename.c_str(), "rb");
       if(!input) return 0;
 
@@ -509,6 +637,34 @@ namespace mars {
       return newNodeFile.node;
     }
 
+    bool GuiHelper::readBobjLodsFromFile(const std::string &filename,
+                                         std::vector< osg::ref_ptr<osg::Geode> > *geodes,
+                                         std::vector<float> *maxDistances,
+                                         bool *lodErrors) {
+      if(!BobjFile::isVersion2(filename)) return false;
+      osg::ref_ptr<osg::Node> node = readBobjFromFile(filename);
+      BobjFile file;
+      if(!node.valid() || !file.open(filename)) return false;
+      if(lodErrors) *lodErrors = file.hasLodErrors();
+      osg::Geometry *shared = node->asGeode()->getDrawable(0)->asGeometry();
+
+      geodes->clear();
+      maxDistances->clear();
+      for(unsigned int l=0; l<file.getLodCount(); ++l) {
+        if(l == 0) {
+          geodes->push_back(node->asGeode());
+        }
+        else {
+          osg::ref_ptr<osg::Geode> geode = new osg::Geode();
+          geode->addDrawable(createBobjGeometry(file, l, shared));
+          geode->setName("bobj");
+          geodes->push_back(geode);
+        }
+        maxDistances->push_back(file.getLodDistance(l));
+      }
+      return true;
+    }
+
     // TODO: should not be in graphics!
     // physics without graphics would need this too.
     // maybe move to NodeFactory ??
@@ -122,6 +122,19 @@ namespace mars {
 
       static osg::ref_ptr<osg::Node> readNodeFromFile(std::string fileName);
       static osg::ref_ptr<osg::Node> readBobjFromFile(const std::string &filename);
+      /**
+       * \brief Reads the levels of detail stored in a .bobj version 2 file.
+       *
+       * Level 0 is the geode returned by readBobjFromFile(), all levels
+       * share its vertex arrays. \c maxDistances is filled with the
+       * distance up to which each level is shown, or with the geometric
+       * error of each level if \c lodErrors is set to \c true.
+       * \return \c false if the file is no version 2 file
+       */
+      static bool readBobjLodsFromFile(const std::string &filename,
+                                       std::vector< osg::ref_ptr<osg::Geode> > *geodes,
+                                       std::vector<float> *maxDistances,
+                                       bool *lodErrors=NULL);
       static osg::ref_ptr<osg::Texture2D> loadTexture(std::string filename);
       static osg::ref_ptr<osg::Image> loadImage(std::string filename);
 
@@ -139,6 +152,7 @@ namespace mars {
       static std::vector<imageFileStruct> imageFiles;
       void getPhysicsFromNode(mars::interfaces::NodeData* node,
                               osg::ref_ptr<osg::Node> completeNode);
+      void getPhysicsFromBobj(mars::interfaces::NodeData* node);
     }; // end of class GuiHelper
 
   } // end of namespace graphics
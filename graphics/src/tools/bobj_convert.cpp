@@ -0,0 +1,141 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file bobj_convert.cpp
+ * \brief Converts .obj, .stl and version 1 .bobj meshes to .bobj version 2.
+ *
+ * Example: mars_bobj_convert --lod 2 --lod-distance 5 base.obj base.bobj
+ *
+ * All geometries of the input are merged into one indexed mesh. Equal
+ * vertices are shared, normals are taken from the input or computed per
+ * face and tangents are computed if the mesh has texture coordinates.
+ * Each additional level of detail halves the resolution of a vertex
+ * clustering of the previous one and reuses the vertices of level 0.
+ * With --lod-error the number of levels is chosen automatically and each
+ * level stores its geometric error instead of a switch distance.
+ */
+
+#include "BobjFile.h"
+#include "MeshLod.h"
+#include "gui_helper_functions.h"
+
+#include <osgDB/ReadFile>
+
+#include <getopt.h>
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace mars::graphics;
+
+namespace {
+
+  void printUsage(const char *name) {
+    fprintf(stderr, "usage: %s [options] input output.bobj\n", name);
+    fprintf(stderr, "  --lod n             additional levels of detail (default 0)\n");
+    fprintf(stderr, "  --lod-distance d    distance up to which level 0 is shown,\n");
+    fprintf(stderr, "                      doubles for every level (default 10)\n");
+    fprintf(stderr, "  --lod-error         generate the levels by their geometric error\n");
+    fprintf(stderr, "                      for screen space selection instead\n");
+  }
+
+} // end of anonymous namespace
+
+int main(int argc, char *argv[]) {
+  int lodLevels = 0;
+  double lodDistance = 10.0;
+  int lodError = 0;
+
+  static struct option long_options[] = {
+    {"lod", required_argument, 0, 'l'},
+    {"lod-distance", required_argument, 0, 'd'},
+    {"lod-error", no_argument, 0, 'e'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+  };
+  int c, option_index = 0;
+  while((c = getopt_long(argc, argv, "l:d:eh", long_options,
+                         &option_index)) != -1) {
+    switch(c) {
+    case 'l': lodLevels = atoi(optarg); break;
+    case 'd': lodDistance = atof(optarg); break;
+    case 'e': lodError = 1; break;
+    default:
+      printUsage(argv[0]);
+      return 2;
+    }
+  }
+  if(argc - optind != 2 || lodLevels < 0 || lodDistance <= 0.0) {
+    printUsage(argv[0]);
+    return 2;
+  }
+  std::string input = argv[optind], output = argv[optind+1];
+
+  osg::ref_ptr<osg::Node> node;
+  if(input.size() > 5 && input.substr(input.size()-5, 5) == ".bobj") {
+    node = GuiHelper::readBobjFromFile(input);
+  }
+  else {
+    node = osgDB::readNodeFile(input);
+  }
+  if(!node.valid()) {
+    fprintf(stderr, "bobj_convert: could not read \"%s\"\n", input.c_str());
+    return 1;
+  }
+
+  BobjMesh mesh;
+  if(!createBobjMesh(node.get(), &mesh)) {
+    fprintf(stderr, "bobj_convert: \"%s\" contains no triangles\n",
+            input.c_str());
+    return 1;
+  }
+
+  if(lodError) {
+    addErrorLods(&mesh);
+  }
+  else {
+    int resolution = 64;
+    for(int l=1; l<=lodLevels; ++l, resolution /= 2) {
+      mesh.lodIndices.push_back(clusterLevel(mesh, std::max(resolution, 2)));
+    }
+    for(int l=0; l<lodLevels; ++l) {
+      mesh.lodDistances.push_back(lodDistance * (1 << l));
+    }
+    mesh.lodDistances.push_back(FLT_MAX);
+  }
+
+  if(!BobjFile::write(output, mesh)) {
+    fprintf(stderr, "bobj_convert: could not write \"%s\"\n", output.c_str());
+    return 1;
+  }
+  fprintf(stderr, "bobj_convert: %lu vertices, %lu triangles",
+          (unsigned long)(mesh.positions.size()/3),
+          (unsigned long)(mesh.lodIndices[0].size()/3));
+  for(size_t l=1; l<mesh.lodIndices.size(); ++l) {
+    fprintf(stderr, ", level %lu: %lu triangles", (unsigned long)l,
+            (unsigned long)(mesh.lodIndices[l].size()/3));
+  }
+  fprintf(stderr, "\n");
+  return 0;
+}
@@ -22,6 +22,7 @@
 #include <mars/interfaces/utils.h>
 
 #include <mars/interfaces/sim/JointManagerInterface.h>
+#include <mars/interfaces/sim/JointInterface.h>
 
 namespace mars {
   namespace gui {
@@ -89,6 +90,8 @@ namespace mars {
         //    control->log->unregisterReceiver((LogClient*)this, LOG_TYPE_JOINT,
         //                                     actualJoint);
       }
+      // the widget shows the axis torques and the joint load
+      control->joints->requestFeedback(index, interfaces::JOINT_FEEDBACK_ALL);
       control->joints->getDataBrokerNames(index, &groupName, &dataName);
       control->dataBroker->registerAsyncReceiver(this, groupName, dataName);
       //  control->log->registerReceiver((LogClient*)this, LOG_TYPE_JOINT, index, 100);
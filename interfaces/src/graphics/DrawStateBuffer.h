@@ -0,0 +1,171 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file DrawStateBuffer.h
+ * \brief Hands draw object poses from the physics to the render thread.
+ */
+
+#ifndef MARS_INTERFACES_GRAPHICS_DRAW_STATE_BUFFER_H
+#define MARS_INTERFACES_GRAPHICS_DRAW_STATE_BUFFER_H
+
+#ifdef _PRINT_HEADER_
+  #warning "DrawStateBuffer.h"
+#endif
+
+#include "draw_structs.h"
+
+#include <mars/utils/TripleBuffer.h>
+#include <mars/utils/misc.h>
+
+#include <atomic>
+#include <vector>
+
+namespace mars {
+  namespace interfaces {
+
+    /**
+     * \brief A snapshot of draw object poses taken by the physics thread.
+     */
+    struct drawStateSnapshot {
+      drawStateSnapshot() : stamp(0) {}
+      long long stamp; ///< wall clock time of publishing in ms
+      std::vector<drawObjectTransform> transforms;
+    };
+
+    /**
+     * \brief Triple buffered exchange of draw object poses.
+     *
+     * The physics thread fills beginWrite() and calls publish() after each
+     * step. The render thread calls collect() once per frame and gets the
+     * poses that changed since the last frame. Neither thread ever waits
+     * for the other and the render thread never touches physics data.
+     *
+     * With interpolation enabled the render thread blends between the two
+     * latest snapshots, lagging one publish interval behind the physics.
+     * Entries are matched by their position in the snapshot; an entry with
+     * a different id in the previous snapshot is not interpolated.
+     */
+    class DrawStateBuffer {
+    public:
+      DrawStateBuffer() : interpolate(true), posThreshold(0),
+                          rotThreshold(0) {}
+
+      /// longest publish interval in ms that is still interpolated
+      static const long long maxInterpolationMs = 200;
+
+      /// physics thread: the cleared snapshot to fill
+      std::vector<drawObjectTransform>& beginWrite() {
+        std::vector<drawObjectTransform> &t = buffer.writeBuffer().transforms;
+        t.clear();
+        return t;
+      }
+
+      /// physics thread: hands the filled snapshot to the render thread
+      void publish() {
+        buffer.writeBuffer().stamp = utils::getTime();
+        buffer.publish();
+      }
+
+      void setInterpolation(bool value) {
+        interpolate = value;
+      }
+
+      /**
+       * \brief Poses that differ less from the last sent pose are not
+       * sent again. The rotation threshold is given in radians.
+       */
+      void setThresholds(sReal pos, sReal rot) {
+        posThreshold = pos;
+        rotThreshold = rot;
+      }
+
+      /**
+       * \brief render thread: appends all poses that changed since the
+       * last call to \c out.
+       * \return \c true if \c out was extended
+       */
+      bool collect(std::vector<drawObjectTransform> *out) {
+        if(buffer.update()) {
+          // swapping hands the oldest vector back to the writer and keeps
+          // the allocations alive
+          drawStateSnapshot &fetched = buffer.readBuffer();
+          previous.transforms.swap(latest.transforms);
+          previous.stamp = latest.stamp;
+          latest.transforms.swap(fetched.transforms);
+          latest.stamp = fetched.stamp;
+          if(sent.size() != latest.transforms.size()) {
+            sent.clear();
+          }
+        }
+        if(latest.transforms.empty()) return false;
+
+        double t = 1.0;
+        // after a pause of the simulation the previous snapshot is too
+        // old to blend with
+        if(interpolate && latest.stamp > previous.stamp &&
+           latest.stamp - previous.stamp <= maxInterpolationMs &&
+           previous.transforms.size() == latest.transforms.size()) {
+          t = (double)(utils::getTime() - latest.stamp) /
+            (double)(latest.stamp - previous.stamp);
+          if(t > 1.0) t = 1.0;
+          else if(t < 0.0) t = 0.0;
+        }
+
+        size_t size = out->size();
+        bool sendAll = sent.empty();
+        if(sendAll) sent.resize(latest.transforms.size());
+        for(size_t i=0; i<latest.transforms.size(); ++i) {
+          drawObjectTransform current = latest.transforms[i];
+          if(t < 1.0 && previous.transforms[i].id == current.id) {
+            const drawObjectTransform &prev = previous.transforms[i];
+            current.pos = prev.pos + (current.pos - prev.pos)*t;
+            current.rot = prev.rot.slerp(t, current.rot);
+          }
+          if(!sendAll && sent[i].id == current.id &&
+             (sent[i].pos - current.pos).norm() <= posThreshold &&
+             sent[i].rot.angularDistance(current.rot) <= rotThreshold) {
+            continue;
+          }
+          sent[i] = current;
+          out->push_back(current);
+        }
+        return out->size() > size;
+      }
+
+      /// render thread: forces all poses to be sent on the next collect()
+      void invalidate() {
+        sent.clear();
+      }
+
+    private:
+      utils::TripleBuffer<drawStateSnapshot> buffer;
+      // only used by the render thread
+      drawStateSnapshot previous, latest;
+      std::vector<drawObjectTransform> sent;
+      // set by the cfg thread, read by the render thread
+      std::atomic<bool> interpolate;
+      sReal posThreshold, rotThreshold;
+    }; // end of class DrawStateBuffer
+
+  } // end of namespace interfaces
+} // end of namespace mars
+
+#endif  /* MARS_INTERFACES_GRAPHICS_DRAW_STATE_BUFFER_H */
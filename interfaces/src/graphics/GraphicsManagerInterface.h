@@ -85,6 +85,18 @@ namespace mars {
                                     const mars::utils::Vector &pos) = 0;
       virtual void setDrawObjectRot(unsigned long id,
                                     const mars::utils::Quaternion &q) = 0;
+      /**
+       * Sets position and rotation of several draw objects at once.
+       * Implementations should resolve the draw objects in one pass instead
+       * of performing a lookup per setDrawObjectPos/setDrawObjectRot call.
+       */
+      virtual void setDrawObjectTransforms(const std::vector<drawObjectTransform> &transforms) {
+        std::vector<drawObjectTransform>::const_iterator it;
+        for(it=transforms.begin(); it!=transforms.end(); ++it) {
+          setDrawObjectPos(it->id, it->pos);
+          setDrawObjectRot(it->id, it->rot);
+        }
+      }
       virtual void setDrawObjectScale(unsigned long id,
                                       const mars::utils::Vector &ext) = 0;
       virtual void setDrawObjectMaterial(unsigned long id, 
@@ -151,6 +163,14 @@ namespace mars {
       virtual void setTexture(unsigned long id, const std::string &filename) = 0;
       virtual unsigned long new3DWindow(void *myQTWidget = 0, bool rtt = 0,
                                         int width = 0, int height = 0, const std::string &name = std::string("")) = 0;
+      /**
+       * Creates a render to texture window like new3DWindow(). All windows
+       * of the same \c group are drawn as tiles of one target in one pass
+       * and read back with a single transfer.
+       */
+      virtual unsigned long new3DWindowTile(const std::string &group,
+                                            int width, int height,
+                                            const std::string &name = std::string("")) = 0;
       virtual void setGrabFrames(bool value) = 0;
       virtual GraphicsWindowInterface* get3DWindow(unsigned long id) const = 0; ///< Return the first matching 3D windows with the given name, 0 otherwise.
       virtual GraphicsWindowInterface* get3DWindow(const std::string &name) const=0;
@@ -36,6 +36,8 @@
 #include "GraphicsEventInterface.h"
 #include <mars/utils/Color.h>
 
+#include <vector>
+
 namespace osg{
     class Group;
 }
@@ -77,7 +79,23 @@ namespace mars {
        * @param height returns the height of the image
        * */
       virtual void getRTTDepthData(float *buffer, int &width, int &height) = 0;
-      virtual void getRTTDepthData(float **data, int &width, int &height) = 0;      
+      virtual void getRTTDepthData(float **data, int &width, int &height) = 0;
+
+      /**
+       * Sets the pixels of the depth image that are read by
+       * getRTTDepthSamples(). The indices are y * width + x in the layout
+       * of getRTTDepthData(). Windows created as tiles gather these pixels
+       * on the graphics card, so only the samples are transferred.
+       *
+       * @param pixels the pixel indices, an empty list disables sampling
+       * */
+      virtual void setRTTDepthSamples(const std::vector<int> &pixels) = 0;
+      /**
+       * This function copies the distances of the pixels set by
+       * setRTTDepthSamples() in the given buffer, which has to hold one
+       * float per pixel. Pixels without depth are NaN.
+       * */
+      virtual void getRTTDepthSamples(float *buffer) = 0;
       virtual osg::Group* getScene() = 0;
       virtual void setScene(osg::Group *scene) = 0;
       virtual void addGraphicsEventHandler(GraphicsEventInterface *graphicsEventHandler) = 0;
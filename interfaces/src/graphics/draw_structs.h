@@ -35,6 +35,7 @@
 
 #include <mars/utils/Color.h>
 #include <mars/utils/Vector.h>
+#include <mars/utils/Quaternion.h>
 
 #include <string>
 #include <vector>
@@ -126,6 +127,15 @@ namespace mars {
       int direction;
     }; // end of struct hudElementStruct
 
+    /** \brief drawObjectTransform is one entry of a batched pose update
+     * for draw objects (see GraphicsManagerInterface::setDrawObjectTransforms)
+     */
+    struct drawObjectTransform {
+      unsigned long id; // id of the draw object
+      mars::utils::Vector pos;
+      mars::utils::Quaternion rot;
+    }; // end of struct drawObjectTransform
+
   } // end of namespace interfaces
 } // end of namespace mars
 
@@ -0,0 +1,155 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file AssetCache.cpp
+ * \brief Read-only meshes and heightmaps shared by all simulations of a
+ * process.
+ *
+ */
+
+#include "AssetCache.h"
+#include "../NodeData.h"
+#include "../terrainStruct.h"
+
+#include <mars/utils/MutexLocker.h>
+#include <mars/utils/mathUtils.h>
+
+#include <cstdlib>
+#include <cstring>
+
+namespace mars {
+  namespace interfaces {
+
+    using namespace utils;
+
+    static bool vectorLess(const Vector &a, const Vector &b) {
+      for(int i=0; i<3; ++i) {
+        if(a[i] != b[i]) return a[i] < b[i];
+      }
+      return false;
+    }
+
+    bool AssetCache::meshKey::operator<(const meshKey &other) const {
+      if(filename != other.filename) return filename < other.filename;
+      if(origName != other.origName) return origName < other.origName;
+      if(loadSizeFromMesh != other.loadSizeFromMesh) {
+        return loadSizeFromMesh < other.loadSizeFromMesh;
+      }
+      if(vectorLess(ext, other.ext)) return true;
+      if(vectorLess(other.ext, ext)) return false;
+      if(vectorLess(pivot, other.pivot)) return true;
+      if(vectorLess(other.pivot, pivot)) return false;
+      return vectorLess(physicalScale, other.physicalScale);
+    }
+
+    AssetCache* AssetCache::instance() {
+      // the cache lives as long as the process and is shared by all
+      // LibManagers, the thread safe initialization is done by C++11
+      static AssetCache cache;
+      return &cache;
+    }
+
+    void AssetCache::getPhysicsFromMesh(NodeData *node,
+                                        LoadMeshInterface *loader) {
+      meshKey key;
+      key.filename = node->filename;
+      key.origName = node->origName;
+      key.ext = node->ext;
+      key.pivot = node->pivot;
+      key.physicalScale = Vector(1.0, 1.0, 1.0);
+      key.loadSizeFromMesh = false;
+      if(node->map.find("loadSizeFromMesh") != node->map.end()) {
+        if(node->map["loadSizeFromMesh"]) {
+          key.loadSizeFromMesh = true;
+          vectorFromConfigItem(&(node->map["physicalScale"][0]),
+                               &key.physicalScale);
+        }
+      }
+
+      MutexLocker locker(&mutex);
+      std::map<meshKey, meshEntry>::iterator it = meshes.find(key);
+      if(it == meshes.end()) {
+        // throws if the file can not be read, nothing is cached then
+        loader->getPhysicsFromMesh(node);
+        meshEntry &entry = meshes[key];
+        entry.ext = node->ext;
+        entry.vertices.resize(node->mesh.vertexcount*4);
+        if(node->mesh.vertexcount) {
+          memcpy(&entry.vertices[0], node->mesh.vertices,
+                 node->mesh.vertexcount*sizeof(mydVector3));
+        }
+        entry.indices.assign(node->mesh.indices,
+                             node->mesh.indices + node->mesh.indexcount);
+        return;
+      }
+
+      const meshEntry &entry = it->second;
+      node->ext = entry.ext;
+      node->mesh.setZero();
+      node->mesh.vertexcount = entry.vertices.size() / 4;
+      node->mesh.indexcount = entry.indices.size();
+      if(node->mesh.vertexcount) {
+        node->mesh.vertices = new mydVector3[node->mesh.vertexcount];
+        memcpy(node->mesh.vertices, &entry.vertices[0],
+               node->mesh.vertexcount*sizeof(mydVector3));
+      }
+      if(node->mesh.indexcount) {
+        node->mesh.indices = new int[node->mesh.indexcount];
+        memcpy(node->mesh.indices, &entry.indices[0],
+               node->mesh.indexcount*sizeof(int));
+      }
+    }
+
+    void AssetCache::readPixelData(terrainStruct *terrain,
+                                   LoadHeightmapInterface *loader) {
+      MutexLocker locker(&mutex);
+      std::map<std::string, heightmapEntry>::iterator it;
+      it = heightmaps.find(terrain->srcname);
+      if(it == heightmaps.end()) {
+        loader->readPixelData(terrain);
+        if(!terrain->pixelData) return;
+        heightmapEntry &entry = heightmaps[terrain->srcname];
+        entry.width = terrain->width;
+        entry.height = terrain->height;
+        entry.pixelData.assign(terrain->pixelData, terrain->pixelData +
+                               terrain->width*terrain->height);
+        return;
+      }
+
+      const heightmapEntry &entry = it->second;
+      terrain->width = entry.width;
+      terrain->height = entry.height;
+      terrain->pixelData = (double*)calloc(entry.pixelData.size(),
+                                           sizeof(double));
+      if(!entry.pixelData.empty()) {
+        memcpy(terrain->pixelData, &entry.pixelData[0],
+               entry.pixelData.size()*sizeof(double));
+      }
+    }
+
+    void AssetCache::clear() {
+      MutexLocker locker(&mutex);
+      meshes.clear();
+      heightmaps.clear();
+    }
+
+  } // end of namespace interfaces
+} // end of namespace mars
@@ -0,0 +1,101 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file AssetCache.h
+ * \brief Read-only meshes and heightmaps shared by all simulations of a
+ * process.
+ *
+ */
+
+#ifndef MARS_INTERFACES_ASSET_CACHE_H
+#define MARS_INTERFACES_ASSET_CACHE_H
+
+#ifdef _PRINT_HEADER_
+  #warning "AssetCache.h"
+#endif
+
+#include "LoadCenter.h"
+#include "../MARSDefs.h"
+
+#include <mars/utils/Mutex.h>
+#include <mars/utils/Vector.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace mars {
+  namespace interfaces {
+
+    /**
+     * \brief Caches the physical meshes and heightmaps that are loaded by
+     * the LoadMeshInterface and LoadHeightmapInterface.
+     *
+     * Several Simulator instances, each with its own LibManager, can run in
+     * one process. They share the cache returned by instance(), thus every
+     * file is read and converted only once. The loaders are called with the
+     * cache mutex locked, which also serializes the file readers that are
+     * not thread safe.
+     *
+     * The caller owns the returned data in the same way as if it was loaded
+     * by the loader directly: the mesh arrays are allocated with new[] and
+     * the pixel data with calloc().
+     */
+    class AssetCache {
+    public:
+      static AssetCache* instance();
+
+      void getPhysicsFromMesh(NodeData *node, LoadMeshInterface *loader);
+      void readPixelData(terrainStruct *terrain,
+                         LoadHeightmapInterface *loader);
+      void clear();
+
+    private:
+      AssetCache() {}
+
+      // everything the loader reads from the NodeData
+      struct meshKey {
+        std::string filename, origName;
+        utils::Vector ext, pivot, physicalScale;
+        bool loadSizeFromMesh;
+        bool operator<(const meshKey &other) const;
+      };
+
+      struct meshEntry {
+        utils::Vector ext;
+        std::vector<sReal> vertices; ///< four values per vertex
+        std::vector<int> indices;
+      };
+
+      struct heightmapEntry {
+        int width, height;
+        std::vector<double> pixelData;
+      };
+
+      utils::Mutex mutex;
+      std::map<meshKey, meshEntry> meshes;
+      std::map<std::string, heightmapEntry> heightmaps;
+    }; // end of class AssetCache
+
+  } // end of namespace interfaces
+} // end of namespace mars
+
+#endif // MARS_INTERFACES_ASSET_CACHE_H
@@ -0,0 +1,127 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file Checkpoint.h
+ * \brief "Checkpoint" is an in-memory binary snapshot of the simulation state
+ *
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#ifdef _PRINT_HEADER_
+  #warning "Checkpoint.h"
+#endif
+
+#include <vector>
+#include <cstring>
+
+namespace mars {
+  namespace interfaces {
+
+    /**
+     * \brief A compact binary blob the simulation state is written into by
+     * SimulatorInterface::saveCheckpoint and read back in the same order by
+     * SimulatorInterface::restoreCheckpoint.
+     *
+     * Only plain old data is stored, thus a checkpoint is only valid for the
+     * process and the scene it was taken from. Reading past the end sets the
+     * failed flag and leaves the value untouched.
+     */
+    class Checkpoint {
+    public:
+      Checkpoint() : readPos(0), failed(false) {}
+
+      template <typename T>
+      void write(const T &value) {
+        const char *p = reinterpret_cast<const char*>(&value);
+        data.insert(data.end(), p, p + sizeof(T));
+      }
+
+      template <typename T>
+      bool read(T *value) {
+        if(failed || readPos + sizeof(T) > data.size()) {
+          failed = true;
+          return false;
+        }
+        memcpy(value, &data[readPos], sizeof(T));
+        readPos += sizeof(T);
+        return true;
+      }
+
+      /// writes a sized sub block, e.g. the state of a plugin
+      void writeBlock(const Checkpoint &block) {
+        write((unsigned long)block.data.size());
+        data.insert(data.end(), block.data.begin(), block.data.end());
+      }
+
+      bool readBlock(Checkpoint *block) {
+        unsigned long size = 0;
+        if(!read(&size) || readPos + size > data.size()) {
+          failed = true;
+          return false;
+        }
+        block->clear();
+        block->data.assign(data.begin() + readPos,
+                           data.begin() + readPos + size);
+        readPos += size;
+        return true;
+      }
+
+      /// starts reading from the beginning again
+      void rewind() {
+        readPos = 0;
+        failed = false;
+      }
+
+      void clear() {
+        data.clear();
+        rewind();
+      }
+
+      bool hasFailed() const {
+        return failed;
+      }
+
+      size_t size() const {
+        return data.size();
+      }
+
+      /// FNV-1a hash of the content, equal states give equal hashes
+      unsigned long long hash() const {
+        unsigned long long h = 0xCBF29CE484222325ULL;
+        for(size_t i=0; i<data.size(); ++i) {
+          h ^= (unsigned char)data[i];
+          h *= 0x100000001B3ULL;
+        }
+        return h;
+      }
+
+    private:
+      std::vector<char> data;
+      size_t readPos;
+      bool failed;
+    };
+
+  } // end of namespace interfaces
+} // end of namespace mars
+
+#endif  // CHECKPOINT_H
@@ -31,6 +31,43 @@
 namespace mars {
   namespace interfaces {
 
+    /**
+     * \brief The quantities of a JointFeedback, combined as bit mask.
+     */
+    enum JointFeedbackFlags {
+      JOINT_FEEDBACK_STATE = 0x01,        ///< positions, velocities, anchor and axes
+      JOINT_FEEDBACK_FORCES = 0x02,       ///< forces and torques on the bodies
+      JOINT_FEEDBACK_MOTOR_TORQUE = 0x04,
+      JOINT_FEEDBACK_AXIS_TORQUE = 0x08,  ///< torques around the axes
+      JOINT_FEEDBACK_LOAD = 0x10,
+      JOINT_FEEDBACK_DEFAULT = 0x07,
+      JOINT_FEEDBACK_ALL = 0x1f
+    };
+
+    /**
+     * \brief The values of a joint after a physics step.
+     *
+     * Only the quantities set in \c flags are updated, the others keep
+     * their last values.
+     */
+    struct JointFeedback {
+      JointFeedback() : flags(JOINT_FEEDBACK_DEFAULT),
+                        position1(0), position2(0),
+                        velocity1(0), velocity2(0), motorTorque(0),
+                        anchor(0, 0, 0), axis1(0, 0, 0), axis2(0, 0, 0),
+                        force1(0, 0, 0), force2(0, 0, 0),
+                        torque1(0, 0, 0), torque2(0, 0, 0),
+                        axis1Torque(0, 0, 0), axis2Torque(0, 0, 0),
+                        jointLoad(0, 0, 0) {}
+      int flags;
+      sReal position1, position2;
+      sReal velocity1, velocity2;
+      sReal motorTorque;
+      utils::Vector anchor, axis1, axis2;
+      utils::Vector force1, force2, torque1, torque2;
+      utils::Vector axis1Torque, axis2Torque, jointLoad;
+    };
+
     class JointInterface {
     public:
       virtual ~JointInterface() {}
@@ -65,6 +102,8 @@ namespace mars {
       virtual void getAxisTorque(utils::Vector *t) const = 0;
       virtual void getAxis2Torque(utils::Vector *t) const = 0;
       virtual void update(void) = 0;
+      /** \brief Fills the quantities set in feedback->flags in one pass. */
+      virtual void getFeedback(JointFeedback *feedback) = 0;
       virtual void getJointLoad(utils::Vector *t) const = 0;
       virtual void changeStepSize(const JointData &jointS) = 0;
       virtual sReal getMotorTorque(void) const = 0;
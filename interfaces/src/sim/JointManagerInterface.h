@@ -130,6 +130,16 @@ namespace mars {
        */
       virtual void updateJoints(sReal calc_ms) = 0;
 
+      /**
+       * \brief Adds quantities (see JointFeedbackFlags) that are computed
+       * for the joint after every step.
+       *
+       * The positions, velocities, forces and the motor torque are always
+       * updated; sensors reading the axis torques or the joint load have to
+       * request them. The request is kept if the joint is reloaded.
+       */
+      virtual void requestFeedback(unsigned long id, int flags) = 0;
+
       /**
        * \brief Removes all joints from the simulation to clear the world.
        */
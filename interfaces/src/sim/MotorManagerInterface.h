@@ -37,6 +37,7 @@
 #endif
 
 #include "../MotorData.h"
+#include "Checkpoint.h"
 
 namespace mars {
 
@@ -277,6 +278,17 @@ namespace mars {
        * \param calc_ms The timing value in miliseconds. 
        */
       virtual void updateMotors(sReal calc_ms) = 0;
+
+      /**
+       * \brief Writes the controller state of all motors into \c checkpoint.
+       */
+      virtual void saveState(Checkpoint *checkpoint) const = 0;
+
+      /**
+       * \brief Restores the state written by saveState.
+       * \return \c false if the checkpoint does not fit the current motors.
+       */
+      virtual bool restoreState(Checkpoint *checkpoint) = 0;
   
       /**
        * \returns the actual position of the motor with the given Id.
@@ -37,6 +37,7 @@
 #include "../sensor_bases.h"
 
 #include "PhysicsInterface.h"
+#include "Checkpoint.h"
 
 namespace mars {
   namespace interfaces {
@@ -76,11 +77,15 @@ namespace mars {
       virtual void setContactParams(contact_params &c_params) = 0;
       virtual void addSensor(BaseSensor *s_cfg) = 0;
       virtual void removeSensor(BaseSensor *s_cfg) = 0;
-      virtual void handleSensorData(bool physics_thread = true) = 0;
+      virtual void delaySensorUpdate(BaseSensor *sensor, sReal delay) = 0; ///< The sensor is updated next in the step that ends in \c delay ms.
       virtual void destroyNode(void) = 0;
       virtual void getMass(sReal *mass, sReal *inertia=0) const = 0;
       virtual const utils::Vector getContactForce(void) const = 0;
       virtual sReal getCollisionDepth(void) const = 0;
+      virtual bool isSleeping(void) const = 0; ///< Returns true if the body is auto disabled.
+      virtual void wakeUp(void) = 0; ///< Enables an auto disabled body again.
+      virtual void saveState(Checkpoint *checkpoint) const = 0; ///< Writes the body state.
+      virtual bool restoreState(Checkpoint *checkpoint) = 0; ///< Reads a state written by saveState.
     };
 
   } // end of namespace interfaces
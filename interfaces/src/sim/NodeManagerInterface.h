@@ -38,6 +38,7 @@
 #include "../sensor_bases.h"
 #include "../NodeData.h"
 #include "../nodeState.h"
+#include "Checkpoint.h"
 
 #include <mars/utils/Vector.h>
 #include <mars/utils/Quaternion.h>
@@ -548,6 +549,18 @@ namespace mars {
        */
       virtual void updateDynamicNodes(sReal calc_ms, bool physics_thread=true) = 0;
 
+      /**
+       * \brief Writes the state of all dynamic nodes into \c checkpoint.
+       */
+      virtual void saveState(Checkpoint *checkpoint) const = 0;
+
+      /**
+       * \brief Restores the state written by saveState without recreating
+       * the nodes.
+       * \return \c false if the checkpoint does not fit the current scene.
+       */
+      virtual bool restoreState(Checkpoint *checkpoint) = 0;
+
       /**
        * \brief This function destroys all nodes within the simulation.
        *
@@ -41,6 +41,8 @@ namespace mars {
   namespace interfaces {
 
     class NodeInterface;
+    class JointInterface;
+    struct JointFeedback;
 
     enum PhysicsError {
       PHYSICS_NO_ERROR = 0,
@@ -54,10 +56,40 @@ namespace mars {
     public:
       sReal ground_friction, ground_cfm, ground_erp;
       sReal step_size; /**< Step size in seconds */
+      /**
+       * Number of equal physics steps stepTheWorld() divides step_size
+       * into. Forces added before the call act on all substeps.
+       */
+      int substeps;
+      /**
+       * If \c true stepTheWorld() keeps the state of the bodies before
+       * the step. The error handler can then set redo_step: stepTheWorld()
+       * restores that state and returns, and the caller steps again, e.g.
+       * with more substeps.
+       */
+      bool keep_step_state;
+      bool redo_step;
+      sReal max_contact_depth; /**< Deepest contact of the last call of stepTheWorld() */
       utils::Vector world_gravity;
       bool fast_step;
       bool draw_contact_points;
       sReal world_cfm, world_erp;
+      /**
+       * Auto disabling of resting bodies (sleeping). A body is disabled if
+       * its linear and angular velocity stay below the thresholds for
+       * auto_disable_steps steps and auto_disable_time seconds. Nodes can
+       * override these values, see NodePhysics.
+       */
+      bool auto_disable;
+      sReal auto_disable_linear_threshold, auto_disable_angular_threshold;
+      int auto_disable_steps;
+      sReal auto_disable_time;
+      /**
+       * Number of threads that cast the rays of the sensors after a step,
+       * while the simulation continues with joints, motors and
+       * controllers. With 0 the rays are cast in stepTheWorld().
+       */
+      int sensor_threads;
 
       virtual ~PhysicsInterface() {}
       virtual void initTheWorld(void) = 0;
@@ -67,6 +99,42 @@ namespace mars {
       virtual const utils::Vector getCenterOfMass(const std::vector<NodeInterface*> &nodes) const = 0;
       virtual int checkCollisions(void) = 0;
       virtual sReal getVectorCollision(const utils::Vector &pos, const utils::Vector &ray) const = 0;
+      /**
+       * \brief Casts \c count rays like getVectorCollision() while the world
+       * is locked once.
+       *
+       * Start points and rays are given as x, y and z arrays. \c depth
+       * receives the distance to the first hit or the length of the ray.
+       */
+      virtual void getVectorCollisions(size_t count, const sReal *const pos[3],
+                                       const sReal *const ray[3], sReal *depth) = 0;
+      /**
+       * \brief Gives the world its own stream of the random numbers the
+       * engine uses internally, e.g. for the constraint order of the fast
+       * step. Without a seed the engine default is used.
+       */
+      virtual void setRandomSeed(unsigned long seed) = 0;
+      /**
+       * \brief The seed the next step starts with. Passing it to
+       * setRandomSeed() later continues the same sequence, e.g. when a
+       * checkpoint is restored.
+       */
+      virtual unsigned long getRandomSeed(void) const = 0;
+      /**
+       * \brief Fills the feedback of all given joints after a step while
+       * the world is locked once.
+       *
+       * \c feedback holds one record per joint; only the quantities set
+       * in the flags of a record are computed.
+       */
+      virtual void getJointFeedback(const std::vector<JointInterface*> &joints,
+                                    const std::vector<JointFeedback*> &feedback) = 0;
+
+      /**
+       * \brief Blocks until the sensors hold the values of the state after
+       * the last call of stepTheWorld().
+       */
+      virtual void waitForSensors(void) = 0;
     };
 
   } // end of namespace interfaces
@@ -33,6 +33,7 @@
 #endif
 
 #include <mars/interfaces/MARSDefs.h> // for sReal
+#include "Checkpoint.h"
 
 #include <string>
 
@@ -54,6 +55,12 @@ namespace mars {
       virtual void init(void) = 0;
       virtual void handleError(void) {};
       virtual void getSomeData(void* data) {(void)data;};
+      /** Plugins with internal state write it here for an in-memory
+       *  checkpoint, see SimulatorInterface::saveCheckpoint. */
+      virtual void saveState(Checkpoint *checkpoint) {(void)checkpoint;};
+      /** Restores the state written by saveState, returns false if the
+       *  state does not fit. */
+      virtual bool restoreState(Checkpoint *checkpoint) {(void)checkpoint; return true;};
 
     protected:
       ControlCenter *control;
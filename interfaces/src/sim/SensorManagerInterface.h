@@ -48,6 +48,27 @@ namespace mars {
     class ControlCenter;
     struct cameraStruct;
 
+    /**
+     * \brief Update period, phase and measured cost of a sensor.
+     *
+     * The cost is the wall clock time in microseconds of one update of a
+     * sensor: its DataBroker callbacks and the work done for it elsewhere,
+     * like casting its rays or rendering its image. The jitter is the largest
+     * difference between the time of two updates and the update period in
+     * milliseconds of simulation time.
+     */
+    struct SensorStatistics {
+      SensorStatistics() : updatePeriod(0), phase(0), updates(0),
+                           avgCost(0.0), maxCost(0.0), costDeviation(0.0),
+                           jitter(0) {}
+      int updatePeriod;
+      /** \brief The offset of the updates within the update period. */
+      long phase;
+      unsigned long updates;
+      double avgCost, maxCost, costDeviation;
+      long jitter;
+    };
+
     /**
      * \brief "SensorManagerInterface" declares the interfaces for all sensor 
      * operations that are used for the communication between the simulation modules.
@@ -181,6 +202,27 @@ namespace mars {
        */
       virtual void reloadSensors(void) = 0;
 
+      /**
+       * \brief Returns the update period, phase and measured cost of a
+       * sensor.
+       *
+       * \returns \c false if the sensor doesn't exist or is not updated by
+       * the simulation timer.
+       */
+      virtual bool getSensorStatistics(unsigned long id,
+                                       SensorStatistics *statistics) const = 0;
+
+      /**
+       * \brief Adds the wall clock time in microseconds of work done for
+       * one update of a sensor outside of its DataBroker callbacks.
+       *
+       * The physics reports the time of casting the rays of a sensor, a
+       * camera the time it adds to the frame it is rendered in. The time
+       * counts to the cost the sensors are scheduled by. Can be called
+       * from any thread.
+       */
+      virtual void addSensorCost(unsigned long id, double cost) = 0;
+
       /**
        * Adds an sensor to the known sensors list
        */
@@ -67,6 +67,16 @@ namespace mars {
       virtual void readArguments(int argc, char **argv) = 0;
       virtual ControlCenter* getControlCenter(void) const = 0;      
 
+      /**
+       * \brief Writes the body, motor and plugin state into \c checkpoint.
+       *
+       * Unlike resetSim no objects are destroyed; restoreCheckpoint sets the
+       * state of the existing objects, which makes it suitable for fast
+       * repeated resets. The scene must not change in between.
+       */
+      virtual void saveCheckpoint(Checkpoint *checkpoint) = 0;
+      virtual bool restoreCheckpoint(Checkpoint *checkpoint) = 0;
+
       // simulation contents
       virtual void addLight(LightData light) = 0;
       virtual void connectNodes(unsigned long id1, unsigned long id2) = 0;
@@ -123,6 +133,24 @@ namespace mars {
 
       virtual double getCalcMs() = 0;
 
+      /**
+       * \brief In the deterministic mode ("Simulator/deterministic") two runs
+       * of the same scene produce the same states step by step: the
+       * simulation does not sleep or read the wall clock, plugins are
+       * updated in the order they were added and all random streams are
+       * seeded from "Simulator/random seed". After each step the hash of
+       * the physical state is computed, see getStateHash(), unless
+       * "Simulator/hash every step" is off.
+       */
+      virtual bool isDeterministic() const = 0;
+      /**
+       * \brief The seed of the random stream \c stream. Every subsystem
+       * should draw from its own stream, e.g. a utils::RandomStream.
+       */
+      virtual unsigned long long getRandomSeed(const std::string &stream) const = 0;
+      /// the state hash of the last step, 0 if not in deterministic mode
+      virtual unsigned long long getStateHash() const = 0;
+
     };
 
 
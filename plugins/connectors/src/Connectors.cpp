@@ -77,6 +77,8 @@ namespace mars {
         jointdata.name = "connector_"+male+"_"+female;
         unsigned long jointid = control->joints->addJoint(&jointdata);
         if (jointid > 0) {
+          // the breakable connections check the joint load
+          control->joints->requestFeedback(jointid, interfaces::JOINT_FEEDBACK_LOAD);
           // TODO: maybe update NodeData here and set collision group differently to avoid collision problems
           maleconnectors[male]["jointid"] = jointid;
           maleconnectors[male]["partner"] = female;
@@ -0,0 +1,334 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file DataBrokerRecorder.cpp
+ * \brief Records DataBroker streams at simulation rate into a binary log.
+ */
+
+
+#include "DataBrokerRecorder.h"
+#include <mars/data_broker/DataBrokerInterface.h>
+#include <mars/data_broker/DataPackage.h>
+#include <mars/interfaces/sim/SimulatorInterface.h>
+#include <mars/interfaces/Logging.hpp>
+#include <mars/utils/MutexLocker.h>
+#include <mars/utils/misc.h>
+
+namespace mars {
+  namespace plugins {
+    namespace data_broker_recorder {
+
+      using namespace mars::utils;
+      using namespace mars::interfaces;
+
+      DataBrokerRecorder::DataBrokerRecorder(lib_manager::LibManager *theManager)
+        : MarsPluginTemplate(theManager, "DataBrokerRecorder"),
+          recording(false), stopWriter(false), ring(0), droppedSamples(0),
+          rowsPerChunk(1024) {
+      }
+
+      void DataBrokerRecorder::init() {
+        cfgRecord = control->cfg->getOrCreateProperty("DataBrokerRecorder",
+                                                      "record", false, this);
+        cfgFile = control->cfg->getOrCreateProperty("DataBrokerRecorder", "file",
+                                                    std::string("databroker.mlog"),
+                                                    this);
+        cfgStreams = control->cfg->getOrCreateProperty("DataBrokerRecorder",
+                                                       "streams",
+                                                       std::string("mars_sim:Joints*;mars_sim:Nodes*"),
+                                                       this);
+        cfgUpdatePeriod = control->cfg->getOrCreateProperty("DataBrokerRecorder",
+                                                            "update period",
+                                                            1, this);
+        cfgRowsPerChunk = control->cfg->getOrCreateProperty("DataBrokerRecorder",
+                                                            "rows per chunk",
+                                                            1024, this);
+        cfgRingSize = control->cfg->getOrCreateProperty("DataBrokerRecorder",
+                                                        "ring size",
+                                                        4*1024*1024, this);
+        if(cfgRecord.bValue) {
+          cfgRecord.bValue = startRecording();
+        }
+      }
+
+      void DataBrokerRecorder::reset() {
+      }
+
+      DataBrokerRecorder::~DataBrokerRecorder() {
+        stopRecording();
+        if(control && control->cfg) {
+          control->cfg->unregisterFromCFG(this);
+        }
+      }
+
+      void DataBrokerRecorder::update(sReal time_ms) {
+        CPP_UNUSED(time_ms);
+      }
+
+      bool DataBrokerRecorder::startRecording() {
+        if(recording) return true;
+        rowsPerChunk = cfgRowsPerChunk.iValue > 0 ? cfgRowsPerChunk.iValue : 1024;
+        if(!writer.open(cfgFile.sValue, rowsPerChunk)) {
+          LOG_ERROR("DataBrokerRecorder: could not open \"%s\"",
+                    cfgFile.sValue.c_str());
+          return false;
+        }
+        ring = new SampleRing(cfgRingSize.iValue);
+        streamIds.clear();
+        streams.clear();
+        builders.clear();
+        droppedSamples = 0;
+        stopWriter = false;
+        recording = true;
+        this->start();
+
+        // a name without wildcards is registered as it is. A pattern only
+        // matches streams that are created after the registration, thus
+        // the existing streams are registered by name in addition.
+        std::vector<std::string> patterns = explodeString(';', cfgStreams.sValue);
+        std::vector<data_broker::DataInfo> infos = control->dataBroker->getDataList();
+        // the timer counts in ms, the period is given in steps
+        int period = 0;
+        if(cfgUpdatePeriod.iValue > 1) {
+          period = (int)(cfgUpdatePeriod.iValue*control->sim->getCalcMs() + 0.5);
+        }
+        for(size_t i=0; i<patterns.size(); ++i) {
+          std::string groupPattern = trim(patterns[i]);
+          std::string dataPattern = "*";
+          size_t p = groupPattern.find(':');
+          if(p != std::string::npos) {
+            dataPattern = groupPattern.substr(p+1);
+            groupPattern = groupPattern.substr(0, p);
+          }
+          if(groupPattern.empty()) continue;
+          bool wildcards = (groupPattern.find('*') != std::string::npos ||
+                            dataPattern.find('*') != std::string::npos);
+          for(size_t k=0; wildcards && k<infos.size(); ++k) {
+            if(matchPattern(groupPattern, infos[k].groupName) &&
+               matchPattern(dataPattern, infos[k].dataName)) {
+              control->dataBroker->registerTimedReceiver(this, infos[k].groupName,
+                                                         infos[k].dataName,
+                                                         "mars_sim/simTimer",
+                                                         period);
+            }
+          }
+          control->dataBroker->registerTimedReceiver(this, groupPattern,
+                                                     dataPattern,
+                                                     "mars_sim/simTimer",
+                                                     period);
+        }
+        return true;
+      }
+
+      void DataBrokerRecorder::stopRecording() {
+        if(!recording) return;
+        // returns after a running callback has finished
+        control->dataBroker->unregisterTimedReceiver(this, "*", "*",
+                                                     "mars_sim/simTimer");
+        recording = false;
+        wakeMutex.lock();
+        stopWriter = true;
+        samplesPushed.wakeAll();
+        wakeMutex.unlock();
+        this->wait();
+        writer.close();
+        delete ring;
+        ring = 0;
+        if(droppedSamples) {
+          LOG_WARN("DataBrokerRecorder: dropped %lu samples, increase the ring size",
+                   droppedSamples);
+        }
+      }
+
+      uint32_t DataBrokerRecorder::addStream(const data_broker::DataInfo &info,
+                                             const data_broker::DataPackage &package) {
+        recordedStream stream;
+        stream.groupName = info.groupName;
+        stream.dataName = info.dataName;
+        for(size_t i=0; i<package.size(); ++i) {
+          data_broker::DataType type = package[i].type;
+          if(type == data_broker::STRING_TYPE ||
+             type == data_broker::UNDEFINED_TYPE) {
+            continue;
+          }
+          stream.columns.push_back(package[i].getName());
+          stream.items.push_back(i);
+        }
+        MutexLocker locker(&streamMutex);
+        uint32_t id = streams.size();
+        streams.push_back(stream);
+        streamIds[info.dataId] = id;
+        return id;
+      }
+
+      void DataBrokerRecorder::receiveData(const data_broker::DataInfo& info,
+                                           const data_broker::DataPackage& package,
+                                           int id) {
+        CPP_UNUSED(id);
+        if(!recording) return;
+        std::map<unsigned long, uint32_t>::iterator it = streamIds.find(info.dataId);
+        uint32_t streamId;
+        if(it == streamIds.end()) streamId = addStream(info, package);
+        else streamId = it->second;
+
+        const std::vector<long> &items = streams[streamId].items;
+        sampleValues.resize(items.size());
+        for(size_t i=0; i<items.size(); ++i) {
+          const data_broker::DataItem &item = package[items[i]];
+          double v = 0.0;
+          switch(item.type) {
+          case data_broker::INT_TYPE: v = item.i; break;
+          case data_broker::UINT_TYPE: v = item.ui; break;
+          case data_broker::LONG_TYPE: v = item.l; break;
+          case data_broker::ULONG_TYPE: v = item.ul; break;
+          case data_broker::FLOAT_TYPE: v = item.f; break;
+          case data_broker::DOUBLE_TYPE: v = item.d; break;
+          case data_broker::BOOL_TYPE: v = item.b ? 1.0 : 0.0; break;
+          default: break;
+          }
+          sampleValues[i] = v;
+        }
+        double time = control->sim->getTime();
+        bool wasEmpty = false;
+        if(!ring->push(streamId, time, sampleValues.empty() ? 0 : &sampleValues[0],
+                       sampleValues.size(), &wasEmpty)) {
+          ++droppedSamples;
+        }
+        else if(wasEmpty) {
+          // the writer may be waiting only if it has emptied the ring
+          wakeMutex.lock();
+          samplesPushed.wakeOne();
+          wakeMutex.unlock();
+        }
+      }
+
+      void DataBrokerRecorder::syncStreams() {
+        // the new streams are copied, the receivers must not wait for the
+        // disk
+        std::vector<recordedStream> added;
+        streamMutex.lock();
+        if(streams.size() > builders.size()) {
+          added.assign(streams.begin()+builders.size(), streams.end());
+        }
+        streamMutex.unlock();
+        for(size_t k=0; k<added.size(); ++k) {
+          const recordedStream &stream = added[k];
+          writer.writeStream(builders.size(), stream.groupName, stream.dataName,
+                             stream.columns);
+          chunkBuilder builder;
+          builder.numColumns = stream.columns.size();
+          builder.numRows = 0;
+          builder.firstRow = 0;
+          builder.columns.resize((size_t)(builder.numColumns+1)*rowsPerChunk);
+          builders.push_back(builder);
+        }
+      }
+
+      void DataBrokerRecorder::flushChunk(uint32_t streamId) {
+        chunkBuilder &builder = builders[streamId];
+        if(builder.numRows == 0) return;
+        data_broker::logChunkHeader header;
+        header.streamId = streamId;
+        header.numRows = builder.numRows;
+        header.firstRow = builder.firstRow;
+        header.firstTime = builder.columns[0];
+        header.lastTime = builder.columns[builder.numRows-1];
+        writer.writeChunk(header, &builder.columns[0], builder.numColumns,
+                          rowsPerChunk);
+        builder.firstRow += builder.numRows;
+        builder.numRows = 0;
+      }
+
+      bool DataBrokerRecorder::drainRing() {
+        uint32_t streamId;
+        double time;
+        bool got = false;
+        while(ring->pop(&streamId, &time, &popValues)) {
+          got = true;
+          if(streamId >= builders.size()) syncStreams();
+          if(streamId >= builders.size()) continue;
+          chunkBuilder &builder = builders[streamId];
+          // the columns of a chunk are stored one after another
+          double *row = &builder.columns[builder.numRows];
+          row[0] = time;
+          size_t n = popValues.size();
+          if(n > builder.numColumns) n = builder.numColumns;
+          for(size_t c=0; c<n; ++c) {
+            row[(c+1)*rowsPerChunk] = popValues[c];
+          }
+          if(++builder.numRows == rowsPerChunk) flushChunk(streamId);
+        }
+        return got;
+      }
+
+      void DataBrokerRecorder::run() {
+        wakeMutex.lock();
+        while(!stopWriter) {
+          wakeMutex.unlock();
+          drainRing();
+          wakeMutex.lock();
+          // a sample pushed into the empty ring signals under wakeMutex,
+          // thus it either is seen here or wakes the wait
+          if(!stopWriter && ring->empty()) {
+            samplesPushed.wait(&wakeMutex);
+          }
+        }
+        wakeMutex.unlock();
+        drainRing();
+        for(size_t i=0; i<builders.size(); ++i) {
+          flushChunk(i);
+        }
+      }
+
+      void DataBrokerRecorder::cfgUpdateProperty(cfg_manager::cfgPropertyStruct _property) {
+
+        if(_property.paramId == cfgRecord.paramId) {
+          if(_property.bValue) {
+            cfgRecord.bValue = startRecording();
+          }
+          else {
+            stopRecording();
+            cfgRecord.bValue = false;
+          }
+        }
+        else if(_property.paramId == cfgFile.paramId) {
+          cfgFile.sValue = _property.sValue;
+        }
+        else if(_property.paramId == cfgStreams.paramId) {
+          cfgStreams.sValue = _property.sValue;
+        }
+        else if(_property.paramId == cfgUpdatePeriod.paramId) {
+          cfgUpdatePeriod.iValue = _property.iValue;
+        }
+        else if(_property.paramId == cfgRowsPerChunk.paramId) {
+          cfgRowsPerChunk.iValue = _property.iValue;
+        }
+        else if(_property.paramId == cfgRingSize.paramId) {
+          cfgRingSize.iValue = _property.iValue;
+        }
+      }
+
+    } // end of namespace data_broker_recorder
+  } // end of namespace plugins
+} // end of namespace mars
+
+DESTROY_LIB(mars::plugins::data_broker_recorder::DataBrokerRecorder);
+CREATE_LIB(mars::plugins::data_broker_recorder::DataBrokerRecorder);
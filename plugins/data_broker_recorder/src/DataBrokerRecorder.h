@@ -0,0 +1,156 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file DataBrokerRecorder.h
+ * \brief Records DataBroker streams at simulation rate into a binary log.
+ *
+ * Configuration (cfg group "DataBrokerRecorder"):
+ *   - record: starts and stops the recording
+ *   - file: the log file, overwritten on each start
+ *   - streams: ';' separated list of "groupPattern:dataPattern" entries,
+ *     e.g. "mars_sim:Joints*;mars_sim:Nodes*"
+ *   - update period: simulation steps between two samples, converted
+ *     with the step size when the recording starts
+ *   - rows per chunk: samples per stream that are written as one chunk
+ *   - ring size: number of values buffered between the simulation and
+ *     the writer thread; samples are dropped if the ring is full
+ *
+ * The log files can be read with the data_broker::LogReader.
+ */
+
+#ifndef MARS_PLUGINS_DATA_BROKER_RECORDER_H
+#define MARS_PLUGINS_DATA_BROKER_RECORDER_H
+
+#ifdef _PRINT_HEADER_
+  #warning "DataBrokerRecorder.h"
+#endif
+
+#include <mars/interfaces/sim/MarsPluginTemplate.h>
+#include <mars/interfaces/MARSDefs.h>
+#include <mars/data_broker/ReceiverInterface.h>
+#include <mars/cfg_manager/CFGManagerInterface.h>
+#include <mars/utils/Thread.h>
+#include <mars/utils/Mutex.h>
+#include <mars/utils/WaitCondition.h>
+#include <mars/data_broker/LogWriter.h>
+
+#include "SampleRing.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace mars {
+
+  namespace plugins {
+    namespace data_broker_recorder {
+
+      class DataBrokerRecorder: public mars::interfaces::MarsPluginTemplate,
+        public mars::data_broker::ReceiverInterface,
+        public mars::cfg_manager::CFGClient,
+        public mars::utils::Thread {
+
+      public:
+        DataBrokerRecorder(lib_manager::LibManager *theManager);
+        ~DataBrokerRecorder();
+
+        // LibInterface methods
+        int getLibVersion() const
+        { return 1; }
+        const std::string getLibName() const
+        { return std::string("data_broker_recorder"); }
+        CREATE_MODULE_INFO();
+
+        // MarsPlugin methods
+        void init();
+        void reset();
+        void update(mars::interfaces::sReal time_ms);
+
+        // DataBrokerReceiver methods
+        virtual void receiveData(const data_broker::DataInfo &info,
+                                 const data_broker::DataPackage &package,
+                                 int callbackParam);
+        // CFGClient methods
+        virtual void cfgUpdateProperty(cfg_manager::cfgPropertyStruct _property);
+
+        // DataBrokerRecorder methods
+        bool startRecording();
+        void stopRecording();
+
+      protected:
+        // writer thread
+        void run();
+
+      private:
+        /// a stream as seen by the simulation thread
+        struct recordedStream {
+          std::string groupName, dataName;
+          std::vector<std::string> columns;
+          std::vector<long> items; ///< package indices of the columns
+        };
+
+        /// collects the rows of one stream until a chunk is full
+        struct chunkBuilder {
+          uint32_t numColumns;
+          uint32_t numRows;
+          uint64_t firstRow;
+          std::vector<double> columns; ///< time column + value columns
+        };
+
+        uint32_t addStream(const data_broker::DataInfo &info,
+                           const data_broker::DataPackage &package);
+        void syncStreams();
+        void flushChunk(uint32_t streamId);
+        bool drainRing();
+
+        cfg_manager::cfgPropertyStruct cfgRecord, cfgFile, cfgStreams;
+        cfg_manager::cfgPropertyStruct cfgUpdatePeriod, cfgRowsPerChunk;
+        cfg_manager::cfgPropertyStruct cfgRingSize;
+
+        bool recording;
+        bool stopWriter;
+        // wakes the writer thread when the ring is no longer empty or it
+        // has to stop
+        utils::Mutex wakeMutex;
+        utils::WaitCondition samplesPushed;
+        SampleRing *ring;
+        data_broker::LogWriter writer;
+        unsigned long droppedSamples;
+
+        // only used by the simulation thread
+        std::map<unsigned long, uint32_t> streamIds;
+        std::vector<double> sampleValues;
+        // streams are added by the simulation thread and written to the
+        // log by the writer thread
+        std::vector<recordedStream> streams;
+        utils::Mutex streamMutex;
+        // only used by the writer thread
+        std::vector<chunkBuilder> builders;
+        std::vector<double> popValues;
+        uint32_t rowsPerChunk;
+
+      }; // end of class definition DataBrokerRecorder
+
+    } // end of namespace data_broker_recorder
+  } // end of namespace plugins
+} // end of namespace mars
+
+#endif // MARS_PLUGINS_DATA_BROKER_RECORDER_H
@@ -0,0 +1,159 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file SampleRing.h
+ * \brief Lock-free single producer / single consumer ring of samples.
+ */
+
+#ifndef MARS_PLUGINS_DATA_BROKER_RECORDER_SAMPLE_RING_H
+#define MARS_PLUGINS_DATA_BROKER_RECORDER_SAMPLE_RING_H
+
+#ifdef _PRINT_HEADER_
+  #warning "SampleRing.h"
+#endif
+
+#include <atomic>
+#include <cstring>
+#include <vector>
+#include <stdint.h>
+
+namespace mars {
+  namespace plugins {
+    namespace data_broker_recorder {
+
+      /**
+       * \brief Passes variable sized samples from the simulation thread to
+       * the writer thread.
+       *
+       * A sample occupies two words (stream id and number of values, time)
+       * followed by its values. Samples are never split at the end of
+       * the ring; the rest of the ring is skipped instead. If the ring is
+       * full the sample is dropped, the producer never waits.
+       */
+      class SampleRing {
+      public:
+        /// \param size number of values, rounded up to a power of two
+        explicit SampleRing(size_t size) : head(0), tail(0) {
+          size_t s = 1024;
+          while(s < size) s <<= 1;
+          buffer.resize(s);
+          mask = s - 1;
+        }
+
+        /**
+         * \brief producer: returns \c false if the sample did not fit.
+         *
+         * \c wasEmpty is set if the consumer had taken all samples
+         * before this one was added. The head and tail are stored and
+         * read sequentially consistent, so a consumer that finds the ring
+         * empty after its last pop is either seen here or sees the sample.
+         */
+        bool push(uint32_t streamId, double time,
+                  const double *values, uint32_t numValues,
+                  bool *wasEmpty = 0) {
+          const size_t need = numValues + 2;
+          const size_t h = head.load(std::memory_order_relaxed);
+          const size_t t = tail.load(std::memory_order_acquire);
+          size_t pos = h & mask;
+          size_t skip = 0;
+          if(pos + need > buffer.size()) {
+            skip = buffer.size() - pos;
+          }
+          if(need > buffer.size() || h - t + skip + need > buffer.size()) {
+            return false;
+          }
+          if(skip) {
+            // marks the rest of the ring as unused
+            buffer[pos] = encodeHeader(wrapMarker, 0);
+            pos = 0;
+          }
+          buffer[pos] = encodeHeader(streamId, numValues);
+          memcpy(&buffer[pos+1], &time, sizeof(double));
+          if(numValues) {
+            memcpy(&buffer[pos+2], values, numValues*sizeof(double));
+          }
+          head.store(h + skip + need);
+          if(wasEmpty) *wasEmpty = (tail.load() == h);
+          return true;
+        }
+
+        /**
+         * \brief consumer: takes the next sample out of the ring.
+         * \return \c false if the ring is empty
+         */
+        bool pop(uint32_t *streamId, double *time,
+                 std::vector<double> *values) {
+          size_t t = tail.load(std::memory_order_relaxed);
+          const size_t h = head.load(std::memory_order_acquire);
+          if(t == h) return false;
+          size_t pos = t & mask;
+          uint32_t numValues;
+          decodeHeader(buffer[pos], streamId, &numValues);
+          if(*streamId == wrapMarker) {
+            t += buffer.size() - pos;
+            if(t == h) {
+              tail.store(t);
+              return false;
+            }
+            pos = 0;
+            decodeHeader(buffer[pos], streamId, &numValues);
+          }
+          memcpy(time, &buffer[pos+1], sizeof(double));
+          values->resize(numValues);
+          if(numValues) {
+            memcpy(&(*values)[0], &buffer[pos+2], numValues*sizeof(double));
+          }
+          tail.store(t + numValues + 2);
+          return true;
+        }
+
+        bool empty() const {
+          return head.load() == tail.load();
+        }
+
+      private:
+        static const uint32_t wrapMarker = 0xffffffff;
+
+        static uint64_t encodeHeader(uint32_t streamId, uint32_t numValues) {
+          return ((uint64_t)streamId << 32) | numValues;
+        }
+
+        static void decodeHeader(uint64_t header, uint32_t *streamId,
+                                 uint32_t *numValues) {
+          *streamId = (uint32_t)(header >> 32);
+          *numValues = (uint32_t)(header & 0xffffffff);
+        }
+
+        // disallow copying
+        SampleRing(const SampleRing &);
+        SampleRing &operator=(const SampleRing &);
+
+        std::vector<uint64_t> buffer; // one word per double
+        size_t mask;
+        // head is only written by the producer, tail only by the consumer
+        std::atomic<size_t> head, tail;
+      }; // end of class SampleRing
+
+    } // end of namespace data_broker_recorder
+  } // end of namespace plugins
+} // end of namespace mars
+
+#endif // MARS_PLUGINS_DATA_BROKER_RECORDER_SAMPLE_RING_H
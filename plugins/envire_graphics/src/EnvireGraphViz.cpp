@@ -60,6 +60,25 @@ void EnvireGraphViz::init()
   GraphItemEventDispatcher<envire::core::Item<smurf::Frame>>::subscribe(control->graph.get());
   GraphItemEventDispatcher<envire::core::Item<smurf::Collidable>>::subscribe(control->graph.get());
   GraphItemEventDispatcher<envire::core::Item<::smurf::Joint>>::subscribe(control->graph.get());
+
+  if(control->cfg)
+  {
+    cfgInterpolate = control->cfg->getOrCreateProperty("Simulator", "interpolate graphics",
+                                                       true, this);
+    drawState.setInterpolation(cfgInterpolate.bValue);
+  }
+  if(control->graphics)
+  {
+    control->graphics->addGraphicsUpdateInterface(this);
+  }
+}
+
+EnvireGraphViz::~EnvireGraphViz()
+{
+  if(control->graphics)
+  {
+    control->graphics->removeGraphicsUpdateInterface(this);
+  }
 }
 
 void EnvireGraphViz::reset() {
@@ -75,6 +94,17 @@ void EnvireGraphViz::frameAdded(const FrameAddedEvent& e)
 }
 
 
+void EnvireGraphViz::edgeAdded(const EdgeAddedEvent& e)
+{
+  //the tree view updates itself, the cached bfs order has to follow
+  drawListDirty = true;
+}
+
+void EnvireGraphViz::edgeRemoved(const EdgeRemovedEvent& e)
+{
+  drawListDirty = true;
+}
+
 void EnvireGraphViz::setPos(const envire::core::FrameId& frame, mars::interfaces::NodeData& node)
 {
     Transform fromOrigin;
@@ -352,7 +382,21 @@ void EnvireGraphViz::update(sReal time_ms) {
   }
 }
 
+void EnvireGraphViz::preGraphicsUpdate()
+{
+  //render thread: only the published poses are used, the envire graph is
+  //never touched here
+  drawTransforms.clear();
+  if(drawState.collect(&drawTransforms))
+  {
+    control->graphics->setDrawObjectTransforms(drawTransforms);
+  }
+}
+
 void EnvireGraphViz::cfgUpdateProperty(cfg_manager::cfgPropertyStruct _property) {
+  if(_property.paramId == cfgInterpolate.paramId) {
+    drawState.setInterpolation(_property.bValue);
+  }
 }
 
 void EnvireGraphViz::changeOrigin(const FrameId& origin)
@@ -367,46 +411,94 @@ void EnvireGraphViz::updateTree(const FrameId& origin)
   assert(newOrigin != control->graph->null_vertex());
   tree.clear();
   control->graph->getTree(newOrigin, true, &tree);
+  drawListDirty = true;
 }
 
-void EnvireGraphViz::updateVisuals()
+void EnvireGraphViz::rebuildDrawList()
 {
+  drawList.clear();
+  drawIds.clear();
+  drawListDirty = false;
+  drawListItemCount = uuidToGraphicsId.size();
+
   if (tree.hasRoot() == false)
     return;
 
-  tree.visitBfs(tree.root, [&](GraphTraits::vertex_descriptor vd, 
+  //only used while building, parents are always visited before children
+  std::unordered_map<vertex_descriptor, int> vertexIndex;
+  tree.visitBfs(tree.root, [&](GraphTraits::vertex_descriptor vd,
                                GraphTraits::vertex_descriptor parent)
   {
-    updatePosition<Item<envire::smurf::Visual>>(vd);
-    updatePosition<Item<smurf::Frame>>(vd);
+    DrawVertex entry;
+    entry.vertex = vd;
+    entry.parent = parent;
+    entry.parentIndex = -1;
+    if(vd != tree.root)
+    {
+      auto it = vertexIndex.find(parent);
+      assert(it != vertexIndex.end());
+      entry.parentIndex = it->second;
+    }
+    entry.firstDrawId = drawIds.size();
+    collectDrawIds<Item<envire::smurf::Visual>>(vd);
+    collectDrawIds<Item<smurf::Frame>>(vd);
+    entry.numDrawIds = drawIds.size() - entry.firstDrawId;
+    vertexIndex[vd] = drawList.size();
+    drawList.push_back(entry);
   });
 }
 
-
-/**Updates the drawing position of @p vertex */              
-template <class physicsType> void EnvireGraphViz::updatePosition(const vertex_descriptor vertex)
+void EnvireGraphViz::updateVisuals()
 {
-  const FrameId& frameId = control->graph->getFrameId(vertex);
-  base::Vector3d translation;
-  base::Quaterniond orientation;
-   
-  if(originId.compare(frameId) == 0)
+  if(drawListDirty || drawListItemCount != uuidToGraphicsId.size())
   {
-    translation << 0, 0, 0;
-    orientation.setIdentity();
+    rebuildDrawList();
   }
-  else
+
+  //drawList is in bfs order, thus every parent pose is already up to date
+  //when its children are processed. Each vertex only needs the transform
+  //of the single edge to its parent.
+  //The snapshot always holds all poses, the render thread filters the
+  //unchanged ones.
+  std::vector<drawObjectTransform>& snapshot = drawState.beginWrite();
+  drawObjectTransform t;
+  for(size_t i = 0; i < drawList.size(); ++i)
   {
-    if(pathsFromOrigin.find(vertex) == pathsFromOrigin.end())
+    DrawVertex& entry = drawList[i];
+    base::Vector3d translation;
+    base::Quaterniond orientation;
+
+    if(entry.parentIndex < 0)
     {
-      //this is an unknown vertex, find the path and store it
-      pathsFromOrigin[vertex] = control->graph->getPath(originId, frameId, true);
+      translation << 0, 0, 0;
+      orientation.setIdentity();
+    }
+    else
+    {
+      const DrawVertex& parent = drawList[entry.parentIndex];
+      const Transform tf = control->graph->getTransform(entry.parent, entry.vertex);
+      translation = parent.translation + parent.orientation * tf.transform.translation;
+      orientation = parent.orientation * tf.transform.orientation;
+    }
+
+    entry.translation = translation;
+    entry.orientation = orientation;
+
+    t.pos = translation;
+    t.rot = orientation;
+    for(size_t k = entry.firstDrawId; k < entry.firstDrawId + entry.numDrawIds; ++k)
+    {
+      t.id = drawIds[k];
+      snapshot.push_back(t);
     }
-    const Transform tf = control->graph->getTransform(pathsFromOrigin[vertex]);
-    translation = tf.transform.translation;
-    orientation = tf.transform.orientation;
   }
-  
+  drawState.publish();
+}
+
+
+/**Appends the graphics ids of all items of type @p physicsType in @p vertex */
+template <class physicsType> void EnvireGraphViz::collectDrawIds(const vertex_descriptor vertex)
+{
   using Iterator = EnvireGraph::ItemIterator<physicsType>;
   Iterator begin, end;
   boost::tie(begin, end) = control->graph->getItems<physicsType>(vertex);
@@ -414,11 +506,10 @@ template <class physicsType> void EnvireGraphViz::updatePosition(const vertex_de
   {
     const physicsType& item = *begin;
     //others might use the same types as well, therefore check if if this is one of ours
-    if(uuidToGraphicsId.find(item.getID()) != uuidToGraphicsId.end())
+    auto it = uuidToGraphicsId.find(item.getID());
+    if(it != uuidToGraphicsId.end())
     {
-      const int graphicsId = uuidToGraphicsId.at(item.getID());
-      control->graphics->setDrawObjectPos(graphicsId, translation);
-      control->graphics->setDrawObjectRot(graphicsId, orientation);
+      drawIds.push_back(it->second);
     }
   }
 }
@@ -31,9 +31,12 @@
 #include <mars/interfaces/MARSDefs.h>
 #include <mars/cfg_manager/CFGManagerInterface.h>
 #include <mars/interfaces/NodeData.h>
+#include <mars/interfaces/graphics/GraphicsUpdateInterface.h>
+#include <mars/interfaces/graphics/DrawStateBuffer.h>
 #include <string>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 #include <boost/functional/hash.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <smurf/Robot.hpp>
@@ -59,6 +62,7 @@ namespace mars {
        * transform graph into NodeData and draw it.
        * */
       class EnvireGraphViz : public mars::interfaces::MarsPluginTemplate,
+                       public mars::interfaces::GraphicsUpdateInterface,
                        public envire::core::GraphEventDispatcher,
                        public envire::core::GraphItemEventDispatcher<envire::core::Item<envire::smurf::Visual>>,
                        public envire::core::GraphItemEventDispatcher<envire::core::Item<smurf::Frame>>,
@@ -68,6 +72,7 @@ namespace mars {
 
       public:
         EnvireGraphViz(lib_manager::LibManager *theManager);
+        ~EnvireGraphViz();
 
         // LibInterface methods
         int getLibVersion() const
@@ -88,6 +93,11 @@ namespace mars {
         virtual void itemAdded(const envire::core::TypedItemAddedEvent<envire::core::Item<smurf::Collidable>>& e);
         virtual void itemAdded(const envire::core::TypedItemAddedEvent<envire::core::Item<::smurf::Joint>>& e);
         virtual void frameAdded(const envire::core::FrameAddedEvent& e);
+        virtual void edgeAdded(const envire::core::EdgeAddedEvent& e);
+        virtual void edgeRemoved(const envire::core::EdgeRemovedEvent& e);
+
+        // GraphicsUpdateInterface methods
+        virtual void preGraphicsUpdate(void);
 
         // CFGClient methods
         virtual void cfgUpdateProperty(cfg_manager::cfgPropertyStruct _property);
@@ -130,23 +140,53 @@ namespace mars {
          */
         void updateTree(const envire::core::FrameId& origin);
         
-        //update position of all visuals
+        /**Calculates the poses of all visuals and publishes them to
+         * #drawState. Called from the physics thread. */
         void updateVisuals();
 
-        /**Updates the drawing position of @p vertex */              
-        template <class physicsType> void updatePosition(const envire::core::GraphTraits::vertex_descriptor vertex);
+        /**Rebuilds #drawList from the current tree. Has to be called whenever
+         * the tree structure or the set of drawn items changes. */
+        void rebuildDrawList();
+
+        /**Appends the graphics ids of all items of type @p physicsType
+         * in @p vertex to #drawIds */
+        template <class physicsType> void collectDrawIds(const envire::core::GraphTraits::vertex_descriptor vertex);
         void setPos(const envire::core::FrameId& frame, mars::interfaces::NodeData& node);
-	
+
+        /**A vertex of the tree in bfs order together with its cached
+         * absolute pose and the range of its graphics ids in #drawIds */
+        struct DrawVertex
+        {
+          envire::core::GraphTraits::vertex_descriptor vertex;
+          envire::core::GraphTraits::vertex_descriptor parent;
+          int parentIndex; /**< index into drawList, -1 for the root */
+          size_t firstDrawId;
+          size_t numDrawIds;
+          base::Vector3d translation;
+          base::Quaterniond orientation;
+        };
+
       private:
         /**Maps the item's uuid to the graphics id used for drawing */
         std::unordered_map<boost::uuids::uuid, int, boost::hash<boost::uuids::uuid>> uuidToGraphicsId;
         envire::core::FrameId originId; /**<id of the current origin */
         envire::core::TreeView tree; /**<tree containing all visualized vertices */
         
-        //buffers the paths from origin to the nodes to avoid tree searches.
-        //FIXME paths might become invalid if the graph changes.
-        std::unordered_map<envire::core::GraphTraits::vertex_descriptor,std::shared_ptr<envire::core::Path>> pathsFromOrigin;
+        /**All tree vertices in bfs order, parents always precede children */
+        std::vector<DrawVertex> drawList;
+        /**Flat array of graphics ids, referenced by DrawVertex ranges */
+        std::vector<int> drawIds;
+        /**Set if the tree structure changed since the last rebuild */
+        bool drawListDirty = true;
+        /**Size of uuidToGraphicsId at the time of the last rebuild */
+        size_t drawListItemCount = 0;
         
+        /**Poses handed from the physics to the render thread */
+        mars::interfaces::DrawStateBuffer drawState;
+        /**Changed poses of the current frame, only used by the render thread */
+        std::vector<mars::interfaces::drawObjectTransform> drawTransforms;
+        cfg_manager::cfgPropertyStruct cfgInterpolate;
+
         bool viewCollidables = false;
         bool viewJoints = false;
         bool viewFrames = false;
@@ -537,6 +537,56 @@ void EnvirePhysics::updatePositions( const GraphTraits::vertex_descriptor origin
   updateChildPositions(target, invTf.transform * originToRoot);
 }
 
+/**
+ * The nodes are visited in the vertex order of the graph, which does not
+ * change as long as the scene is not modified.
+ */
+void EnvirePhysics::saveState(Checkpoint *checkpoint)
+{
+  using simNodeType = envire::core::Item<std::shared_ptr<mars::sim::SimNode>>;
+  using IteratorSimNode = EnvireGraph::ItemIterator<simNodeType>;
+  EnvireGraph::vertex_iterator vi_begin, vi_end;
+  boost::tie(vi_begin, vi_end) = control->graph->getVertices();
+  for(; vi_begin != vi_end; ++vi_begin)
+  {
+    if(!control->graph->containsItems<simNodeType>(*vi_begin))
+      continue;
+    IteratorSimNode begin_sim, end_sim;
+    boost::tie(begin_sim, end_sim) = control->graph->getItems<simNodeType>(*vi_begin);
+    for(; begin_sim != end_sim; ++begin_sim)
+    {
+      checkpoint->write(true);
+      begin_sim->getData()->saveState(checkpoint);
+    }
+  }
+  checkpoint->write(false);
+}
+
+bool EnvirePhysics::restoreState(Checkpoint *checkpoint)
+{
+  using simNodeType = envire::core::Item<std::shared_ptr<mars::sim::SimNode>>;
+  using IteratorSimNode = EnvireGraph::ItemIterator<simNodeType>;
+  EnvireGraph::vertex_iterator vi_begin, vi_end;
+  bool next = false;
+  boost::tie(vi_begin, vi_end) = control->graph->getVertices();
+  for(; vi_begin != vi_end; ++vi_begin)
+  {
+    if(!control->graph->containsItems<simNodeType>(*vi_begin))
+      continue;
+    IteratorSimNode begin_sim, end_sim;
+    boost::tie(begin_sim, end_sim) = control->graph->getItems<simNodeType>(*vi_begin);
+    for(; begin_sim != end_sim; ++begin_sim)
+    {
+      if(!checkpoint->read(&next) || !next ||
+         !begin_sim->getData()->restoreState(checkpoint))
+      {
+        return false;
+      }
+    }
+  }
+  return checkpoint->read(&next) && !next;
+}
+
 DESTROY_LIB(mars::plugins::envire_physics::EnvirePhysics);
 CREATE_LIB(mars::plugins::envire_physics::EnvirePhysics);
 
@@ -119,6 +119,12 @@ namespace mars {
          */
         void update(mars::interfaces::sReal time_ms);
 
+        /** Writes the state of all simulation nodes stored in the graph */
+        void saveState(mars::interfaces::Checkpoint *checkpoint);
+        /** Restores the node states in place, the graph transforms follow
+         *  with the next update */
+        bool restoreState(mars::interfaces::Checkpoint *checkpoint);
+
         void cfgUpdateProperty(cfg_manager::cfgPropertyStruct _property);
         
       private:
@@ -118,6 +118,11 @@ namespace mars {
         newJoint->setAttachedNodes(node1, node2);
         //    newJoint->setSJoint(*jointS);
         newJoint->setPhysicalJoint(newJointInterface);
+        std::map<unsigned long, int>::iterator request;
+        request = feedbackRequests.find(jointS->index);
+        if(request != feedbackRequests.end()) {
+          newJoint->requestFeedback(request->second);
+        }
         simJoints[jointS->index] = newJoint;
         iMutex.unlock();
         control->sim->sceneHasChanged(false);
@@ -256,18 +261,46 @@ namespace mars {
         addJoint(&(*iter), true);
     }
 
+    /**
+     * The feedback of all joints is read from the physics in one call,
+     * afterwards the joints update their values from their records.
+     */
     void JointManager::updateJoints(sReal calc_ms) {
       MutexLocker locker(&iMutex);
       map<unsigned long, SimJoint*>::iterator iter;
+      feedbackJoints.clear();
+      feedbackRecords.clear();
+      for(iter = simJoints.begin(); iter != simJoints.end(); iter++) {
+        if(iter->second->getPhysicalJoint()) {
+          feedbackJoints.push_back(iter->second->getPhysicalJoint());
+          feedbackRecords.push_back(iter->second->getFeedback());
+        }
+      }
+      if(!feedbackJoints.empty()) {
+        control->sim->getPhysics()->getJointFeedback(feedbackJoints,
+                                                     feedbackRecords);
+      }
       for(iter = simJoints.begin(); iter != simJoints.end(); iter++) {
         iter->second->update(calc_ms);
       }
     }
 
+    void JointManager::requestFeedback(unsigned long id, int flags) {
+      MutexLocker locker(&iMutex);
+      feedbackRequests[id] |= flags;
+      map<unsigned long, SimJoint*>::iterator iter = simJoints.find(id);
+      if(iter != simJoints.end()) {
+        iter->second->requestFeedback(flags);
+      }
+    }
+
     void JointManager::clearAllJoints(bool clear_all) {
       map<unsigned long, SimJoint*>::iterator iter;
       MutexLocker locker(&iMutex);
-      if(clear_all) simJointsReload.clear();
+      if(clear_all) {
+        simJointsReload.clear();
+        feedbackRequests.clear();
+      }
 
       while(!simJoints.empty()) {
         control->motors->removeJointFromMotors(simJoints.begin()->first);
@@ -35,6 +35,7 @@
 
 #include <mars/interfaces/sim/ControlCenter.h>
 #include <mars/interfaces/sim/JointManagerInterface.h>
+#include <mars/interfaces/sim/JointInterface.h>
 #include <mars/utils/Mutex.h>
 
 namespace mars {
@@ -62,6 +63,7 @@ namespace mars {
       virtual void reattacheJoints(unsigned long node_id);
       virtual void reloadJoints(void);
       virtual void updateJoints(interfaces::sReal calc_ms);
+      virtual void requestFeedback(unsigned long id, int flags);
       virtual void clearAllJoints(bool clear_all=false);
       virtual void setReloadJointOffset(unsigned long id, interfaces::sReal offset);
       virtual void setReloadJointAxis(unsigned long id, const utils::Vector &axis);
@@ -94,6 +96,11 @@ namespace mars {
       unsigned long next_joint_id;
       std::map<unsigned long, SimJoint*> simJoints;
       std::list<interfaces::JointData> simJointsReload;
+      // quantities requested per joint id, kept for reloaded joints
+      std::map<unsigned long, int> feedbackRequests;
+      // the joints and records passed to the physics in updateJoints()
+      std::vector<interfaces::JointInterface*> feedbackJoints;
+      std::vector<interfaces::JointFeedback*> feedbackRecords;
       interfaces::ControlCenter *control;
       mutable utils::Mutex iMutex;
       interfaces::JointManagerInterface* getJointInterface(unsigned long node_id);
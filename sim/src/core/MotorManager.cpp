@@ -525,6 +525,32 @@ namespace mars {
     }
 
 
+    void MotorManager::saveState(Checkpoint *checkpoint) const {
+      map<unsigned long, SimMotor*>::const_iterator iter;
+      MutexLocker locker(&iMutex);
+      checkpoint->write((unsigned long)simMotors.size());
+      for(iter = simMotors.begin(); iter != simMotors.end(); iter++) {
+        checkpoint->write(iter->first);
+        iter->second->saveState(checkpoint);
+      }
+    }
+
+    bool MotorManager::restoreState(Checkpoint *checkpoint) {
+      map<unsigned long, SimMotor*>::iterator iter;
+      MutexLocker locker(&iMutex);
+      unsigned long size = 0, id = 0;
+      if(!checkpoint->read(&size) || size != simMotors.size()) {
+        return false;
+      }
+      for(iter = simMotors.begin(); iter != simMotors.end(); iter++) {
+        if(!checkpoint->read(&id) || id != iter->first ||
+           !iter->second->restoreState(checkpoint)) {
+          return false;
+        }
+      }
+      return true;
+    }
+
     sReal MotorManager::getActualPosition(unsigned long motorId) const {
       MutexLocker locker(&iMutex);
       map<unsigned long, SimMotor*>::const_iterator iter;
@@ -262,6 +262,8 @@ namespace mars {
        * \param calc_ms The timing value in miliseconds. 
        */
       virtual void updateMotors(interfaces::sReal calc_ms);
+      virtual void saveState(interfaces::Checkpoint *checkpoint) const;
+      virtual bool restoreState(interfaces::Checkpoint *checkpoint);
 
       /**
        * \returns the actual position of the motor with the given Id.
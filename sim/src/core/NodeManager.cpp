@@ -31,9 +31,11 @@
 #include "JointManager.h"
 #include "PhysicsMapper.h"
 
+#include <mars/interfaces/sim/AssetCache.h>
 #include <mars/interfaces/sim/LoadCenter.h>
 #include <mars/interfaces/sim/SimulatorInterface.h>
 #include <mars/interfaces/graphics/GraphicsManagerInterface.h>
+#include <mars/cfg_manager/CFGManagerInterface.h>
 #include <mars/interfaces/terrainStruct.h>
 #include <mars/interfaces/Logging.hpp>
 
@@ -69,12 +71,38 @@ namespace mars {
                                                  visual_rep(1),
                                                  maxGroupID(0),
                                                  libManager(theManager),
-                                                 control(c)
+                                                 control(c),
+                                                 graphicsSyncPosThreshold(0.0001),
+                                                 graphicsSyncRotThreshold(0.0001)
     {
       if(control->graphics) {
         GraphicsUpdateInterface *gui = static_cast<GraphicsUpdateInterface*>(this);
         control->graphics->addGraphicsUpdateInterface(gui);
       }
+      if(control->cfg) {
+        graphicsSyncPosThreshold = control->cfg->getOrCreateProperty("Simulator", "graphics sync pos threshold",
+                                                                     graphicsSyncPosThreshold).dValue;
+        graphicsSyncRotThreshold = control->cfg->getOrCreateProperty("Simulator", "graphics sync rot threshold",
+                                                                     graphicsSyncRotThreshold).dValue;
+        cfgInterpolateGraphics = control->cfg->getOrCreateProperty("Simulator", "interpolate graphics",
+                                                                   true, this);
+        graphicsState.setInterpolation(cfgInterpolateGraphics.bValue);
+      }
+      graphicsState.setThresholds(graphicsSyncPosThreshold,
+                                  graphicsSyncRotThreshold);
+    }
+
+    NodeManager::~NodeManager() {
+      if(control->cfg) {
+        control->cfg->unregisterFromParam(cfgInterpolateGraphics.paramId, this);
+      }
+    }
+
+    void NodeManager::cfgUpdateProperty(cfg_manager::cfgPropertyStruct _property) {
+      if(_property.paramId == cfgInterpolateGraphics.paramId) {
+        // read by the render thread in the next collect()
+        graphicsState.setInterpolation(_property.bValue);
+      }
     }
 
 
@@ -120,7 +148,9 @@ namespace mars {
             LOG_ERROR("NodeManager:: loadCenter is missing, can not create terrain Node");
             return INVALID_ID;
           }
-          if (!control->loadCenter->loadHeightmap){
+          // generated terrains come with their pixel data
+          if (!control->loadCenter->loadHeightmap &&
+              !nodeS->terrain->pixelData){
             GraphicsManagerInterface *g = libManager->getLibraryAs<GraphicsManagerInterface>("mars_graphics");
             if(!g) {
               libManager->loadLibrary("mars_graphics", NULL, false, true);
@@ -130,7 +160,8 @@ namespace mars {
               reloadNode.terrain = new(terrainStruct);
               *(reloadNode.terrain) = *(nodeS->terrain);
               control->loadCenter->loadHeightmap = g->getLoadHeightmapInterface();
-              control->loadCenter->loadHeightmap->readPixelData(reloadNode.terrain);
+              AssetCache::instance()->readPixelData(reloadNode.terrain,
+                                                    control->loadCenter->loadHeightmap);
               libManager->releaseLibrary("mars_graphics");
               LOG_INFO("NodeManager:: mars_graphics was just released");
               if(!reloadNode.terrain->pixelData) {
@@ -182,7 +213,9 @@ namespace mars {
             LOG_ERROR("NodeManager:: loadMesh is missing, can not create Node");
           }
         }
-        control->loadCenter->loadMesh->getPhysicsFromMesh(nodeS);
+        // meshes are shared by all simulations of this process
+        AssetCache::instance()->getPhysicsFromMesh(nodeS,
+                                                   control->loadCenter->loadMesh);
       }
       if((nodeS->physicMode == NODE_TYPE_TERRAIN) && nodeS->terrain ) {
         if(!nodeS->terrain->pixelData) {
@@ -206,7 +239,8 @@ namespace mars {
               return INVALID_ID;
             }
           }
-          control->loadCenter->loadHeightmap->readPixelData(nodeS->terrain);
+          AssetCache::instance()->readPixelData(nodeS->terrain,
+                                              control->loadCenter->loadHeightmap);
           if (release_graphics){
             libManager->releaseLibrary("mars_graphics");
             LOG_INFO("NodeManager:: mars_graphics was just released");
@@ -1250,6 +1284,46 @@ namespace mars {
       for(iter = simNodesDyn.begin(); iter != simNodesDyn.end(); iter++) {
         iter->second->update(calc_ms, physics_thread);
       }
+      if(!control->graphics) return;
+
+      // hand the new poses to the render thread, iMutex serializes the
+      // writers of the buffer
+      std::vector<drawObjectTransform> &snapshot = graphicsState.beginWrite();
+      drawObjectTransform t;
+      for(iter = simNodesDyn.begin(); iter != simNodesDyn.end(); iter++) {
+        t.id = iter->second->getGraphicsID();
+        t.pos = iter->second->getVisualPosition();
+        t.rot = iter->second->getVisualRotation();
+        snapshot.push_back(t);
+        t.id = iter->second->getGraphicsID2();
+        t.pos = iter->second->getPosition();
+        t.rot = iter->second->getRotation();
+        snapshot.push_back(t);
+      }
+      graphicsState.publish();
+    }
+
+    void NodeManager::saveState(Checkpoint *checkpoint) const {
+      MutexLocker locker(&iMutex);
+      NodeMap::const_iterator iter;
+      checkpoint->write((unsigned long)simNodesDyn.size());
+      for(iter = simNodesDyn.begin(); iter != simNodesDyn.end(); iter++) {
+        iter->second->saveState(checkpoint);
+      }
+    }
+
+    bool NodeManager::restoreState(Checkpoint *checkpoint) {
+      MutexLocker locker(&iMutex);
+      NodeMap::iterator iter;
+      unsigned long size = 0;
+      if(!checkpoint->read(&size) || size != simNodesDyn.size()) {
+        return false;
+      }
+      for(iter = simNodesDyn.begin(); iter != simNodesDyn.end(); iter++) {
+        if(!iter->second->restoreState(checkpoint)) return false;
+      }
+      update_all_nodes = true;
+      return true;
     }
 
     void NodeManager::preGraphicsUpdate() {
@@ -1258,44 +1332,47 @@ namespace mars {
       if(!control->graphics)
         return;
 
-      iMutex.lock();
-      if(update_all_nodes) {
-        update_all_nodes = false;
-        for(iter = simNodes.begin(); iter != simNodes.end(); iter++) {
-          control->graphics->setDrawObjectPos(iter->second->getGraphicsID(),
-                                              iter->second->getVisualPosition());
-          control->graphics->setDrawObjectRot(iter->second->getGraphicsID(),
-                                              iter->second->getVisualRotation());
-          control->graphics->setDrawObjectPos(iter->second->getGraphicsID2(),
-                                              iter->second->getPosition());
-          control->graphics->setDrawObjectRot(iter->second->getGraphicsID2(),
-                                              iter->second->getRotation());
-        }
-      }
-      else {
-        for(iter = simNodesDyn.begin(); iter != simNodesDyn.end(); iter++) {
-          control->graphics->setDrawObjectPos(iter->second->getGraphicsID(),
-                                              iter->second->getVisualPosition());
-          control->graphics->setDrawObjectRot(iter->second->getGraphicsID(),
-                                              iter->second->getVisualRotation());
-          control->graphics->setDrawObjectPos(iter->second->getGraphicsID2(),
-                                              iter->second->getPosition());
-          control->graphics->setDrawObjectRot(iter->second->getGraphicsID2(),
-                                              iter->second->getRotation());
+      graphicsSync.clear();
+      // the dynamic nodes come from the snapshots of updateDynamicNodes,
+      // only nodes that moved noticeably since the last frame are handed
+      // to the graphics
+      graphicsState.collect(&graphicsSync);
+
+      // explicitly changed nodes are read directly; if the physics
+      // currently holds the lock they are handled in the next frame
+      if(iMutex.tryLock() == MUTEX_ERROR_NO_ERROR) {
+        if(update_all_nodes) {
+          update_all_nodes = false;
+          graphicsState.invalidate();
+          for(iter = simNodes.begin(); iter != simNodes.end(); iter++) {
+            pushGraphicsSync(iter->second);
+          }
         }
-        for(iter = nodesToUpdate.begin(); iter != nodesToUpdate.end(); iter++) {
-          control->graphics->setDrawObjectPos(iter->second->getGraphicsID(),
-                                              iter->second->getVisualPosition());
-          control->graphics->setDrawObjectRot(iter->second->getGraphicsID(),
-                                              iter->second->getVisualRotation());
-          control->graphics->setDrawObjectPos(iter->second->getGraphicsID2(),
-                                              iter->second->getPosition());
-          control->graphics->setDrawObjectRot(iter->second->getGraphicsID2(),
-                                              iter->second->getRotation());
+        else if(!nodesToUpdate.empty()) {
+          // the forced poses overwrite the ones sent from the snapshot
+          graphicsState.invalidate();
+          for(iter = nodesToUpdate.begin(); iter != nodesToUpdate.end(); iter++) {
+            pushGraphicsSync(iter->second);
+          }
         }
         nodesToUpdate.clear();
+        iMutex.unlock();
+      }
+      if(!graphicsSync.empty()) {
+        control->graphics->setDrawObjectTransforms(graphicsSync);
       }
-      iMutex.unlock();
+    }
+
+    void NodeManager::pushGraphicsSync(SimNode *node) {
+      drawObjectTransform t;
+      t.id = node->getGraphicsID();
+      t.pos = node->getVisualPosition();
+      t.rot = node->getVisualRotation();
+      graphicsSync.push_back(t);
+      t.id = node->getGraphicsID2();
+      t.pos = node->getPosition();
+      t.rot = node->getRotation();
+      graphicsSync.push_back(t);
     }
 
     /**
@@ -1310,6 +1387,9 @@ namespace mars {
       simNodesDyn.clear();
       if(clear_all) simNodesReload.clear();
       next_node_id = 1;
+      // the scene is cleared or reloaded, reread changed mesh and
+      // heightmap files
+      AssetCache::instance()->clear();
       iMutex.unlock();
     }
 
@@ -1612,8 +1692,10 @@ namespace mars {
 
     void NodeManager::setVisualQOffset(NodeId id, const Quaternion &q) {
       NodeMap::const_iterator iter = simNodes.find(id);
-      if (iter != simNodes.end())
+      if (iter != simNodes.end()) {
         iter->second->setVisQOffset(q);
+        pushToUpdate(iter->second);
+      }
     }
 
     void NodeManager::updatePR(NodeId id, const Vector &pos,
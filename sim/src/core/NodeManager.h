@@ -33,7 +33,10 @@
 #endif
 
 #include <mars/utils/Mutex.h>
+#include <mars/cfg_manager/CFGManagerInterface.h>
 #include <mars/interfaces/graphics/GraphicsUpdateInterface.h>
+#include <mars/interfaces/graphics/draw_structs.h>
+#include <mars/interfaces/graphics/DrawStateBuffer.h>
 #include <mars/interfaces/sim/ControlCenter.h>
 #include <mars/interfaces/sim/NodeManagerInterface.h>
 
@@ -50,11 +53,12 @@ namespace mars {
      *
      */
     class NodeManager : public interfaces::NodeManagerInterface,
-                        public interfaces::GraphicsUpdateInterface {
+                        public interfaces::GraphicsUpdateInterface,
+                        public cfg_manager::CFGClient {
     public:
       NodeManager(interfaces::ControlCenter *c,
                   lib_manager::LibManager *theManager);
-      virtual ~NodeManager(){}
+      virtual ~NodeManager();
 
       virtual interfaces::NodeId createPrimitiveNode(const std::string &name,
                                                      interfaces::NodeType type,
@@ -106,6 +110,8 @@ namespace mars {
       virtual void setReloadFriction(interfaces::NodeId id, interfaces::sReal friction1,
                                      interfaces::sReal friction2);
       virtual void updateDynamicNodes(interfaces::sReal calc_ms, bool physics_thread = true);
+      virtual void saveState(interfaces::Checkpoint *checkpoint) const;
+      virtual bool restoreState(interfaces::Checkpoint *checkpoint);
       virtual void clearAllNodes(bool clear_all=false, bool clearGraphics=true);
       virtual void setReloadAngle(interfaces::NodeId id, const utils::sRotation &angle);
       virtual void setContactParams(interfaces::NodeId id, const interfaces::contact_params &cp);
@@ -118,6 +124,7 @@ namespace mars {
       virtual void addRotation(interfaces::NodeId id, const utils::Quaternion &q);
       virtual void setReloadQuaternion(interfaces::NodeId id, const utils::Quaternion &q);
       virtual void preGraphicsUpdate(void);
+      virtual void cfgUpdateProperty(cfg_manager::cfgPropertyStruct _property);
       virtual void exportGraphicNodesByID(const std::string &folder) const;
       virtual void getContactPoints(std::vector<interfaces::NodeId> *ids,
                                     std::vector<utils::Vector> *contact_points) const;
@@ -173,6 +180,14 @@ namespace mars {
 
       interfaces::ControlCenter *control;
 
+      // batched draw object poses collected in preGraphicsUpdate
+      std::vector<interfaces::drawObjectTransform> graphicsSync;
+      // poses of the dynamic nodes published by updateDynamicNodes
+      interfaces::DrawStateBuffer graphicsState;
+      interfaces::sReal graphicsSyncPosThreshold;
+      interfaces::sReal graphicsSyncRotThreshold;
+      cfg_manager::cfgPropertyStruct cfgInterpolateGraphics;
+
       std::list<interfaces::NodeData>::iterator getReloadNode(interfaces::NodeId id);
 
       // interfaces::NodeInterface* getNodeInterface(NodeId node_id);
@@ -215,6 +230,7 @@ namespace mars {
       void removeNode(interfaces::NodeId id, bool lock,
                       bool clearGraphics=true);
       void pushToUpdate(SimNode* node);
+      void pushGraphicsSync(SimNode *node);
 
       void printNodeMasses(bool onlysum);
 
@@ -32,6 +32,7 @@
  */
 
 #include "SensorManager.h"
+#include "SimNode.h"
 
 // sensor includes
 #include "JointAVGTorqueSensor.h"
@@ -59,7 +60,11 @@
 #include <mars/interfaces/sim/SimulatorInterface.h>
 #include <mars/utils/MutexLocker.h>
 #include <mars/interfaces/Logging.hpp>
+#include <mars/data_broker/DataBrokerInterface.h>
+#include <mars/data_broker/ProducerInterface.h>
 
+#include <algorithm>
+#include <cmath>
 #include <cstdio>
 #include <stdexcept>
 
@@ -70,6 +75,107 @@ namespace mars {
     using namespace utils;
     using namespace interfaces;
 
+    namespace {
+
+      const char *simTimer = "mars_sim/simTimer";
+      // upper bound of the steps of the common period of all sensors
+      const unsigned long maxScheduleSlots = 4096;
+
+      struct ScheduledSensor {
+        BaseSensor *sensor;
+        data_broker::ReceiverInterface *receiver;
+        // a producer that publishes what the receiver collected
+        data_broker::ProducerInterface *producer;
+        long period, phaseTime;
+        unsigned long slots, phase, newPhase;
+        double cost, producerCost;
+      };
+
+      bool costGreater(const ScheduledSensor &a, const ScheduledSensor &b) {
+        return a.cost + a.producerCost > b.cost + b.producerCost;
+      }
+
+      unsigned long gcd(unsigned long a, unsigned long b) {
+        while(b) {
+          unsigned long t = a % b;
+          a = b;
+          b = t;
+        }
+        return a;
+      }
+
+      // the highest load of the steps the sensor is updated in with phase
+      double peakLoad(const std::vector<double> &load, unsigned long slots,
+                      unsigned long phase, double cost) {
+        double peak = 0.0;
+        for(unsigned long i=phase%slots; i<load.size(); i+=slots) {
+          peak = std::max(peak, load[i] + cost);
+        }
+        return peak;
+      }
+
+      void addLoad(std::vector<double> *load, unsigned long slots,
+                   unsigned long phase, double cost) {
+        for(unsigned long i=phase%slots; i<load->size(); i+=slots) {
+          (*load)[i] += cost;
+        }
+      }
+
+      // the receiver is called in the first step, the producer in the
+      // step after it
+      double sensorPeakLoad(const std::vector<double> &load,
+                            const ScheduledSensor &sensor, unsigned long phase) {
+        double peak = peakLoad(load, sensor.slots, phase, sensor.cost);
+        if(sensor.producer) {
+          peak = std::max(peak, peakLoad(load, sensor.slots, phase+1,
+                                         sensor.producerCost));
+        }
+        return peak;
+      }
+
+      void addSensorLoad(std::vector<double> *load,
+                         const ScheduledSensor &sensor, unsigned long phase) {
+        addLoad(load, sensor.slots, phase, sensor.cost);
+        if(sensor.producer) {
+          addLoad(load, sensor.slots, phase+1, sensor.producerCost);
+        }
+      }
+
+      // the first time after t with the given phase, as in the DataBroker
+      long nextTriggerTime(long t, long period, long phase) {
+        long next = t - t % period + phase % period;
+        if(next <= t) next += period;
+        return next;
+      }
+
+      // Moves the work of the sensors to the steps their receivers are
+      // called in: the rays are cast in the step the receiver reads them,
+      // a producer with the period of the receiver publishes in the step
+      // after it, like producers that are called in every step.
+      void alignSensors(ControlCenter *control,
+                        const std::vector<ScheduledSensor> &sensors,
+                        long t, long step) {
+        for(size_t i=0; i<sensors.size(); ++i) {
+          const ScheduledSensor &sensor = sensors[i];
+          if(sensor.producer) {
+            control->dataBroker->setTimedProducerPhase(sensor.producer, simTimer,
+                                                       sensor.phaseTime + step);
+          }
+          if(!dynamic_cast<BasePolarIntersectionSensor*>(sensor.sensor) &&
+             !dynamic_cast<BaseGridIntersectionSensor*>(sensor.sensor)) {
+            continue;
+          }
+          BaseNodeSensor *nodeSensor = dynamic_cast<BaseNodeSensor*>(sensor.sensor);
+          SimNode *node = control->nodes->getSimNode(nodeSensor->getAttachedNode());
+          if(node && node->getInterface()) {
+            long next = nextTriggerTime(t, sensor.period, sensor.phaseTime);
+            node->getInterface()->delaySensorUpdate(sensor.sensor, next - t);
+          }
+        }
+      }
+
+    } // end of anonymous namespace
+
     /**
      * \brief Constructor.
      *
@@ -123,6 +229,26 @@ namespace mars {
 
       // missing sensors:
       //   RayGridSensor
+
+      scheduleDirty = false;
+      staggered = false;
+      nextSchedule = 0;
+      if(control->cfg) {
+        cfgStagger = control->cfg->getOrCreateProperty("Simulator",
+                                                       "stagger sensors",
+                                                       true);
+      }
+      if(control->dataBroker) {
+        control->dataBroker->registerTimedReceiver(this, "data_broker",
+                                                   std::string("timers/") + simTimer,
+                                                   simTimer, 0);
+      }
+    }
+
+    SensorManager::~SensorManager() {
+      if(control->dataBroker) {
+        control->dataBroker->unregisterTimedReceiver(this, "*", "*", simTimer);
+      }
     }
 
 
@@ -195,6 +321,9 @@ namespace mars {
           delete tmpSensor;
       }
       iMutex.unlock();
+      costMutex.lock();
+      sensorCosts.erase(index);
+      costMutex.unlock();
 
       control->sim->sceneHasChanged(false);
     }
@@ -268,6 +397,9 @@ namespace mars {
       simSensors.clear();
       if(clear_all) simSensorsReload.clear();
       next_sensor_id = 1;
+      costMutex.lock();
+      sensorCosts.clear();
+      costMutex.unlock();
     }
 
 
@@ -290,6 +422,241 @@ namespace mars {
       iMutex.unlock();
     }
 
+    bool SensorManager::getSensorStatistics(unsigned long id,
+                                            SensorStatistics *statistics) const {
+      data_broker::TimedCallbackStatistics timed, produced;
+      data_broker::ReceiverInterface *receiver;
+      data_broker::ProducerInterface *producer;
+      *statistics = SensorStatistics();
+      if(!control->dataBroker) return false;
+      {
+        MutexLocker locker(&iMutex);
+        map<unsigned long, BaseSensor*>::const_iterator iter = simSensors.find(id);
+        if(iter == simSensors.end()) return false;
+        receiver = dynamic_cast<data_broker::ReceiverInterface*>(iter->second);
+        producer = dynamic_cast<data_broker::ProducerInterface*>(iter->second);
+      }
+      if(!receiver ||
+         !control->dataBroker->getTimedReceiverStatistics(receiver, simTimer,
+                                                          &timed)) {
+        return false;
+      }
+      statistics->updatePeriod = timed.updatePeriod;
+      statistics->phase = timed.phase;
+      statistics->updates = timed.calls;
+      statistics->avgCost = timed.avgTime;
+      statistics->maxCost = timed.maxTime;
+      double variance = timed.deviation*timed.deviation;
+      statistics->jitter = timed.intervalJitter;
+      if(producer &&
+         control->dataBroker->getTimedProducerStatistics(producer, simTimer,
+                                                         &produced)) {
+        statistics->avgCost += produced.avgTime;
+        statistics->maxCost += produced.maxTime;
+        variance += produced.deviation*produced.deviation;
+      }
+      {
+        MutexLocker locker(&costMutex);
+        map<unsigned long, SensorCost>::const_iterator it = sensorCosts.find(id);
+        if(it != sensorCosts.end() && it->second.calls) {
+          const SensorCost &cost = it->second;
+          double avg = cost.sum / cost.calls;
+          statistics->avgCost += avg;
+          statistics->maxCost += cost.max;
+          if(cost.sumSquared / cost.calls > avg*avg) {
+            variance += cost.sumSquared / cost.calls - avg*avg;
+          }
+        }
+      }
+      // the parts of the cost are taken as independent
+      statistics->costDeviation = sqrt(variance);
+      return true;
+    }
+
+    void SensorManager::addSensorCost(unsigned long id, double cost) {
+      MutexLocker locker(&costMutex);
+      SensorCost &sensorCost = sensorCosts[id];
+      sensorCost.calls += 1;
+      sensorCost.sum += cost;
+      sensorCost.sumSquared += cost*cost;
+      if(cost > sensorCost.max) sensorCost.max = cost;
+    }
+
+    void SensorManager::receiveData(const data_broker::DataInfo &info,
+                                    const data_broker::DataPackage &package,
+                                    int callbackParam) {
+      long t;
+      if(!package.get("t", &t)) return;
+      if(!scheduleDirty && t < nextSchedule) return;
+      scheduleDirty = false;
+      nextSchedule = t + 1000;
+      scheduleSensors(t);
+    }
+
+    /**
+     * \brief Distributes the sensors over the steps of their update period.
+     *
+     * The cost of a sensor is the time of its timed receiver, the work
+     * reported by addSensorCost() and the time of its timed producer, which
+     * is called one step after the receiver. The sensors are placed one
+     * after the other, the most expensive first, at the phase where the
+     * highest load of the steps they are updated in is the lowest (longest
+     * processing time first). Sensors without measurements count with the
+     * average cost of the measured ones. The new phases are only applied if
+     * they lower the load of the most expensive step by more than 20%,
+     * moving a sensor causes one update interval that differs from its
+     * period.
+     *
+     * The measured costs differ from run to run. In the deterministic mode
+     * ("Simulator/deterministic") the sensors of each period are therefore
+     * placed round-robin in the order of their ids instead.
+     *
+     * Afterwards the ray casting and the producer of every sensor are
+     * moved to the step of its receiver. This is repeated with every
+     * revision, thus it also corrects sensors that were added later.
+     */
+    void SensorManager::scheduleSensors(long t) {
+      bool enabled = true;
+      if(!control->dataBroker || !control->sim) return;
+      if(control->cfg) {
+        control->cfg->getPropertyValue(cfgStagger.paramId, "value", &enabled);
+      }
+
+      long step = std::max(1L, (long)(control->sim->getCalcMs() + 0.5));
+      std::vector<ScheduledSensor> sensors;
+      data_broker::TimedCallbackStatistics timed, produced;
+      map<unsigned long, BaseSensor*>::iterator iter;
+      map<unsigned long, SensorCost>::iterator costIt;
+      double measuredCost = 0.0;
+      unsigned long measured = 0;
+
+      iMutex.lock();
+      costMutex.lock();
+      for(iter = simSensors.begin(); iter != simSensors.end(); ++iter) {
+        ScheduledSensor sensor;
+        sensor.sensor = iter->second;
+        sensor.receiver = dynamic_cast<data_broker::ReceiverInterface*>(iter->second);
+        if(!sensor.receiver ||
+           !control->dataBroker->getTimedReceiverStatistics(sensor.receiver,
+                                                            simTimer, &timed)) {
+          continue;
+        }
+        // sensors updated in every step are neither staggered nor aligned
+        sensor.period = timed.updatePeriod;
+        if(sensor.period <= step) continue;
+        sensor.slots = sensor.period / step;
+        sensor.phaseTime = timed.phase;
+        sensor.phase = (timed.phase / step) % sensor.slots;
+        sensor.newPhase = 0;
+        sensor.cost = timed.calls ? timed.avgTime : -1.0;
+        costIt = sensorCosts.find(iter->first);
+        if(costIt != sensorCosts.end() && costIt->second.calls) {
+          if(sensor.cost < 0.0) sensor.cost = 0.0;
+          sensor.cost += costIt->second.sum / costIt->second.calls;
+        }
+        if(sensor.cost >= 0.0) {
+          measuredCost += sensor.cost;
+          ++measured;
+        }
+        sensor.producer = dynamic_cast<data_broker::ProducerInterface*>(iter->second);
+        sensor.producerCost = 0.0;
+        if(sensor.producer &&
+           control->dataBroker->getTimedProducerStatistics(sensor.producer,
+                                                           simTimer, &produced) &&
+           produced.updatePeriod == sensor.period) {
+          sensor.producerCost = produced.avgTime;
+        }
+        else {
+          sensor.producer = NULL;
+        }
+        sensors.push_back(sensor);
+      }
+      costMutex.unlock();
+      iMutex.unlock();
+
+      if(!enabled) {
+        // move the sensors back to the same phase
+        if(staggered) {
+          for(size_t i=0; i<sensors.size(); ++i) {
+            control->dataBroker->setTimedReceiverPhase(sensors[i].receiver,
+                                                       simTimer, 0);
+            sensors[i].phaseTime = 0;
+          }
+          staggered = false;
+        }
+        alignSensors(control, sensors, t, step);
+        return;
+      }
+      if(sensors.size() < 2) {
+        alignSensors(control, sensors, t, step);
+        return;
+      }
+      if(control->sim->isDeterministic()) {
+        // the sensors are ordered by id, count them per period
+        std::map<unsigned long, unsigned long> placed;
+        for(size_t i=0; i<sensors.size(); ++i) {
+          ScheduledSensor &sensor = sensors[i];
+          long phaseTime = (placed[sensor.slots]++ % sensor.slots)*step;
+          if(phaseTime != sensor.phaseTime) {
+            sensor.phaseTime = phaseTime;
+            control->dataBroker->setTimedReceiverPhase(sensor.receiver,
+                                                       simTimer, phaseTime);
+          }
+        }
+        staggered = true;
+        alignSensors(control, sensors, t, step);
+        return;
+      }
+
+      double defaultCost = measured ? measuredCost / measured : 1.0;
+      unsigned long slots = 1, maxSlots = 1;
+      for(size_t i=0; i<sensors.size(); ++i) {
+        if(sensors[i].cost < 0.0) sensors[i].cost = defaultCost;
+        maxSlots = std::max(maxSlots, sensors[i].slots);
+        if(slots) {
+          slots = slots / gcd(slots, sensors[i].slots) * sensors[i].slots;
+          if(slots > maxScheduleSlots) slots = 0;
+        }
+      }
+      // if the common period gets too long the schedule of the longest
+      // period is an approximation
+      if(!slots) slots = maxSlots;
+
+      std::vector<ScheduledSensor> ordered(sensors);
+      std::sort(ordered.begin(), ordered.end(), costGreater);
+      std::vector<double> load(slots, 0.0), currentLoad(slots, 0.0);
+      for(size_t i=0; i<ordered.size(); ++i) {
+        ScheduledSensor &sensor = ordered[i];
+        double bestPeak = sensorPeakLoad(load, sensor, 0);
+        for(unsigned long phase=1; phase<sensor.slots; ++phase) {
+          double peak = sensorPeakLoad(load, sensor, phase);
+          if(peak < bestPeak) {
+            bestPeak = peak;
+            sensor.newPhase = phase;
+          }
+        }
+        addSensorLoad(&load, sensor, sensor.newPhase);
+        addSensorLoad(&currentLoad, sensor, sensor.phase);
+      }
+
+      double peak = *std::max_element(load.begin(), load.end());
+      double currentPeak = *std::max_element(currentLoad.begin(),
+                                             currentLoad.end());
+      if(peak < 0.8*currentPeak) {
+        for(size_t i=0; i<ordered.size(); ++i) {
+          if(ordered[i].newPhase != ordered[i].phase) {
+            ordered[i].phaseTime = ordered[i].newPhase*step;
+            control->dataBroker->setTimedReceiverPhase(ordered[i].receiver,
+                                                       simTimer,
+                                                       ordered[i].phaseTime);
+          }
+        }
+        sensors.swap(ordered);
+        staggered = true;
+      }
+      alignSensors(control, sensors, t, step);
+    }
+
     void SensorManager::addMarsParser(const std::string string,
 				      BaseConfig* (*func)(ControlCenter*, ConfigMap*)){
       marsParser.insert(std::pair<const std::string, BaseConfig* (*)(ControlCenter*, ConfigMap*)>(string,func));
@@ -323,6 +690,7 @@ namespace mars {
       BaseSensor *sensor = ((*it).second)(this->control,config);
       iMutex.lock();
       simSensors[id] = sensor;
+      scheduleDirty = true;
       iMutex.unlock();
   
       if(!reload) {
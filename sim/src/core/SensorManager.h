@@ -41,6 +41,8 @@
 #include <mars/interfaces/sim/SensorManagerInterface.h>
 #include <mars/interfaces/sim/ControlCenter.h>
 #include <mars/utils/Mutex.h>
+#include <mars/data_broker/ReceiverInterface.h>
+#include <mars/cfg_manager/CFGManagerInterface.h>
 #include <configmaps/ConfigData.h>
 
 namespace mars {
@@ -65,8 +67,17 @@ namespace mars {
      * have the desired results. Currently the verified use of the functions 
      * is only guaranteed by calling it within the main thread (update 
      * callback from \c gui_thread).
+     *
+     * Sensors with the same update period are triggered in the same step of
+     * the simulation timer by default. The manager spreads them over the
+     * steps of their period such that the most expensive step gets as cheap
+     * as possible, using the cost the DataBroker measures for every sensor
+     * update. The schedule is set up when sensors are added and revised
+     * every second of simulation time ("Simulator/stagger sensors"). In
+     * the deterministic mode the phases only depend on the sensor ids.
      */
-    class SensorManager : public interfaces::SensorManagerInterface {
+    class SensorManager : public interfaces::SensorManagerInterface,
+                          public data_broker::ReceiverInterface {
     public:
 
       /**
@@ -79,7 +90,7 @@ namespace mars {
       /**
        * \brief Destructor.
        */
-      virtual ~SensorManager(){}
+      virtual ~SensorManager();
   
       /**
        * \brief Add a sensor to the simulation.
@@ -194,6 +205,15 @@ namespace mars {
        * are added back to the simulation again with a \c reload value of \c true. 
        */
       virtual void reloadSensors(void) ;
+
+      virtual bool getSensorStatistics(unsigned long id,
+                                       interfaces::SensorStatistics *statistics) const;
+      virtual void addSensorCost(unsigned long id, double cost);
+
+      // DataBroker callback of the simulation timer
+      virtual void receiveData(const data_broker::DataInfo &info,
+                               const data_broker::DataPackage &package,
+                               int callbackParam);
   
       //virtual void addSensorType(const std::string &name,  BaseSensor* (*func)(interfaces::ControlCenter*,const unsigned long int,const std::string,QDomElement*));
       //void addSensorType(const std::string &name, BaseSensor* (*func)(interfaces::ControlCenter*,const unsigned long int, const std::string, mars::ConfigMap*));
@@ -233,6 +253,22 @@ namespace mars {
       //std::map<const std::string,BaseConfig* (*)(QDomElement*)> qDomParser;
       std::map<const std::string, interfaces::BaseConfig* (*)(interfaces::ControlCenter*, configmaps::ConfigMap*)> marsParser;
 
+      cfg_manager::cfgPropertyStruct cfgStagger;
+      //! the schedule is revised if sensors were added or at this time
+      bool scheduleDirty, staggered;
+      long nextSchedule;
+
+      struct SensorCost {
+        SensorCost() : calls(0), sum(0.0), sumSquared(0.0), max(0.0) {}
+        unsigned long calls;
+        double sum, sumSquared, max;
+      };
+      //! the work reported by addSensorCost(), guarded by costMutex
+      std::map<unsigned long, SensorCost> sensorCosts;
+      mutable utils::Mutex costMutex;
+
+      void scheduleSensors(long t);
+
     }; // class SensorManager
 
   } // end of namespace sim
@@ -214,30 +214,40 @@ namespace mars {
     void SimJoint::update(sReal calc_ms){
       CPP_UNUSED(calc_ms);
       if (physical_joint) {
-        // update the position and rotation of the node
-        position1 = (sJoint.angle1_offset + invert*physical_joint->getPosition());
-        position2 = (sJoint.angle2_offset + invert*physical_joint->getPosition2());
-
-        physical_joint->getAnchor(&anchor);
-        physical_joint->getAxis(&axis1);
-        physical_joint->getAxis2(&axis2);
-        physical_joint->getForce1(&f1);
-        physical_joint->getForce2(&f2);
-        physical_joint->getTorque1(&t1);
-        physical_joint->getTorque2(&t2);
-        physical_joint->update();
-        physical_joint->getAxisTorque(&axis1_torque);
-        physical_joint->getAxis2Torque(&axis2_torque);
-        physical_joint->getJointLoad(&joint_load);
-        axis1_torque *= invert;
-        axis2_torque *= invert;
-        joint_load *= invert;
-        velocity1 = invert*physical_joint->getVelocity();
-        velocity2 = invert*physical_joint->getVelocity2();
-        motor_torque = invert*physical_joint->getMotorTorque();
+        // the quantities that are not requested keep their last values
+        const int flags = feedback.flags;
+        if(flags & JOINT_FEEDBACK_STATE) {
+          // update the position and rotation of the node
+          position1 = (sJoint.angle1_offset + invert*feedback.position1);
+          position2 = (sJoint.angle2_offset + invert*feedback.position2);
+          anchor = feedback.anchor;
+          axis1 = feedback.axis1;
+          axis2 = feedback.axis2;
+          velocity1 = invert*feedback.velocity1;
+          velocity2 = invert*feedback.velocity2;
+        }
+        if(flags & JOINT_FEEDBACK_FORCES) {
+          f1 = feedback.force1;
+          f2 = feedback.force2;
+          t1 = feedback.torque1;
+          t2 = feedback.torque2;
+        }
+        if(flags & (JOINT_FEEDBACK_AXIS_TORQUE | JOINT_FEEDBACK_LOAD)) {
+          axis1_torque = invert*feedback.axis1Torque;
+          axis2_torque = invert*feedback.axis2Torque;
+          joint_load = invert*feedback.jointLoad;
+        }
+        if(flags & (JOINT_FEEDBACK_MOTOR_TORQUE | JOINT_FEEDBACK_AXIS_TORQUE |
+                    JOINT_FEEDBACK_LOAD)) {
+          motor_torque = invert*feedback.motorTorque;
+        }
       }
     }
 
+    void SimJoint::requestFeedback(int flags) {
+      feedback.flags |= flags;
+    }
+
     void SimJoint::setSJoint(const JointData &sJoint) {
       this->sJoint = sJoint;
       id = sJoint.index;
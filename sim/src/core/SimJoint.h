@@ -95,6 +95,9 @@ namespace mars {
      *  - "jointLoad/y" (double)
      *  - "jointLoad/z" (double)
      *  - "motorTorque" (double)
+     *
+     * The axis torques and the joint load stay zero unless they are
+     * requested with JointManagerInterface::requestFeedback().
      */
     class SimJoint : public data_broker::ProducerInterface {
     public:
@@ -105,7 +108,12 @@ namespace mars {
 
       // function members
       void rotateAxis(const utils::Quaternion &rotatem, unsigned char axis_index=1);
+      /// takes the values from the feedback record filled by the physics
       void update(interfaces::sReal calc_ms);
+      /// adds quantities (see interfaces::JointFeedbackFlags) to the feedback
+      void requestFeedback(int flags);
+      interfaces::JointFeedback* getFeedback(void) {return &feedback;}
+      interfaces::JointInterface* getPhysicalJoint(void) const {return physical_joint;}
       void reattachJoint(void);
       void attachMotor(unsigned char axis_index);
       void detachMotor(unsigned char axis_index);
@@ -209,6 +217,7 @@ namespace mars {
       interfaces::sReal motor_torque, invert;
       utils::Vector axis1InNode1;
       utils::Vector node1ToAnchor;
+      interfaces::JointFeedback feedback;
 
       // for dataBroker communication
       void setupDataPackageMapping();
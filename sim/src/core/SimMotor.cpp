@@ -392,6 +392,44 @@ namespace mars {
       }
     }
 
+    /**
+     * \brief Writes the controller and estimation state of the motor.
+     */
+    void SimMotor::saveState(Checkpoint *checkpoint) const {
+      checkpoint->write(active);
+      checkpoint->write(sMotor.value);
+      checkpoint->write(controlValue);
+      checkpoint->write(time);
+      checkpoint->write(velocity);
+      checkpoint->write(position1);
+      checkpoint->write(position2);
+      checkpoint->write(effort);
+      checkpoint->write(current);
+      checkpoint->write(temperature);
+      checkpoint->write(last_error);
+      checkpoint->write(integ_error);
+      checkpoint->write(joint_velocity);
+      checkpoint->write(error);
+    }
+
+    bool SimMotor::restoreState(Checkpoint *checkpoint) {
+      checkpoint->read(&active);
+      checkpoint->read(&sMotor.value);
+      checkpoint->read(&controlValue);
+      checkpoint->read(&time);
+      checkpoint->read(&velocity);
+      checkpoint->read(&position1);
+      checkpoint->read(&position2);
+      checkpoint->read(&effort);
+      checkpoint->read(&current);
+      checkpoint->read(&temperature);
+      checkpoint->read(&last_error);
+      checkpoint->read(&integ_error);
+      checkpoint->read(&joint_velocity);
+      checkpoint->read(&error);
+      return !checkpoint->hasFailed();
+    }
+
     void SimMotor::estimateCurrent() {
       // calculate current
       effort = myJoint->getMotorTorque();
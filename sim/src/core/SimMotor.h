@@ -31,6 +31,7 @@
 #include <mars/data_broker/ReceiverInterface.h>
 #include <mars/data_broker/DataPackage.h>
 #include <mars/interfaces/MotorData.h>
+#include <mars/interfaces/sim/Checkpoint.h>
 #include <mars/utils/mathUtils.h>
 
 #include <iostream>
@@ -70,6 +71,8 @@ namespace mars {
 
       void update(interfaces::sReal time_ms);
       void updateController();
+      void saveState(interfaces::Checkpoint *checkpoint) const;
+      bool restoreState(interfaces::Checkpoint *checkpoint);
       void activate(void);
       void deactivate(void);
       void attachJoint(SimJoint *joint);
@@ -292,7 +292,6 @@ namespace mars {
       setRotation(rot, true);
     }
 
-
     const Vector SimNode::getLinearVelocity() const {
       MutexLocker locker(&iMutex);
       return l_vel;
@@ -528,15 +527,18 @@ namespace mars {
         sReal d;
         last_l_vel = l_vel;
         last_a_vel = a_vel;
+        if(my_interface->isSleeping()) {
+          // a sleeping body is at rest; the pose is unchanged and applying
+          // the damping would wake it up again
+          l_vel = a_vel = Vector(0, 0, 0);
+          l_acc = a_acc = Vector(0, 0, 0);
+          ground_contact = my_interface->getGroundContact();
+          ground_contact_force = my_interface->getGroundContactForce();
+          checkNodeState();
+          return;
+        }
         // update the position and rotation of the node
-        my_interface->getPosition(&sNode.pos);    //from NodePhysics member  
-        my_interface->getRotation(&sNode.rot);
-        my_interface->getLinearVelocity(&l_vel);
-        my_interface->getAngularVelocity(&a_vel);
-        my_interface->getForce(&f);
-        my_interface->getTorque(&t);
-        ground_contact = my_interface->getGroundContact();
-        ground_contact_force = my_interface->getGroundContactForce();
+        readPhysicsState();
         if(calc_ms > 0) {
           l_acc = (l_vel - last_l_vel) / (calc_ms / 1000.);
           a_acc = (a_vel - last_a_vel) / (calc_ms / 1000.);
@@ -594,14 +596,56 @@ namespace mars {
           my_interface->setAngularVelocity(damping);
         }
         //vel_ptr = (vel_ptr+1)%BACK_VEL;
-        if(update_ray || true) {
-          my_interface->handleSensorData(physics_thread);
-          update_ray = false;
-        }
         checkNodeState();
       }
     }
 
+    /**
+     * \brief Copies pose, velocities, forces and contact state of the
+     * physical layer into the cached values of the node.
+     *
+     * pre:
+     *     - iMutex is locked and interface != 0
+     */
+    void SimNode::readPhysicsState(void) {
+      my_interface->getPosition(&sNode.pos);    //from NodePhysics member
+      my_interface->getRotation(&sNode.rot);
+      my_interface->getLinearVelocity(&l_vel);
+      my_interface->getAngularVelocity(&a_vel);
+      my_interface->getForce(&f);
+      my_interface->getTorque(&t);
+      ground_contact = my_interface->getGroundContact();
+      ground_contact_force = my_interface->getGroundContactForce();
+    }
+
+    void SimNode::saveState(Checkpoint *checkpoint) const {
+      MutexLocker locker(&iMutex);
+      checkpoint->write(sNode.index);
+      checkpoint->write(my_interface != nullptr);
+      if(my_interface) my_interface->saveState(checkpoint);
+    }
+
+    bool SimNode::restoreState(Checkpoint *checkpoint) {
+      MutexLocker locker(&iMutex);
+      NodeId index = 0;
+      bool hasInterface = false;
+      if(!checkpoint->read(&index) || index != sNode.index ||
+         !checkpoint->read(&hasInterface) ||
+         hasInterface != (my_interface != nullptr)) {
+        return false;
+      }
+      if(my_interface) {
+        if(!my_interface->restoreState(checkpoint)) return false;
+        // refresh the cached values, the accelerations are reset
+        readPhysicsState();
+        l_acc = Vector(0, 0, 0);
+        a_acc = Vector(0, 0, 0);
+        last_l_vel = l_vel;
+        last_a_vel = a_vel;
+      }
+      return true;
+    }
+
     void SimNode::getCoreExchange(core_objects_exchange *obj) const {
       MutexLocker locker(&iMutex);
       obj->index = sNode.index;
@@ -165,6 +165,8 @@ namespace mars {
       
       // manipulation
       void update(interfaces::sReal calc_ms, bool physics_thread = true); ///< Updates the values of the node from the physical layer.
+      void saveState(interfaces::Checkpoint *checkpoint) const; ///< Writes the physical state of the node.
+      bool restoreState(interfaces::Checkpoint *checkpoint); ///< Restores a state written by saveState in place.
       void rotateAtPoint(const utils::Vector &rotation_point, const utils::Quaternion &rotation, bool move_group);
       void changeNode(interfaces::NodeData *node);
       void clearRelativePosition(void);
@@ -209,6 +211,8 @@ namespace mars {
       mutable utils::Mutex iMutex;
       // stuff for dataBroker communication
       data_broker::DataPackageMapping dbPackageMapping;
+
+      void readPhysicsState(void);
     };
 
   } // end of namespace sim
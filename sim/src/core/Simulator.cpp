@@ -38,6 +38,7 @@
 #include "Controller.h"
 
 #include <mars/utils/misc.h>
+#include <mars/utils/RandomStream.h>
 #include <mars/interfaces/SceneParseException.h>
 #include <mars/interfaces/graphics/GraphicsManagerInterface.h>
 #include <mars/interfaces/sim/LoadCenter.h>
@@ -75,6 +76,8 @@ namespace mars {
 
 
     Simulator *Simulator::activeSimulator = 0;
+    std::vector<Simulator*> Simulator::instances;
+    utils::Mutex Simulator::instancesMutex;
 
     Simulator::Simulator(lib_manager::LibManager *theManager) :
       lib_manager::LibInterface(theManager),
@@ -97,7 +100,30 @@ namespace mars {
       sim_fault = false;
       // set the calculation step size in ms
       calc_ms      = 10; //defaultCFG->getInt("physics", "calc_ms", 10);
+      physics_substeps = 1;
+      sensor_threads = 2;
+      adaptive_step = false;
+      adaptive_max_substeps = 16;
+      adaptive_max_depth = 0.01;
+      adaptive_calm_steps = 0;
+      adaptive_refine = false;
       my_real_time = 0;
+      realTimeNeedsInit = true;
+      deterministic = false;
+      deterministicRequest = false;
+      deterministicChanged = false;
+      reseedRequested = false;
+      hash_steps = true;
+      random_seed = 0;
+      state_hash = 0;
+      plugin_order_changed = false;
+      stateHashFile = NULL;
+      dbStateHashId = 0;
+      profile_steps = false;
+      profileStepsRequest = false;
+      profileStepsChanged = false;
+      profileStepStart = profilePhaseStart = 0;
+      dbStepTimesId = 0;
       show_time = 0;
       // to synchronise drawing and physics
       sync_time = 40;
@@ -108,7 +134,10 @@ namespace mars {
       arg_run    = 0;
       arg_grid   = 0;
       arg_ortho  = 0;
+      instancesMutex.lock();
+      instances.push_back(this);
       Simulator::activeSimulator = this; // set this Simulator object to the active one
+      instancesMutex.unlock();
 
       gravity = Vector(0.0, 0.0, -9.81); // set gravity to earth conditions
 
@@ -118,6 +147,15 @@ namespace mars {
       control->sim = (SimulatorInterface*)this;
       control->cfg = 0;//defaultCFG;
       dbSimTimePackage.add("simTime", 0.);
+      dbStateHashPackage.add("hash", (unsigned long)0);
+      dbStepTimesPackage.add("physics", 0.);
+      dbStepTimesPackage.add("joints", 0.);
+      dbStepTimesPackage.add("motors", 0.);
+      dbStepTimesPackage.add("controllers", 0.);
+      dbStepTimesPackage.add("sensors", 0.);
+      dbStepTimesPackage.add("dataBroker", 0.);
+      dbStepTimesPackage.add("plugins", 0.);
+      dbStepTimesPackage.add("total", 0.);
       // load optional libs
       checkOptionalDependency("data_broker");
       checkOptionalDependency("cfg_manager");
@@ -153,6 +191,26 @@ namespace mars {
         saveFile.append("/mars_Simulator.yaml");
         control->cfg->writeConfig(saveFile.c_str(), "Simulator");
       }
+      if(stateHashFile) fclose(stateHashFile);
+      // other simulations in this process must not keep using our
+      // instances, they are handed over to the remaining Simulators and
+      // cleared with the last one
+      instancesMutex.lock();
+      instances.erase(std::find(instances.begin(), instances.end(), this));
+      if(control->dataBroker &&
+         ControlCenter::theDataBroker == control->dataBroker) {
+        ControlCenter::theDataBroker = NULL;
+        for(size_t i=0; i<instances.size(); ++i) {
+          if(instances[i]->control->dataBroker) {
+            ControlCenter::theDataBroker = instances[i]->control->dataBroker;
+            break;
+          }
+        }
+      }
+      if(Simulator::activeSimulator == this) {
+        Simulator::activeSimulator = instances.empty() ? 0 : instances.back();
+      }
+      instancesMutex.unlock();
       // TODO: do we need to delete control?
       libManager->releaseLibrary("mars_graphics");
       libManager->releaseLibrary("cfg_manager");
@@ -168,7 +226,12 @@ namespace mars {
       if(libName == "data_broker") {
         control->dataBroker = libManager->getLibraryAs<data_broker::DataBrokerInterface>("data_broker");
         if(control->dataBroker) {
-          ControlCenter::theDataBroker = control->dataBroker;
+          // the log macros use one DataBroker for the whole process
+          instancesMutex.lock();
+          if(!ControlCenter::theDataBroker) {
+            ControlCenter::theDataBroker = control->dataBroker;
+          }
+          instancesMutex.unlock();
           // create streams
           getTimeMutex.lock();
           dbSimTimeId = control->dataBroker->pushData("mars_sim", "simTime",
@@ -259,16 +322,25 @@ namespace mars {
       physics->initTheWorld();
       // the physics step_size is in seconds
       physics->step_size = calc_ms/1000.;
+      physics->substeps = physics_substeps;
+      physics->sensor_threads = sensor_threads;
+      physics->keep_step_state = adaptive_step;
       physics->fast_step = false;
 
       physics->world_erp = cfgWorldErp.dValue;
       physics->world_cfm = cfgWorldCfm.dValue;
+      physics->auto_disable = cfgAutoDisable.bValue;
+      physics->auto_disable_linear_threshold = cfgAutoDisableLinear.dValue;
+      physics->auto_disable_angular_threshold = cfgAutoDisableAngular.dValue;
+      physics->auto_disable_steps = cfgAutoDisableSteps.iValue;
+      physics->auto_disable_time = cfgAutoDisableTime.dValue;
 
       gravity.x() = cfgGX.dValue;
       gravity.y() = cfgGY.dValue;
       gravity.z() = cfgGZ.dValue;
       physics->world_gravity = gravity;
       physics->draw_contact_points = cfgDrawContact.bValue;
+      if(deterministic) seedRandomStreams();
 #ifndef __linux__
       this->setStackSize(16777216);
       fprintf(stderr, "INFO: set physics stack size to: %lu\n", getStackSize());
@@ -347,7 +419,7 @@ namespace mars {
         }
         stepping_mutex.unlock();
 
-        if(my_real_time) {
+        if(my_real_time && !deterministic) {
           myRealTime();
         } else if(physics_mutex_count > 0) {
           // if not in realtime this thread would lock the physicsThread right
@@ -371,6 +443,7 @@ namespace mars {
       Status oldState;
 
       physicsThreadLock();
+      applyRequests();
 
       if(setState) {
         oldState = simulationStatus;
@@ -381,6 +454,9 @@ namespace mars {
       long startTime = utils::getTime();
 
 #endif
+      if(profile_steps) {
+        profileStepStart = profilePhaseStart = utils::getTimeMicro();
+      }
       if(control->dataBroker) {
         control->dataBroker->trigger("mars_sim/prePhysicsUpdate");
       }
@@ -388,10 +464,27 @@ namespace mars {
 #ifdef DEBUG_TIME
       LOG_DEBUG("Step World: %ld", getTimeDiff(startTime));
 #endif
+      if(adaptive_step) {
+        // a failed step is redone from the state before it with more
+        // substeps until it succeeds or the maximum is reached
+        while(physics->redo_step) {
+          adaptive_refine = true;
+          adaptPhysicsSubsteps();
+          physics->stepTheWorld();
+        }
+        adaptPhysicsSubsteps();
+      }
+      if(profile_steps) profilePhase(PHASE_PHYSICS);
 
       control->joints->updateJoints(calc_ms);
+      if(profile_steps) profilePhase(PHASE_JOINTS);
       control->motors->updateMotors(calc_ms);
+      if(profile_steps) profilePhase(PHASE_MOTORS);
       control->controllers->updateControllers(calc_ms);
+      if(profile_steps) profilePhase(PHASE_CONTROLLERS);
+      // the ray sensors are cast since the end of stepTheWorld()
+      physics->waitForSensors();
+      if(profile_steps) profilePhase(PHASE_SENSORS);
 
       if(show_time)
         time = utils::getTime();
@@ -404,6 +497,7 @@ namespace mars {
                                       dbSimTimePackage);
         control->dataBroker->stepTimer("mars_sim/simTimer", calc_ms);
       }
+      if(profile_steps) profilePhase(PHASE_DATA_BROKER);
 
       if(show_time) {
         avg_log_time += getTimeDiff(time);
@@ -415,6 +509,7 @@ namespace mars {
         }
       }
 
+      if(deterministic && plugin_order_changed) sortActivePlugins();
       pluginLocker.lockForRead();
 
       // It is possible for plugins to call switchPluginUpdateMode during
@@ -445,6 +540,7 @@ namespace mars {
         }
       }
       pluginLocker.unlock();
+      if(profile_steps) profilePhase(PHASE_PLUGINS);
       if (sync_graphics) {
         calc_time += calc_ms;
         if (calc_time >= sync_time) {
@@ -459,6 +555,8 @@ namespace mars {
       if(control->dataBroker) {
         control->dataBroker->trigger("mars_sim/postPhysicsUpdate");
       }
+      if(deterministic && hash_steps) updateStateHash();
+      if(profile_steps) profilePhase(PHASE_TOTAL);
 
       if(setState) {
         simulationStatus = oldState;
@@ -507,16 +605,15 @@ namespace mars {
 #ifdef __linux__  //__unix__, wenn Darwin das mitmacht.
       //used to remember last time this function was called
       //and as absolute (minimum) wake-up time.
-      static struct timespec ts;
-      static bool tsNeedsInit = true;
-      if (tsNeedsInit)
+      struct timespec &ts = realTimeWakeup;
+      if (realTimeNeedsInit)
         {
           int retval = clock_gettime(CLOCK_MONOTONIC, &ts);
           if (retval != 0)
             {
               throw std::runtime_error("clock_gettime(CLOCK_MONOTONIC, ...) failed");
             }
-          tsNeedsInit = false;
+          realTimeNeedsInit = false;
         }
 
       //schedule minimum sleep time
@@ -543,7 +640,11 @@ namespace mars {
           throw std::runtime_error("clock_gettime(CLOCK_MONOTONIC, ...) failed");
         }
 #else
-      static long myTime = utils::getTime();
+      long &myTime = realTimeLast;
+      if(realTimeNeedsInit) {
+        myTime = utils::getTime();
+        realTimeNeedsInit = false;
+      }
       long timeDiff = getTimeDiff(myTime);
 
       if(show_time) {
@@ -772,6 +873,7 @@ namespace mars {
         control->entities->resetPose();
         for (unsigned int i=0; i<allPlugins.size(); i++)
           allPlugins[i].p_interface->reset();
+        if(deterministic) seedRandomStreams();
         control->controllers->setLoadingAllowed(true);
         if (was_running) {
           StartSimulation();
@@ -858,6 +960,93 @@ namespace mars {
       stepping_mutex.unlock();
     }
 
+    // identifies the layout of a checkpoint, increase on changes
+    static const unsigned long checkpointVersion = 2;
+
+    void Simulator::saveCheckpoint(Checkpoint *checkpoint) {
+      physicsThreadLock();
+      checkpoint->clear();
+      checkpoint->write(checkpointVersion);
+      getTimeMutex.lock();
+      checkpoint->write(dbSimTimePackage[0].d);
+      getTimeMutex.unlock();
+      // the random numbers continue where they were
+      checkpoint->write(physics->getRandomSeed());
+      checkpoint->write(randStream.getState());
+      control->nodes->saveState(checkpoint);
+      control->motors->saveState(checkpoint);
+
+      // every plugin gets its own block, thus plugins can't break the
+      // layout of the others
+      pluginLocker.lockForRead();
+      Checkpoint block;
+      checkpoint->write((unsigned long)allPlugins.size());
+      for(unsigned int i=0; i<allPlugins.size(); i++) {
+        block.clear();
+        allPlugins[i].p_interface->saveState(&block);
+        checkpoint->writeBlock(block);
+      }
+      pluginLocker.unlock();
+      physicsThreadUnlock();
+    }
+
+    /**
+     * \brief Restores a checkpoint of the current scene in place.
+     * \return \c false if the checkpoint does not fit the scene, the state
+     *         may then be partially restored.
+     */
+    bool Simulator::restoreCheckpoint(Checkpoint *checkpoint) {
+      unsigned long version = 0, numPlugins = 0, physicsSeed = 0;
+      uint64_t randState = 0;
+      double simTime = 0.0;
+      bool ok = true;
+
+      physicsThreadLock();
+      checkpoint->rewind();
+      if(!checkpoint->read(&version) || version != checkpointVersion ||
+         !checkpoint->read(&simTime) || !checkpoint->read(&physicsSeed) ||
+         !checkpoint->read(&randState)) {
+        LOG_ERROR("Simulator: invalid checkpoint");
+        physicsThreadUnlock();
+        return false;
+      }
+      if(!control->nodes->restoreState(checkpoint) ||
+         !control->motors->restoreState(checkpoint)) {
+        LOG_ERROR("Simulator: checkpoint does not fit the current scene");
+        ok = false;
+      }
+
+      if(ok) {
+        pluginLocker.lockForRead();
+        Checkpoint block;
+        if(!checkpoint->read(&numPlugins) || numPlugins != allPlugins.size()) {
+          LOG_ERROR("Simulator: checkpoint does not fit the loaded plugins");
+          ok = false;
+        }
+        for(unsigned int i=0; ok && i<allPlugins.size(); i++) {
+          if(!checkpoint->readBlock(&block) ||
+             !allPlugins[i].p_interface->restoreState(&block)) {
+            LOG_ERROR("Simulator: plugin \"%s\" failed to restore its state",
+                      allPlugins[i].name.c_str());
+            ok = false;
+          }
+        }
+        pluginLocker.unlock();
+      }
+
+      if(ok) {
+        getTimeMutex.lock();
+        dbSimTimePackage[0].set(simTime);
+        getTimeMutex.unlock();
+        control->controllers->resetControllerData();
+        if(deterministic) {
+          physics->setRandomSeed(physicsSeed);
+          randStream.setSeed(randState);
+        }
+      }
+      physicsThreadUnlock();
+      return ok;
+    }
 
     void Simulator::reloadWorld(void) {
       control->nodes->reloadNodes(reloadGraphics);
@@ -1040,8 +1229,10 @@ namespace mars {
       for(p_iter=allPlugins.begin(); p_iter!=allPlugins.end();
           p_iter++) {
         if((*p_iter).p_interface == pl) {
-          if(mode & PLUGIN_SIM_MODE && !afound)
+          if(mode & PLUGIN_SIM_MODE && !afound) {
             activePlugins.push_back(*p_iter);
+            plugin_order_changed = true;
+          }
           if(mode & PLUGIN_GUI_MODE && !gfound)
             guiPlugins.push_back(*p_iter);
           break;
@@ -1072,6 +1263,16 @@ namespace mars {
         break;
       }
 
+      // in adaptive mode the failed step is redone with more substeps,
+      // only at the maximum the onPhysicsError policy applies
+      if(adaptive_step && physics->keep_step_state &&
+         error != PHYSICS_DEBUG && error != PHYSICS_NO_ERROR &&
+         physics->substeps < adaptive_max_substeps) {
+        LOG_WARN("Simulator: physics error, redoing the step with more substeps");
+        physics->redo_step = true;
+        return;
+      }
+
       for(p_iter=allPlugins.begin(); p_iter!=allPlugins.end();
           p_iter++) {
         (*p_iter).p_interface->handleError();
@@ -1102,6 +1303,37 @@ namespace mars {
       }
     }
 
+    void Simulator::setPhysicsSubsteps(int substeps) {
+      if(physics->substeps == substeps) return;
+      physics->substeps = substeps;
+      // the joint cfm and erp depend on the physics step
+      if(control->joints) control->joints->changeStepSize();
+    }
+
+    /**
+     * \brief Doubles the physics substeps after an error or a contact
+     * deeper than adaptive_max_depth and halves them again after 100 calm
+     * steps, never going below physics_substeps.
+     */
+    void Simulator::adaptPhysicsSubsteps(void) {
+      int substeps = physics->substeps;
+      if(adaptive_refine || physics->max_contact_depth > adaptive_max_depth) {
+        adaptive_refine = false;
+        adaptive_calm_steps = 0;
+        substeps = std::min(substeps*2, adaptive_max_substeps);
+      }
+      else if(physics->max_contact_depth < 0.25*adaptive_max_depth) {
+        if(++adaptive_calm_steps >= 100) {
+          adaptive_calm_steps = 0;
+          substeps = std::max(substeps/2, physics_substeps);
+        }
+      }
+      else {
+        adaptive_calm_steps = 0;
+      }
+      setPhysicsSubsteps(std::max(substeps, 1));
+    }
+
     void Simulator::setGravity(const Vector &gravity) {
       if(control->cfg) {
         control->cfg->setPropertyValue("Simulator", "Gravity x", "value",
@@ -1264,6 +1496,35 @@ namespace mars {
         return;
       }
 
+      if(_property.paramId == cfgSubsteps.paramId) {
+        physics_substeps = std::max(1, _property.iValue);
+        if(physics) setPhysicsSubsteps(physics_substeps);
+        return;
+      }
+
+      if(_property.paramId == cfgSensorThreads.paramId) {
+        sensor_threads = std::max(0, _property.iValue);
+        if(physics) physics->sensor_threads = sensor_threads;
+        return;
+      }
+
+      if(_property.paramId == cfgAdaptiveStep.paramId) {
+        adaptive_step = _property.bValue;
+        if(physics) physics->keep_step_state = adaptive_step;
+        if(physics && !adaptive_step) setPhysicsSubsteps(physics_substeps);
+        return;
+      }
+
+      if(_property.paramId == cfgAdaptiveMaxSubsteps.paramId) {
+        adaptive_max_substeps = _property.iValue;
+        return;
+      }
+
+      if(_property.paramId == cfgAdaptiveMaxDepth.paramId) {
+        adaptive_max_depth = _property.dValue;
+        return;
+      }
+
       if(_property.paramId == cfgFaststep.paramId) {
         if(physics) physics->fast_step = _property.bValue;
         return;
@@ -1323,11 +1584,66 @@ namespace mars {
         return;
       }
 
+      // the auto disable parameters apply to bodies created afterwards
+      if(_property.paramId == cfgAutoDisable.paramId) {
+        physics->auto_disable = _property.bValue;
+        return;
+      }
+
+      if(_property.paramId == cfgAutoDisableLinear.paramId) {
+        physics->auto_disable_linear_threshold = _property.dValue;
+        return;
+      }
+
+      if(_property.paramId == cfgAutoDisableAngular.paramId) {
+        physics->auto_disable_angular_threshold = _property.dValue;
+        return;
+      }
+
+      if(_property.paramId == cfgAutoDisableSteps.paramId) {
+        physics->auto_disable_steps = _property.iValue;
+        return;
+      }
+
+      if(_property.paramId == cfgAutoDisableTime.paramId) {
+        physics->auto_disable_time = _property.dValue;
+        return;
+      }
+
       if(_property.paramId == cfgVisRep.paramId) {
         control->nodes->setVisualRep(0, _property.iValue);
         return;
       }
 
+      if(_property.paramId == cfgRandomSeed.paramId) {
+        cfgRandomSeed.iValue = _property.iValue;
+        random_seed = (unsigned int)_property.iValue;
+        reseedRequested = true;
+        return;
+      }
+
+      if(_property.paramId == cfgStateHashFile.paramId) {
+        cfgStateHashFile.sValue = _property.sValue;
+        // reopens the file
+        deterministicChanged = true;
+        return;
+      }
+
+      if(_property.paramId == cfgDeterministic.paramId) {
+        setDeterministic(_property.bValue);
+        return;
+      }
+
+      if(_property.paramId == cfgProfileSteps.paramId) {
+        setProfileSteps(_property.bValue);
+        return;
+      }
+
+      if(_property.paramId == cfgHashSteps.paramId) {
+        hash_steps = _property.bValue;
+        return;
+      }
+
     }
 
     void Simulator::initCfgParams(void) {
@@ -1336,6 +1652,28 @@ namespace mars {
       cfgCalcMs = control->cfg->getOrCreateProperty("Simulator", "calc_ms",
                                                     calc_ms, this);
       calc_ms = cfgCalcMs.dValue;
+
+      cfgSubsteps = control->cfg->getOrCreateProperty("Simulator", "physics substeps",
+                                                      physics_substeps, this);
+      physics_substeps = std::max(1, cfgSubsteps.iValue);
+
+      cfgSensorThreads = control->cfg->getOrCreateProperty("Simulator", "sensor threads",
+                                                           sensor_threads, this);
+      sensor_threads = std::max(0, cfgSensorThreads.iValue);
+
+      cfgAdaptiveStep = control->cfg->getOrCreateProperty("Simulator", "adaptive step",
+                                                          adaptive_step, this);
+      adaptive_step = cfgAdaptiveStep.bValue;
+
+      cfgAdaptiveMaxSubsteps = control->cfg->getOrCreateProperty("Simulator",
+                                                                 "adaptive max substeps",
+                                                                 adaptive_max_substeps, this);
+      adaptive_max_substeps = cfgAdaptiveMaxSubsteps.iValue;
+
+      cfgAdaptiveMaxDepth = control->cfg->getOrCreateProperty("Simulator",
+                                                              "adaptive max depth",
+                                                              adaptive_max_depth, this);
+      adaptive_max_depth = cfgAdaptiveMaxDepth.dValue;
       cfgFaststep = control->cfg->getOrCreateProperty("Simulator", "faststep",
                                                       false, this);
       cfgRealtime = control->cfg->getOrCreateProperty("Simulator", "realtime calc",
@@ -1369,6 +1707,26 @@ namespace mars {
       cfgWorldCfm = control->cfg->getOrCreateProperty("Simulator", "world cfm",
                                                       1e-10, this);
 
+      cfgAutoDisable = control->cfg->getOrCreateProperty("Simulator",
+                                                         "auto disable",
+                                                         false, this);
+
+      cfgAutoDisableLinear = control->cfg->getOrCreateProperty("Simulator",
+                                                               "auto disable linear threshold",
+                                                               0.01, this);
+
+      cfgAutoDisableAngular = control->cfg->getOrCreateProperty("Simulator",
+                                                                "auto disable angular threshold",
+                                                                0.01, this);
+
+      cfgAutoDisableSteps = control->cfg->getOrCreateProperty("Simulator",
+                                                              "auto disable steps",
+                                                              (int)10, this);
+
+      cfgAutoDisableTime = control->cfg->getOrCreateProperty("Simulator",
+                                                             "auto disable time",
+                                                             0.0, this);
+
       cfgVisRep = control->cfg->getOrCreateProperty("Simulator", "visual rep.",
                                                     (int)1, this);
 
@@ -1377,6 +1735,28 @@ namespace mars {
 
       control->cfg->getOrCreateProperty("Simulator", "onPhysicsError",
                                         "abort", this);
+
+      cfgRandomSeed = control->cfg->getOrCreateProperty("Simulator", "random seed",
+                                                        (int)0, this);
+      random_seed = (unsigned int)cfgRandomSeed.iValue;
+      cfgStateHashFile = control->cfg->getOrCreateProperty("Simulator",
+                                                           "state hash file",
+                                                           std::string(""), this);
+      cfgDeterministic = control->cfg->getOrCreateProperty("Simulator",
+                                                           "deterministic",
+                                                           false, this);
+      // the simulation thread is not running yet
+      deterministicRequest = cfgDeterministic.bValue;
+      applyDeterministic(cfgDeterministic.bValue);
+      cfgProfileSteps = control->cfg->getOrCreateProperty("Simulator",
+                                                          "profile steps",
+                                                          false, this);
+      profileStepsRequest = cfgProfileSteps.bValue;
+      applyProfileSteps(cfgProfileSteps.bValue);
+      cfgHashSteps = control->cfg->getOrCreateProperty("Simulator",
+                                                       "hash every step",
+                                                       true, this);
+      hash_steps = cfgHashSteps.bValue;
       show_time = cfgDebugTime.bValue;
 
     }
@@ -1435,7 +1815,11 @@ namespace mars {
     unsigned long Simulator::getTime() {
       unsigned long returnTime;
       getTimeMutex.lock();
-      if(cfgUseNow.bValue) {
+      if(deterministic) {
+        // no wall clock offset, the time only depends on the steps
+        returnTime = dbSimTimePackage[0].d;
+      }
+      else if(cfgUseNow.bValue) {
         returnTime = realStartTime+dbSimTimePackage[0].d;
       }
       else {
@@ -1451,6 +1835,142 @@ namespace mars {
       return calc_ms;
     }
 
+    unsigned long long Simulator::getRandomSeed(const std::string &stream) const {
+      return RandomStream::deriveSeed(random_seed, stream);
+    }
+
+    void Simulator::setDeterministic(bool value) {
+      deterministicRequest = value;
+      deterministicChanged = true;
+    }
+
+    void Simulator::setProfileSteps(bool value) {
+      profileStepsRequest = value;
+      profileStepsChanged = true;
+    }
+
+    /**
+     * \brief Applies the changes of the cfg callbacks, called at the start
+     * of step() with the physics thread locked.
+     */
+    void Simulator::applyRequests(void) {
+      if(deterministicChanged.exchange(false)) {
+        applyDeterministic(deterministicRequest);
+      }
+      if(profileStepsChanged.exchange(false)) {
+        applyProfileSteps(profileStepsRequest);
+      }
+      if(reseedRequested.exchange(false) && deterministic) {
+        seedRandomStreams();
+      }
+      // legacy users of rand(), e.g. utils::random_number(), draw from a
+      // sequence that only depends on the seed and the step
+      if(deterministic) srand((unsigned int)randStream.next());
+    }
+
+    void Simulator::applyDeterministic(bool value) {
+      deterministic = value;
+      state_hash = 0;
+      if(stateHashFile) {
+        fclose(stateHashFile);
+        stateHashFile = NULL;
+      }
+      if(deterministic) {
+        if(!cfgStateHashFile.sValue.empty()) {
+          stateHashFile = fopen(cfgStateHashFile.sValue.c_str(), "w");
+          if(!stateHashFile) {
+            LOG_ERROR("Simulator: could not open state hash file \"%s\"",
+                      cfgStateHashFile.sValue.c_str());
+          }
+        }
+        if(control->dataBroker && !dbStateHashId) {
+          dbStateHashId = control->dataBroker->pushData("mars_sim", "stateHash",
+                                                        dbStateHashPackage,
+                                                        NULL,
+                                                        data_broker::DATA_PACKAGE_READ_FLAG);
+        }
+        plugin_order_changed = true;
+        seedRandomStreams();
+      }
+    }
+
+    void Simulator::seedRandomStreams(void) {
+      randStream.setSeed(getRandomSeed("rand"));
+      if(physics) physics->setRandomSeed((unsigned long)getRandomSeed("physics"));
+    }
+
+    /**
+     * \brief Brings the plugins that are updated by the simulation into the
+     * order they were added, independent of when they switched their mode.
+     */
+    void Simulator::sortActivePlugins(void) {
+      std::vector<pluginStruct> sorted;
+      pluginLocker.lockForWrite();
+      for(unsigned int i=0; i<allPlugins.size(); i++) {
+        for(unsigned int k=0; k<activePlugins.size(); k++) {
+          if(activePlugins[k].p_interface == allPlugins[i].p_interface) {
+            sorted.push_back(activePlugins[k]);
+            break;
+          }
+        }
+      }
+      activePlugins.swap(sorted);
+      plugin_order_changed = false;
+      pluginLocker.unlock();
+    }
+
+    /**
+     * \brief Hashes the simulation time and the body and motor states, the
+     * same data restoreCheckpoint() would set.
+     */
+    void Simulator::updateStateHash(void) {
+      double simTime;
+      stateCheckpoint.clear();
+      getTimeMutex.lock();
+      simTime = dbSimTimePackage[0].d;
+      getTimeMutex.unlock();
+      stateCheckpoint.write(simTime);
+      control->nodes->saveState(&stateCheckpoint);
+      control->motors->saveState(&stateCheckpoint);
+      state_hash = stateCheckpoint.hash();
+
+      if(control->dataBroker && dbStateHashId) {
+        dbStateHashPackage[0].set((unsigned long)state_hash);
+        control->dataBroker->pushData(dbStateHashId, dbStateHashPackage);
+      }
+      if(stateHashFile) {
+        fprintf(stateHashFile, "%.3f %016llx\n", simTime, state_hash);
+      }
+    }
+
+    void Simulator::applyProfileSteps(bool value) {
+      profile_steps = value;
+      if(profile_steps && control->dataBroker && !dbStepTimesId) {
+        dbStepTimesId = control->dataBroker->pushData("mars_sim", "stepTimes",
+                                                      dbStepTimesPackage,
+                                                      NULL,
+                                                      data_broker::DATA_PACKAGE_READ_FLAG);
+      }
+    }
+
+    /**
+     * \brief Stores the time since the end of the last phase as the time of
+     * \c phase. PHASE_TOTAL stores the time of the whole step and publishes
+     * the package.
+     */
+    void Simulator::profilePhase(StepPhase phase) {
+      long long now = utils::getTimeMicro();
+      if(phase == PHASE_TOTAL) {
+        dbStepTimesPackage[PHASE_TOTAL].d = (now - profileStepStart)*0.001;
+        if(control->dataBroker && dbStepTimesId) {
+          control->dataBroker->pushData(dbStepTimesId, dbStepTimesPackage);
+        }
+        return;
+      }
+      dbStepTimesPackage[phase].d = (now - profilePhaseStart)*0.001;
+      profilePhaseStart = now;
+    }
+
   } // end of namespace sim
 
   namespace interfaces {
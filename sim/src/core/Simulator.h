@@ -39,6 +39,7 @@
 #include <mars/utils/Mutex.h>
 #include <mars/utils/WaitCondition.h>
 #include <mars/utils/ReadWriteLock.h>
+#include <mars/utils/RandomStream.h>
 #include <mars/interfaces/sim/SimulatorInterface.h>
 #include <mars/interfaces/sim/PhysicsInterface.h>
 #include <mars/interfaces/sim/PluginInterface.h>
@@ -46,6 +47,9 @@
 #include <mars/interfaces/graphics/GraphicsUpdateInterface.h>
 
 #include <iostream>
+#include <ctime>
+#include <cstdio>
+#include <atomic>
 
 
 namespace mars {
@@ -80,6 +84,7 @@ namespace mars {
 
       Simulator(lib_manager::LibManager *theManager); ///< Constructor of the \c class Simulator.
       virtual ~Simulator();
+      /// the last created Simulator that still exists
       static Simulator *activeSimulator;
 
 
@@ -126,6 +131,8 @@ namespace mars {
       }
 
       virtual void resetSim(bool resetGraphics=true);
+      virtual void saveCheckpoint(interfaces::Checkpoint *checkpoint);
+      virtual bool restoreCheckpoint(interfaces::Checkpoint *checkpoint);
       virtual bool isSimRunning() const;
       bool startStopTrigger(); ///< Starts and pauses the simulation.
       virtual void singleStep(void);
@@ -222,6 +229,13 @@ namespace mars {
       virtual unsigned long getTime();
 
       virtual double getCalcMs();
+      virtual bool isDeterministic() const {
+        return deterministic;
+      }
+      virtual unsigned long long getRandomSeed(const std::string &stream) const;
+      virtual unsigned long long getStateHash() const {
+        return state_hash;
+      }
 
     private:
 
@@ -252,6 +266,13 @@ namespace mars {
       interfaces::sReal sync_time;
       bool my_real_time;
       bool fast_step;      
+      // wake-up time of myRealTime(), every instance keeps its own pace
+      bool realTimeNeedsInit;
+#ifdef __linux__
+      struct timespec realTimeWakeup;
+#else
+      long realTimeLast;
+#endif
 
 
       // graphics
@@ -270,6 +291,10 @@ namespace mars {
       utils::Mutex stepping_mutex; ///< Used for preventing active waiting for a single step or start event.
       utils::WaitCondition stepping_wc; ///< Used for preventing active waiting for a single step or start event.
       utils::Mutex getTimeMutex;
+      // all Simulators of the process, to hand the process-wide pointers
+      // of ControlCenter and activeSimulator over to the remaining ones
+      static std::vector<Simulator*> instances;
+      static utils::Mutex instancesMutex;
       int physics_mutex_count;
       double avg_log_time;
       int count;
@@ -278,6 +303,63 @@ namespace mars {
       // physics
       interfaces::PhysicsInterface *physics;
       double calc_ms;
+      /**
+       * The physics is stepped physics_substeps times per calc_ms while
+       * controllers, plugins and the DataBroker run once per calc_ms. In
+       * adaptive mode the number of substeps is raised up to
+       * adaptive_max_substeps on physics errors or deep contacts and
+       * lowered again when the scene is calm.
+       */
+      int physics_substeps;
+      /** threads casting the ray sensors after the physics step */
+      int sensor_threads;
+      bool adaptive_step;
+      int adaptive_max_substeps;
+      interfaces::sReal adaptive_max_depth;
+      int adaptive_calm_steps;
+      bool adaptive_refine;
+      void setPhysicsSubsteps(int substeps);
+      void adaptPhysicsSubsteps(void);
+
+      // deterministic mode, see SimulatorInterface::isDeterministic()
+      bool deterministic;
+      unsigned long long random_seed;
+      unsigned long long state_hash;
+      bool plugin_order_changed;
+      interfaces::Checkpoint stateCheckpoint;
+      FILE *stateHashFile;
+      unsigned long dbStateHashId;
+      data_broker::DataPackage dbStateHashPackage;
+      utils::RandomStream randStream; ///< seeds rand() before every step
+      // the cfg callbacks may be called from within step(), thus they only
+      // store their changes and step() applies them before the next step
+      std::atomic<bool> deterministicRequest, profileStepsRequest;
+      std::atomic<bool> deterministicChanged, profileStepsChanged;
+      std::atomic<bool> reseedRequested;
+      std::atomic<bool> hash_steps;
+      void setDeterministic(bool value);
+      void applyDeterministic(bool value);
+      void applyRequests(void);
+      void seedRandomStreams(void);
+      void sortActivePlugins(void);
+      void updateStateHash(void);
+
+      /**
+       * With "Simulator/profile steps" enabled step() measures the time of
+       * its phases and publishes them in ms as "mars_sim/stepTimes".
+       */
+      enum StepPhase {
+        PHASE_PHYSICS, PHASE_JOINTS, PHASE_MOTORS, PHASE_CONTROLLERS,
+        PHASE_SENSORS, PHASE_DATA_BROKER, PHASE_PLUGINS, PHASE_TOTAL,
+        NUM_STEP_PHASES
+      };
+      bool profile_steps;
+      long long profileStepStart, profilePhaseStart;
+      unsigned long dbStepTimesId;
+      data_broker::DataPackage dbStepTimesPackage;
+      void setProfileSteps(bool value);
+      void applyProfileSteps(bool value);
+      void profilePhase(StepPhase phase);
       int load_option;
       int std_port; ///< Controller port (default value: 1600)
       utils::Vector gravity;
@@ -310,10 +392,19 @@ namespace mars {
       cfg_manager::cfgPropertyStruct cfgSyncGui, cfgDrawContact;
       cfg_manager::cfgPropertyStruct cfgGX, cfgGY, cfgGZ;
       cfg_manager::cfgPropertyStruct cfgWorldErp, cfgWorldCfm;
+      cfg_manager::cfgPropertyStruct cfgAutoDisable, cfgAutoDisableLinear;
+      cfg_manager::cfgPropertyStruct cfgAutoDisableAngular;
+      cfg_manager::cfgPropertyStruct cfgAutoDisableSteps, cfgAutoDisableTime;
+      cfg_manager::cfgPropertyStruct cfgSubsteps, cfgAdaptiveStep;
+      cfg_manager::cfgPropertyStruct cfgSensorThreads;
+      cfg_manager::cfgPropertyStruct cfgAdaptiveMaxSubsteps, cfgAdaptiveMaxDepth;
       cfg_manager::cfgPropertyStruct cfgVisRep;
       cfg_manager::cfgPropertyStruct cfgSyncTime;
       cfg_manager::cfgPropertyStruct configPath;
       cfg_manager::cfgPropertyStruct cfgUseNow;
+      cfg_manager::cfgPropertyStruct cfgDeterministic, cfgRandomSeed;
+      cfg_manager::cfgPropertyStruct cfgStateHashFile, cfgProfileSteps;
+      cfg_manager::cfgPropertyStruct cfgHashSteps;
       
       // data
       data_broker::DataPackage dbPhysicsUpdatePackage;
@@ -29,11 +29,13 @@
  */
 
 #include <mars/utils/MutexLocker.h>
+#include <mars/utils/mathUtils.h>
 
 #include "JointPhysics.h"
 #include "NodePhysics.h"
 
 #include <cstdio>
+#include <cmath>
 
 namespace mars {
   namespace sim {
@@ -54,6 +56,8 @@ namespace mars {
       spring = 0;
       body1 = 0;
       body2 = 0;
+      last_velocity = last_velocity2 = 0;
+      last_force_limit = last_force_limit2 = 0;
     }
 
     /**
@@ -79,7 +83,8 @@ namespace mars {
         // CFM = 1 / (h kp + kd)
         damping = (dReal)jointS->damping_const_constraint_axis1;
         spring = (dReal)jointS->spring_const_constraint_axis1;
-        dReal h = theWorld->getWorldStep();
+        // the constraints are solved on every physics substep
+        dReal h = theWorld->getWorldStep() / theWorld->substeps;
         cfm = damping;
         erp1 = h*(dReal)jointS->spring_const_constraint_axis1
           +(dReal)jointS->damping_const_constraint_axis1;
@@ -202,6 +207,11 @@ namespace mars {
     void JointPhysics::setForceLimit(sReal max_force) {
       MutexLocker locker(&(theWorld->iMutex));
 
+      if(fabs(max_force - last_force_limit) > EPSILON) {
+        last_force_limit = max_force;
+        wakeUpBodies();
+      }
+
       switch(joint_type) {
       case  JOINT_TYPE_HINGE:
         dJointSetHingeParam(jointId, dParamFMax, (dReal)max_force);
@@ -221,6 +231,11 @@ namespace mars {
     void JointPhysics::setForceLimit2(sReal max_force) {
       MutexLocker locker(&(theWorld->iMutex));
 
+      if(fabs(max_force - last_force_limit2) > EPSILON) {
+        last_force_limit2 = max_force;
+        wakeUpBodies();
+      }
+
       switch(joint_type) {
       case  JOINT_TYPE_HINGE:
         break;
@@ -238,6 +253,14 @@ namespace mars {
     void JointPhysics::setVelocity(sReal velocity) {
       MutexLocker locker(&(theWorld->iMutex));
 
+      // motors set the velocity every step; only a commanded motion
+      // wakes up sleeping bodies
+      if(fabs(velocity) > EPSILON ||
+         fabs(velocity - last_velocity) > EPSILON) {
+        wakeUpBodies();
+      }
+      last_velocity = velocity;
+
       switch(joint_type) {
       case  JOINT_TYPE_HINGE:
         dJointSetHingeParam(jointId, dParamVel, (dReal)velocity);
@@ -257,6 +280,12 @@ namespace mars {
     void JointPhysics::setVelocity2(sReal velocity) {
       MutexLocker locker(&(theWorld->iMutex));
 
+      if(fabs(velocity) > EPSILON ||
+         fabs(velocity - last_velocity2) > EPSILON) {
+        wakeUpBodies();
+      }
+      last_velocity2 = velocity;
+
       switch(joint_type) {
       case  JOINT_TYPE_HINGE:
         break;
@@ -892,12 +921,20 @@ namespace mars {
      *
      */
     void JointPhysics::update(void) {
+      MutexLocker locker(&(theWorld->iMutex));
+      calculateAxisTorques();
+    }
+
+    void JointPhysics::calculateAxisTorques(void) {
       const dReal *b1_pos, *b2_pos;
       dReal anchor[4], axis[4], axis2[4];
       int calc1 = 0, calc2 = 0;
       dReal radius, dot, torque;
       dReal v1[3], normal[3], load[3], tmp1[3], axis_force[3];
-      MutexLocker locker(&(theWorld->iMutex));
+
+      // the feedback of joints between sleeping bodies is not updated by
+      // ODE, so we keep the last calculated values
+      if(bodiesSleeping()) return;
 
       switch(joint_type) {
       case  JOINT_TYPE_HINGE:
@@ -1051,6 +1088,81 @@ namespace mars {
       t->z() = joint_load.z();
     }
 
+    void JointPhysics::getFeedback(JointFeedback *feedback) {
+      MutexLocker locker(&(theWorld->iMutex));
+      fillFeedback(feedback);
+    }
+
+    /**
+     * \brief Reads the state of the joint with one switch over the joint
+     * type instead of the single getters which lock the world each.
+     *
+     * The axis torques and the joint load are only calculated if they are
+     * requested.
+     */
+    void JointPhysics::fillFeedback(JointFeedback *fb) {
+      if(fb->flags & JOINT_FEEDBACK_STATE) {
+        dReal pos[4] = {0,0,0,0}, axis[4] = {0,0,0,0}, axis2[4] = {0,0,0,0};
+        fb->position1 = fb->position2 = 0;
+        fb->velocity1 = fb->velocity2 = 0;
+        switch(joint_type) {
+        case  JOINT_TYPE_HINGE:
+          dJointGetHingeAnchor(jointId, pos);
+          dJointGetHingeAxis(jointId, axis);
+          fb->position1 = (sReal)dJointGetHingeAngle(jointId);
+          fb->velocity1 = (sReal)dJointGetHingeAngleRate(jointId);
+          break;
+        case JOINT_TYPE_HINGE2:
+          dJointGetHinge2Anchor(jointId, pos);
+          dJointGetHinge2Axis1(jointId, axis);
+          dJointGetHinge2Axis2(jointId, axis2);
+          fb->position1 = (sReal)dJointGetHinge2Angle1(jointId);
+          fb->velocity1 = (sReal)dJointGetHinge2Angle1Rate(jointId);
+          fb->velocity2 = (sReal)dJointGetHinge2Angle2Rate(jointId);
+          break;
+        case JOINT_TYPE_SLIDER:
+          dJointGetSliderAxis(jointId, axis);
+          fb->position1 = (sReal)dJointGetSliderPosition(jointId);
+          fb->velocity1 = (sReal)dJointGetSliderPositionRate(jointId);
+          break;
+        case JOINT_TYPE_BALL:
+          dJointGetBallAnchor(jointId, pos);
+          break;
+        case JOINT_TYPE_UNIVERSAL:
+          dJointGetUniversalAnchor(jointId, pos);
+          dJointGetUniversalAxis1(jointId, axis);
+          dJointGetUniversalAxis2(jointId, axis2);
+          fb->position1 = (sReal)dJointGetUniversalAngle1(jointId);
+          fb->position2 = (sReal)dJointGetUniversalAngle2(jointId);
+          fb->velocity1 = (sReal)dJointGetUniversalAngle1Rate(jointId);
+          fb->velocity2 = (sReal)dJointGetUniversalAngle2Rate(jointId);
+          break;
+        default:
+          break;
+        }
+        fb->anchor = Vector(pos[0], pos[1], pos[2]);
+        fb->axis1 = Vector(axis[0], axis[1], axis[2]);
+        fb->axis2 = Vector(axis2[0], axis2[1], axis2[2]);
+      }
+      if(fb->flags & JOINT_FEEDBACK_FORCES) {
+        fb->force1 = Vector(feedback.f1[0], feedback.f1[1], feedback.f1[2]);
+        fb->force2 = Vector(feedback.f2[0], feedback.f2[1], feedback.f2[2]);
+        fb->torque1 = Vector(feedback.t1[0], feedback.t1[1], feedback.t1[2]);
+        fb->torque2 = Vector(feedback.t2[0], feedback.t2[1], feedback.t2[2]);
+      }
+      if(fb->flags & (JOINT_FEEDBACK_AXIS_TORQUE | JOINT_FEEDBACK_LOAD)) {
+        calculateAxisTorques();
+        fb->axis1Torque = axis1_torque;
+        fb->axis2Torque = axis2_torque;
+        fb->jointLoad = joint_load;
+        fb->motorTorque = (sReal)motor_torque;
+      }
+      else if(fb->flags & JOINT_FEEDBACK_MOTOR_TORQUE) {
+        if(!bodiesSleeping()) motor_torque = feedback.lambda;
+        fb->motorTorque = (sReal)motor_torque;
+      }
+    }
+
 
     /**
      * \brief Creates a fixed joint in the physical environment. For
@@ -1126,6 +1238,7 @@ namespace mars {
 
     void JointPhysics::setTorque(sReal torque) {
       MutexLocker locker(&(theWorld->iMutex));
+      if(fabs(torque) > EPSILON) wakeUpBodies();
       switch(joint_type) {
       case JOINT_TYPE_HINGE:
         dJointAddHingeTorque(jointId, torque);
@@ -1147,6 +1260,24 @@ namespace mars {
       }
     }
 
+    /**
+     * \brief Enables the attached bodies if they are disabled.
+     *
+     * pre:
+     *     - the world mutex is locked
+     */
+    void JointPhysics::wakeUpBodies(void) {
+      if(body1 && !dBodyIsEnabled(body1)) dBodyEnable(body1);
+      if(body2 && !dBodyIsEnabled(body2)) dBodyEnable(body2);
+    }
+
+    bool JointPhysics::bodiesSleeping(void) const {
+      if(!body1 && !body2) return false;
+      if(body1 && dBodyIsEnabled(body1)) return false;
+      if(body2 && dBodyIsEnabled(body2)) return false;
+      return true;
+    }
+
     void JointPhysics::setTorque2(sReal torque) {
       CPP_UNUSED(torque);
       switch(joint_type) {
@@ -86,6 +86,9 @@ namespace mars {
       virtual void setHighStop(interfaces::sReal highStop);
       virtual void setLowStop2(interfaces::sReal lowStop2);
       virtual void setHighStop2(interfaces::sReal highStop2);
+      virtual void getFeedback(interfaces::JointFeedback *feedback);
+      /// as getFeedback() but the caller has to lock the world
+      void fillFeedback(interfaces::JointFeedback *feedback);
 
     private:
       WorldPhysics* theWorld;
@@ -98,8 +101,15 @@ namespace mars {
       dReal damping, spring;
       utils::Vector axis1_torque, axis2_torque, joint_load;
       dReal motor_torque;
+      dReal last_velocity, last_velocity2;
+      dReal last_force_limit, last_force_limit2;
 
       void calculateCfmErp(const interfaces::JointData *jointS);
+      ///enables attached bodies that are disabled by ODE's auto disable
+      void wakeUpBodies(void);
+      bool bodiesSleeping(void) const;
+      ///calculates the axis torques and joint load, the world has to be locked
+      void calculateAxisTorques(void);
 
       ///create a joint from type Hing
       void createHinge(interfaces::JointData* jointS,
@@ -96,6 +96,7 @@ namespace mars {
     NodePhysics::~NodePhysics(void) {
       std::vector<sensor_list_element>::iterator iter;
       MutexLocker locker(&(theWorld->iMutex));
+      theWorld->waitForSensors();
 
       if(nBody) theWorld->destroyBody(nBody, this);
 
@@ -114,6 +115,7 @@ namespace mars {
         dGeomDestroy((*iter).geom);
         sensor_list.erase(iter);
       }
+      theWorld->removeSensorNode(this);
       if(myTriMeshData) dGeomTriMeshDataDestroy(myTriMeshData);
     }
 
@@ -144,6 +146,7 @@ namespace mars {
               node->mass, node->density);
 #endif
       MutexLocker locker(&(theWorld->iMutex));
+      theWorld->waitForSensors();
       if(theWorld && theWorld->existsWorld()) {
         bool ret;
        // LOG_DEBUG("physicMode %d", node->physicMode);
@@ -182,7 +185,10 @@ namespace mars {
 
         // then, if the geometry was sucsessfully build, we can create a
         // body for the node or add the node to an existing body
-        if(node->movable) setProperties(node);
+        if(node->movable) {
+          setProperties(node);
+          setAutoDisable(node);
+        }
         else if(node->physicMode != NODE_TYPE_PLANE) {
           dQuaternion tmp, t1, t2;
           tmp[1] = (dReal)node->rot.x();
@@ -277,7 +283,10 @@ namespace mars {
       dReal npos[3];
       Vector offset;
       MutexLocker locker(&(theWorld->iMutex));
+      theWorld->waitForSensors();
 
+      // a moved body has to be simulated again
+      enableBody();
       if(composite) {
         if(move_group) {
           /*
@@ -515,7 +524,9 @@ namespace mars {
       dMatrix3 R;
       dVector3 pos, new_pos, new2_pos;
       MutexLocker locker(&(theWorld->iMutex));
+      theWorld->waitForSensors();
 
+      enableBody();
       pos[0] = pos[1] = pos[2] = 0;
       tmp[1] = (dReal)q.x();
       tmp[2] = (dReal)q.y();
@@ -894,6 +905,47 @@ namespace mars {
 #endif
     }
 
+    /**
+     * \brief Sets the auto disable (sleeping) parameters of the body.
+     *
+     * The world parameters are used by default. They can be overridden per
+     * node by the keys "autoDisable", "autoDisableLinearThreshold",
+     * "autoDisableAngularThreshold", "autoDisableSteps" and
+     * "autoDisableTime" in the node's config map.
+     *
+     * pre:
+     *     - the body is created and the world mutex is locked
+     */
+    void NodePhysics::setAutoDisable(NodeData* node) {
+      if(!nBody) return;
+      bool flag = theWorld->auto_disable;
+      dReal linear = theWorld->auto_disable_linear_threshold;
+      dReal angular = theWorld->auto_disable_angular_threshold;
+      int steps = theWorld->auto_disable_steps;
+      dReal time = theWorld->auto_disable_time;
+
+      if(node->map.find("autoDisable") != node->map.end()) {
+        flag = node->map["autoDisable"];
+      }
+      if(node->map.find("autoDisableLinearThreshold") != node->map.end()) {
+        linear = (double)node->map["autoDisableLinearThreshold"];
+      }
+      if(node->map.find("autoDisableAngularThreshold") != node->map.end()) {
+        angular = (double)node->map["autoDisableAngularThreshold"];
+      }
+      if(node->map.find("autoDisableSteps") != node->map.end()) {
+        steps = node->map["autoDisableSteps"];
+      }
+      if(node->map.find("autoDisableTime") != node->map.end()) {
+        time = (double)node->map["autoDisableTime"];
+      }
+      dBodySetAutoDisableFlag(nBody, flag);
+      dBodySetAutoDisableLinearThreshold(nBody, linear);
+      dBodySetAutoDisableAngularThreshold(nBody, angular);
+      dBodySetAutoDisableSteps(nBody, steps);
+      dBodySetAutoDisableTime(nBody, time);
+    }
+
     /**
      * \brief executes an rotation at a given point and returns the
      * new position of the node
@@ -911,7 +963,9 @@ namespace mars {
       Vector npos;
       dMatrix3 R;
       MutexLocker locker(&(theWorld->iMutex));
+      theWorld->waitForSensors();
   
+      enableBody();
       tmp[1] = (dReal)rotation.x();
       tmp[2] = (dReal)rotation.y();
       tmp[3] = (dReal)rotation.z();
@@ -1009,6 +1063,7 @@ namespace mars {
               node->mass, node->density);
 #endif
       MutexLocker locker(&(theWorld->iMutex));
+      theWorld->waitForSensors();
 
       if(nGeom && theWorld && theWorld->existsWorld()) {
         if(composite) {
@@ -1097,8 +1152,11 @@ namespace mars {
      */
     void NodePhysics::setLinearVelocity(const Vector &velocity) {
       MutexLocker locker(&(theWorld->iMutex));
-      if(nBody) dBodySetLinearVel(nBody, (dReal)velocity.x(),
-                                  (dReal)velocity.y(), (dReal)velocity.z());
+      if(nBody) {
+        if(velocity.squaredNorm() > 0) enableBody();
+        dBodySetLinearVel(nBody, (dReal)velocity.x(),
+                          (dReal)velocity.y(), (dReal)velocity.z());
+      }
     }
 
     /**
@@ -1112,8 +1170,11 @@ namespace mars {
      */
     void NodePhysics::setAngularVelocity(const Vector &velocity) {
       MutexLocker locker(&(theWorld->iMutex));
-      if(nBody) dBodySetAngularVel(nBody, (dReal)velocity.x(),
-                                   (dReal)velocity.y(), (dReal)velocity.z());
+      if(nBody) {
+        if(velocity.squaredNorm() > 0) enableBody();
+        dBodySetAngularVel(nBody, (dReal)velocity.x(),
+                           (dReal)velocity.y(), (dReal)velocity.z());
+      }
     }
 
     /**
@@ -1127,8 +1188,11 @@ namespace mars {
      */
     void NodePhysics::setForce(const Vector &f) {
       MutexLocker locker(&(theWorld->iMutex));
-      if(nBody) dBodySetForce(nBody, (dReal)f.x(),
-                              (dReal)f.y(), (dReal)f.z());
+      if(nBody) {
+        if(f.squaredNorm() > 0) enableBody();
+        dBodySetForce(nBody, (dReal)f.x(),
+                      (dReal)f.y(), (dReal)f.z());
+      }
     }
 
     /**
@@ -1142,8 +1206,11 @@ namespace mars {
      */
     void NodePhysics::setTorque(const Vector &t) {
       MutexLocker locker(&(theWorld->iMutex));
-      if(nBody) dBodySetTorque(nBody, (dReal)t.x(),
-                               (dReal)t.y(), (dReal)t.z());
+      if(nBody) {
+        if(t.squaredNorm() > 0) enableBody();
+        dBodySetTorque(nBody, (dReal)t.x(),
+                       (dReal)t.y(), (dReal)t.z());
+      }
     }
 
     /**
@@ -1158,6 +1225,7 @@ namespace mars {
     void NodePhysics::addForce(const Vector &f, const Vector &p) {
       MutexLocker locker(&(theWorld->iMutex));
       if(nBody) {
+        if(f.squaredNorm() > 0) enableBody();
         dBodyAddForceAtPos(nBody, 
                            (dReal)f.x(), (dReal)f.y(), (dReal)f.z(),
                            (dReal)p.x(), (dReal)p.y(), (dReal)p.z());
@@ -1175,6 +1243,7 @@ namespace mars {
     void NodePhysics::addForce(const Vector &f) {
       MutexLocker locker(&(theWorld->iMutex));
       if(nBody) {
+        if(f.squaredNorm() > 0) enableBody();
         dBodyAddForce(nBody, (dReal)f.x(), (dReal)f.y(), (dReal)f.z());
       }
     }
@@ -1190,7 +1259,89 @@ namespace mars {
      */
     void NodePhysics::addTorque(const Vector &t) {
       MutexLocker locker(&(theWorld->iMutex));
-      if(nBody) dBodyAddTorque(nBody, (dReal)t.x(), (dReal)t.y(), (dReal)t.z());
+      if(nBody) {
+        if(t.squaredNorm() > 0) enableBody();
+        dBodyAddTorque(nBody, (dReal)t.x(), (dReal)t.y(), (dReal)t.z());
+      }
+    }
+
+    /**
+     * \brief Returns true if the body of the node is auto disabled
+     */
+    bool NodePhysics::isSleeping(void) const {
+      MutexLocker locker(&(theWorld->iMutex));
+      return nBody && !dBodyIsEnabled(nBody);
+    }
+
+    /**
+     * \brief Enables the body of the node if it was auto disabled
+     */
+    void NodePhysics::wakeUp(void) {
+      MutexLocker locker(&(theWorld->iMutex));
+      enableBody();
+    }
+
+    /**
+     * \brief Writes the pose, the velocities and the enabled state of the
+     * body. The ODE objects are not touched.
+     */
+    void NodePhysics::saveState(Checkpoint *checkpoint) const {
+      MutexLocker locker(&(theWorld->iMutex));
+      const dReal *v;
+      int i;
+
+      checkpoint->write(nBody != 0);
+      if(!nBody) return;
+      v = dBodyGetPosition(nBody);
+      for(i=0; i<3; ++i) checkpoint->write(v[i]);
+      v = dBodyGetQuaternion(nBody);
+      for(i=0; i<4; ++i) checkpoint->write(v[i]);
+      v = dBodyGetLinearVel(nBody);
+      for(i=0; i<3; ++i) checkpoint->write(v[i]);
+      v = dBodyGetAngularVel(nBody);
+      for(i=0; i<3; ++i) checkpoint->write(v[i]);
+      checkpoint->write(dBodyIsEnabled(nBody));
+    }
+
+    /**
+     * \brief Restores a state written by saveState in place.
+     * \return \c false if the checkpoint does not fit this node
+     */
+    bool NodePhysics::restoreState(Checkpoint *checkpoint) {
+      MutexLocker locker(&(theWorld->iMutex));
+      theWorld->waitForSensors();
+      bool hasBody = false;
+      dReal pos[3], q[4], lvel[3], avel[3];
+      int enabled = 0, i;
+
+      if(!checkpoint->read(&hasBody) || hasBody != (nBody != 0)) return false;
+      if(!nBody) return true;
+      for(i=0; i<3; ++i) checkpoint->read(&pos[i]);
+      for(i=0; i<4; ++i) checkpoint->read(&q[i]);
+      for(i=0; i<3; ++i) checkpoint->read(&lvel[i]);
+      for(i=0; i<3; ++i) checkpoint->read(&avel[i]);
+      checkpoint->read(&enabled);
+      if(checkpoint->hasFailed()) return false;
+
+      dBodySetPosition(nBody, pos[0], pos[1], pos[2]);
+      dBodySetQuaternion(nBody, q);
+      dBodySetLinearVel(nBody, lvel[0], lvel[1], lvel[2]);
+      dBodySetAngularVel(nBody, avel[0], avel[1], avel[2]);
+      dBodySetForce(nBody, 0, 0, 0);
+      dBodySetTorque(nBody, 0, 0, 0);
+      if(enabled) enableBody();
+      else dBodyDisable(nBody);
+      return true;
+    }
+
+    /**
+     * \brief Enables a disabled body, the world mutex has to be locked
+     *
+     * dBodyEnable resets the auto disable counters, thus it is only
+     * called for bodies that are really disabled.
+     */
+    void NodePhysics::enableBody(void) {
+      if(nBody && !dBodyIsEnabled(nBody)) dBodyEnable(nBody);
     }
 
     bool NodePhysics::getGroundContact(void) const {
@@ -1221,47 +1372,17 @@ namespace mars {
 
 
     sReal NodePhysics::getGroundContactForce(void) const {
-      std::vector<dJointFeedback*>::const_iterator iter;
-      dReal force[3] = {0,0,0};
-
-      if(nGeom) {
-        for(iter = node_data.ground_feedbacks.begin();
-            iter != node_data.ground_feedbacks.end(); iter++) {
-          if(node_data.node1) {
-            force[0] += (*iter)->f1[0];
-            force[1] += (*iter)->f1[1];
-            force[2] += (*iter)->f1[2];
-          }
-          else {
-            force[0] += (*iter)->f2[0];
-            force[1] += (*iter)->f2[1];
-            force[2] += (*iter)->f2[2];
-          }
-        }
-      }
-      return dLENGTH(force);
+      return getContactForce().norm();
     }
 
     const Vector NodePhysics::getContactForce(void) const {
-      std::vector<dJointFeedback*>::const_iterator iter;
-      dReal force[3] = {0,0,0};
-
       if(nGeom) {
-        for(iter = node_data.ground_feedbacks.begin();
-            iter != node_data.ground_feedbacks.end(); iter++) {
-          if(node_data.node1) {
-            force[0] += (*iter)->f1[0];
-            force[1] += (*iter)->f1[1];
-            force[2] += (*iter)->f1[2];
-          }
-          else {
-            force[0] += (*iter)->f2[0];
-            force[1] += (*iter)->f2[1];
-            force[2] += (*iter)->f2[2];
-          }
+        if(nBody && !dBodyIsEnabled(nBody)) {
+          return node_data.sleep_contact_force;
         }
+        return node_data.getFeedbackForce();
       }
-      return Vector(force[0], force[1], force[2]);
+      return Vector(0.0, 0.0, 0.0);
     }
 
     void NodePhysics::addCompositeOffset(dReal x, dReal y, dReal z) {
@@ -1474,8 +1595,10 @@ namespace mars {
       
             gd->ray_sensor = 1;
             gd->parent_geom = nGeom;
-            sle.geom = dCreateRay(theWorld->getSpace(),
-                                  polarGridSensor->maxDistance);
+            gd->parent_body = nBody;
+            // the rays are cast by the sensor workers, thus they must not
+            // be part of the world space
+            sle.geom = dCreateRay(NULL, polarGridSensor->maxDistance);
             dGeomSetCollideBits(sle.geom, 32768);
             dGeomSetCategoryBits(sle.geom, 32768);
         
@@ -1514,10 +1637,12 @@ namespace mars {
           }
         }
       }
+      if(!sensor_list.empty()) theWorld->addSensorNode(this);
     }
 
     void NodePhysics::removeSensor(BaseSensor *sensor) {
       MutexLocker locker(&(theWorld->iMutex));
+      theWorld->waitForSensors();
       std::vector<sensor_list_element>::iterator iter;
       for (iter = sensor_list.begin(); iter != sensor_list.end(); ) {
         if (iter->sensor == sensor) {
@@ -1527,134 +1652,109 @@ namespace mars {
         } else
           ++iter;
       }
+      if(sensor_list.empty()) theWorld->removeSensorNode(this);
     }
 
     /**
-     * \brief This function copies all sensor values to the specific allocated
-     *  memory
-     *
-     * pre:
+     * \brief Sets the update time of the rays of \c sensor such that they
+     * are cast next in the step that ends in \c delay ms.
      *
-     * post:
+     * The SensorManager passes the time until the next call of the timed
+     * receiver of the sensor, thus the rays are cast in the step the sensor
+     * reads them.
      */
-    void NodePhysics::handleSensorData(bool physics_thread) {
-      if(!physics_thread) return;
+    void NodePhysics::delaySensorUpdate(BaseSensor *sensor, sReal delay) {
       MutexLocker locker(&(theWorld->iMutex));
+      theWorld->waitForSensors();
+      std::vector<sensor_list_element>::iterator iter;
+      for(iter = sensor_list.begin(); iter != sensor_list.end(); ++iter) {
+        if(iter->sensor == sensor) {
+          iter->updateTime = 0.001*(sensor->updateRate - delay);
+        }
+      }
+    }
+
+    /**
+     * \brief Appends the rays of the sensors that are due in this step to
+     * \c rays.
+     *
+     * The rays are placed with the pose of the node after the step and the
+     * rotating ray sensors are turned. The update times are compared with
+     * a tolerance of half a step, the sum of the step sizes must not miss
+     * the step of the timed receiver of the sensor by rounding. The world
+     * has to be locked.
+     */
+    void NodePhysics::getSensorRays(std::vector<sensor_ray> *rays) {
       std::vector<sensor_list_element>::iterator iter;
+      if(!nGeom) return;
       const dReal* pos = dGeomGetPosition(nGeom);
       const dReal* rot = dGeomGetRotation(nGeom);
-      dVector3 dest, tmp, posOffset;
-      dReal steps_size = 1.0, length = 0.0;
-      bool done = false;
-      int steps = 0;
+      dVector3 tmp, posOffset;
       dReal worldStep = theWorld->getWorldStep();
+      sensor_ray ray;
       // RotatingRaySensor
       utils::Vector tmpV;
       utils::Quaternion turnrotation;
       turnrotation.setIdentity();
       std::set<unsigned long> ids_rotating_ray_sensors;
 
-      //New Code
-      int i=0;
       for(iter = sensor_list.begin(); iter != sensor_list.end(); iter++) {
-        i+=1;
         if((double)iter->sensor->updateRate * 0.001 > worldStep) {
           iter->updateTime += worldStep;
-          if(iter->updateTime < 0.001*iter->sensor->updateRate) continue;
+          if(iter->updateTime < 0.001*iter->sensor->updateRate - 0.5*worldStep) {
+            continue;
+          }
           iter->updateTime -= 0.001*iter->sensor->updateRate;
         }
-        BasePolarIntersectionSensor *polarSensor = dynamic_cast<BasePolarIntersectionSensor*>((*iter).sensor);
-        if(polarSensor){
-          sensor_list_element elem = *iter;
-
-          tmpV[0] = elem.ray_direction.x();
-          tmpV[1] = elem.ray_direction.y();
-          tmpV[2] = elem.ray_direction.z();
-          
-          // Applies orientation_offset (z-Rotation) to the laser rays.
-          mars::sim::RotatingRaySensor *rotRaySensor = dynamic_cast<RotatingRaySensor*>((*iter).sensor);
-          if(rotRaySensor){
-              std::set<unsigned long>::iterator it = ids_rotating_ray_sensors.find(rotRaySensor->id);
-              // Takes care that each rotating ray sensor is only turned once (sensor_list contains each ray independently).
-              if(it == ids_rotating_ray_sensors.end()) {
-                  //turnrotation.setIdentity(); // If we set it to identity first, receiveSensorData will not be called anymore.. wtf!?
-                  turnrotation = rotRaySensor->turn();
-                  ids_rotating_ray_sensors.insert(rotRaySensor->id);
-              }
-              //fprintf(stderr, "tmp[%i]: %f, %f, %f\n", i, tmpV.x(), tmpV.y(), tmpV.z());
-              tmpV = turnrotation * tmpV;
-              //fprintf(stderr, "tmp[%i]: %f, %f, %f\n", i, tmpV.x(), tmpV.y(), tmpV.z());
-          }
-          tmp[0] = tmpV.x();//elem.ray_direction.x();
-          tmp[1] = tmpV.y();//elem.ray_direction.y();
-          tmp[2] = tmpV.z();//elem.ray_direction.z();
-          dMULTIPLY0_331(dest, rot, tmp);
-
-          if(physics_thread) {
-            steps = 0;
-            length = 0.0;
-            done = false;
-            dGeomEnable(elem.geom);
-            // make here the collision check
-            while (!done) {
-              dGeomRaySet(elem.geom,
-                          pos[0] + dest[0]*steps_size*steps,
-                          pos[1] + dest[1]*steps_size*steps,
-                          pos[2] + dest[2]*steps_size*steps,
-                          dest[0], dest[1], dest[2]);
-              if(length + steps_size < polarSensor->maxDistance) {
-                steps++;
-                dGeomRaySetLength(elem.geom, steps_size);
-              }
-              else {
-                dGeomRaySetLength(elem.geom, polarSensor->maxDistance- length);
-                done = true;
-              }
-              if(theWorld->handleCollision(elem.geom)) {
-                elem.gd->value += length;
-                done = true;
-              }
-              if(!done) length = steps_size*steps;
+        ray.sensor = iter->sensor;
+        ray.geom = iter->geom;
+        ray.parent_geom = iter->gd->parent_geom;
+        ray.parent_body = iter->gd->parent_body;
+
+        BasePolarIntersectionSensor *polarSensor = dynamic_cast<BasePolarIntersectionSensor*>(iter->sensor);
+        if(polarSensor) {
+          tmpV = iter->ray_direction;
+          RotatingRaySensor *rotRaySensor = dynamic_cast<RotatingRaySensor*>(iter->sensor);
+          if(rotRaySensor) {
+            // each rotating ray sensor is only turned once
+            if(ids_rotating_ray_sensors.insert(rotRaySensor->id).second) {
+              turnrotation = rotRaySensor->turn();
             }
-            dGeomDisable(elem.geom);
+            tmpV = turnrotation * tmpV;
           }
-          (*polarSensor)[elem.index] = elem.gd->value;
-          elem.gd->value = polarSensor->maxDistance;
+          tmp[0] = tmpV.x();
+          tmp[1] = tmpV.y();
+          tmp[2] = tmpV.z();
+          dMULTIPLY0_331(ray.dir, rot, tmp);
+          ray.pos[0] = pos[0];
+          ray.pos[1] = pos[1];
+          ray.pos[2] = pos[2];
+          ray.max_distance = polarSensor->maxDistance;
+          ray.value = &(*polarSensor)[iter->index];
+          ray.stepped = true;
+          rays->push_back(ray);
         }
-    
+
         BaseGridIntersectionSensor *polarGridSensor;
         polarGridSensor = dynamic_cast<BaseGridIntersectionSensor*>(iter->sensor);
-
         if(polarGridSensor) {
-          sensor_list_element elem = *iter;
-
-          if(physics_thread) {
-        
-            tmp[0] = elem.ray_direction.x();
-            tmp[1] = elem.ray_direction.y();
-            tmp[2] = elem.ray_direction.z();
-            dMULTIPLY0_331(dest, rot, tmp);
-
-            tmp[0] = elem.ray_pos_offset.x();
-            tmp[1] = elem.ray_pos_offset.y();
-            tmp[2] = elem.ray_pos_offset.z();
-            dMULTIPLY0_331(posOffset, rot, tmp);
-
-            dGeomEnable(elem.geom);
-
-            dGeomRaySet(elem.geom, pos[0] + posOffset[0],
-                        pos[1] + posOffset[1],
-                        pos[2] + posOffset[2],
-                        dest[0], dest[1], dest[2]);
-
-            dGeomRaySetLength(elem.geom, polarGridSensor->maxDistance);
-            theWorld->handleCollision(elem.geom);
-            dGeomDisable(elem.geom);        
-          }
-          (*polarGridSensor)[elem.index] = elem.gd->value;
-          elem.gd->value = polarGridSensor->maxDistance;      
+          tmp[0] = iter->ray_direction.x();
+          tmp[1] = iter->ray_direction.y();
+          tmp[2] = iter->ray_direction.z();
+          dMULTIPLY0_331(ray.dir, rot, tmp);
+          tmp[0] = iter->ray_pos_offset.x();
+          tmp[1] = iter->ray_pos_offset.y();
+          tmp[2] = iter->ray_pos_offset.z();
+          dMULTIPLY0_331(posOffset, rot, tmp);
+          ray.pos[0] = pos[0] + posOffset[0];
+          ray.pos[1] = pos[1] + posOffset[1];
+          ray.pos[2] = pos[2] + posOffset[2];
+          ray.max_distance = polarGridSensor->maxDistance;
+          ray.value = &(*polarGridSensor)[iter->index];
+          ray.stepped = false;
+          rays->push_back(ray);
         }
-      } // end for loop.
+      }
     }
 
     /**
@@ -1666,6 +1766,7 @@ namespace mars {
      */
     void NodePhysics::destroyNode(void) {
       MutexLocker locker(&(theWorld->iMutex));
+      theWorld->waitForSensors();
       if(nBody) theWorld->destroyBody(nBody, this);
 
       if(nGeom) dGeomDestroy(nGeom);
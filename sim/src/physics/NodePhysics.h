@@ -54,9 +54,26 @@ namespace mars {
         ray_sensor = 0;
         sense_contact_force = 1;
         value = 0;
+        sleep_contact_force = utils::Vector(0.0, 0.0, 0.0);
         c_params.setZero();
       }
 
+      /** returns the sum of the forces in the ground_feedbacks */
+      utils::Vector getFeedbackForce() const {
+        std::vector<dJointFeedback*>::const_iterator iter;
+        utils::Vector force(0.0, 0.0, 0.0);
+        for(iter = ground_feedbacks.begin();
+            iter != ground_feedbacks.end(); iter++) {
+          if(node1) {
+            force += utils::Vector((*iter)->f1[0], (*iter)->f1[1], (*iter)->f1[2]);
+          }
+          else {
+            force += utils::Vector((*iter)->f2[0], (*iter)->f2[1], (*iter)->f2[2]);
+          }
+        }
+        return force;
+      }
+
       geom_data(){
         setZero();
       }
@@ -65,6 +82,8 @@ namespace mars {
       std::vector<utils::Vector> contact_points;
       std::list<unsigned long> contact_ids;
       std::vector<dJointFeedback*> ground_feedbacks;
+      // contact force of the last step before the body fell asleep
+      utils::Vector sleep_contact_force;
       bool node1;
       interfaces::contact_params c_params;
       bool ray_sensor;
@@ -120,11 +139,17 @@ namespace mars {
       virtual void setContactParams(interfaces::contact_params &c_params);
       virtual void addSensor(interfaces::BaseSensor *sensor);
       virtual void removeSensor(interfaces::BaseSensor *sensor);
-      virtual void handleSensorData(bool physics_thread = true);
+      virtual void delaySensorUpdate(interfaces::BaseSensor *sensor,
+                                     interfaces::sReal delay);
+      void getSensorRays(std::vector<sensor_ray> *rays);
       virtual void destroyNode(void);
       virtual void getMass(interfaces::sReal *mass, interfaces::sReal *inertia=0) const;
       virtual const utils::Vector getContactForce(void) const;
       virtual interfaces::sReal getCollisionDepth(void) const;
+      virtual bool isSleeping(void) const;
+      virtual void wakeUp(void);
+      virtual void saveState(interfaces::Checkpoint *checkpoint) const;
+      virtual bool restoreState(interfaces::Checkpoint *checkpoint);
       void addCompositeOffset(dReal x, dReal y, dReal z);
       ///return the body; this function is created to make it possible to get the 
       ///body from joint physics s
@@ -156,6 +181,8 @@ namespace mars {
       bool createHeightfield(interfaces::NodeData *node);
       void setProperties(interfaces::NodeData *node);
       void setInertiaMass(interfaces::NodeData *node);
+      void setAutoDisable(interfaces::NodeData *node);
+      void enableBody(void);
     };
 
   } // end of namespace sim
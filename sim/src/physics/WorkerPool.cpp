@@ -0,0 +1,99 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "WorkerPool.h"
+
+namespace mars {
+  namespace sim {
+
+    using namespace utils;
+
+    WorkerPool::WorkerPool(unsigned int numThreads)
+      : job(NULL), context(NULL), count(0), next(0), done(0), stop(false) {
+      for(unsigned int i=0; i<numThreads; ++i) {
+        workers.push_back(new Worker(this));
+        workers.back()->start();
+      }
+    }
+
+    WorkerPool::~WorkerPool() {
+      mutex.lock();
+      waitLocked();
+      stop = true;
+      workAvailable.wakeAll();
+      mutex.unlock();
+      for(size_t i=0; i<workers.size(); ++i) {
+        workers[i]->wait();
+        delete workers[i];
+      }
+    }
+
+    void WorkerPool::start(Job job, void *context, size_t count) {
+      mutex.lock();
+      waitLocked();
+      this->job = job;
+      this->context = context;
+      this->count = count;
+      next = done = 0;
+      workAvailable.wakeAll();
+      mutex.unlock();
+    }
+
+    void WorkerPool::wait() {
+      mutex.lock();
+      waitLocked();
+      mutex.unlock();
+    }
+
+    bool WorkerPool::isBusy() {
+      mutex.lock();
+      bool busy = done < count;
+      mutex.unlock();
+      return busy;
+    }
+
+    void WorkerPool::work() {
+      while(next < count) {
+        size_t index = next++;
+        mutex.unlock();
+        job(context, index);
+        mutex.lock();
+        if(++done == count) workDone.wakeAll();
+      }
+    }
+
+    void WorkerPool::waitLocked() {
+      work();
+      while(done < count) {
+        workDone.wait(&mutex);
+      }
+    }
+
+    void WorkerPool::Worker::run() {
+      pool->mutex.lock();
+      while(!pool->stop) {
+        pool->work();
+        if(!pool->stop) pool->workAvailable.wait(&pool->mutex);
+      }
+      pool->mutex.unlock();
+    }
+
+  } // end of namespace sim
+} // end of namespace mars
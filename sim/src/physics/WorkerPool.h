@@ -0,0 +1,93 @@
+/*
+ *  Copyright 2011, 2012, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file WorkerPool.h
+ * \brief A fixed number of threads that process the items of one batch.
+ */
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#ifdef _PRINT_HEADER_
+  #warning "WorkerPool.h"
+#endif
+
+#include <mars/utils/Thread.h>
+#include <mars/utils/Mutex.h>
+#include <mars/utils/WaitCondition.h>
+
+#include <vector>
+#include <cstddef>
+
+namespace mars {
+  namespace sim {
+
+    /**
+     * \brief Runs \c job(context, i) for all items \c i of a batch on
+     * worker threads.
+     *
+     * start() returns immediately, thus the calling thread can do other
+     * work while the batch is processed. wait() lets the calling thread
+     * help with the remaining items and returns when all are done; it may
+     * be called from several threads. Only one batch is processed at a
+     * time.
+     */
+    class WorkerPool {
+    public:
+      typedef void (*Job)(void *context, size_t index);
+
+      explicit WorkerPool(unsigned int numThreads);
+      ~WorkerPool();
+
+      unsigned int getNumThreads() const {return workers.size();}
+      /** \brief Waits for the running batch and starts a new one. */
+      void start(Job job, void *context, size_t count);
+      void wait();
+      /** \brief Returns \c true if items of the last batch are not done. */
+      bool isBusy();
+
+    private:
+      class Worker : public utils::Thread {
+      public:
+        explicit Worker(WorkerPool *pool) : pool(pool) {}
+      protected:
+        void run();
+      private:
+        WorkerPool *pool;
+      };
+
+      std::vector<Worker*> workers;
+      utils::Mutex mutex;
+      utils::WaitCondition workAvailable, workDone;
+      Job job;
+      void *context;
+      size_t count, next, done;
+      bool stop;
+
+      // processes items until none is left, mutex has to be locked
+      void work();
+      void waitLocked();
+    }; // end of class WorkerPool
+
+  } // end of namespace sim
+} // end of namespace mars
+
+#endif  // WORKER_POOL_H
@@ -38,25 +38,50 @@
 
 #include "WorldPhysics.h"
 #include "NodePhysics.h"
+#include "JointPhysics.h"
 
 
 #include <mars/utils/MutexLocker.h>
+#include <mars/utils/misc.h>
 #include <mars/interfaces/graphics/draw_structs.h>
 #include <mars/interfaces/graphics/GraphicsManagerInterface.h>
 #include <mars/interfaces/sim/SimulatorInterface.h>
+#include <mars/interfaces/sim/SensorManagerInterface.h>
 #include <mars/interfaces/Logging.hpp>
 
 
 #include <boost/scoped_ptr.hpp>
 #include <boost/intrusive_ptr.hpp>	
 
+#include <algorithm>
+#include <cmath>
+
 namespace mars {
   namespace sim {
 
     using namespace utils;
     using namespace interfaces;
 
-    PhysicsError WorldPhysics::error = PHYSICS_NO_ERROR;
+    // the ODE message handlers are global, every world is stepped in its
+    // own thread and only sees the errors raised in that thread
+    thread_local PhysicsError WorldPhysics::error = PHYSICS_NO_ERROR;
+
+    // the sensor rays are handed to the workers in chunks of this size
+    static const size_t SENSOR_RAYS_PER_JOB = 32;
+
+    /**
+     * \brief ODE needs its collision data in every thread that uses it. Several
+     * worlds can be created and stepped in different threads of one process.
+     */
+    static void allocateODEThreadData() {
+#ifdef ODE11
+      static thread_local bool allocated = false;
+      if(!allocated) {
+        dAllocateODEDataForThread(dAllocateMaskAll);
+        allocated = true;
+      }
+#endif
+    }
 
     void myMessageFunction(int errnum, const char *msg, va_list ap) {
       CPP_UNUSED(errnum);
@@ -94,6 +119,11 @@ namespace mars {
       world_cfm = 1e-10;
       world_erp = 0.1;
       world_gravity = Vector(0.0, 0.0, -9.81);
+      auto_disable = false;
+      auto_disable_linear_threshold = 0.01;
+      auto_disable_angular_threshold = 0.01;
+      auto_disable_steps = 10;
+      auto_disable_time = 0.0;
       ground_friction = 20;
       ground_cfm = 0.00000001;
       ground_erp = 0.1;
@@ -107,13 +137,23 @@ namespace mars {
 
       // the step size in seconds
       step_size = 0.01;
+      substeps = 1;
+      max_contact_depth = 0.0;
+      own_rand_seed = false;
+      rand_seed = 0;
+      sensor_threads = 0;
+      sensorPool = NULL;
+      sensorCostsPending = false;
+      keep_step_state = false;
+      redo_step = false;
       // dInitODE is relevant for using trimesh objects as correct as
       // possible in the ode implementation
       MutexLocker locker(&iMutex);
 #ifdef ODE11
       // for ode-0.11
+      // ODE counts the init and close calls of all worlds in the process
       dInitODE2(0);
-      dAllocateODEDataForThread(dAllocateMaskAll);
+      allocateODEThreadData();
 #else
       dInitODE();
 #endif
@@ -133,6 +173,11 @@ namespace mars {
      *
      */
     WorldPhysics::~WorldPhysics(void) {
+      // stop the sensor workers before the geoms are destroyed
+      if(sensorPool) {
+        delete sensorPool;
+        sensorPool = NULL;
+      }
       // free the ode objects
       freeTheWorld();
       // and close the ODE ...
@@ -153,6 +198,7 @@ namespace mars {
      */
     void WorldPhysics::initTheWorld(void) {
       MutexLocker locker(&iMutex);
+      allocateODEThreadData();
   
       // if world_init = true debug something
       if (!world_init) {
@@ -169,7 +215,7 @@ namespace mars {
         dWorldSetCFM(world, (dReal)world_cfm);
         dWorldSetERP (world, (dReal)world_erp);
 
-        dWorldSetAutoDisableFlag (world,0);
+        setAutoDisableParams();
         // if usefull for some tests a ground can be created here
         plane = 0; //dCreatePlane (space,0,0,1,0);
         world_init = 1;
@@ -181,6 +227,25 @@ namespace mars {
       //printf("initTheWorld..\n");
     }
 
+    /**
+     * \brief Applies the auto disable parameters to the world.
+     *
+     * ODE copies the world parameters into a body on creation, thus
+     * NodePhysics applies them to its body as well.
+     */
+    void WorldPhysics::setAutoDisableParams(void) {
+      old_auto_disable = auto_disable;
+      old_auto_disable_linear = auto_disable_linear_threshold;
+      old_auto_disable_angular = auto_disable_angular_threshold;
+      old_auto_disable_steps = auto_disable_steps;
+      old_auto_disable_time = auto_disable_time;
+      dWorldSetAutoDisableFlag(world, auto_disable);
+      dWorldSetAutoDisableLinearThreshold(world, (dReal)auto_disable_linear_threshold);
+      dWorldSetAutoDisableAngularThreshold(world, (dReal)auto_disable_angular_threshold);
+      dWorldSetAutoDisableSteps(world, auto_disable_steps);
+      dWorldSetAutoDisableTime(world, (dReal)auto_disable_time);
+    }
+
     /**
      * \brief This functions destroys the ode world.
      *
@@ -193,6 +258,13 @@ namespace mars {
      */
     void WorldPhysics::freeTheWorld(void) {
       MutexLocker locker(&iMutex);
+      waitForSensors();
+      sensorRays.clear();
+      sensorTargets.clear();
+      for(size_t i=0; i<vectorRayGeoms.size(); ++i) {
+        dGeomDestroy(vectorRayGeoms[i]);
+      }
+      vectorRayGeoms.clear();
       if(world_init) {
         //LOG_DEBUG("free physics world");
         dJointGroupDestroy(contactgroup);
@@ -230,9 +302,9 @@ namespace mars {
      */
     void WorldPhysics::stepTheWorld(void) {
       MutexLocker locker(&iMutex);
-      std::vector<dJointFeedback*>::iterator iter;
-      geom_data* data;
-      int i;
+      allocateODEThreadData();
+      // the rays of the last step must not see the world moving
+      waitForSensors();
       // if world_init = false or step_size <= 0 debug something
        if(world_init && step_size > 0) {
         if(old_gravity != world_gravity) {
@@ -250,48 +322,461 @@ namespace mars {
           old_erp = world_erp;
           dWorldSetERP(world, (dReal)world_erp);
         }
-	//	printf("now WorldPhysics.cpp..stepTheWorld(void)....1 : dSpaceGetNumGeoms: %d\n",dSpaceGetNumGeoms(space)); 
-        /// first clear the collision counters of all geoms
-        for(i=0; i<dSpaceGetNumGeoms(space); i++) {
-          data = (geom_data*)dGeomGetData(dSpaceGetGeom(space, i));
-          data->num_ground_collisions = 0;
-          data->contact_ids.clear();
-          data->contact_points.clear();
-          data->ground_feedbacks.clear();
-        
+
+        if(old_auto_disable != auto_disable ||
+           old_auto_disable_linear != auto_disable_linear_threshold ||
+           old_auto_disable_angular != auto_disable_angular_threshold ||
+           old_auto_disable_steps != auto_disable_steps ||
+           old_auto_disable_time != auto_disable_time) {
+          setAutoDisableParams();
         }
-        
+        max_contact_depth = 0.0;
+        redo_step = false;
+        if(keep_step_state) storeBodyStates();
+        if(substeps > 1) {
+          // ODE clears the force accumulators after each step, thus we
+          // store them to apply them on every substep
+          storeBodyForces();
+        }
+        if(own_rand_seed) dRandSetSeed(rand_seed);
+        for(int s=0; s<substeps; ++s) {
+          if(s > 0) restoreBodyForces();
+          stepOnce((dReal)(step_size/substeps));
+          if(WorldPhysics::error) {
+            control->sim->handleError(WorldPhysics::error);
+            WorldPhysics::error = PHYSICS_NO_ERROR;
+            break;
+          }
+          if(redo_step) break;
+        }
+        if(redo_step) {
+          // the caller steps again, starting from the state before the step
+          restoreBodyStates();
+          return;
+        }
+        if(own_rand_seed) rand_seed = dRandGetSeed();
+        startSensorUpdate();
+      }
+    }
+
+    void WorldPhysics::setRandomSeed(unsigned long seed) {
+      MutexLocker locker(&iMutex);
+      rand_seed = seed;
+      own_rand_seed = true;
+    }
+
+    unsigned long WorldPhysics::getRandomSeed(void) const {
+      MutexLocker locker(&iMutex);
+      return own_rand_seed ? rand_seed : dRandGetSeed();
+    }
+
+    void WorldPhysics::getJointFeedback(const std::vector<JointInterface*> &joints,
+                                        const std::vector<JointFeedback*> &feedback) {
+      MutexLocker locker(&iMutex);
+      for(size_t i=0; i<joints.size() && i<feedback.size(); ++i) {
+        // all joints of this world are created by the PhysicsMapper
+        static_cast<JointPhysics*>(joints[i])->fillFeedback(feedback[i]);
+      }
+    }
+
+    void WorldPhysics::addSensorNode(NodePhysics *node) {
+      sensorNodes.insert(node);
+    }
+
+    void WorldPhysics::removeSensorNode(NodePhysics *node) {
+      sensorNodes.erase(node);
+    }
+
+    void WorldPhysics::waitForSensors(void) {
+      if(sensorPool) sensorPool->wait();
+      if(sensorCostsPending) {
+        sensorCostsPending = false;
+        reportSensorCosts();
+      }
+    }
+
+    /**
+     * \brief Hands the time the rays of every sensor took to the
+     * SensorManager, which schedules the sensors by their cost.
+     */
+    void WorldPhysics::reportSensorCosts(void) {
+      if(!control->sensors) return;
+      interfaces::BaseSensor *sensor = NULL;
+      double cost = 0.0;
+      for(size_t i=0; i<sensorRays.size(); ++i) {
+        if(sensorRays[i].sensor != sensor) {
+          if(sensor) control->sensors->addSensorCost(sensor->getID(), cost);
+          sensor = sensorRays[i].sensor;
+          cost = 0.0;
+        }
+        cost += sensorRays[i].cost;
+      }
+      if(sensor) control->sensors->addSensorCost(sensor->getID(), cost);
+    }
+
+    /**
+     * \brief Starts casting the rays of the sensors that are due after the
+     * step.
+     *
+     * The rays and the bounding boxes of the geoms are taken while the
+     * world is locked. Until the next step or a change of a node the
+     * geoms are only read, thus the workers cast the rays while the
+     * simulation thread updates joints, motors and controllers. Simulator
+     * waits for them before the DataBroker publishes the sensors.
+     *
+     * pre:
+     *     - iMutex is locked
+     */
+    void WorldPhysics::startSensorUpdate(void) {
+      std::set<NodePhysics*>::iterator iter;
+      sensorRays.clear();
+      for(iter = sensorNodes.begin(); iter != sensorNodes.end(); ++iter) {
+        (*iter)->getSensorRays(&sensorRays);
+      }
+      if(sensorRays.empty()) return;
+
+      sensorTargets.clear();
+      addSensorTargets(space);
+      startSensorJobs();
+      sensorCostsPending = true;
+    }
+
+    /**
+     * \brief Hands sensorRays to the workers, or casts them here if no
+     * sensor threads are used.
+     *
+     * pre:
+     *     - iMutex is locked and the targets are taken
+     */
+    void WorldPhysics::startSensorJobs(void) {
+      unsigned int threads = sensor_threads > 0 ? sensor_threads : 0;
+#ifndef ODE11
+      // the colliders need their own data per thread
+      threads = 0;
+#endif
+      if(sensorPool && sensorPool->getNumThreads() != threads) {
+        delete sensorPool;
+        sensorPool = NULL;
+      }
+      if(threads && !sensorPool) {
+        sensorPool = new WorkerPool(threads);
+      }
+      size_t jobs = (sensorRays.size() + SENSOR_RAYS_PER_JOB - 1) / SENSOR_RAYS_PER_JOB;
+      if(sensorPool) {
+        sensorPool->start(&WorldPhysics::sensorJob, this, jobs);
+      }
+      else {
+        for(size_t i=0; i<jobs; ++i) sensorJob(this, i);
+      }
+    }
+
+    /**
+     * \brief Casts a batch of rays on the sensor workers and waits for them.
+     *
+     * The rays do not belong to a node, thus they are tested against all
+     * geoms. The rays of one job are cast one after the other, so every
+     * job reuses one ray geom.
+     */
+    void WorldPhysics::getVectorCollisions(size_t count,
+                                           const sReal *const pos[3],
+                                           const sReal *const ray[3],
+                                           sReal *depth) {
+      MutexLocker locker(&iMutex);
+      allocateODEThreadData();
+      waitForSensors();
+      if(!world_init || count == 0) return;
+
+      size_t jobs = (count + SENSOR_RAYS_PER_JOB - 1) / SENSOR_RAYS_PER_JOB;
+      while(vectorRayGeoms.size() < jobs) {
+        dGeomID geom = dCreateRay(NULL, 1.0);
+        dGeomDisable(geom);
+        vectorRayGeoms.push_back(geom);
+      }
+
+      sensor_ray sRay;
+      sRay.sensor = NULL;
+      sRay.parent_geom = NULL;
+      sRay.parent_body = NULL;
+      sRay.stepped = false;
+      sensorRays.clear();
+      sensorRays.reserve(count);
+      for(size_t i=0; i<count; ++i) {
+        sRay.geom = vectorRayGeoms[i / SENSOR_RAYS_PER_JOB];
+        sRay.value = depth + i;
+        sRay.max_distance = sqrt(ray[0][i]*ray[0][i] + ray[1][i]*ray[1][i] +
+                                 ray[2][i]*ray[2][i]);
+        for(int k=0; k<3; ++k) {
+          sRay.pos[k] = pos[k][i];
+          sRay.dir[k] = sRay.max_distance > 0 ? ray[k][i] / sRay.max_distance : 0;
+        }
+        sensorRays.push_back(sRay);
+      }
+      sensorTargets.clear();
+      addSensorTargets(space);
+      startSensorJobs();
+      waitForSensors();
+      sensorRays.clear();
+    }
+
+    void WorldPhysics::addSensorTargets(dSpaceID theSpace) {
+      sensor_target target;
+      for(int i=0; i<dSpaceGetNumGeoms(theSpace); i++) {
+        target.geom = dSpaceGetGeom(theSpace, i);
+        if(dGeomIsSpace(target.geom)) {
+          addSensorTargets((dSpaceID)target.geom);
+          continue;
+        }
+        if(!dGeomIsEnabled(target.geom)) continue;
+        geom_data *data = (geom_data*)dGeomGetData(target.geom);
+        if(data && data->ray_sensor) continue;
+        target.body = dGeomGetBody(target.geom);
+        // updates the position and bounding box of geoms that moved
+        dGeomGetAABB(target.geom, target.aabb);
+        target.category_bits = dGeomGetCategoryBits(target.geom);
+        target.collide_bits = dGeomGetCollideBits(target.geom);
+        target.shared = dGeomGetClass(target.geom) == dHeightfieldClass;
+        sensorTargets.push_back(target);
+      }
+    }
+
+    void WorldPhysics::sensorJob(void *context, size_t index) {
+      WorldPhysics *world = (WorldPhysics*)context;
+      allocateODEThreadData();
+      size_t end = std::min((index+1)*SENSOR_RAYS_PER_JOB,
+                            world->sensorRays.size());
+      size_t first = index*SENSOR_RAYS_PER_JOB;
+      long long start = utils::getTimeMicro();
+      for(size_t i=first; i<end; ++i) {
+        sensor_ray &ray = world->sensorRays[i];
+        *ray.value = world->castSensorRay(ray);
+        ray.cost = 0.0;
+        // the time of the rays of one sensor in this job
+        if(i+1 == end || world->sensorRays[i+1].sensor != ray.sensor) {
+          long long now = utils::getTimeMicro();
+          world->sensorRays[first].cost = (double)(now - start);
+          first = i+1;
+          start = now;
+        }
+      }
+    }
+
+    /**
+     * \brief Returns the distance to the first hit of \c ray or its
+     * maximum distance.
+     *
+     * Polar rays are cast in segments of one meter since the colliders
+     * report any contact of a ray and not the closest one.
+     */
+    dReal WorldPhysics::castSensorRay(const sensor_ray &ray) {
+      dReal start = 0.0, length, depth;
+      dReal distance = ray.max_distance;
+      dGeomEnable(ray.geom);
+      while(start < ray.max_distance) {
+        length = ray.max_distance - start;
+        if(ray.stepped && length > 1.0) length = 1.0;
+        dGeomRaySet(ray.geom,
+                    ray.pos[0] + ray.dir[0]*start,
+                    ray.pos[1] + ray.dir[1]*start,
+                    ray.pos[2] + ray.dir[2]*start,
+                    ray.dir[0], ray.dir[1], ray.dir[2]);
+        dGeomRaySetLength(ray.geom, length);
+        if(collideSensorRay(ray, &depth)) {
+          distance = start + depth;
+          break;
+        }
+        start += length;
+      }
+      dGeomDisable(ray.geom);
+      return distance;
+    }
+
+    /**
+     * \brief Tests the ray against the geoms taken by startSensorUpdate(),
+     * like nearCallback() does for ray sensors.
+     */
+    bool WorldPhysics::collideSensorRay(const sensor_ray &ray, dReal *depth) {
+      std::vector<sensor_target>::const_iterator iter;
+      unsigned long category = dGeomGetCategoryBits(ray.geom);
+      unsigned long collide = dGeomGetCollideBits(ray.geom);
+      dReal aabb[6];
+      dContact contact;
+      bool hit = false;
+      int numc;
 
-        for(iter = contact_feedback_list.begin();
-            iter != contact_feedback_list.end(); iter++) {
-          free((*iter));
+      dGeomGetAABB(ray.geom, aabb);
+      for(iter = sensorTargets.begin(); iter != sensorTargets.end(); ++iter) {
+        // rays without a parent node are tested against every geom
+        if(ray.parent_geom && (iter->geom == ray.parent_geom ||
+                               iter->body == ray.parent_body)) {
+          continue;
+        }
+        if(!((category & iter->collide_bits) ||
+             (iter->category_bits & collide))) {
+          continue;
+        }
+        if(aabb[0] > iter->aabb[1] || aabb[1] < iter->aabb[0] ||
+           aabb[2] > iter->aabb[3] || aabb[3] < iter->aabb[2] ||
+           aabb[4] > iter->aabb[5] || aabb[5] < iter->aabb[4]) {
+          continue;
+        }
+        if(iter->shared) sharedGeomMutex.lock();
+        numc = dCollide(iter->geom, ray.geom, 1|CONTACTS_UNIMPORTANT,
+                        &(contact.geom), sizeof(dContact));
+        if(iter->shared) sharedGeomMutex.unlock();
+        if(numc && (!hit || contact.geom.depth < *depth)) {
+          *depth = contact.geom.depth;
+          hit = true;
         }
+      }
+      return hit;
+    }
+
+    /**
+     * \brief Collides and steps the world once for \c dt seconds.
+     *
+     * pre:
+     *     - the world is initialized and iMutex is locked
+     */
+    void WorldPhysics::stepOnce(dReal dt) {
+      std::vector<dJointFeedback*>::iterator iter;
+      geom_data* data;
+      dGeomID geom;
+      dBodyID body;
+      int i;
+
+	//	printf("now WorldPhysics.cpp..stepTheWorld(void)....1 : dSpaceGetNumGeoms: %d\n",dSpaceGetNumGeoms(space)); 
+      /// first clear the collision counters of all geoms
+      for(i=0; i<dSpaceGetNumGeoms(space); i++) {
+        geom = dSpaceGetGeom(space, i);
+        data = (geom_data*)dGeomGetData(geom);
+        body = dGeomGetBody(geom);
+        if(body && !dBodyIsEnabled(body)) {
+          // sleeping bodies are not collided, thus we keep their last
+          // contact state and only cache the force of the last feedbacks
+          // before they get freed below
+          if(!data->ground_feedbacks.empty()) {
+            data->sleep_contact_force = data->getFeedbackForce();
+            data->ground_feedbacks.clear();
+          }
+          continue;
+        }
+        data->num_ground_collisions = 0;
+        data->contact_ids.clear();
+        data->contact_points.clear();
+        data->ground_feedbacks.clear();
+      
+      }
+      
+
+      for(iter = contact_feedback_list.begin();
+          iter != contact_feedback_list.end(); iter++) {
+        free((*iter));
+      }
  
-        contact_feedback_list.clear();
-        draw_intern.clear();
-        /// then we have to clear the contacts
-        dJointGroupEmpty(contactgroup);
-        /// first check for collisions
-        num_contacts = log_contacts = 0;
-        create_contacts = 1;
-        
-        dSpaceCollide(space,this, &WorldPhysics::callbackForward);
-        drawLock.lock();
-        draw_extern.swap(draw_intern);
-        drawLock.unlock();
-        // then calculate the next state for a time of step_size seconds
-        try {
-          if(fast_step) dWorldQuickStep(world, step_size);
-          else dWorldStep(world, step_size);
+      contact_feedback_list.clear();
+      draw_intern.clear();
+      /// then we have to clear the contacts
+      dJointGroupEmpty(contactgroup);
+      /// first check for collisions
+      num_contacts = log_contacts = 0;
+      create_contacts = 1;
+      
+      dSpaceCollide(space,this, &WorldPhysics::callbackForward);
+      drawLock.lock();
+      draw_extern.swap(draw_intern);
+      drawLock.unlock();
+      // then calculate the next state for a time of step_size seconds
+      try {
+        if(fast_step) dWorldQuickStep(world, dt);
+        else dWorldStep(world, dt);
+
+      } catch (...) {
+        control->sim->handleError(PHYSICS_UNKNOWN);
+      }
+    }
 
-        } catch (...) {
-          control->sim->handleError(PHYSICS_UNKNOWN);
+    void WorldPhysics::storeBodyForces(void) {
+      dBodyID body;
+      const dReal *v;
+      bodyForce f;
+      // the geoms of a composite object share one body
+      std::set<dBodyID> visited;
+
+      bodyForces.clear();
+      for(int i=0; i<dSpaceGetNumGeoms(space); i++) {
+        body = dGeomGetBody(dSpaceGetGeom(space, i));
+        if(!body || !visited.insert(body).second) {
+          continue;
+        }
+        v = dBodyGetForce(body);
+        f.body = body;
+        f.force[0] = v[0]; f.force[1] = v[1]; f.force[2] = v[2];
+        v = dBodyGetTorque(body);
+        f.torque[0] = v[0]; f.torque[1] = v[1]; f.torque[2] = v[2];
+        if(f.force[0] != 0 || f.force[1] != 0 || f.force[2] != 0 ||
+           f.torque[0] != 0 || f.torque[1] != 0 || f.torque[2] != 0) {
+          bodyForces.push_back(f);
         }
-	if(WorldPhysics::error) {
-          control->sim->handleError(WorldPhysics::error);
-          WorldPhysics::error = PHYSICS_NO_ERROR;
-	}
-      }   
+      }
+    }
+
+    void WorldPhysics::restoreBodyForces(void) {
+      std::vector<bodyForce>::iterator it;
+      for(it=bodyForces.begin(); it!=bodyForces.end(); ++it) {
+        dBodyAddForce(it->body, it->force[0], it->force[1], it->force[2]);
+        dBodyAddTorque(it->body, it->torque[0], it->torque[1], it->torque[2]);
+      }
+    }
+
+    /**
+     * \brief Stores pose, velocities, force accumulators and the enabled
+     * state of all bodies. The auto disable counters cannot be read from
+     * ODE and are not kept.
+     */
+    void WorldPhysics::storeBodyStates(void) {
+      dBodyID body;
+      const dReal *v;
+      bodyState b;
+      // the geoms of a composite object share one body
+      std::set<dBodyID> visited;
+      int i;
+
+      bodyStates.clear();
+      for(int g=0; g<dSpaceGetNumGeoms(space); g++) {
+        body = dGeomGetBody(dSpaceGetGeom(space, g));
+        if(!body || !visited.insert(body).second) {
+          continue;
+        }
+        b.body = body;
+        v = dBodyGetPosition(body);
+        for(i=0; i<3; ++i) b.pos[i] = v[i];
+        v = dBodyGetQuaternion(body);
+        for(i=0; i<4; ++i) b.q[i] = v[i];
+        v = dBodyGetLinearVel(body);
+        for(i=0; i<3; ++i) b.lvel[i] = v[i];
+        v = dBodyGetAngularVel(body);
+        for(i=0; i<3; ++i) b.avel[i] = v[i];
+        v = dBodyGetForce(body);
+        for(i=0; i<3; ++i) b.force[i] = v[i];
+        v = dBodyGetTorque(body);
+        for(i=0; i<3; ++i) b.torque[i] = v[i];
+        b.enabled = dBodyIsEnabled(body);
+        bodyStates.push_back(b);
+      }
+    }
+
+    void WorldPhysics::restoreBodyStates(void) {
+      std::vector<bodyState>::iterator it;
+      for(it=bodyStates.begin(); it!=bodyStates.end(); ++it) {
+        dBodySetPosition(it->body, it->pos[0], it->pos[1], it->pos[2]);
+        dBodySetQuaternion(it->body, it->q);
+        dBodySetLinearVel(it->body, it->lvel[0], it->lvel[1], it->lvel[2]);
+        dBodySetAngularVel(it->body, it->avel[0], it->avel[1], it->avel[2]);
+        dBodySetForce(it->body, it->force[0], it->force[1], it->force[2]);
+        dBodySetTorque(it->body, it->torque[0], it->torque[1], it->torque[2]);
+        if(it->enabled && !dBodyIsEnabled(it->body)) dBodyEnable(it->body);
+        else if(!it->enabled && dBodyIsEnabled(it->body)) dBodyDisable(it->body);
+      }
     }
 
     /**
@@ -503,6 +988,11 @@ namespace mars {
 
       if(!b1 && !b2 && !geom_data1->ray_sensor && !geom_data2->ray_sensor) return;
 
+      // sleeping bodies are not stepped, so contacts are only created if at
+      // least one of the bodies is awake
+      if(create_contacts && (!b1 || !dBodyIsEnabled(b1)) &&
+         (!b2 || !dBodyIsEnabled(b2))) return;
+
       int maxNumContacts = 0;
       if(geom_data1->c_params.max_num_contacts <
          geom_data2->c_params.max_num_contacts) {
@@ -712,9 +1202,14 @@ namespace mars {
                                       geom_data2->c_params.depth_correction);
         
             if(contact[0].geom.depth < 0.0) contact[0].geom.depth = 0.0;
+            if(contact[i].geom.depth > max_contact_depth)
+              max_contact_depth = contact[i].geom.depth;
             dJointID c=dJointCreateContact(world,contactgroup,contact+i);
 
             dJointAttach(c,b1,b2);
+            // a contact with an awake body wakes up a sleeping one
+            if(b1 && !dBodyIsEnabled(b1)) dBodyEnable(b1);
+            if(b2 && !dBodyIsEnabled(b2)) dBodyEnable(b2);
 
             geom_data1->num_ground_collisions += numc;
             geom_data2->num_ground_collisions += numc;
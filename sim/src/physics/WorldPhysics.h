@@ -38,11 +38,15 @@
 #include <mars/utils/Mutex.h>
 #include <mars/utils/Vector.h>
 #include <mars/interfaces/sim_common.h>
+#include <mars/interfaces/sensor_bases.h>
 #include <mars/interfaces/sim/ControlCenter.h>
 #include <mars/interfaces/sim/PhysicsInterface.h>
 #include <mars/interfaces/graphics/draw_structs.h>
 
+#include "WorkerPool.h"
+
 #include <vector>
+#include <set>
 
 #include <ode/ode.h>
 
@@ -78,6 +82,37 @@ namespace mars {
       std::vector<NodePhysics*> comp_nodes;
     };
 
+    /**
+     * A ray of a sensor that is cast after the step. Rays of polar sensors
+     * are cast in segments of one meter. The rays of a sensor follow each
+     * other; the time a job needed for the rays of one sensor is stored in
+     * the cost (microseconds) of the first of them.
+     */
+    struct sensor_ray {
+      interfaces::BaseSensor *sensor;
+      double cost;
+      dGeomID geom;
+      dGeomID parent_geom;
+      dBodyID parent_body;
+      double *value;
+      dVector3 pos, dir;
+      dReal max_distance;
+      bool stepped;
+    };
+
+    /**
+     * A geom the sensor rays are tested against, with the bounding box
+     * and collision bits it had after the step.
+     */
+    struct sensor_target {
+      dGeomID geom;
+      dBodyID body;
+      dReal aabb[6];
+      unsigned long category_bits, collide_bits;
+      // the collider keeps temporary data in the geom
+      bool shared;
+    };
+
     /**
      * Declaration of the physical class, that implements the
      * physics interface.
@@ -94,6 +129,15 @@ namespace mars {
       virtual void update(std::vector<interfaces::draw_item> *drawItems);
       virtual int checkCollisions(void);
       virtual interfaces::sReal getVectorCollision(const utils::Vector &pos, const utils::Vector &ray) const;
+      virtual void getVectorCollisions(size_t count,
+                                       const interfaces::sReal *const pos[3],
+                                       const interfaces::sReal *const ray[3],
+                                       interfaces::sReal *depth);
+      virtual void setRandomSeed(unsigned long seed);
+      virtual unsigned long getRandomSeed(void) const;
+      virtual void getJointFeedback(const std::vector<interfaces::JointInterface*> &joints,
+                                    const std::vector<interfaces::JointFeedback*> &feedback);
+      virtual void waitForSensors(void);
 
       // this functions are used by the other physical classes
       dWorldID getWorld(void) const;
@@ -105,9 +149,11 @@ namespace mars {
       void moveCompositeMassCenter(dBodyID theBody, dReal x, dReal y, dReal z);
       int handleCollision(dGeomID theGeom);
       interfaces::sReal getCollisionDepth(dGeomID theGeom);
+      void addSensorNode(NodePhysics *node);
+      void removeSensorNode(NodePhysics *node);
       mutable utils::Mutex iMutex;
 
-      static interfaces::PhysicsError error;
+      static thread_local interfaces::PhysicsError error;
 		int testItem;
 		
     private:
@@ -121,6 +167,10 @@ namespace mars {
       interfaces::ControlCenter *control;
       utils::Vector old_gravity;
       interfaces::sReal old_cfm, old_erp;
+      bool old_auto_disable;
+      interfaces::sReal old_auto_disable_linear, old_auto_disable_angular;
+      int old_auto_disable_steps;
+      interfaces::sReal old_auto_disable_time;
 
       std::vector<body_nbr_tupel> comp_body_list;
       std::vector<interfaces::draw_item> draw_intern;
@@ -129,6 +179,47 @@ namespace mars {
       bool create_contacts, log_contacts;
       int num_contacts;
       int ray_collision;
+
+      // force accumulators of the bodies, applied on every substep
+      struct bodyForce {
+        dBodyID body;
+        dReal force[3], torque[3];
+      };
+      std::vector<bodyForce> bodyForces;
+      // the bodies before the step, for redo_step
+      struct bodyState {
+        dBodyID body;
+        dReal pos[3], q[4], lvel[3], avel[3], force[3], torque[3];
+        bool enabled;
+      };
+      std::vector<bodyState> bodyStates;
+      // ODE's random state is global, the world swaps its own in and out
+      bool own_rand_seed;
+      unsigned long rand_seed;
+
+      // sensor rays cast on the workers after the step
+      std::set<NodePhysics*> sensorNodes;
+      std::vector<sensor_ray> sensorRays;
+      std::vector<sensor_target> sensorTargets;
+      WorkerPool *sensorPool;
+      bool sensorCostsPending;
+      utils::Mutex sharedGeomMutex;
+      // one ray geom per job of getVectorCollisions()
+      std::vector<dGeomID> vectorRayGeoms;
+
+      void setAutoDisableParams(void);
+      void stepOnce(dReal dt);
+      void storeBodyForces(void);
+      void restoreBodyForces(void);
+      void storeBodyStates(void);
+      void restoreBodyStates(void);
+      void startSensorUpdate(void);
+      void startSensorJobs(void);
+      void reportSensorCosts(void);
+      void addSensorTargets(dSpaceID theSpace);
+      dReal castSensorRay(const sensor_ray &ray);
+      bool collideSensorRay(const sensor_ray &ray, dReal *depth);
+      static void sensorJob(void *context, size_t index);
       // this functions are for the collision implementation
       void nearCallback (dGeomID o1, dGeomID o2);
       static void callbackForward(void *data, dGeomID o1, dGeomID o2);
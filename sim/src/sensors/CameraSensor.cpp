@@ -22,9 +22,11 @@
 
 #include <mars/data_broker/DataBrokerInterface.h>
 #include <mars/utils/mathUtils.h>
+#include <mars/utils/misc.h>
 #include <mars/interfaces/sim/LoadCenter.h>
 #include <mars/interfaces/sim/NodeManagerInterface.h>
 #include <mars/interfaces/sim/SimulatorInterface.h>
+#include <mars/interfaces/sim/SensorManagerInterface.h>
 #include <mars/interfaces/sim/ControlCenter.h>
 #include <mars/interfaces/graphics/GraphicsManagerInterface.h>
 #include <mars/interfaces/Logging.hpp>
@@ -55,6 +57,9 @@ namespace mars {
       imageCamera(id,name,config.width,config.height,4,false)
     {
       renderCam = 2;
+      frameStart = 0;
+      idleFrameTime = 0.0;
+      rendering = false;
       this->attached_node = config.attached_node;
       draw_id = control->nodes->getDrawID(attached_node);
       std::vector<unsigned long>::iterator iter;
@@ -92,8 +97,10 @@ namespace mars {
           cam_id = control->graphics->addHUDElement(&hudCam);
 
 
-        cam_window_id = control->graphics->new3DWindow(0, true, config.width,
-                                                       config.height, name);
+        // all cameras are drawn in one pass as tiles of a shared target
+        cam_window_id = control->graphics->new3DWindowTile("CameraSensor",
+                                                           config.width,
+                                                           config.height, name);
         if(config.show_cam)
           control->graphics->setHUDElementTextureRTT(cam_id, cam_window_id,
                                                      false);
@@ -224,6 +231,7 @@ namespace mars {
 
     void CameraSensor::preGraphicsUpdate(void) {
       mutex.lock();
+      frameStart = getTimeMicro();
       if(gc) {
         Vector p = control->graphics->getDrawObjectPosition(draw_id);
         Quaternion qcorrect = Quaternion(0.5, 0.5, -0.5, -0.5);
@@ -236,6 +244,7 @@ namespace mars {
           else if(renderCam == 2) {
             control->graphics->activate3DWindow(cam_window_id);
             renderCam = 1;
+            rendering = true;
           }
           else if(renderCam == 1) {
             control->graphics->deactivate3DWindow(cam_window_id);
@@ -246,6 +255,22 @@ namespace mars {
       mutex.unlock();
     }
 
+    void CameraSensor::postGraphicsUpdate(void) {
+      mutex.lock();
+      double frameTime = (double)(getTimeMicro() - frameStart);
+      if(rendering) {
+        // the camera is rendered in the update of its window, the time
+        // the frame takes longer than the others is the cost of the camera
+        rendering = false;
+        double cost = frameTime - idleFrameTime;
+        mutex.unlock();
+        control->sensors->addSensorCost(id, cost > 0.0 ? cost : 0.0);
+        return;
+      }
+      idleFrameTime = idleFrameTime > 0.0 ? 0.9*idleFrameTime + 0.1*frameTime : frameTime;
+      mutex.unlock();
+    }
+
     void CameraSensor::receiveData(const data_broker::DataInfo &info,
                                    const data_broker::DataPackage &package,
                                    int callbackParam) {
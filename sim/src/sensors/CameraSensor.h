@@ -113,6 +113,7 @@ namespace mars {
                                int callbackParam);
 
       virtual void preGraphicsUpdate(void);
+      virtual void postGraphicsUpdate(void);
       void getCameraInfo( interfaces::cameraStruct *cs );
 
       static interfaces::BaseConfig* parseConfig(interfaces::ControlCenter *control,
@@ -141,6 +142,11 @@ namespace mars {
       utils::Mutex mutex;
       int renderCam;
       unsigned long draw_id;
+      // start of the current frame and the average time of the frames
+      // without the camera, to report the time the camera adds to a frame
+      long long frameStart;
+      double idleFrameTime;
+      bool rendering;
     };
 
   } // end of namespace sim
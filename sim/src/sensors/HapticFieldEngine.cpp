@@ -0,0 +1,251 @@
+/*
+ *  Copyright 2014, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "HapticFieldEngine.h"
+#include <mars/data_broker/DataBrokerInterface.h>
+#include <mars/interfaces/sim/PhysicsInterface.h>
+#include <mars/interfaces/sim/SimulatorInterface.h>
+#include <mars/utils/MutexLocker.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace mars {
+  namespace sim {
+
+    using namespace utils;
+    using namespace interfaces;
+
+    std::map<ControlCenter*, HapticFieldEngine*> HapticFieldEngine::engines;
+    Mutex HapticFieldEngine::enginesMutex;
+
+    HapticFieldEngine* HapticFieldEngine::acquire(ControlCenter *control) {
+      MutexLocker locker(&enginesMutex);
+      HapticFieldEngine *&engine = engines[control];
+      if(!engine) engine = new HapticFieldEngine(control);
+      ++engine->references;
+      return engine;
+    }
+
+    void HapticFieldEngine::release(HapticFieldEngine *engine) {
+      MutexLocker locker(&enginesMutex);
+      if(--engine->references == 0) {
+        engines.erase(engine->control);
+        delete engine;
+      }
+    }
+
+    HapticFieldEngine::HapticFieldEngine(ControlCenter *control)
+      : control(control), references(0), nextId(1) {
+    }
+
+    HapticFieldEngine::~HapticFieldEngine() {
+      if(control->dataBroker) {
+        control->dataBroker->unregisterTimedReceiver(this, "*", "*",
+                                                     "mars_sim/simTimer");
+      }
+    }
+
+    void HapticFieldEngine::registerTimer() {
+      if(!control->dataBroker) return;
+      // the receivers of a timer are called in the order of registration
+      control->dataBroker->unregisterTimedReceiver(this, "*", "*",
+                                                   "mars_sim/simTimer");
+      control->dataBroker->registerTimedReceiver(this, "data_broker",
+                                                 "timers/mars_sim/simTimer",
+                                                 "mars_sim/simTimer", 0);
+    }
+
+    unsigned long HapticFieldEngine::addPatch(const std::vector<Vector> &points,
+                                              const Vector &ray) {
+      unsigned long id;
+      {
+        MutexLocker locker(&mutex);
+        Patch patch;
+        patch.offset = localX.size();
+        patch.count = points.size();
+        patch.position = Vector(0.0, 0.0, 0.0);
+        patch.orientation.setIdentity();
+        patch.ray = ray;
+        patch.contactForce = patch.forceSum = 0.0;
+        patch.contact = patch.pending = false;
+        for(size_t i=0; i<points.size(); ++i) {
+          localX.push_back(points[i].x());
+          localY.push_back(points[i].y());
+          localZ.push_back(points[i].z());
+        }
+        weights.resize(localX.size(), 1.0);
+        forces.resize(localX.size(), 0.0);
+        id = nextId++;
+        patches[id] = patch;
+      }
+      registerTimer();
+      return id;
+    }
+
+    void HapticFieldEngine::removePatch(unsigned long id) {
+      MutexLocker locker(&mutex);
+      std::map<unsigned long, Patch>::iterator it = patches.find(id);
+      if(it == patches.end()) return;
+      size_t begin = it->second.offset, end = begin + it->second.count;
+      localX.erase(localX.begin()+begin, localX.begin()+end);
+      localY.erase(localY.begin()+begin, localY.begin()+end);
+      localZ.erase(localZ.begin()+begin, localZ.begin()+end);
+      weights.erase(weights.begin()+begin, weights.begin()+end);
+      forces.erase(forces.begin()+begin, forces.begin()+end);
+      patches.erase(it);
+      for(it = patches.begin(); it != patches.end(); ++it) {
+        if(it->second.offset > begin) it->second.offset -= end - begin;
+      }
+    }
+
+    HapticFieldEngine::Patch* HapticFieldEngine::findPatch(unsigned long id) {
+      std::map<unsigned long, Patch>::iterator it = patches.find(id);
+      return it == patches.end() ? NULL : &it->second;
+    }
+
+    void HapticFieldEngine::setPatchState(unsigned long id, const Vector &position,
+                                          const Quaternion &orientation,
+                                          bool contact, double contactForce) {
+      MutexLocker locker(&mutex);
+      Patch *patch = findPatch(id);
+      if(!patch) return;
+      // patches without contact stay cleared
+      patch->pending = contact || patch->contact;
+      patch->position = position;
+      patch->orientation = orientation;
+      patch->contact = contact;
+      patch->contactForce = contactForce;
+    }
+
+    size_t HapticFieldEngine::getForces(unsigned long id, double *forces) {
+      MutexLocker locker(&mutex);
+      Patch *patch = findPatch(id);
+      if(!patch) return 0;
+      if(patch->count) {
+        memcpy(forces, &this->forces[patch->offset], patch->count*sizeof(double));
+      }
+      return patch->count;
+    }
+
+    size_t HapticFieldEngine::getWeights(unsigned long id, double *weights) {
+      MutexLocker locker(&mutex);
+      Patch *patch = findPatch(id);
+      if(!patch) return 0;
+      if(patch->count) {
+        memcpy(weights, &this->weights[patch->offset], patch->count*sizeof(double));
+      }
+      return patch->count;
+    }
+
+    double HapticFieldEngine::getForceSum(unsigned long id) {
+      MutexLocker locker(&mutex);
+      Patch *patch = findPatch(id);
+      return patch ? patch->forceSum : 0.0;
+    }
+
+    void HapticFieldEngine::receiveData(const data_broker::DataInfo &info,
+                                        const data_broker::DataPackage &package,
+                                        int callbackParam) {
+      update();
+    }
+
+    void HapticFieldEngine::update() {
+      std::map<unsigned long, Patch>::iterator it;
+      MutexLocker locker(&mutex);
+
+      size_t numRays = 0;
+      for(it = patches.begin(); it != patches.end(); ++it) {
+        Patch &patch = it->second;
+        if(!patch.pending) continue;
+        if(patch.contact) {
+          numRays += patch.count;
+        }
+        else {
+          std::fill(forces.begin()+patch.offset,
+                    forces.begin()+patch.offset+patch.count, 0.0);
+          patch.forceSum = 0.0;
+          patch.pending = false;
+        }
+      }
+      if(numRays == 0) return;
+
+      // start points and directions of the rays of all patches in contact
+      for(int k=0; k<3; ++k) {
+        rayPos[k].resize(numRays);
+        rayDir[k].resize(numRays);
+      }
+      depths.resize(numRays);
+      size_t r = 0;
+      for(it = patches.begin(); it != patches.end(); ++it) {
+        const Patch &patch = it->second;
+        if(!patch.pending || patch.count == 0) continue;
+        const Eigen::Matrix3d m = patch.orientation.toRotationMatrix();
+        const Vector &p = patch.position;
+        const Vector dir = patch.orientation * patch.ray;
+        const double *x = &localX[patch.offset];
+        const double *y = &localY[patch.offset];
+        const double *z = &localZ[patch.offset];
+        double *px = &rayPos[0][r], *py = &rayPos[1][r], *pz = &rayPos[2][r];
+        // flat loops over the arrays, the compiler can vectorize them
+        for(size_t i=0; i<patch.count; ++i) {
+          px[i] = m(0,0)*x[i] + m(0,1)*y[i] + m(0,2)*z[i] + p.x();
+          py[i] = m(1,0)*x[i] + m(1,1)*y[i] + m(1,2)*z[i] + p.y();
+          pz[i] = m(2,0)*x[i] + m(2,1)*y[i] + m(2,2)*z[i] + p.z();
+        }
+        for(int k=0; k<3; ++k) {
+          std::fill(rayDir[k].begin()+r, rayDir[k].begin()+r+patch.count, dir[k]);
+        }
+        r += patch.count;
+      }
+
+      const double *pos[3] = {rayPos[0].data(), rayPos[1].data(), rayPos[2].data()};
+      const double *ray[3] = {rayDir[0].data(), rayDir[1].data(), rayDir[2].data()};
+      control->sim->getPhysics()->getVectorCollisions(numRays, pos, ray,
+                                                      depths.data());
+
+      // the contact force is distributed over the taxels by their weights
+      r = 0;
+      for(it = patches.begin(); it != patches.end(); ++it) {
+        Patch &patch = it->second;
+        if(!patch.pending) continue;
+        patch.pending = false;
+        if(patch.count == 0) continue;
+        double length = patch.ray.norm();
+        double scale = length > 0.0 ? 1.0 / length : 0.0;
+        const double *d = &depths[r];
+        double *w = &weights[patch.offset];
+        double *f = &forces[patch.offset];
+        double weightSum = 0.0;
+        for(size_t i=0; i<patch.count; ++i) {
+          w[i] = 1.0 - d[i]*scale;
+          weightSum += w[i];
+        }
+        double forceQuant = weightSum > 0.0 ? patch.contactForce / weightSum : 0.0;
+        for(size_t i=0; i<patch.count; ++i) {
+          f[i] = w[i] * forceQuant;
+        }
+        patch.forceSum = weightSum > 0.0 ? patch.contactForce : 0.0;
+        r += patch.count;
+      }
+    }
+
+  } // end of namespace sim
+} // end of namespace mars
@@ -0,0 +1,128 @@
+/*
+ *  Copyright 2014, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file HapticFieldEngine.h
+ * \brief Evaluates the taxels of all haptic field sensors of a simulation
+ * in one batch.
+ */
+
+#ifndef HAPTICFIELDENGINE_H
+#define HAPTICFIELDENGINE_H
+
+#ifdef _PRINT_HEADER_
+#warning "HapticFieldEngine.h"
+#endif
+
+#include <mars/data_broker/ReceiverInterface.h>
+#include <mars/interfaces/sim/ControlCenter.h>
+#include <mars/utils/Vector.h>
+#include <mars/utils/Quaternion.h>
+#include <mars/utils/Mutex.h>
+
+#include <map>
+#include <vector>
+
+namespace mars {
+  namespace sim {
+
+    /**
+     * \brief Keeps the taxels of all haptic field patches of one simulation
+     * in contiguous x, y and z arrays and computes their forces together.
+     *
+     * A sensor hands its pose and contact state to setPatchState() when it
+     * receives the data of its node. Only patches whose state was set since
+     * the last update are evaluated: the rays of all patches in contact are
+     * transformed in flat loops over the arrays, cast with one call of
+     * PhysicsInterface::getVectorCollisions() and turned into weights and
+     * forces. Patches without contact are cleared once.
+     *
+     * The engine is a timed receiver of the simulation timer. It registers
+     * again whenever a patch is added, thus it is called after the sensors
+     * in the same step.
+     */
+    class HapticFieldEngine : public data_broker::ReceiverInterface {
+    public:
+      /** \brief Returns the engine of the simulation and takes a reference. */
+      static HapticFieldEngine* acquire(interfaces::ControlCenter *control);
+      /** \brief Drops a reference; the last one deletes the engine. */
+      static void release(HapticFieldEngine *engine);
+
+      /**
+       * \brief Adds a patch with the given taxels in node coordinates
+       * and the ray that is cast from every taxel.
+       * \return the id of the patch
+       */
+      unsigned long addPatch(const std::vector<utils::Vector> &points,
+                             const utils::Vector &ray);
+      void removePatch(unsigned long id);
+      void setPatchState(unsigned long id, const utils::Vector &position,
+                         const utils::Quaternion &orientation, bool contact,
+                         double contactForce);
+
+      /** \brief Copies the forces of the patch to \c forces, which has to
+       * hold one value per taxel. \return the number of taxels */
+      size_t getForces(unsigned long id, double *forces);
+      /** \brief Copies the weights (1 - distance/ray length) of the patch. */
+      size_t getWeights(unsigned long id, double *weights);
+      double getForceSum(unsigned long id);
+
+      /** \brief Evaluates the patches whose state has changed. */
+      void update();
+
+      virtual void receiveData(const data_broker::DataInfo &info,
+                               const data_broker::DataPackage &package,
+                               int callbackParam);
+
+    private:
+      struct Patch {
+        size_t offset, count;
+        utils::Vector position;
+        utils::Quaternion orientation;
+        utils::Vector ray;
+        double contactForce, forceSum;
+        bool contact, pending;
+      };
+
+      explicit HapticFieldEngine(interfaces::ControlCenter *control);
+      ~HapticFieldEngine();
+
+      void registerTimer();
+      Patch* findPatch(unsigned long id);
+
+      static std::map<interfaces::ControlCenter*, HapticFieldEngine*> engines;
+      static utils::Mutex enginesMutex;
+
+      interfaces::ControlCenter *control;
+      int references;
+      utils::Mutex mutex;
+      unsigned long nextId;
+      std::map<unsigned long, Patch> patches;
+      // taxels in node coordinates and their state, patch after patch
+      std::vector<double> localX, localY, localZ;
+      std::vector<double> weights, forces;
+      // rays of the patches evaluated by update()
+      std::vector<double> rayPos[3], rayDir[3], depths;
+    }; // end of class HapticFieldEngine
+
+  } // end of namespace sim
+} // end of namespace mars
+
+#endif // HAPTICFIELDENGINE_H
@@ -27,6 +27,7 @@
  */
 
 #include "HapticFieldSensor.h"
+#include "HapticFieldEngine.h"
 #include <mars/data_broker/DataBrokerInterface.h>
 #include <mars/interfaces/sensor_bases.h>
 #include <mars/interfaces/sim/NodeManagerInterface.h>
@@ -70,6 +71,8 @@ namespace mars {
       fieldheight = config.rows * config.stepY;
       forces.resize(config.cols*config.rows, 0.0);
       weights.resize(config.cols*config.rows, 1.0);
+      engine = NULL;
+      patchId = 0;
 
       //control->nodes->addNodeSensor(this); //register sensor with NodePhysics
 
@@ -79,7 +82,7 @@ namespace mars {
       control->dataBroker->registerTimedReceiver(this, groupName, dataName, "mars_sim/simTimer",
           updateRate);
       dbPackage.add("id", (long) config.id);
-      char nametag[7];
+      char nametag[16];
       for (int c = 0; c < config.cols; c++) {
         for (int r = 0; r < config.rows; r++) {
           sprintf(nametag, "%3d/%3d", c, r);
@@ -103,6 +106,10 @@ namespace mars {
           sensorpoints.push_back(offset);
         }
       }
+      // added after the receiver is registered, so the engine evaluates
+      // the patch after receiveData() in the same step
+      engine = HapticFieldEngine::acquire(control);
+      patchId = engine->addPatch(sensorpoints, ray);
 
       drawStruct draw;
       draw_item item;
@@ -140,32 +147,26 @@ namespace mars {
       control->graphics->removeDrawItems((DrawInterface*) this);
       control->dataBroker->unregisterTimedReceiver(this, "*", "*", "mars_sim/simTimer");
       control->dataBroker->unregisterTimedProducer(this, "*", "*", "mars_sim/simTimer");
+      engine->removePatch(patchId);
+      HapticFieldEngine::release(engine);
     }
 
     int HapticFieldSensor::getAsciiData(char* data) const {
-      sReal contact = 0;
-      std::vector<double>::const_iterator iter;
-
-      for (iter = forces.begin(); iter != forces.end(); iter++) {
-        contact += *iter;
-      }
-      sprintf(data, " %9.3f", contact);
+      sprintf(data, " %9.3f", engine->getForceSum(patchId));
       return 10;
     }
 
     int HapticFieldSensor::getSensorData(sReal** data) const {
-      sReal contact = 0;
-      std::vector<double>::const_iterator iter;
-
       *data = (sReal*) malloc(sizeof(sReal));
-      for (iter = forces.begin(); iter != forces.end(); iter++) {
-        contact += *iter;
-        ;
-      }
-      **data = contact;
+      **data = engine->getForceSum(patchId);
       return 1;
     }
 
+    int HapticFieldSensor::getForceField(sReal** data) const {
+      *data = (sReal*) malloc(sensorpoints.size()*sizeof(sReal));
+      return engine->getForces(patchId, *data);
+    }
+
     void HapticFieldSensor::receiveData(const data_broker::DataInfo &info,
         const data_broker::DataPackage &package, int callbackParam) {
       if (contactForceIndex == -1) {
@@ -174,13 +175,6 @@ namespace mars {
       }
       package.get(contactForceIndex, &contactForce);
       package.get(contactIndex, &contact);
-      if (contact) {
-        computeForces();
-      } else {
-        for (std::vector<double>::iterator it = forces.begin(); it < forces.end(); ++it) {
-          *it = 0;
-        }
-      }
 
       if (positionIndices[0] == -1) {
         positionIndices[0] = package.getIndexByName("position/x");
@@ -200,19 +194,19 @@ namespace mars {
       package.get(rotationIndices[2], &orientation.z());
       package.get(rotationIndices[3], &orientation.w());
 
+      // the forces are computed by the engine after all sensors of the step
+      engine->setPatchState(patchId, position, orientation, contact, contactForce);
       haveUpdate = true;
     }
 
     void HapticFieldSensor::produceData(const data_broker::DataInfo &info,
         data_broker::DataPackage *dbPackage, int callbackParam) {
-      Vector tmp;
       dbPackage->set(0, (long) id);
-      fprintf(stderr, "  HapticFieldSensor: ");
+      if (forces.empty()) return;
+      engine->getForces(patchId, &forces[0]);
       for (size_t i = 0; i < forces.size(); ++i) {
-        dbPackage->set(i + 1, forces.at(i));
-        fprintf(stderr, "%g, ", forces.at(i));
+        dbPackage->set(i + 1, forces[i]);
       }
-      fprintf(stderr, "\n");
     }
 
     void HapticFieldSensor::update(std::vector<draw_item>* drawItems) {
@@ -222,6 +216,7 @@ namespace mars {
           haveUpdate = false;
         }
         if (!(*drawItems)[0].draw_state) {
+          if (!weights.empty()) engine->getWeights(patchId, &weights[0]);
           for (size_t i = 0; i < sensorpoints.size(); ++i) {
               (*drawItems)[i].draw_state = DRAW_STATE_UPDATE;
               (*drawItems)[i].start = position + orientation*(sensorpoints[i]);
@@ -250,32 +245,5 @@ namespace mars {
       //      }
     }
 
-    void HapticFieldSensor::computeForces() {
-      // FIXME: add mutex here?
-      double weightSum = 0;
-      double weight = 0;
-      double distance = 0;
-      Vector pos, ray;
-      int i = 0;
-      //fprintf(stderr, "weights:\n");
-      for (int c = 0; c < config.cols; ++c) {
-        for (int r = 0; r < config.rows; ++r) {
-          i = c*config.rows+r;
-          pos = position + orientation*(sensorpoints.at(i));
-          ray = orientation*this->ray;
-          distance = control->sim->getPhysics()->getVectorCollision(pos, ray);
-          weight = 1 - distance/maxDistance; // = (maxDistance-distance)/maxDistance
-          weights.at(c*config.rows+r) = weight;
-//          fprintf(stderr, "%6g ", weight);
-          weightSum += weight;
-        }
-//        fprintf(stderr, "\n");
-      }
-      double forceQuant = contactForce / weightSum;
-      for (size_t i = 0; i < forces.size(); ++i) {
-        forces.at(i) = weights.at(i) * forceQuant;
-      }
-    }
-
   } // end of namespace sim
 } // end of namespace mars
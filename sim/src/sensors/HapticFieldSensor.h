@@ -42,6 +42,8 @@
 namespace mars {
   namespace sim {
 
+    class HapticFieldEngine;
+
     class HapticFieldConfig : public interfaces::BaseConfig{
     public:
       HapticFieldConfig(){
@@ -90,6 +92,8 @@ namespace mars {
 
       virtual int getAsciiData(char* data) const;
       virtual int getSensorData(interfaces::sReal** data) const;
+      /** \brief Returns the forces of all taxels, column after column. */
+      int getForceField(interfaces::sReal** data) const;
       virtual void receiveData(const data_broker::DataInfo &info,
           const data_broker::DataPackage &package, int callbackParam);
       virtual void produceData(const data_broker::DataInfo &info,
@@ -105,7 +109,6 @@ namespace mars {
 
     private:
 
-      void computeForces();
       //std::map<unsigned long, double> contact_forces; // <id of node in contact, force exerted by said node>
       interfaces::drawStruct draw;
       int contactForceIndex, contactIndex;
@@ -116,8 +119,11 @@ namespace mars {
       long rotationIndices[4];
       std::vector<utils::Vector> sensorpoints;
       utils::Vector ray;
+      // copies of the state of the patch in the engine
       std::vector<double> forces;
       std::vector<double> weights;
+      HapticFieldEngine *engine;
+      unsigned long patchId;
       double fieldwidth, fieldheight;
       HapticFieldConfig config;
       data_broker::DataPackage dbPackage;
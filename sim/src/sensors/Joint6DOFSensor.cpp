@@ -160,8 +160,9 @@ namespace mars {
         dbPushId = control->dataBroker->pushData("mars_sim", text,
                                            dbPackage, NULL,
                                            data_broker::DATA_PACKAGE_READ_FLAG);
+        // the SensorManager calls the producer one step after the receivers
         control->dataBroker->registerTimedProducer(this, "mars_sim", text,
-                                             "mars_sim/simTimer", 0);     
+                                             "mars_sim/simTimer", updateRate);
     }    
 
     Joint6DOFSensor::~Joint6DOFSensor(void) 
@@ -29,6 +29,9 @@
 #include <cstdio>
 #include "JointAVGTorqueSensor.h"
 
+#include <mars/interfaces/sim/JointInterface.h>
+#include <mars/interfaces/sim/JointManagerInterface.h>
+
 namespace mars {
   namespace sim {
 
@@ -49,6 +52,10 @@ namespace mars {
 
       torqueIndices[0] = -1;
       typeName = "JointAVGTorque";
+      std::vector<unsigned long>::iterator it;
+      for(it=config.ids.begin(); it!=config.ids.end(); ++it) {
+        control->joints->requestFeedback(*it, JOINT_FEEDBACK_AXIS_TORQUE);
+      }
       dbPackage.add("id", (long)config.id);
       dbPackage.add("torque", 0.0);
       char text[55];
@@ -57,8 +64,10 @@ namespace mars {
                                     dbPackage, NULL,
                                     data_broker::DATA_PACKAGE_READ_FLAG);
 
+      // the SensorManager calls the producer one step after the receivers
       control->dataBroker->registerTimedProducer(this, "mars_sim", text,
-                                                 "mars_sim/simTimer", 0);
+                                                 "mars_sim/simTimer",
+                                                 updateRate);
     }
 
     JointAVGTorqueSensor::~JointAVGTorqueSensor(void) {
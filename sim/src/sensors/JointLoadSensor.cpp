@@ -30,6 +30,9 @@
 
 #include "JointLoadSensor.h"
 
+#include <mars/interfaces/sim/JointInterface.h>
+#include <mars/interfaces/sim/JointManagerInterface.h>
+
 namespace mars {
   namespace sim {
 
@@ -48,6 +51,10 @@ namespace mars {
       JointArraySensor(control, config) {
 
       typeName = "JointLoad";
+      std::vector<unsigned long>::iterator it;
+      for(it=config.ids.begin(); it!=config.ids.end(); ++it) {
+        control->joints->requestFeedback(*it, JOINT_FEEDBACK_LOAD);
+      }
       loadIndices[0] = -1;
       dbPackage.add("id", (long)config.id);
       dbPackage.add("load", 0.0);
@@ -56,8 +63,10 @@ namespace mars {
       control->dataBroker->pushData("mars_sim", text,
                                     dbPackage, NULL,
                                     data_broker::DATA_PACKAGE_READ_FLAG);
+      // the SensorManager calls the producer one step after the receivers
       control->dataBroker->registerTimedProducer(this, "mars_sim", text,
-                                                 "mars_sim/simTimer", 0);
+                                                 "mars_sim/simTimer",
+                                                 updateRate);
     }
 
     JointLoadSensor::~JointLoadSensor(void) {
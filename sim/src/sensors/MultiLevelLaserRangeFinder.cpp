@@ -12,6 +12,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <algorithm>
+#include <map>
 
 namespace mars {
   namespace sim {
@@ -66,7 +67,9 @@ MultiLevelLaserRangeFinder::MultiLevelLaserRangeFinder(ControlCenter *control, M
 
             std::cout << "Computing width an height for laser depth image to " << rttWidth << " " << rttHeight << std::endl; 
 
-            long cam_window_id = control->graphics->new3DWindow(0, true, rttWidth, rttHeight, name);
+            // the sub cameras are drawn in one pass as tiles of a shared target
+            long cam_window_id = control->graphics->new3DWindowTile("MultiLevelLaserRangeFinder",
+                                                                    rttWidth, rttHeight, name);
 
 //          interfaces::hudElementStruct hudCam;
 //          hudCam.type            = HUD_ELEMENT_TEXTURE;
@@ -108,7 +111,6 @@ MultiLevelLaserRangeFinder::MultiLevelLaserRangeFinder(ControlCenter *control, M
             rs->gc = gc;
             rs->rttWidth = rttWidth;
             rs->rttHeight = rttHeight;
-            rs->depthBuffer.resize(rttHeight * rttWidth);
             rs->coveredAngle = curWidth;
             
             rs->distImage.setSize(rttWidth, rttHeight);
@@ -226,8 +228,13 @@ void MultiLevelLaserRangeFinder::calculateSamplingPixels()
     for(std::vector<RaySubSensor>::iterator it = subSensors.begin(); it != subSensors.end();it++)
     {
         std::fill(it->distImage.data.begin(), it->distImage.data.end(), 1.0);
+        it->samplePixels.clear();
     }
     
+    //index of each pixel in the sample list of its sub sensor, rays
+    //hitting the same pixel share the sample
+    std::map<std::pair<RaySubSensor*, int>, int> pixelSamples;
+    
     
     // Run through the image horizontally.  
     for(int h = 0; h < config.numRaysHorizontal; h++)
@@ -243,10 +250,28 @@ void MultiLevelLaserRangeFinder::calculateSamplingPixels()
             
             int y = tan(verAngle) / cos(curHorAngle) * b_y + (config.rttResolutionY / 2.0);
             
+            //the rays at the border of a camera hit the pixel next to the image
+            x = std::min(std::max(x, 0), config.rttResolutionX - 1);
+            y = std::min(std::max(y, 0), config.rttResolutionY - 1);
+            
             Lookup &lookup(lookups[v + (config.numRaysHorizontal - h - 1) * config.numRaysVertical]);
             lookup.x = x;
             lookup.y = y;
             lookup.sensor = &(*it);
+            
+            const int pixel = y * config.rttResolutionX + x;
+            std::map<std::pair<RaySubSensor*, int>, int>::iterator sampleIt;
+            sampleIt = pixelSamples.find(std::make_pair(&(*it), pixel));
+            if(sampleIt == pixelSamples.end())
+            {
+                lookup.sample = it->samplePixels.size();
+                it->samplePixels.push_back(pixel);
+                pixelSamples[std::make_pair(&(*it), pixel)] = lookup.sample;
+            }
+            else
+            {
+                lookup.sample = sampleIt->second;
+            }
 
             Eigen::Vector3d dirVec;
             bool result = it->distImage.getScenePoint(x, y, dirVec);
@@ -269,6 +294,14 @@ void MultiLevelLaserRangeFinder::calculateSamplingPixels()
     
     std::cout << "Got " << lookups.size() << " lookup " << std::endl;
     
+    //only the sampled pixels are read back from the depth images
+    for(std::vector<RaySubSensor>::iterator it = subSensors.begin(); it != subSensors.end();it++)
+    {
+        it->depthBuffer.resize(it->samplePixels.size());
+        if(it->gw)
+            it->gw->setRTTDepthSamples(it->samplePixels);
+    }
+    
 }
 
 
@@ -277,14 +310,13 @@ void MultiLevelLaserRangeFinder::update(std::vector<draw_item>* drawItems) {
     
 //     std::cout << "Update Called " << std::endl;
     
-    //update distance images
+    //read the distances of the sampled pixels
     for(std::vector<RaySubSensor>::iterator it = subSensors.begin(); it != subSensors.end();it++)
     {
-        it->gw->getRTTDepthData(it->distImage.data.data(), config.rttResolutionX, config.rttResolutionY);
+        if(!it->samplePixels.empty())
+            it->gw->getRTTDepthSamples(it->depthBuffer.data());
     }
     
-    const int width = config.rttResolutionX;
-    
     int validCnt = 0;
     
     for(int h = 0; h < config.numRaysHorizontal; h++)
@@ -294,20 +326,10 @@ void MultiLevelLaserRangeFinder::update(std::vector<draw_item>* drawItems) {
             const int curScanPos = h*config.numRaysVertical + v;
             Lookup &lookup(lookups[curScanPos]);
             
-            const int &x(lookup.x);
-            const int &y(lookup.y);
-            
-            const int curImagePos = y*width + x;
-            
-            const float &dist(lookup.sensor->distImage.data[curImagePos]);
+            const float &dist(lookup.sensor->depthBuffer[lookup.sample]);
             if(boost::math::isnormal( dist ))
             {
                 rayValues[curScanPos] = (dist * lookup.directionVector).norm();
-                
-                Eigen::Vector3d p;
-                lookup.sensor->distImage.getScenePoint(x, y, p);
-                
-                assert(fabs(p.norm() -  rayValues[curScanPos]) < 0.0001);
                 validCnt++;
             }
             else
@@ -83,6 +83,8 @@ namespace mars {
             interfaces::GraphicsWindowInterface *gw;
             interfaces::GraphicsCameraInterface *gc;
             base::samples::DistanceImage distImage;
+            // the pixels read from the depth image and their distances
+            std::vector<int> samplePixels;
             std::vector<float> depthBuffer;
             int rttWidth;
             int rttHeight;
@@ -95,6 +97,7 @@ namespace mars {
             int x;
             int y;
             struct RaySubSensor *sensor;
+            int sample;
             utils::Vector directionVector;
         };
         
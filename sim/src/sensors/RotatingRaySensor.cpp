@@ -44,6 +44,8 @@
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <algorithm>
+#include <limits>
 
 namespace mars {
   namespace sim {
@@ -82,10 +84,6 @@ namespace mars {
       full_scan = false;
       current_pose.setIdentity();
       num_points = 0;
-      toCloud = &pointcloud1;
-      toDepthMap = &partialDepthMaps1;
-      convertPointCloud = false;
-      nextCloud = 2;
       update_available = false;
       for(int i = 0; i < 3; ++i)
         positionIndices[i] = -1;
@@ -105,8 +103,6 @@ namespace mars {
       turning_step = config.horizontal_resolution; 
       vertical_resolution = config.lasers <= 1 ? 0 : config.opening_height/(config.lasers -1);
       // Initialize DepthMap 
-      partialDepthMaps1 = std::vector<base::samples::DepthMap>(config.bands);
-      partialDepthMaps2 = std::vector<base::samples::DepthMap>(config.bands);
       finalDepthMap = base::samples::DepthMap();
       double limitVAngle = config.lasers <= 1 ? 0.0 : config.opening_height/2.0;
       std::vector<double> vertical_interval;
@@ -121,6 +117,48 @@ namespace mars {
       finalDepthMap.horizontal_size = (2.0*M_PI)/config.horizontal_resolution;
       LOG_DEBUG("Horizontal size from config is: %d", finalDepthMap.horizontal_size );
       LOG_DEBUG("Horizontal by vertical size: %d", finalDepthMap.horizontal_size*finalDepthMap.vertical_size );
+      initScanPool();
+    }
+
+    void RotatingRaySensor::initScanPool(){
+      // Reserves the expected size of one scan; receiveData is called
+      // with the update rate, which may differ from the turning rate, so
+      // the buffers may still grow during the first scans.
+      size_t samples = 1;
+      if(turning_step > 0) {
+        samples += (size_t)ceil(turning_end_fullscan / turning_step);
+      }
+      size_t points = samples * config.bands * config.lasers;
+      freeScans.clear();
+      pendingScans.clear();
+      freeScans.reserve(scanPoolSize);
+      for(int i = 0; i < scanPoolSize; ++i) {
+        ScanBuffer &scan = scanPool[i];
+        scan.pose.setIdentity();
+        if(config.provide_pointcloud) {
+          scan.x.reserve(points);
+          scan.y.reserve(points);
+          scan.z.reserve(points);
+        }
+        scan.distances.resize(config.bands);
+        scan.timestamps.resize(config.bands);
+        if(config.provide_depthmap) {
+          for(int b = 0; b < config.bands; ++b) {
+            scan.distances[b].reserve(samples * config.lasers);
+            scan.timestamps[b].reserve(samples);
+          }
+        }
+        if(i > 0) freeScans.push_back(&scan);
+      }
+      fillScan = &scanPool[0];
+      if(config.provide_pointcloud) {
+        pointcloud_next.reserve(points);
+        pointcloud_full.reserve(points);
+      }
+      if(config.provide_depthmap) {
+        depthmap_next.distances.reserve(samples * config.bands * config.lasers);
+        depthmap_next.timestamps.reserve(samples * config.bands);
+      }
     }
 
    void RotatingRaySensor::setSensorPos(){
@@ -214,7 +252,11 @@ namespace mars {
     RotatingRaySensor::~RotatingRaySensor(void) {
       control->graphics->removeDrawItems((DrawInterface*)this);
       control->dataBroker->unregisterTimedReceiver(this, "*", "*", "mars_sim/simTimer");
+      mutex_pointcloud.lock();
       closeThread = true;
+      scanQueued.wakeAll();
+      scanFreed.wakeAll();
+      mutex_pointcloud.unlock();
       this->wait();
     }
 
@@ -257,13 +299,13 @@ namespace mars {
         depthMap.vertical_interval = finalDepthMap.vertical_interval;
         depthMap.vertical_size = finalDepthMap.vertical_size;
         depthMap.horizontal_size = finalDepthMap.horizontal_size;
-        depthMap.timestamps.resize(finalDepthMap.timestamps.size());
-        for(unsigned i = 0; i < finalDepthMap.timestamps.size(); i++)
-            depthMap.timestamps[(depthMap.timestamps.size()-1)-i] = finalDepthMap.timestamps[i];
+        depthMap.timestamps.swap(finalDepthMap.timestamps);
+        std::reverse(depthMap.timestamps.begin(), depthMap.timestamps.end());
+        // the vectors of the consumer are handed back and reused for the
+        // next scan
         depthMap.distances.swap(finalDepthMap.distances);
-        base::samples::DepthMap::DepthMatrix distances = depthMap.getDistanceMatrixMap();
         for(unsigned i = 0; i < depthMap.vertical_size; i++)
-                depthMap.getDistanceMatrixMap().block(i,0,1,depthMap.horizontal_size) = distances.block(i,0,1,depthMap.horizontal_size).reverse();
+                depthMap.getDistanceMatrixMap().row(i).reverseInPlace();
         finalDepthMap.distances.clear();
         finalDepthMap.timestamps.clear();
         finalDepthMap.remissions.clear();
@@ -323,43 +365,43 @@ namespace mars {
       assert((int)data.size() == config.bands * config.lasers);
       int i = 0; // data_counter
       float local_dist;
+      ScanBuffer &scan = *fillScan;
       if (config.provide_depthmap)
       {
         base::Time timestamp = base::Time::fromMilliseconds(control->sim->getTime());
-        std::vector<base::samples::DepthMap> &partialDepthMaps = *toDepthMap; 
         for(int b=0; b<config.bands; ++b) {
-          partialDepthMaps[b].timestamps.push_back(timestamp);
+          scan.timestamps[b].push_back(timestamp);
+          std::vector<float> &distances = scan.distances[b];
           for(int col=0; col<config.lasers; col++, ++i){
-            local_dist = (orientation_offset * directions[i] * data[i]).norm();
+            // the directions are normalized
+            local_dist = std::fabs(data[i]);
             if(local_dist < config.minDistance)
-              partialDepthMaps[b].distances.push_back(0.f);
+              distances.push_back(0.f);
             else if(local_dist >= config.maxDistance)
-              partialDepthMaps[b].distances.push_back(std::numeric_limits<float>::infinity());
+              distances.push_back(std::numeric_limits<float>::infinity());
             else
-              partialDepthMaps[b].distances.push_back(local_dist);
+              distances.push_back(local_dist);
           }
         }
       }
       i = 0;
       if  (config.provide_pointcloud)
       {
-        utils::Vector local_ray, tmpvec;
-        for(int b=0; b<config.bands; ++b) {
-          base::Orientation base_orientation;
-          base_orientation.x() = orientation_offset.x();
-          base_orientation.y() = orientation_offset.y();
-          base_orientation.z() = orientation_offset.z();
-          base_orientation.w() = orientation_offset.w();
-          // If min/max are exceeded distance will be ignored.
-          for(int l=0; l<config.lasers; ++l, ++i){
-            if (data[i] >= config.minDistance && data[i] <= config.maxDistance) {
-              // Calculates the ray/vector within the sensor frame.
-              local_ray = orientation_offset * directions[i] * data[i];
-              // Gathers pointcloud in the world frame to prevent/reduce movement distortion.
-              // This necessitates a back-transformation (world2node) in getPointcloud().
-              tmpvec = current_pose * local_ray;
-              toCloud->push_back(tmpvec); // Scale normalized vector.
-            }
+        // Gathers pointcloud in the world frame to prevent/reduce movement distortion.
+        // This necessitates a back-transformation (world2node) in prepareFinalPointcloud().
+        poseMutex.lock();
+        Eigen::Affine3d tf = current_pose * orientation_offset;
+        poseMutex.unlock();
+        const Eigen::Matrix3d rot = tf.linear();
+        const Eigen::Vector3d trans = tf.translation();
+        utils::Vector tmpvec;
+        // If min/max are exceeded distance will be ignored.
+        for(int n=config.bands*config.lasers; i<n; ++i){
+          if (data[i] >= config.minDistance && data[i] <= config.maxDistance) {
+            tmpvec = rot * (directions[i] * data[i]) + trans;
+            scan.x.push_back(tmpvec.x());
+            scan.y.push_back(tmpvec.y());
+            scan.z.push_back(tmpvec.z());
           }
         }
       }
@@ -392,24 +434,23 @@ namespace mars {
 
     utils::Quaternion RotatingRaySensor::turn() {  
       
-      // If the scan is full the pointcloud will be copied.
+      // If the scan is full it is queued for the conversion thread.
       mutex_pointcloud.lock();
       turning_offset += turning_step;
       if(turning_offset >= turning_end_fullscan) {
-        while(convertPointCloud) msleep(1);
-        fromCloud = toCloud;
-        fromDepthMap = toDepthMap;
-        if(nextCloud == 2) {
-          toCloud = &pointcloud2;
-          toDepthMap = &partialDepthMaps2;
-          nextCloud = 1;
+        // only blocks if the conversion is more than a full scan behind
+        while(freeScans.empty() && !closeThread) {
+          scanFreed.wait(&mutex_pointcloud);
         }
-        else {
-          toCloud = &pointcloud1;
-          toDepthMap = &partialDepthMaps1;
-          nextCloud = 2;
+        if(!freeScans.empty()) {
+          poseMutex.lock();
+          fillScan->pose = current_pose;
+          poseMutex.unlock();
+          pendingScans.push_back(fillScan);
+          fillScan = freeScans.back();
+          freeScans.pop_back();
+          scanQueued.wakeOne();
         }
-        convertPointCloud = true;
         turning_offset = 0;
       }
       orientation_offset = utils::angleAxisToQuaternion(turning_offset, utils::Vector(0.0, 0.0, 1.0));
@@ -422,81 +463,117 @@ namespace mars {
       return config.bands * config.lasers;
     }
 
-    void RotatingRaySensor::prepareFinalPointcloud(){
-      // Copies current full pointcloud to pointcloud_full.
-      poseMutex.lock();
-      Eigen::Affine3d current_pose2 = current_pose;
+    void RotatingRaySensor::transformPoints(const Eigen::Affine3d &tf,
+                                            const ScanBuffer &scan,
+                                            std::vector<utils::Vector> *points) {
+      const size_t n = scan.x.size();
+      points->resize(n);
+      const Eigen::Matrix4d m = tf.matrix();
+      const double *x = scan.x.data();
+      const double *y = scan.y.data();
+      const double *z = scan.z.data();
+      // Vector is three packed doubles, so the output is written as a
+      // flat array the compiler can vectorize
+      double *out = (*points)[0].data();
+      for(size_t i = 0; i < n; ++i) {
+        out[3*i]   = m(0,0)*x[i] + m(0,1)*y[i] + m(0,2)*z[i] + m(0,3);
+        out[3*i+1] = m(1,0)*x[i] + m(1,1)*y[i] + m(1,2)*z[i] + m(1,3);
+        out[3*i+2] = m(2,0)*x[i] + m(2,1)*y[i] + m(2,2)*z[i] + m(2,3);
+      }
+    }
+
+    void RotatingRaySensor::prepareFinalPointcloud(const ScanBuffer &scan){
+      // Transforms the pointcloud back from world to the node pose at the
+      // end of the scan (see receiveData()).
+      // In addition 'transf_sensor_rot_to_sensor' is applied which describes
+      // the orientation of the sensor in the unturned sensor frame.
       Eigen::Affine3d rot;
       rot.setIdentity();
       rot.rotate(config.transf_sensor_rot_to_sensor);
-      poseMutex.unlock();
-      std::list<utils::Vector>::iterator it = fromCloud->begin();
-      pointcloud_full.clear();
-      pointcloud_full.reserve(fromCloud->size());
-      base::Vector3d vec_local;
-      for(int i=0; it != fromCloud->end(); it++, i++) {
-        // Transforms the pointcloud back from world to current node (see receiveDate()).
-        // In addition 'transf_sensor_rot_to_sensor' is applied which describes
-        // the orientation of the sensor in the unturned sensor frame.
-        vec_local = rot * current_pose2.inverse() * (*it);
-        pointcloud_full.push_back(vec_local);
+      if(scan.x.empty()) {
+        pointcloud_next.clear();
+        return;
       }
-      //LOG_DEBUG("[RotatingRaySensor::prepareFinalPointcloud]: Pointcloud size: %d", pointcloud_full.size());
-      fromCloud->clear();
+      transformPoints(rot * scan.pose.inverse(), scan, &pointcloud_next);
     }
 
-    void RotatingRaySensor::prepareFinalDepthMap(){
-      std::vector<base::samples::DepthMap> &partialDepthMaps = *fromDepthMap; 
+    void RotatingRaySensor::prepareFinalDepthMap(ScanBuffer &scan){
+      std::vector<base::Time> &timestamps = depthmap_next.timestamps;
+      std::vector<float> &distances = depthmap_next.distances;
+      size_t num_samples = 0;
+      for(int b=0; b<config.bands; b++){
+        num_samples += scan.timestamps[b].size();
+      }
+      timestamps.resize(num_samples);
+      distances.resize(num_samples*config.lasers);
 
+      size_t index = 0;
       for(int b=0; b<config.bands; b++){
-        //LOG_DEBUG("Num samples in partial depthmap %d: %d", b, partialDepthMaps[b].timestamps.size());
-        for(unsigned int sample=0; sample < partialDepthMaps[b].timestamps.size(); sample++){
-          finalDepthMap.timestamps.push_back(partialDepthMaps[b].timestamps[sample]);
+        for(size_t sample=0; sample < scan.timestamps[b].size(); sample++){
+          timestamps[index++] = scan.timestamps[b][sample];
         }
       }
+      // The partial maps are stored sample wise, the final one laser wise.
       int partial_row_size = config.lasers;
+      index = 0;
       for (int laser_i=0; laser_i<config.lasers; laser_i++){
         for(int b=0; b<config.bands; b++){
-          int partial_num_samples = partialDepthMaps[b].timestamps.size();
-          //LOG_DEBUG("Partial DepthMap: %d ", b);
-          //LOG_DEBUG("Partial num samples: %d", partial_num_samples);
-          //LOG_DEBUG("Distances size: %d", partialDepthMaps[b].distances.size());
-          //LOG_DEBUG("partialDepthMaps1[b] timestamps size: %d", partialDepthMaps1[b].timestamps.size() );
-          //LOG_DEBUG("partialDepthMaps2[b] timestamps size: %d", partialDepthMaps2[b].timestamps.size() );
-          for (int sample_i=0; sample_i<partial_num_samples; sample_i++){
-            // We have to invert the coordinates
-            finalDepthMap.distances.push_back(partialDepthMaps[b].distances[sample_i*partial_row_size + laser_i]);
+          const float *partial = scan.distances[b].data();
+          size_t partial_num_samples = scan.timestamps[b].size();
+          for (size_t sample_i=0; sample_i<partial_num_samples; sample_i++){
+            distances[index++] = partial[sample_i*partial_row_size + laser_i];
           }
         }
       }
-      for(int b=0; b<config.bands; b++){
-        partialDepthMaps[b].distances.clear();
-        partialDepthMaps[b].timestamps.clear();
-      }
-      //LOG_DEBUG("The final depthMap has a distances size of: %d", finalDepthMap.distances.size());
-      //LOG_DEBUG("The final depthMap has %d timestamps", finalDepthMap.timestamps.size());
-      //LOG_DEBUG("The final depthMap has %d vertical size", finalDepthMap.vertical_size);
-      //LOG_DEBUG("The final depthMap timestamps multiplied by the number laser should be equal to the number of distances: %d", finalDepthMap.timestamps.size()*finalDepthMap.vertical_size);
-      finalDepthMap.time = base::Time::fromMilliseconds(control->sim->getTime());
-      finalDepthMap.horizontal_size = finalDepthMap.timestamps.size();
+      depthmap_next.time = base::Time::fromMilliseconds(control->sim->getTime());
     }
 
     void RotatingRaySensor::run() {
+      mutex_pointcloud.lock();
       while(!closeThread) {
-        if(convertPointCloud) { 
-          if (config.provide_pointcloud)
-          {
-            prepareFinalPointcloud();
-          }
-          if (config.provide_depthmap)
-          {
-            prepareFinalDepthMap();
-          }
-          convertPointCloud = false;
-          full_scan = true;
+        if(pendingScans.empty()) {
+          scanQueued.wait(&mutex_pointcloud);
+          continue;
         }
-        else msleep(2);
+        ScanBuffer *scan = pendingScans.front();
+        pendingScans.pop_front();
+        mutex_pointcloud.unlock();
+
+        if (config.provide_pointcloud)
+        {
+          prepareFinalPointcloud(*scan);
+        }
+        if (config.provide_depthmap)
+        {
+          prepareFinalDepthMap(*scan);
+        }
+        scan->x.clear();
+        scan->y.clear();
+        scan->z.clear();
+        for(int b=0; b<config.bands; b++){
+          scan->distances[b].clear();
+          scan->timestamps[b].clear();
+        }
+
+        mutex_pointcloud.lock();
+        // an unfetched previous scan is replaced by the new one
+        if (config.provide_pointcloud)
+        {
+          pointcloud_full.swap(pointcloud_next);
+        }
+        if (config.provide_depthmap)
+        {
+          finalDepthMap.distances.swap(depthmap_next.distances);
+          finalDepthMap.timestamps.swap(depthmap_next.timestamps);
+          finalDepthMap.time = depthmap_next.time;
+          finalDepthMap.horizontal_size = finalDepthMap.timestamps.size();
+          depthmap_sent = false;
+        }
+        full_scan = true;
+        freeScans.push_back(scan);
+        scanFreed.wakeOne();
       }
+      mutex_pointcloud.unlock();
     }
 
     BaseConfig* RotatingRaySensor::parseConfig(ControlCenter *control,
@@ -39,11 +39,14 @@
 #include <mars/utils/Thread.h>
 #include <mars/utils/mathUtils.h>
 #include <mars/utils/Mutex.h>
+#include <mars/utils/WaitCondition.h>
 #include <mars/interfaces/graphics/draw_structs.h>
 
 #include <base/Pose.hpp>
 #include <base/samples/DepthMap.hpp>
 
+#include <deque>
+
 namespace mars {
   namespace sim {
 
@@ -164,9 +167,9 @@ namespace mars {
       /**
        * Turns the sensor during each simulation step.
        * As soon as a full scan has been done (depends on the number of bands)
-       * the pointcloud is copied to pointcloud_full and a new scan
-       * is initiated. Runs in the same thread than receiveData, so only the use of 
-       * full_pointcloud (turn(), getPointcloud() and getSensorData()) has to be 
+       * the filled scan buffer is handed to the conversion thread and a new
+       * scan is started in a free buffer of the pool. Runs in the same thread
+       * than receiveData, so only the exchange of the buffers has to be
        * synchronized.
        */
       utils::Quaternion turn();
@@ -192,21 +195,42 @@ namespace mars {
       void validateConfigVals();
       void computeRaysDirectionsAndPrepareDraw();
       void pushDrawRayItem(const utils::Vector &tmp, mars::interfaces::drawStruct &draw);
-      void prepareFinalPointcloud();
-      void prepareFinalDepthMap();
 
     private:
+      /**
+       * One scan as gathered by receiveData(). The points are stored in the
+       * world frame as separate coordinate arrays. The buffers are recycled
+       * and only cleared, so after the first scans no memory is allocated.
+       */
+      struct ScanBuffer {
+        std::vector<double> x, y, z;
+        // per band: lasers distances per sample and one timestamp per sample
+        std::vector<std::vector<float> > distances;
+        std::vector<std::vector<base::Time> > timestamps;
+        Eigen::Affine3d pose; // sensor pose at the end of the scan
+      };
+      /** Number of preallocated scans: filling, queued and converting. */
+      static const int scanPoolSize = 3;
+
+      void initScanPool();
+      void prepareFinalPointcloud(const ScanBuffer &scan);
+      void prepareFinalDepthMap(ScanBuffer &scan);
+      static void transformPoints(const Eigen::Affine3d &tf,
+                                  const ScanBuffer &scan,
+                                  std::vector<utils::Vector> *points);
+
       /** Contains the normalized scan directions. */ 
       std::vector<utils::Vector> directions;
-      // TODO Storing the pointcloud four times is not very effective.
-      // Maybe: Integrate distortion-prevention (use current sensor pose)
-      // in mlls and only create the pointcloud on demand.
-      std::list<utils::Vector> pointcloud1; // TODO Replace with array with fix size.
-      std::list<utils::Vector> pointcloud2; // TODO Replace with array with fix size.
-      std::list<utils::Vector> *toCloud, *fromCloud; // TODO Replace with array with fix size.
+      ScanBuffer scanPool[scanPoolSize];
+      ScanBuffer *fillScan; // only used by the simulation thread
+      std::vector<ScanBuffer*> freeScans;
+      std::deque<ScanBuffer*> pendingScans;
+      utils::WaitCondition scanQueued, scanFreed;
+      // written by the conversion thread and swapped into the final
+      // results, thus finished scans reach the consumer without a copy
+      std::vector<utils::Vector> pointcloud_next;
+      base::samples::DepthMap depthmap_next;
       std::vector<utils::Vector> pointcloud_full; // Stores the full scan.
-      bool convertPointCloud;
-      int nextCloud;
       double vertical_resolution;
       bool update_available;
       bool full_scan;
@@ -222,9 +246,6 @@ namespace mars {
       bool closeThread;
       unsigned int num_points;
       base::samples::DepthMap finalDepthMap;
-      std::vector<base::samples::DepthMap> partialDepthMaps1; 
-      std::vector<base::samples::DepthMap> partialDepthMaps2;
-      std::vector<base::samples::DepthMap> *fromDepthMap, *toDepthMap;
       bool depthmap_sent;
     };
 
@@ -0,0 +1,349 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file LogReplay.cpp
+ * \brief Replays a recorded simulation log in the Viz.
+ *
+ */
+
+#include "LogReplay.h"
+#include "Viz.h"
+
+#include <mars/interfaces/graphics/GraphicsManagerInterface.h>
+#include <mars/interfaces/Logging.hpp>
+#include <mars/utils/MutexLocker.h>
+#include <mars/utils/misc.h>
+
+namespace mars {
+  namespace viz {
+
+    using namespace mars::utils;
+    using namespace mars::interfaces;
+    using data_broker::LogStream;
+
+    const double LogReplay::minSpeed = 0.1;
+    const double LogReplay::maxSpeed = 100.0;
+
+    // period of the GraphicsTimer in ms
+    static const double renderPeriod = 10.0;
+    // number of decoded frames kept ahead of the playback time
+    static const size_t maxFrames = 64;
+
+    LogReplay::LogReplay(Viz *viz, cfg_manager::CFGManagerInterface *cfg)
+      : viz(viz), cfg(cfg), startTime(0.0), endTime(0.0), logStep(0.0),
+        playing(false), speed(1.0), playStartTime(0.0), playStartWall(0),
+        decodeTime(0.0), decodeStep(renderPeriod), generation(0),
+        stopThread(false) {
+      if(cfg) {
+        cfgPlay = cfg->getOrCreateProperty("Replay", "play", false, this);
+        cfgSpeed = cfg->getOrCreateProperty("Replay", "speed", 1.0, this);
+        cfgTime = cfg->getOrCreateProperty("Replay", "time", 0.0, this);
+        speed = cfgSpeed.dValue;
+        if(speed < minSpeed) speed = minSpeed;
+        else if(speed > maxSpeed) speed = maxSpeed;
+      }
+    }
+
+    LogReplay::~LogReplay() {
+      if(cfg) cfg->unregisterFromCFG(this);
+      stopDecoder();
+    }
+
+    void LogReplay::stopDecoder() {
+      if(!this->isRunning()) return;
+      {
+        MutexLocker locker(&mutex);
+        stopThread = true;
+        wakeDecoder.wakeAll();
+      }
+      this->wait();
+      stopThread = false;
+    }
+
+    std::string LogReplay::stripIndex(const std::string &name,
+                                      const std::string &prefix) {
+      // the simulation names its streams "<prefix>%05lu_<name>"
+      if(name.compare(0, prefix.size(), prefix) != 0) return "";
+      size_t p = name.find('_', prefix.size());
+      if(p == std::string::npos) return "";
+      return name.substr(p+1);
+    }
+
+    bool LogReplay::open(const std::string &filename) {
+      stopDecoder();
+      MutexLocker locker(&mutex);
+      nodes.clear();
+      joints.clear();
+      frames.clear();
+      playing = false;
+      if(!reader.open(filename)) {
+        LOG_ERROR("LogReplay: could not open \"%s\"", filename.c_str());
+        return false;
+      }
+
+      static const char* nodeColumns[7] = {"position/x", "position/y",
+                                           "position/z", "rotation/x",
+                                           "rotation/y", "rotation/z",
+                                           "rotation/w"};
+      const std::vector<LogStream> &streams = reader.getStreams();
+      bool haveTime = false;
+      logStep = 0.0;
+      for(size_t i=0; i<streams.size(); ++i) {
+        const LogStream &stream = streams[i];
+        if(stream.groupName != "mars_sim" || stream.chunks.empty()) continue;
+        std::string name = stripIndex(stream.dataName, "Nodes/");
+        if(!name.empty()) {
+          // only nodes that are not attached to a parent draw object
+          // can be placed with absolute poses
+          replayNode node;
+          node.stream = i;
+          node.node = viz->getNode(name);
+          bool valid = (node.node != NULL);
+          for(int c=0; valid && c<7; ++c) {
+            node.columns[c] = reader.findColumn(i, nodeColumns[c]);
+            valid = (node.columns[c] >= 0);
+          }
+          if(!valid) continue;
+          nodes.push_back(node);
+        }
+        else {
+          name = stripIndex(stream.dataName, "Joints/");
+          if(name.empty()) continue;
+          replayJoint joint;
+          joint.stream = i;
+          joint.column = reader.findColumn(i, "axis1/angle");
+          joint.index = viz->getJointIndex(name);
+          if(joint.column < 0 || joint.index < 0) continue;
+          joints.push_back(joint);
+        }
+
+        double first = stream.chunks.front().firstTime;
+        double last = stream.chunks.back().lastTime;
+        if(!haveTime || first < startTime) startTime = first;
+        if(!haveTime || last > endTime) endTime = last;
+        haveTime = true;
+        if(stream.numRows > 1) {
+          double step = (last - first) / (stream.numRows - 1);
+          if(logStep <= 0.0 || step < logStep) logStep = step;
+        }
+      }
+
+      if(nodes.empty() && joints.empty()) {
+        LOG_ERROR("LogReplay: \"%s\" contains no streams of the scene",
+                  filename.c_str());
+        reader.close();
+        return false;
+      }
+      // joints that are not recorded keep their current value
+      std::vector<std::string> jointNames = viz->getJointNames();
+      jointValues.resize(jointNames.size());
+      for(size_t i=0; i<jointNames.size(); ++i) {
+        jointValues[i] = viz->getJoint(jointNames[i])->value;
+      }
+      LOG_INFO("LogReplay: %lu nodes, %lu joints, %g - %g ms",
+               (unsigned long)nodes.size(), (unsigned long)joints.size(),
+               startTime, endTime);
+
+      playStartTime = startTime;
+      restart(startTime);
+      this->start();
+      return true;
+    }
+
+    // called with the mutex locked
+    void LogReplay::restart(double timeMs) {
+      while(!frames.empty()) {
+        spareFrames.push_back(replayFrame());
+        spareFrames.back().transforms.swap(frames.front().transforms);
+        frames.pop_front();
+      }
+      decodeStep = speed*renderPeriod;
+      if(decodeStep < logStep) decodeStep = logStep;
+      decodeTime = timeMs;
+      ++generation;
+      wakeDecoder.wakeAll();
+    }
+
+    void LogReplay::play() {
+      MutexLocker locker(&mutex);
+      if(playing) return;
+      if(playStartTime >= endTime) {
+        playStartTime = startTime;
+        restart(startTime);
+      }
+      playStartWall = utils::getTime();
+      playing = true;
+    }
+
+    void LogReplay::pause() {
+      MutexLocker locker(&mutex);
+      if(!playing) return;
+      playStartTime += utils::getTimeDiff(playStartWall)*speed;
+      if(playStartTime > endTime) playStartTime = endTime;
+      playing = false;
+    }
+
+    void LogReplay::setSpeed(double speed_) {
+      if(speed_ < minSpeed) speed_ = minSpeed;
+      else if(speed_ > maxSpeed) speed_ = maxSpeed;
+      MutexLocker locker(&mutex);
+      long long now = utils::getTime();
+      if(playing) {
+        playStartTime += (now - playStartWall)*speed;
+        playStartWall = now;
+      }
+      speed = speed_;
+      // the frame interval depends on the speed
+      restart(playStartTime);
+    }
+
+    void LogReplay::seek(double timeMs) {
+      if(timeMs < startTime) timeMs = startTime;
+      else if(timeMs > endTime) timeMs = endTime;
+      MutexLocker locker(&mutex);
+      playStartTime = timeMs;
+      playStartWall = utils::getTime();
+      restart(timeMs);
+    }
+
+    double LogReplay::getTime() const {
+      MutexLocker locker(&mutex);
+      double time = playStartTime;
+      if(playing) time += utils::getTimeDiff(playStartWall)*speed;
+      return time > endTime ? endTime : time;
+    }
+
+    void LogReplay::preGraphicsUpdate(void) {
+      {
+        MutexLocker locker(&mutex);
+        double time = playStartTime;
+        if(playing) {
+          time += utils::getTimeDiff(playStartWall)*speed;
+          if(time >= endTime) {
+            time = playStartTime = endTime;
+            playing = false;
+          }
+        }
+        // the latest frame that is due replaces all older ones
+        bool due = false;
+        while(!frames.empty() && frames.front().time <= time) {
+          if(due) {
+            spareFrames.push_back(replayFrame());
+            spareFrames.back().transforms.swap(applyTransforms);
+          }
+          applyTransforms.swap(frames.front().transforms);
+          frames.pop_front();
+          due = true;
+        }
+        if(frames.empty() && decodeTime + decodeStep < time) {
+          // the decoder fell behind, continue at the playback time
+          decodeTime = time;
+          ++generation;
+        }
+        wakeDecoder.wakeOne();
+        if(!due) return;
+      }
+      viz->graphics->setDrawObjectTransforms(applyTransforms);
+      MutexLocker locker(&mutex);
+      spareFrames.push_back(replayFrame());
+      spareFrames.back().transforms.swap(applyTransforms);
+    }
+
+    void LogReplay::run() {
+      replayFrame frame;
+      MutexLocker locker(&mutex);
+      while(!stopThread) {
+        if(frames.size() >= maxFrames || decodeTime > endTime + decodeStep) {
+          wakeDecoder.wait(&mutex, 100);
+          continue;
+        }
+        unsigned long decodeGeneration = generation;
+        frame.time = decodeTime;
+        if(!spareFrames.empty()) {
+          frame.transforms.swap(spareFrames.back().transforms);
+          spareFrames.pop_back();
+        }
+        locker.unlock();
+        decodeFrame(frame.time, &frame);
+        locker.relock();
+        if(decodeGeneration == generation) {
+          frames.push_back(replayFrame());
+          frames.back().time = frame.time;
+          frames.back().transforms.swap(frame.transforms);
+          decodeTime = frame.time + decodeStep;
+        }
+      }
+    }
+
+    // reads the last row of the stream with a time <= time into rowValues
+    bool LogReplay::readRow(int stream, double time) {
+      uint64_t row = reader.findRow(stream, time);
+      double rowTime;
+      if(row >= reader.getNumRows(stream)) {
+        if(row == 0) return false;
+        --row;
+      }
+      if(!reader.getRow(stream, row, &rowTime, &rowValues)) return false;
+      if(rowTime > time && row > 0) {
+        return reader.getRow(stream, row-1, &rowTime, &rowValues);
+      }
+      return true;
+    }
+
+    void LogReplay::decodeFrame(double time, replayFrame *frame) {
+      for(size_t i=0; i<joints.size(); ++i) {
+        const replayJoint &joint = joints[i];
+        if(!readRow(joint.stream, time)) continue;
+        jointValues[joint.index] = rowValues[joint.column];
+      }
+      viz->computeJointTransforms(jointValues, &frame->transforms, NULL);
+
+      drawObjectTransform transform;
+      for(size_t i=0; i<nodes.size(); ++i) {
+        const replayNode &node = nodes[i];
+        if(!readRow(node.stream, time)) continue;
+        const int *c = node.columns;
+        Vector pos(rowValues[c[0]], rowValues[c[1]], rowValues[c[2]]);
+        Quaternion rot(rowValues[c[6]], rowValues[c[3]], rowValues[c[4]],
+                       rowValues[c[5]]);
+        viz->computeNodeTransform(*node.node, pos, rot, &transform);
+        frame->transforms.push_back(transform);
+      }
+    }
+
+    void LogReplay::cfgUpdateProperty(cfg_manager::cfgPropertyStruct _property) {
+      if(_property.paramId == cfgPlay.paramId) {
+        cfgPlay.bValue = _property.bValue;
+        if(_property.bValue) play();
+        else pause();
+      }
+      else if(_property.paramId == cfgSpeed.paramId) {
+        cfgSpeed.dValue = _property.dValue;
+        setSpeed(_property.dValue);
+      }
+      else if(_property.paramId == cfgTime.paramId) {
+        cfgTime.dValue = _property.dValue;
+        seek(_property.dValue);
+      }
+    }
+
+  } // end of namespace viz
+} // end of namespace mars
@@ -0,0 +1,163 @@
+/*
+ *  Copyright 2013, DFKI GmbH Robotics Innovation Center
+ *
+ *  This file is part of the MARS simulation framework.
+ *
+ *  MARS is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation, either version 3
+ *  of the License, or (at your option) any later version.
+ *
+ *  MARS is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with MARS.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/**
+ * \file LogReplay.h
+ * \brief Replays a recorded simulation log in the Viz.
+ *
+ */
+
+#ifndef MARS_VIZ_LOG_REPLAY_H
+#define MARS_VIZ_LOG_REPLAY_H
+
+#ifdef _PRINT_HEADER_
+  #warning "LogReplay.h"
+#endif
+
+#include <mars/interfaces/graphics/GraphicsUpdateInterface.h>
+#include <mars/interfaces/graphics/draw_structs.h>
+#include <mars/interfaces/NodeData.h>
+#include <mars/cfg_manager/CFGManagerInterface.h>
+#include <mars/data_broker/LogReader.h>
+#include <mars/utils/Thread.h>
+#include <mars/utils/Mutex.h>
+#include <mars/utils/WaitCondition.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace mars {
+  namespace viz {
+
+    class Viz;
+
+    /**
+     * \brief Plays back node poses and joint values recorded by the
+     * DataBrokerRecorder plugin.
+     *
+     * The "mars_sim" "Nodes/..." and "Joints/..." streams of the log are
+     * matched by name to the nodes and joints of the scene loaded in the
+     * Viz. A background thread samples the log on a time grid that depends
+     * on the replay speed, evaluates the kinematic tree of the Viz for the
+     * recorded joint values (see Viz::computeJointTransforms()), decodes
+     * the node samples into draw object transforms
+     * and keeps a bounded queue of frames ahead of the playback time. On each
+     * graphics update the latest due frame is handed to the graphics as one
+     * batch.
+     *
+     * Playback is controlled by the methods below or the cfg properties
+     * "Replay/play", "Replay/speed" (0.1 - 100) and "Replay/time" (ms, setting
+     * it seeks).
+     */
+    class LogReplay : public interfaces::GraphicsUpdateInterface,
+                      public cfg_manager::CFGClient,
+                      public utils::Thread {
+    public:
+      LogReplay(Viz *viz, cfg_manager::CFGManagerInterface *cfg);
+      ~LogReplay();
+
+      bool open(const std::string &filename);
+
+      void play();
+      void pause();
+      bool isPlaying() const {
+        return playing;
+      }
+      /// clamped to [minSpeed, maxSpeed]
+      void setSpeed(double speed);
+      void seek(double timeMs);
+      /// current replay time in ms
+      double getTime() const;
+      double getStartTime() const {
+        return startTime;
+      }
+      double getEndTime() const {
+        return endTime;
+      }
+
+      static const double minSpeed, maxSpeed;
+
+      // GraphicsUpdateInterface
+      virtual void preGraphicsUpdate(void);
+      // CFGClient
+      virtual void cfgUpdateProperty(cfg_manager::cfgPropertyStruct _property);
+
+    protected:
+      // prefetch thread
+      void run();
+
+    private:
+      struct replayNode {
+        int stream;
+        int columns[7]; // position x, y, z; rotation x, y, z, w
+        const interfaces::NodeData *node;
+      };
+
+      struct replayJoint {
+        int stream;
+        int column;
+        int index; ///< index in Viz::getJointNames()
+      };
+
+      struct replayFrame {
+        double time;
+        std::vector<interfaces::drawObjectTransform> transforms;
+      };
+
+      void decodeFrame(double time, replayFrame *frame);
+      bool readRow(int stream, double time);
+      void restart(double timeMs);
+      void stopDecoder();
+      static std::string stripIndex(const std::string &name,
+                                    const std::string &prefix);
+
+      Viz *viz;
+      cfg_manager::CFGManagerInterface *cfg;
+      cfg_manager::cfgPropertyStruct cfgPlay, cfgSpeed, cfgTime;
+      data_broker::LogReader reader;
+      std::vector<replayNode> nodes;
+      std::vector<replayJoint> joints;
+      double startTime, endTime;
+      double logStep; ///< smallest sample interval of the log in ms
+
+      // playback state and frame queue, guarded by mutex
+      mutable utils::Mutex mutex;
+      utils::WaitCondition wakeDecoder;
+      bool playing;
+      double speed;
+      double playStartTime; ///< replay time at playStartWall
+      long long playStartWall;
+      std::deque<replayFrame> frames;
+      std::vector<replayFrame> spareFrames;
+      double decodeTime, decodeStep;
+      unsigned long generation;
+      bool stopThread;
+
+      // only used by the graphics thread
+      std::vector<interfaces::drawObjectTransform> applyTransforms;
+      // only used by the prefetch thread
+      std::vector<double> rowValues, jointValues;
+    }; // end of class LogReplay
+
+  } // end of namespace viz
+} // end of namespace mars
+
+#endif // MARS_VIZ_LOG_REPLAY_H
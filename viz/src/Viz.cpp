@@ -25,10 +25,12 @@
  */
 
 #include "Viz.h"
+#include "LogReplay.h"
 
 #include <lib_manager/LibManager.hpp>
 #include <lib_manager/LibInterface.hpp>
 #include <mars/utils/misc.h>
+#include <mars/utils/MutexLocker.h>
 #include <mars/interfaces/graphics/GraphicsManagerInterface.h>
 #include <mars/cfg_manager/CFGManagerInterface.h>
 #include <mars/scene_loader/Load.h>
@@ -71,7 +73,7 @@ namespace mars {
     }
 
     Viz::Viz() : lib_manager::LibInterface(new lib_manager::LibManager()),
-                 configDir(".") {
+                 configDir("."), cfg(NULL), replay(NULL) {
 #ifdef WIN32
       // request a scheduler of 1ms
       timeBeginPeriod(1);
@@ -79,7 +81,8 @@ namespace mars {
     }
 
     Viz::Viz(lib_manager::LibManager *theManager) : lib_manager::LibInterface(theManager),
-                                                    configDir("."){
+                                                    configDir("."),
+                                                    cfg(NULL), replay(NULL) {
 #ifdef WIN32
       // request a scheduler of 1ms
       timeBeginPeriod(1);
@@ -90,6 +93,11 @@ namespace mars {
       //! close simulation
       exit_main(0);
 
+      if(replay) {
+        graphics->removeGraphicsUpdateInterface(replay);
+        delete replay;
+      }
+
       libManager->releaseLibrary("mars_graphics");
       libManager->releaseLibrary("cfg_manager");
 
@@ -126,7 +134,6 @@ namespace mars {
       libManager->addLibrary(this);
       libManager->loadConfigFile(coreConfigFile);
 
-      mars::cfg_manager::CFGManagerInterface *cfg;
       cfg = libManager->getLibraryAs<mars::cfg_manager::CFGManagerInterface>("cfg_manager", true);
       if(!cfg) {
         fprintf(stderr, "can not load needed library \"cfg_manager\".\n");
@@ -197,6 +204,16 @@ namespace mars {
       std::map<unsigned long, NodeData>::iterator it3;
       std::list<JointData> jointList;
       std::list<JointData>::iterator jointIt;
+      // scene node index -> index in links
+      std::map<unsigned long, int> linkIndex;
+
+      linkMutex.lock();
+      links.clear();
+      linkByDrawId.clear();
+      jointOrder.clear();
+      jointTransforms.clear();
+      linkPoses.clear();
+      linkMutex.unlock();
 
       for(unsigned int i=0; i<load.jointList.size(); ++i) {
         JointData joint;
@@ -280,6 +297,10 @@ namespace mars {
       it1 = nodeMapI.find(1);
       if(it1!=nodeMapI.end()) {
         nodeMapReady[it1->first] = it1->second;
+        // the root node keeps absolute poses like the unconnected nodes
+        nodeMapById[it1->second.index] = it1->second;
+        nodeMapByName[it1->second.name] = it1->second;
+        linkIndex[it1->first] = addLink(it1->second, -1, -1);
         nodeMapI.erase(it1);
 
         it1 = nodeMapReady.begin();
@@ -298,6 +319,7 @@ namespace mars {
                 graphics->makeChild(it1->second.index, it2->second.index);
                 graphics->setDrawObjectPos(node.index, node.pos);
                 graphics->setDrawObjectRot(node.index, node.rot);
+                linkIndex[it2->first] = addLink(node, linkIndex[it1->first], -1);
 
                 nodeMapReady[it2->first] = it2->second;
                 nodeMapI.erase(it2++);
@@ -375,6 +397,12 @@ namespace mars {
                   graphics->makeChild(it1->second.index, it2->second.index);
                   graphics->setDrawObjectPos(node.index, node.pos);
                   graphics->setDrawObjectRot(node.index, node.rot);
+                  linkMutex.lock();
+                  jointOrder.push_back(&jointMapByName[jointIt->name]);
+                  int jointIndex = jointOrder.size()-1;
+                  linkMutex.unlock();
+                  linkIndex[it2->first] = addLink(node, linkIndex[it1->first],
+                                                  jointIndex);
                   if(jointIt->type != JOINT_TYPE_FIXED) {
                     std::string packageName;
                     if(robotname.empty()) {
@@ -420,9 +448,24 @@ namespace mars {
       for(it1=nodeMapI.begin(); it1!=nodeMapI.end(); ++it1) {
         nodeMapById[it1->second.index] = it1->second;
         nodeMapByName[it1->second.name] = it1->second;
+        addLink(it1->second, -1, -1);
       }
     }
 
+    int Viz::addLink(const NodeData &node, int parent, int joint) {
+      KinematicLink link;
+      link.id = node.index;
+      link.parent = parent;
+      link.joint = joint;
+      link.pos = node.pos;
+      link.rot = node.rot;
+      link.pivot = node.pivot;
+      utils::MutexLocker locker(&linkMutex);
+      links.push_back(link);
+      linkByDrawId[link.id] = links.size()-1;
+      return links.size()-1;
+    }
+
 
     void Viz::setJointValue(std::string jointName, double value) {
       std::map<std::string, ForwardTransform>::iterator it;
@@ -439,17 +482,144 @@ namespace mars {
 
     void Viz::setJointValue(ForwardTransform *joint, double value) {
       joint->value = value;
-      if(joint->linear) {
-        utils::Vector v = joint->axis*joint->value + joint->relPos;
-        graphics->setDrawObjectPos(joint->id, joint->anchor+v);
+      drawObjectTransform transform;
+      computeJointTransform(*joint, value, &transform);
+      graphics->setDrawObjectPos(transform.id, transform.pos);
+      if(!joint->linear) {
+        graphics->setDrawObjectRot(transform.id, transform.rot);
+      }
+    }
+
+    void Viz::computeJointTransform(const ForwardTransform &joint, double value,
+                                    drawObjectTransform *transform) const {
+      transform->id = joint.id;
+      if(joint.linear) {
+        utils::Vector v = joint.axis*value + joint.relPos;
+        transform->pos = joint.anchor+v;
+        transform->rot = joint.q;
       }
       else {
-        utils::Quaternion q = utils::angleAxisToQuaternion(joint->value+joint->offset,
-                                                           joint->axis);
-        utils::Vector v = q * joint->relPos;
-        graphics->setDrawObjectPos(joint->id, joint->anchor+v);
-        graphics->setDrawObjectRot(joint->id, q * joint->q);
+        utils::Quaternion q = utils::angleAxisToQuaternion(value+joint.offset,
+                                                           joint.axis);
+        utils::Vector v = q * joint.relPos;
+        transform->pos = joint.anchor+v;
+        transform->rot = q * joint.q;
+      }
+    }
+
+    void Viz::computeNodeTransform(const NodeData &node,
+                                   const utils::Vector &pos,
+                                   const utils::Quaternion &rot,
+                                   drawObjectTransform *transform) const {
+      transform->id = node.index;
+      transform->pos = pos + rot * node.visual_offset_pos;
+      transform->rot = rot * node.visual_offset_rot;
+    }
+
+    const NodeData* Viz::getNode(const std::string &nodeName) const {
+      std::map<std::string, interfaces::NodeData>::const_iterator it;
+      it = nodeMapByName.find(nodeName);
+      if(it == nodeMapByName.end()) return NULL;
+      return &it->second;
+    }
+
+    const ForwardTransform* Viz::getJoint(const std::string &jointName) const {
+      std::map<std::string, ForwardTransform>::const_iterator it;
+      it = jointMapByName.find(jointName);
+      if(it == jointMapByName.end()) return NULL;
+      return &it->second;
+    }
+
+    void Viz::computeJointTransforms(const std::vector<double> &values,
+                                     std::vector<drawObjectTransform> *local,
+                                     std::vector<drawObjectTransform> *world) const {
+      utils::MutexLocker locker(&linkMutex);
+      evaluateLinks(values, local, world);
+    }
+
+    void Viz::evaluateLinks(const std::vector<double> &values,
+                            std::vector<drawObjectTransform> *local,
+                            std::vector<drawObjectTransform> *world) const {
+      // the links are stored in topological order, a parent is always
+      // evaluated before its children
+      local->resize(jointOrder.size());
+      if(world) world->resize(links.size());
+      for(size_t i=0; i<links.size(); ++i) {
+        const KinematicLink &link = links[i];
+        const utils::Vector *pos = &link.pos;
+        const utils::Quaternion *rot = &link.rot;
+        if(link.joint >= 0) {
+          const ForwardTransform &joint = *jointOrder[link.joint];
+          double value = ((size_t)link.joint < values.size() ?
+                          values[link.joint] : joint.value);
+          drawObjectTransform &transform = (*local)[link.joint];
+          computeJointTransform(joint, value, &transform);
+          pos = &transform.pos;
+          rot = &transform.rot;
+        }
+        if(!world) continue;
+        drawObjectTransform &pose = (*world)[i];
+        pose.id = link.id;
+        if(link.parent < 0) {
+          pose.pos = *pos;
+          pose.rot = *rot;
+        }
+        else {
+          const drawObjectTransform &parent = (*world)[link.parent];
+          pose.pos = parent.pos + parent.rot*(*pos - links[link.parent].pivot);
+          pose.rot = parent.rot * *rot;
+        }
+      }
+    }
+
+    void Viz::setJointValues(const std::vector<double> &values) {
+      utils::MutexLocker locker(&linkMutex);
+      for(size_t i=0; i<values.size() && i<jointOrder.size(); ++i) {
+        jointOrder[i]->value = values[i];
+      }
+      evaluateLinks(values, &jointTransforms, &linkPoses);
+      graphics->setDrawObjectTransforms(jointTransforms);
+    }
+
+    std::vector<std::string> Viz::getJointNames() const {
+      utils::MutexLocker locker(&linkMutex);
+      std::vector<std::string> names(jointOrder.size());
+      for(size_t i=0; i<jointOrder.size(); ++i) {
+        names[i] = jointOrder[i]->name;
+      }
+      return names;
+    }
+
+    int Viz::getJointIndex(const std::string &jointName) const {
+      utils::MutexLocker locker(&linkMutex);
+      for(size_t i=0; i<jointOrder.size(); ++i) {
+        if(jointOrder[i]->name == jointName) return i;
+      }
+      return -1;
+    }
+
+    bool Viz::getLinkPose(unsigned long id, utils::Vector *pos,
+                          utils::Quaternion *rot) const {
+      utils::MutexLocker locker(&linkMutex);
+      std::map<unsigned long, int>::const_iterator it = linkByDrawId.find(id);
+      if(it == linkByDrawId.end() || (size_t)it->second >= linkPoses.size()) {
+        return false;
+      }
+      *pos = linkPoses[it->second].pos;
+      *rot = linkPoses[it->second].rot;
+      return true;
+    }
+
+    void Viz::setTransforms(const std::vector<drawObjectTransform> &transforms) {
+      graphics->setDrawObjectTransforms(transforms);
+    }
+
+    bool Viz::replayLog(const std::string &filename) {
+      if(!replay) {
+        replay = new LogReplay(this, cfg);
+        graphics->addGraphicsUpdateInterface(replay);
       }
+      return replay->open(filename);
     }
 
     void Viz::setNodePosition(const std::string &nodeName, const utils::Vector &pos) {
@@ -462,6 +632,9 @@ namespace mars {
 
     void Viz::setNodePosition(const unsigned long &id, const utils::Vector &pos) {
       graphics->setDrawObjectPos(id, pos);
+      utils::MutexLocker locker(&linkMutex);
+      std::map<unsigned long, int>::iterator it = linkByDrawId.find(id);
+      if(it != linkByDrawId.end()) links[it->second].pos = pos;
     }
 
     void Viz::setNodeOrientation(const std::string &nodeName, const utils::Quaternion &q) {
@@ -474,6 +647,9 @@ namespace mars {
 
     void Viz::setNodeOrientation(const unsigned long &id, const utils::Quaternion &q) {
       graphics->setDrawObjectRot(id, q);
+      utils::MutexLocker locker(&linkMutex);
+      std::map<unsigned long, int>::iterator it = linkByDrawId.find(id);
+      if(it != linkByDrawId.end()) links[it->second].rot = q;
     }
 
     void Viz::receiveData(const data_broker::DataInfo& info,
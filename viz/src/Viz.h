@@ -35,7 +35,10 @@
 #include <lib_manager/LibInterface.hpp>
 #include <mars/interfaces/sim/ControlCenter.h>
 #include <mars/interfaces/NodeData.h>
+#include <mars/interfaces/graphics/draw_structs.h>
 #include <mars/data_broker/ReceiverInterface.h>
+#include <mars/cfg_manager/CFGManagerInterface.h>
+#include <mars/utils/Mutex.h>
 
 namespace mars {
 
@@ -53,6 +56,8 @@ namespace mars {
       std::string name;
     };
 
+    class LogReplay;
+
     void exit_main(int signal);
 
     class Viz : public lib_manager::LibInterface,
@@ -81,6 +86,61 @@ namespace mars {
                               const utils::Quaternion &q);
       void setNodeOrientation(const unsigned long &id,
                               const utils::Quaternion &q);
+      /// sets the poses of several draw objects in one graphics update
+      void setTransforms(const std::vector<interfaces::drawObjectTransform> &transforms);
+
+      /// returns the root node or a node without parent, NULL otherwise
+      const interfaces::NodeData* getNode(const std::string &nodeName) const;
+      const ForwardTransform* getJoint(const std::string &jointName) const;
+      /**
+       * \brief Computes the draw object pose of a node from its physical
+       * pose; does not change the graphics.
+       */
+      void computeNodeTransform(const interfaces::NodeData &node,
+                                const utils::Vector &pos,
+                                const utils::Quaternion &rot,
+                                interfaces::drawObjectTransform *transform) const;
+      /**
+       * \brief Computes the draw object pose of the node moved by the
+       * joint for the given joint value; does not change the graphics.
+       */
+      void computeJointTransform(const ForwardTransform &joint, double value,
+                                 interfaces::drawObjectTransform *transform) const;
+
+      /**
+       * \brief Sets all joint values at once. The joint poses of the whole
+       * kinematic tree are evaluated in one pass and handed to the graphics
+       * as one batch.
+       * \param values joint values in the order of getJointNames(), missing
+       * values keep the current joint value
+       */
+      void setJointValues(const std::vector<double> &values);
+      /// joints in the topological order of the last loaded kinematic tree
+      std::vector<std::string> getJointNames() const;
+      /// index of the joint in getJointNames() or -1
+      int getJointIndex(const std::string &jointName) const;
+      /**
+       * \brief Evaluates the kinematic tree without changing the graphics.
+       * \param local receives the parent relative pose of the draw object
+       * moved by each joint, in the order of getJointNames()
+       * \param world if not NULL, receives the world poses of all draw
+       * objects of the tree
+       */
+      void computeJointTransforms(const std::vector<double> &values,
+                                  std::vector<interfaces::drawObjectTransform> *local,
+                                  std::vector<interfaces::drawObjectTransform> *world) const;
+      /// world pose of a draw object as of the last setJointValues() call
+      bool getLinkPose(unsigned long id, utils::Vector *pos,
+                       utils::Quaternion *rot) const;
+
+      /**
+       * \brief Replays a log of the DataBrokerRecorder plugin on the loaded
+       * scene, see LogReplay.
+       */
+      bool replayLog(const std::string &filename);
+      LogReplay* getLogReplay() {
+        return replay;
+      }
 
       interfaces::GraphicsManagerInterface *graphics;
 
@@ -90,6 +150,16 @@ namespace mars {
 
 
     private:
+      /// one draw object of the kinematic tree
+      struct KinematicLink {
+        unsigned long id;
+        int parent; ///< index in links, -1 for nodes with absolute poses
+        int joint; ///< index in jointOrder, -1 for fixed relations
+        utils::Vector pos; ///< pose relative to the parent
+        utils::Quaternion rot;
+        utils::Vector pivot;
+      };
+
       std::string configDir;
 
       std::map<unsigned long, interfaces::NodeData> nodeMapById;
@@ -98,9 +168,22 @@ namespace mars {
       std::map<unsigned long, ForwardTransform*> jointMapById;
       std::map<unsigned long, ForwardTransform*> jointMapByNodeId;
       std::vector<ForwardTransform*> jointByControllerIdx;
+      // the kinematic tree of the last loaded scene; guarded by linkMutex
+      // since the log replay evaluates it in its own thread
+      std::vector<KinematicLink> links; ///< parents before children
+      std::map<unsigned long, int> linkByDrawId;
+      std::vector<ForwardTransform*> jointOrder;
+      std::vector<interfaces::drawObjectTransform> jointTransforms, linkPoses;
+      mutable utils::Mutex linkMutex;
       interfaces::ControlCenter *control;
+      cfg_manager::CFGManagerInterface *cfg;
+      LogReplay *replay;
 
       void setJointValue(ForwardTransform *joint, double value);
+      int addLink(const interfaces::NodeData &node, int parent, int joint);
+      void evaluateLinks(const std::vector<double> &values,
+                         std::vector<interfaces::drawObjectTransform> *local,
+                         std::vector<interfaces::drawObjectTransform> *world) const;
 
     };
 
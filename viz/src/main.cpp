@@ -19,6 +19,7 @@
  */
 
 #include "Viz.h"
+#include "LogReplay.h"
 #include "GraphicsTimer.h"
 #include "MyApp.h"
 
@@ -68,6 +69,10 @@ int main(int argc, char *argv[]) {
 
   if(argc > 2) {
     viz->loadScene(argv[2], argv[1]);
+    // optional log of the DataBrokerRecorder to replay on the scene
+    if(argc > 3 && viz->replayLog(argv[3])) {
+      viz->getLogReplay()->play();
+    }
   }
   else if(argc > 1) {
     viz->loadScene(argv[1]);